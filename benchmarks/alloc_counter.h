@@ -0,0 +1,9 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+
+// Number of global operator new calls made by the process so far
+size_t getAllocationCount();
+
+#endif  // ALLOC_COUNTER_H
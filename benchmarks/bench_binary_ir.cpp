@@ -0,0 +1,201 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IR.h"
+#include "binary_ir.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "mem2reg.h"
+
+namespace {
+
+// SSA form of a random loop program; about 14 instructions per block
+std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+std::string writeInput(const Graph& g, unsigned num_blocks) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("bench_binary_ir_" + std::to_string(num_blocks) + ".bin"))
+                           .string();
+    BinaryIRWriter writer(&g);
+    if (!writer.writeFile(path)) {
+        std::fprintf(stderr, "%s\n", writer.getError().c_str());
+    }
+    return path;
+}
+
+// What a loader without the format would do: rebuild every block and instruction of src
+// through createInst, patching operands defined later in block order
+void cloneGraph(const Graph& src, Graph& dst) {
+    std::vector<BasicBlock*> blocks;
+    for (BasicBlock* bb : src.getBasicBlocks()) {
+        blocks.push_back(dst.createBB(bb->getName()));
+    }
+    AllocaInst placeholder(~0u);
+    std::vector<Inst*> insts(src.getNumInsts(), nullptr);
+    std::vector<std::pair<Inst*, const Inst*>> forward_refs;  // (copy, original)
+    auto value = [&](const Inst* inst) {
+        Inst* copy = insts[inst->getId()];
+        return copy != nullptr ? copy : &placeholder;
+    };
+    for (BasicBlock* bb : src.getBasicBlocks()) {
+        BasicBlock* copy_bb = blocks[bb->getId()];
+        for (Inst* inst : bb->getInstructions()) {
+            Inst* copy = nullptr;
+            switch (inst->getOpcode()) {
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP:
+                    copy = dst.createInst<BinaryInst>(copy_bb, inst->getOpcode(),
+                                                      value(inst->getOperand(0)),
+                                                      value(inst->getOperand(1)));
+                    break;
+                case Opcode::JUMP:
+                    copy = dst.createInst<JumpInst>(
+                        copy_bb, blocks[static_cast<JumpInst*>(inst)->getTarget()->getId()]);
+                    break;
+                case Opcode::COND_JUMP: {
+                    auto* jump = static_cast<CondJumpInst*>(inst);
+                    copy = dst.createInst<CondJumpInst>(
+                        copy_bb, value(inst->getOperand(0)),
+                        blocks[jump->getTrueTarget()->getId()],
+                        blocks[jump->getFalseTarget()->getId()]);
+                    break;
+                }
+                case Opcode::RETURN:
+                    copy = dst.createInst<ReturnInst>(
+                        copy_bb,
+                        inst->getNumOperands() == 0 ? nullptr : value(inst->getOperand(0)));
+                    break;
+                case Opcode::PHI: {
+                    auto* phi = static_cast<PhiInst*>(inst);
+                    auto* copy_phi = dst.createInst<PhiInst>(copy_bb);
+                    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+                        copy_phi->addIncoming(value(phi->getIncomingValue(i)),
+                                              blocks[phi->getIncomingBlock(i)->getId()]);
+                    }
+                    copy = copy_phi;
+                    break;
+                }
+                case Opcode::PARAM:
+                    copy = dst.createInst<ParamInst>(copy_bb,
+                                                     static_cast<ParamInst*>(inst)->getIndex());
+                    break;
+                case Opcode::CONST:
+                    copy = dst.createInst<ConstInst>(copy_bb,
+                                                     static_cast<ConstInst*>(inst)->getValue());
+                    break;
+                default:
+                    break;  // No memory operations are left after Mem2Reg
+            }
+            insts[inst->getId()] = copy;
+            for (unsigned i = 0; i < copy->getNumOperands(); ++i) {
+                if (copy->getOperand(i) == &placeholder) {
+                    forward_refs.emplace_back(copy, inst);
+                    break;
+                }
+            }
+        }
+    }
+    for (auto [copy, inst] : forward_refs) {
+        for (unsigned i = 0; i < copy->getNumOperands(); ++i) {
+            copy->setOperand(i, insts[inst->getOperand(i)->getId()]);
+        }
+    }
+    dst.setStartBlock(blocks[src.getStartBlock()->getId()]);
+    dst.buildPredecessors();
+}
+
+}  // namespace
+
+// Map and validate the file, then read every operand through the view
+static void BM_BinaryIRView(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    std::string path = writeInput(*g, state.range(0));
+    unsigned num_insts = 0;
+    for (auto _ : state) {
+        BinaryIRView view;
+        if (!view.openFile(path)) {
+            state.SkipWithError(view.getError().c_str());
+            break;
+        }
+        uint64_t sum = 0;
+        num_insts = view.getNumInsts();
+        for (unsigned id = 0; id < num_insts; ++id) {
+            for (uint32_t op : view.getOperands(id)) {
+                sum += op;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_BinaryIRView)->Arg(1000)->Arg(70000)->Unit(benchmark::kMillisecond);
+
+// Map the file and build a Graph from it; destroying the graph is not timed
+static void BM_BinaryIRMaterialize(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    std::string path = writeInput(*g, state.range(0));
+    unsigned num_insts = 0;
+    for (auto _ : state) {
+        auto copy = std::make_unique<Graph>("copy");
+        BinaryIRView view;
+        if (!view.openFile(path) || !view.materialize(*copy)) {
+            state.SkipWithError(view.getError().c_str());
+            break;
+        }
+        num_insts = copy->getNumInsts();
+        state.PauseTiming();
+        copy.reset();
+        state.ResumeTiming();
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_BinaryIRMaterialize)->Arg(1000)->Arg(70000)->Unit(benchmark::kMillisecond);
+
+// Baseline: the same graph rebuilt from memory through createInst, without any I/O
+static void BM_RebuildWithCreateInst(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    unsigned num_insts = 0;
+    for (auto _ : state) {
+        auto copy = std::make_unique<Graph>("copy");
+        cloneGraph(*g, *copy);
+        num_insts = copy->getNumInsts();
+        state.PauseTiming();
+        copy.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_RebuildWithCreateInst)->Arg(1000)->Arg(70000)->Unit(benchmark::kMillisecond);
+
+static void BM_BinaryIRWrite(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    std::vector<uint8_t> bytes;
+    for (auto _ : state) {
+        BinaryIRWriter writer(g.get());
+        writer.write(bytes);
+        benchmark::DoNotOptimize(bytes.data());
+    }
+    size_t num_insts = 0;
+    for (BasicBlock* bb : g->getBasicBlocks()) {
+        num_insts += bb->getInstructions().size();
+    }
+    state.counters["bytes"] = bytes.size();
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_BinaryIRWrite)->Arg(1000)->Arg(70000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include "IR.h"
+#include "cfg_generators.h"
+
+// What BasicBlock::getSuccessors() used to do: build a fresh vector on every call
+static std::vector<BasicBlock*> copySuccessors(const BasicBlock* bb) {
+    auto successors = bb->getSuccessors();
+    return std::vector<BasicBlock*>(successors.begin(), successors.end());
+}
+
+static void BM_EdgeWalkVector(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0));
+    for (auto _ : state) {
+        unsigned checksum = 0;
+        for (auto* bb : g.getBasicBlocks()) {
+            for (auto* succ : copySuccessors(bb)) {
+                checksum += succ->getId();
+            }
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(state.iterations() * g.getEdgeTable().getNumEdges());
+}
+BENCHMARK(BM_EdgeWalkVector)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_EdgeWalkSpan(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0));
+    for (auto _ : state) {
+        unsigned checksum = 0;
+        for (auto* bb : g.getBasicBlocks()) {
+            for (auto* succ : bb->getSuccessors()) {
+                checksum += succ->getId();
+            }
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(state.iterations() * g.getEdgeTable().getNumEdges());
+}
+BENCHMARK(BM_EdgeWalkSpan)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_EdgeWalkTable(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0));
+    const CFGEdgeTable& edges = g.getEdgeTable();
+    for (auto _ : state) {
+        unsigned checksum = 0;
+        for (unsigned id = 0; id < edges.getNumBlocks(); ++id) {
+            for (unsigned succ : edges.getSuccessors(id)) {
+                checksum += succ;
+            }
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(state.iterations() * edges.getNumEdges());
+}
+BENCHMARK(BM_EdgeWalkTable)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_BuildPredecessors(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0));
+    for (auto _ : state) {
+        g.buildPredecessors();
+        benchmark::DoNotOptimize(g.getEdgeTable().getNumEdges());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildPredecessors)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
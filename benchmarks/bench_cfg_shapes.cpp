@@ -0,0 +1,148 @@
+#include <benchmark/benchmark.h>
+
+#include <ostream>
+#include <random>
+#include <streambuf>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+
+// The core graph operations across CFG shapes of comparable size. The argument is the
+// approximate number of blocks; items are blocks, so that shapes compare per block.
+
+namespace {
+
+enum class Shape { Reducible, Irreducible, Chain, SwitchTree, Factorials };
+
+void buildShape(Graph& g, Shape shape, unsigned num_blocks) {
+    switch (shape) {
+        case Shape::Reducible:
+            buildReducibleCFG(g, num_blocks);
+            break;
+        case Shape::Irreducible:
+            buildIrreducibleCFG(g, num_blocks / 3);
+            break;
+        case Shape::Chain:
+            buildChainCFG(g, num_blocks);
+            break;
+        case Shape::SwitchTree:
+            buildSwitchTreeCFG(g, num_blocks / 2);
+            break;
+        case Shape::Factorials:
+            buildFactorialChain(g, num_blocks / 3);
+            break;
+    }
+}
+
+// Counts what dump writes without keeping it, so that only formatting is measured
+class CountingBuf : public std::streambuf {
+   public:
+    size_t getCount() const {
+        return count_;
+    }
+
+   protected:
+    int overflow(int c) override {
+        ++count_;
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        count_ += n;
+        return n;
+    }
+
+   private:
+    size_t count_ = 0;
+};
+
+}  // namespace
+
+// Building every block and instruction, including the final buildPredecessors
+template <Shape S>
+static void BM_Build(benchmark::State& state) {
+    size_t num_blocks = 0;
+    for (auto _ : state) {
+        Graph g("bench");
+        buildShape(g, S, state.range(0));
+        num_blocks = g.getBasicBlocks().size();
+        benchmark::DoNotOptimize(g.getStartBlock());
+    }
+    state.SetItemsProcessed(state.iterations() * num_blocks);
+}
+
+template <Shape S>
+static void BM_BuildPredecessors(benchmark::State& state) {
+    Graph g("bench");
+    buildShape(g, S, state.range(0));
+    for (auto _ : state) {
+        g.buildPredecessors();
+        benchmark::DoNotOptimize(g.getStartBlock());
+    }
+    state.SetItemsProcessed(state.iterations() * g.getBasicBlocks().size());
+}
+
+template <Shape S>
+static void BM_DominatorTreeRun(benchmark::State& state) {
+    Graph g("bench");
+    buildShape(g, S, state.range(0));
+    for (auto _ : state) {
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        benchmark::DoNotOptimize(dom_tree.getImmediateDominator(g.getBasicBlocks().back()));
+    }
+    state.SetItemsProcessed(state.iterations() * g.getBasicBlocks().size());
+}
+
+// 4096 random (A, B) dominance queries; items are queries
+template <Shape S>
+static void BM_Dominates(benchmark::State& state) {
+    Graph g("bench");
+    buildShape(g, S, state.range(0));
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    const auto& blocks = g.getBasicBlocks();
+    std::mt19937 rng(7);
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> queries(4096);
+    for (auto& query : queries) {
+        query = {blocks[rng() % blocks.size()], blocks[rng() % blocks.size()]};
+    }
+    for (auto _ : state) {
+        for (auto& [a, b] : queries) {
+            benchmark::DoNotOptimize(dom_tree.dominates(a, b));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <Shape S>
+static void BM_Dump(benchmark::State& state) {
+    Graph g("bench");
+    buildShape(g, S, state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        CountingBuf buf;
+        std::ostream os(&buf);
+        g.dump(os);
+        bytes += buf.getCount();
+    }
+    state.SetBytesProcessed(bytes);
+    state.SetItemsProcessed(state.iterations() * g.getBasicBlocks().size());
+}
+
+#define SHAPE_BENCHMARK(name, shape) \
+    BENCHMARK_TEMPLATE(name, Shape::shape)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond)
+
+#define SHAPE_BENCHMARKS(shape)                   \
+    SHAPE_BENCHMARK(BM_Build, shape);             \
+    SHAPE_BENCHMARK(BM_BuildPredecessors, shape); \
+    SHAPE_BENCHMARK(BM_DominatorTreeRun, shape);  \
+    SHAPE_BENCHMARK(BM_Dominates, shape);         \
+    SHAPE_BENCHMARK(BM_Dump, shape)
+
+SHAPE_BENCHMARKS(Reducible);
+SHAPE_BENCHMARKS(Irreducible);
+SHAPE_BENCHMARKS(Chain);
+SHAPE_BENCHMARKS(SwitchTree);
+SHAPE_BENCHMARKS(Factorials);
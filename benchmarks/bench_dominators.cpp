@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "legacy_dominators.h"
+
+template <typename Tree>
+static void BM_DominatorTree(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0));
+    for (auto _ : state) {
+        Tree dom_tree(&g);
+        dom_tree.run();
+        benchmark::DoNotOptimize(dom_tree.getImmediateDominator(g.getBasicBlocks().back()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_DominatorTree, MapDominatorTree)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(50000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DominatorTree, DominatorTree)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(50000)
+    ->Unit(benchmark::kMillisecond);
+
+// Random (A, B) dominance queries on a sparse-branching CFG, whose dominator tree is deep
+template <typename Tree>
+static void BM_DominatesQuery(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0), /*branch_percent=*/10);
+    Tree dom_tree(&g);
+    dom_tree.run();
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<unsigned> pick(0, state.range(0) - 1);
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> queries(4096);
+    for (auto& query : queries) {
+        query = {g.getBasicBlocks()[pick(rng)], g.getBasicBlocks()[pick(rng)]};
+    }
+    for (auto _ : state) {
+        for (auto& [a, b] : queries) {
+            benchmark::DoNotOptimize(dom_tree.dominates(a, b));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK_TEMPLATE(BM_DominatesQuery, MapDominatorTree)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_DominatesQuery, DominatorTree)->Arg(10000)->Arg(1000000);
+
+static void BM_NearestCommonDominator(benchmark::State& state) {
+    Graph g("bench");
+    buildRandomCFG(g, state.range(0), /*branch_percent=*/10);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<unsigned> pick(0, state.range(0) - 1);
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> queries(4096);
+    for (auto& query : queries) {
+        query = {g.getBasicBlocks()[pick(rng)], g.getBasicBlocks()[pick(rng)]};
+    }
+    for (auto _ : state) {
+        for (auto& [a, b] : queries) {
+            benchmark::DoNotOptimize(dom_tree.findNearestCommonDominator(a, b));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_NearestCommonDominator)->Arg(10000)->Arg(1000000);
+
+enum class CFGShape { Reducible, Irreducible, Ladder };
+
+template <CFGShape Shape, DomAlgorithm Algorithm>
+static void BM_DomAlgorithm(benchmark::State& state) {
+    Graph g("bench");
+    switch (Shape) {
+        case CFGShape::Reducible:
+            buildReducibleCFG(g, state.range(0));
+            break;
+        case CFGShape::Irreducible:
+            buildRandomCFG(g, state.range(0));
+            break;
+        case CFGShape::Ladder:
+            buildLadderCFG(g, state.range(0));
+            break;
+    }
+    for (auto _ : state) {
+        DominatorTree dom_tree(&g, Algorithm);
+        dom_tree.run();
+        benchmark::DoNotOptimize(dom_tree.getImmediateDominator(g.getBasicBlocks().back()));
+    }
+    state.SetItemsProcessed(state.iterations() * g.getBasicBlocks().size());
+}
+
+#define DOM_ALGORITHM_BENCHMARK(shape, algorithm, max_blocks)                      \
+    BENCHMARK_TEMPLATE(BM_DomAlgorithm, CFGShape::shape, DomAlgorithm::algorithm) \
+        ->RangeMultiplier(10)                                                      \
+        ->Range(10, max_blocks)                                                    \
+        ->Unit(benchmark::kMicrosecond)
+
+DOM_ALGORITHM_BENCHMARK(Reducible, CooperHarveyKennedy, 1000000);
+DOM_ALGORITHM_BENCHMARK(Reducible, SemiNCA, 1000000);
+DOM_ALGORITHM_BENCHMARK(Irreducible, CooperHarveyKennedy, 1000000);
+DOM_ALGORITHM_BENCHMARK(Irreducible, SemiNCA, 1000000);
+// The iterative algorithm needs O(rungs) passes on a ladder: 1M blocks take minutes
+DOM_ALGORITHM_BENCHMARK(Ladder, CooperHarveyKennedy, 100000);
+DOM_ALGORITHM_BENCHMARK(Ladder, SemiNCA, 1000000);
+
+// Points the true edge of `count` random CondJumps at random blocks and returns the edge
+// updates describing the change
+static std::vector<CFGUpdate> retargetRandomEdges(Graph& g, unsigned count, std::mt19937& rng) {
+    const auto& blocks = g.getBasicBlocks();
+    std::vector<CFGUpdate> updates;
+    while (count > 0) {
+        Inst* term = blocks[rng() % blocks.size()]->getTerminator();
+        if (term == nullptr || term->getOpcode() != Opcode::COND_JUMP) {
+            continue;
+        }
+        auto* jump = static_cast<CondJumpInst*>(term);
+        BasicBlock* target = blocks[rng() % blocks.size()];
+        BasicBlock* old_target = jump->getTrueTarget();
+        jump->setTrueTarget(target);
+        if (old_target != jump->getFalseTarget()) {
+            updates.push_back({CFGUpdateKind::Delete, jump->getParent(), old_target});
+        }
+        if (target != jump->getFalseTarget()) {
+            updates.push_back({CFGUpdateKind::Insert, jump->getParent(), target});
+        }
+        --count;
+    }
+    return updates;
+}
+
+// Repairing the tree after a batch of random edits: applyUpdates() against the
+// buildPredecessors() + run() it replaces. Args: blocks, edits per batch.
+template <bool Incremental>
+static void BM_DomUpdateBatch(benchmark::State& state) {
+    Graph g("bench");
+    buildReducibleCFG(g, state.range(0));
+    DominatorTree dom_tree(&g, DomAlgorithm::SemiNCA);
+    dom_tree.run();
+
+    std::mt19937 rng(7);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<CFGUpdate> updates = retargetRandomEdges(g, state.range(1), rng);
+        state.ResumeTiming();
+        if (Incremental) {
+            dom_tree.applyUpdates(updates);
+        } else {
+            g.buildPredecessors();
+            dom_tree.run();
+        }
+        benchmark::DoNotOptimize(dom_tree.getImmediateDominator(g.getBasicBlocks().back()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK_TEMPLATE(BM_DomUpdateBatch, true)
+    ->ArgsProduct({{100000}, {1, 10, 100}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DomUpdateBatch, false)
+    ->ArgsProduct({{100000}, {1, 10, 100}})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+
+#include "IR.h"
+#include "alloc_counter.h"
+
+// Builds a chain of factorial-like blocks until the graph holds `num_insts` instructions
+static void buildStraightLineGraph(Graph& g, size_t num_insts) {
+    BasicBlock* bb = g.createBB("entry");
+    g.setStartBlock(bb);
+    Inst* acc = g.createInst<ParamInst>(bb, 0);
+    size_t emitted = 1;
+    while (emitted + 5 < num_insts) {
+        Inst* one = g.createInst<ConstInst>(bb, 1);
+        Inst* sum = g.createInst<BinaryInst>(bb, Opcode::ADD, acc, one);
+        acc = g.createInst<BinaryInst>(bb, Opcode::MUL, sum, acc);
+        BasicBlock* next = g.createBB();
+        g.createInst<JumpInst>(bb, next);
+        emitted += 4;
+        bb = next;
+    }
+    g.createInst<ReturnInst>(bb, acc);
+}
+
+static void BM_GraphBuild(benchmark::State& state) {
+    size_t num_insts = state.range(0);
+    size_t allocations = 0;
+    for (auto _ : state) {
+        size_t before = getAllocationCount();
+        Graph g("bench");
+        buildStraightLineGraph(g, num_insts);
+        allocations += getAllocationCount() - before;
+        benchmark::DoNotOptimize(g.getStartBlock());
+    }
+    state.counters["allocs_per_inst"] =
+        benchmark::Counter(double(allocations) / (double(num_insts) * state.iterations()));
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_GraphBuild)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
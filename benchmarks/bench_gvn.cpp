@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "gvn.h"
+#include "mem2reg.h"
+
+// GVN over range(0) factorial loops in a row, whose loop constants repeat the ones before
+// them, and over the SSA form of a random loop program with range(0) blocks. Inputs are
+// rebuilt outside the timed region; items are instructions, so equal rates at all sizes
+// mean linear time.
+static void runGVN(benchmark::State& state, bool factorial_chain) {
+    size_t num_insts = 0;
+    unsigned eliminated = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = std::make_unique<Graph>("bench");
+        if (factorial_chain) {
+            buildFactorialChain(*g, state.range(0));
+        } else {
+            buildRandomLoopProgram(*g, state.range(0), /*num_vars=*/16, /*trip_count=*/4);
+        }
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        Mem2Reg(g.get(), dom_tree).run();
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        GVN gvn(g.get(), dom_tree);
+        benchmark::DoNotOptimize(gvn.run());
+        eliminated = gvn.getNumEliminated();
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+    state.counters["eliminated"] = eliminated;
+}
+
+static void BM_GVNFactorialChain(benchmark::State& state) {
+    runGVN(state, true);
+}
+BENCHMARK(BM_GVNFactorialChain)->Arg(1000)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_GVNLoopProgram(benchmark::State& state) {
+    runGVN(state, false);
+}
+BENCHMARK(BM_GVNLoopProgram)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Cost of hash-consing while building: range(0) factorial loops with consing off (0) or on (1)
+static void BM_BuildHashConsed(benchmark::State& state) {
+    for (auto _ : state) {
+        Graph g("bench");
+        g.setHashConsing(state.range(1) != 0);
+        buildFactorialChain(g, state.range(0));
+        benchmark::DoNotOptimize(g.getNumInsts());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildHashConsed)->Args({10000, 0})->Args({10000, 1})->Unit(benchmark::kMillisecond);
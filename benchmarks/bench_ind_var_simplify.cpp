@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "ind_var_simplify.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "loop_info.h"
+#include "mem2reg.h"
+
+// Random nest of counted loops with range(0) blocks, in SSA form
+static std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+// The pass including its induction variable analysis; the input is rebuilt outside the timed
+// region. Items are instructions.
+static void BM_IndVarSimplify(benchmark::State& state) {
+    size_t num_insts = 0;
+    unsigned exit_values = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = buildInput(state.range(0));
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        LoopInfo loops(g.get(), dom_tree);
+        loops.run();
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        IndVarSimplify indvars(g.get(), loops, dom_tree);
+        indvars.run();
+        exit_values = indvars.getNumExitValuesReplaced();
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+    state.counters["exit_values"] = exit_values;
+}
+BENCHMARK(BM_IndVarSimplify)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// sum += param + 8 * i for i = 0..trips-1, then return sum + i: a strided access pattern.
+// The pass turns 8 * i into a phi stepping by 8, moves the exit test onto it, deletes i and
+// returns its constant exit value.
+static void buildStridedSum(Graph& g, int64_t trips) {
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("header");
+    BasicBlock* body = g.createBB("body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* base = g.createInst<ParamInst>(entry, 0);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    Inst* stride = g.createInst<ConstInst>(entry, 8);
+    Inst* last = g.createInst<ConstInst>(entry, trips - 1);
+    g.createInst<JumpInst>(entry, header);
+    auto* sum = g.createInst<PhiInst>(header);
+    auto* i = g.createInst<PhiInst>(header);
+    Inst* more = g.createInst<BinaryInst>(header, Opcode::CMP, i, last);
+    g.createInst<CondJumpInst>(header, more, body, exit);
+    Inst* offset = g.createInst<BinaryInst>(body, Opcode::MUL, i, stride);
+    Inst* address = g.createInst<BinaryInst>(body, Opcode::ADD, base, offset);
+    Inst* sum_next = g.createInst<BinaryInst>(body, Opcode::ADD, sum, address);
+    Inst* i_next = g.createInst<BinaryInst>(body, Opcode::ADD, i, one);
+    g.createInst<JumpInst>(body, header);
+    g.createInst<ReturnInst>(exit, g.createInst<BinaryInst>(exit, Opcode::ADD, sum, i));
+    sum->addIncoming(zero, entry);
+    sum->addIncoming(sum_next, body);
+    i->addIncoming(zero, entry);
+    i->addIncoming(i_next, body);
+    g.buildPredecessors();
+}
+
+static void simplifyInductionVariables(Graph& g) {
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    LoopInfo loops(&g, dom_tree);
+    loops.run();
+    IndVarSimplify(&g, loops, dom_tree).run();
+}
+
+// What the loop gains: interpreting 1000 iterations as built (0) and after the pass (1)
+static void BM_StridedSumInterpreted(benchmark::State& state) {
+    Graph g("strided");
+    buildStridedSum(g, 1000);
+    if (state.range(0) != 0) {
+        simplifyInductionVariables(g);
+    }
+    Interpreter interpreter(&g);
+    if (!interpreter.compile()) {
+        state.SkipWithError(interpreter.getError().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.execute({3}));
+    }
+}
+BENCHMARK(BM_StridedSumInterpreted)->Arg(0)->Arg(1);
+
+// Same through the JIT
+static void BM_StridedSumJit(benchmark::State& state) {
+    Graph g("strided");
+    buildStridedSum(g, 1000);
+    if (state.range(0) != 0) {
+        simplifyInductionVariables(g);
+    }
+    JitFunction jit(&g);
+    if (!JitFunction::isSupported() || !jit.compile()) {
+        state.SkipWithError("JIT compilation failed");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jit(3));
+    }
+}
+BENCHMARK(BM_StridedSumJit)->Arg(0)->Arg(1);
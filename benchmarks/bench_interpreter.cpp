@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "interpreter.h"
+#include "ir_walker.h"
+#include "mem2reg.h"
+
+// Items are IR instructions executed, counted once by the IR walker, so that the bytecode
+// interpreter and the walker report comparable instructions per second
+
+static void buildRandomLoops(Graph& g) {
+    buildRandomLoopProgram(g, 200, 16, 8);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    Mem2Reg(&g, dom_tree).run();
+}
+
+template <typename Engine>
+static void runProgram(benchmark::State& state, const Graph& g, std::vector<int64_t> args);
+
+template <>
+void runProgram<Interpreter>(benchmark::State& state, const Graph& g, std::vector<int64_t> args) {
+    Interpreter interpreter(&g);
+    if (!interpreter.compile()) {
+        state.SkipWithError(interpreter.getError().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.execute(args));
+    }
+    IRWalker walker(&g);
+    walker.run(args);
+    state.SetItemsProcessed(state.iterations() * walker.getNumExecuted());
+}
+
+template <>
+void runProgram<IRWalker>(benchmark::State& state, const Graph& g, std::vector<int64_t> args) {
+    IRWalker walker(&g);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(walker.run(args));
+    }
+    state.SetItemsProcessed(state.iterations() * walker.getNumExecuted());
+}
+
+// factorial(range(0)): a three-block loop that wraps around past 20!
+template <typename Engine>
+static void BM_Factorial(benchmark::State& state) {
+    Graph g("factorial");
+    buildFactorialFunction(g);
+    runProgram<Engine>(state, g, {state.range(0)});
+}
+BENCHMARK_TEMPLATE(BM_Factorial, IRWalker)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_Factorial, Interpreter)->Arg(20)->Arg(1000);
+
+// Random nests of counted loops and diamonds over 16 variables, after Mem2Reg
+template <typename Engine>
+static void BM_RandomLoops(benchmark::State& state) {
+    Graph g("loops");
+    buildRandomLoops(g);
+    runProgram<Engine>(state, g, {3});
+}
+BENCHMARK_TEMPLATE(BM_RandomLoops, IRWalker);
+BENCHMARK_TEMPLATE(BM_RandomLoops, Interpreter);
+
+// Lowering cost, per IR instruction
+static void BM_InterpreterCompile(benchmark::State& state) {
+    Graph g("loops");
+    buildRandomLoops(g);
+    for (auto _ : state) {
+        Interpreter interpreter(&g);
+        benchmark::DoNotOptimize(interpreter.compile());
+    }
+    state.SetItemsProcessed(state.iterations() * g.getNumInsts());
+}
+BENCHMARK(BM_InterpreterCompile);
@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "ir_parser.h"
+#include "mem2reg.h"
+
+namespace {
+
+// Dump of the SSA form of a random loop program: about 14 lines per block, with phis,
+// forward references and the id gaps Mem2Reg leaves behind
+std::string buildDump(unsigned num_blocks) {
+    Graph g("bench");
+    buildRandomLoopProgram(g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    Mem2Reg(&g, dom_tree).run();
+    std::ostringstream os;
+    g.dump(os);
+    return os.str();
+}
+
+}  // namespace
+
+// Reference point for the parsers: one pass over the same bytes counting lines
+static void BM_CountLines(benchmark::State& state) {
+    std::string text = buildDump(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::count(text.begin(), text.end(), '\n'));
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_CountLines)->Arg(70000)->Unit(benchmark::kMillisecond);
+
+// Parse from memory into a new Graph; destroying the graph is not timed. Items are lines.
+static void BM_ParseText(benchmark::State& state) {
+    std::string text = buildDump(state.range(0));
+    size_t num_lines = std::count(text.begin(), text.end(), '\n');
+    for (auto _ : state) {
+        auto g = std::make_unique<Graph>("");
+        IRParser parser(g.get());
+        if (!parser.parse(text)) {
+            state.SkipWithError(parser.getError().c_str());
+            break;
+        }
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.SetItemsProcessed(state.iterations() * num_lines);
+}
+BENCHMARK(BM_ParseText)->Arg(1000)->Arg(70000)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseFile(benchmark::State& state) {
+    std::string text = buildDump(state.range(0));
+    size_t num_lines = std::count(text.begin(), text.end(), '\n');
+    std::string path =
+        (std::filesystem::temp_directory_path() / "bench_ir_parser.ir").string();
+    std::ofstream(path) << text;
+    for (auto _ : state) {
+        auto g = std::make_unique<Graph>("");
+        IRParser parser(g.get());
+        if (!parser.parseFile(path)) {
+            state.SkipWithError(parser.getError().c_str());
+            break;
+        }
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    std::remove(path.c_str());
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.SetItemsProcessed(state.iterations() * num_lines);
+}
+BENCHMARK(BM_ParseFile)->Arg(70000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <vector>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "interpreter.h"
+#include "ir_walker.h"
+#include "jit.h"
+#include "mem2reg.h"
+
+// Items are IR instructions executed, as counted by the IR walker. The speedup counter is
+// the bytecode interpreter's time per call over the JIT's, timed on the same argument.
+
+static void buildRandomLoops(Graph& g, unsigned num_blocks) {
+    buildRandomLoopProgram(g, num_blocks, 16, 8);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    Mem2Reg(&g, dom_tree).run();
+}
+
+template <typename Fn>
+static double nanosecondsPerCall(Fn fn) {
+    constexpr int kCalls = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+        benchmark::DoNotOptimize(fn());
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kCalls;
+}
+
+static void runJit(benchmark::State& state, const Graph& g, int64_t arg) {
+    JitFunction jit(&g);
+    Interpreter interpreter(&g);
+    if (!jit.compile() || !interpreter.compile()) {
+        state.SkipWithError("compilation failed");
+        return;
+    }
+    auto fn = jit.getFunction<int64_t (*)(int64_t)>();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fn(arg));
+    }
+
+    IRWalker walker(&g);
+    std::vector<int64_t> args{arg};
+    walker.run(args);
+    state.SetItemsProcessed(state.iterations() * walker.getNumExecuted());
+    double interpreted = nanosecondsPerCall([&] { return interpreter.execute({arg}); });
+    state.counters["speedup"] = interpreted / nanosecondsPerCall([&] { return fn(arg); });
+    state.counters["code_bytes"] = jit.getCodeSize();
+}
+
+static void BM_JitFactorial(benchmark::State& state) {
+    Graph g("factorial");
+    buildFactorialFunction(g);
+    runJit(state, g, state.range(0));
+}
+BENCHMARK(BM_JitFactorial)->Arg(20)->Arg(1000);
+
+// Random nests of counted loops and diamonds over 16 variables, after Mem2Reg
+static void BM_JitRandomLoops(benchmark::State& state) {
+    Graph g("loops");
+    buildRandomLoops(g, 200);
+    runJit(state, g, 3);
+}
+BENCHMARK(BM_JitRandomLoops);
+
+// Compile latency, per IR instruction: lowering, encoding and mapping the code
+static void BM_JitCompile(benchmark::State& state) {
+    Graph g("loops");
+    buildRandomLoops(g, state.range(0));
+    for (auto _ : state) {
+        JitFunction jit(&g);
+        benchmark::DoNotOptimize(jit.compile());
+    }
+    state.SetItemsProcessed(state.iterations() * g.getNumInsts());
+}
+BENCHMARK(BM_JitCompile)->Arg(200)->Arg(5000);
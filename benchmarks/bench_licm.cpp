@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "interpreter.h"
+#include "licm.h"
+#include "loop_info.h"
+#include "mem2reg.h"
+
+// Random nest of counted loops with range(0) blocks, in SSA form
+static std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+// Items are blocks, so equal rates at all sizes mean linear time
+static void BM_LoopInfo(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    size_t num_loops = 0;
+    for (auto _ : state) {
+        LoopInfo loops(g.get(), dom_tree);
+        loops.run();
+        num_loops = loops.getNumLoops();
+    }
+    state.SetItemsProcessed(state.iterations() * g->getBasicBlocks().size());
+    state.counters["loops"] = num_loops;
+}
+BENCHMARK(BM_LoopInfo)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// LICM including its LoopInfo; the input is rebuilt outside the timed region. Items are
+// instructions.
+static void BM_LICM(benchmark::State& state) {
+    size_t num_insts = 0;
+    unsigned hoisted = 0;
+    unsigned preheaders = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = buildInput(state.range(0));
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        LICM licm(g.get(), &dom_tree);
+        licm.run();
+        hoisted = licm.getNumHoisted();
+        preheaders = licm.getNumPreheadersCreated();
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+    state.counters["hoisted"] = hoisted;
+    state.counters["preheaders"] = preheaders;
+}
+BENCHMARK(BM_LICM)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// What the loops gain: interpreting factorial(1000) as built (0) and after LICM (1)
+static void BM_FactorialAfterLICM(benchmark::State& state) {
+    Graph g("factorial");
+    buildFactorialFunction(g);
+    if (state.range(0) != 0) {
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        LICM(&g, &dom_tree).run();
+    }
+    Interpreter interpreter(&g);
+    if (!interpreter.compile()) {
+        state.SkipWithError(interpreter.getError().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.execute({1000}));
+    }
+}
+BENCHMARK(BM_FactorialAfterLICM)->Arg(0)->Arg(1);
+
+// Same for the random loop nests, whose bodies recompute invariant products
+static void BM_LoopProgramAfterLICM(benchmark::State& state) {
+    auto g = buildInput(200);
+    if (state.range(0) != 0) {
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        LICM(g.get(), &dom_tree).run();
+    }
+    Interpreter interpreter(g.get());
+    if (!interpreter.compile()) {
+        state.SkipWithError(interpreter.getError().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.execute({3, 5}));
+    }
+}
+BENCHMARK(BM_LoopProgramAfterLICM)->Arg(0)->Arg(1);
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "linear_scan.h"
+#include "mem2reg.h"
+
+// Random nest of counted loops with range(0) blocks, in SSA form
+static std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+// The whole allocation, including its dominator tree, loops and liveness, with range(1)
+// registers. Items are instructions.
+static void BM_LinearScan(benchmark::State& state) {
+    auto g = buildInput(state.range(0));
+    LinearScan allocation(g.get(), state.range(1));
+    for (auto _ : state) {
+        allocation.run();
+    }
+    state.SetItemsProcessed(state.iterations() * g->getNumInsts());
+    state.counters["intervals"] = allocation.getNumIntervals();
+    state.counters["spilled"] = allocation.getNumSpilled();
+    state.counters["stack_slots"] = allocation.getNumStackSlots();
+    state.counters["edge_moves"] = allocation.getNumEdgeMoves();
+}
+BENCHMARK(BM_LinearScan)
+    ->Args({1000, 12})
+    ->Args({10000, 12})
+    ->Args({10000, 4})
+    ->Unit(benchmark::kMillisecond);
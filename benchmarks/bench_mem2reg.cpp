@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominance_frontier.h"
+#include "dominators.h"
+#include "mem2reg.h"
+
+static void BM_DominanceFrontier(benchmark::State& state) {
+    Graph g("bench");
+    buildReducibleCFG(g, state.range(0));
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    for (auto _ : state) {
+        DominanceFrontier df(&g, dom_tree);
+        df.run();
+        benchmark::DoNotOptimize(df.getFrontier(g.getBasicBlocks().back()).size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DominanceFrontier)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// IDF of 4 random defining blocks per query, the typical size for a local variable
+static void BM_IteratedDominanceFrontier(benchmark::State& state) {
+    Graph g("bench");
+    buildReducibleCFG(g, state.range(0));
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    IteratedDominanceFrontier idf(&g, dom_tree);
+
+    std::mt19937 rng(7);
+    const auto& blocks = g.getBasicBlocks();
+    std::vector<std::vector<BasicBlock*>> queries(1024);
+    for (auto& defs : queries) {
+        for (int i = 0; i < 4; ++i) {
+            defs.push_back(blocks[rng() % blocks.size()]);
+        }
+    }
+    std::vector<BasicBlock*> result;
+    size_t query = 0;
+    for (auto _ : state) {
+        idf.setDefiningBlocks(queries[query++ % queries.size()]);
+        idf.calculate(result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IteratedDominanceFrontier)->Arg(10000)->Arg(100000);
+
+// Whole SSA construction (liveness, phi placement and renaming) on a function with
+// range(0) blocks and range(1) variables; the input is rebuilt outside the timed region.
+// Loops are bounded so that live ranges, and with them the SSA form, grow linearly.
+static void BM_Mem2Reg(benchmark::State& state) {
+    unsigned num_blocks = state.range(0);
+    unsigned num_vars = state.range(1);
+    size_t num_phis = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = std::make_unique<Graph>("bench");
+        buildReducibleCFG(*g, num_blocks, /*seed=*/42, /*max_loop_blocks=*/100);
+        addVariableAccesses(*g, num_vars);
+        auto dom_tree = std::make_unique<DominatorTree>(g.get());
+        dom_tree->run();
+        state.ResumeTiming();
+
+        Mem2Reg mem2reg(g.get(), *dom_tree);
+        mem2reg.run();
+        num_phis = mem2reg.getInsertedPhis().size();
+
+        state.PauseTiming();
+        dom_tree.reset();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.counters["phis"] = num_phis;
+    state.SetItemsProcessed(state.iterations() * num_blocks);
+}
+BENCHMARK(BM_Mem2Reg)
+    ->Args({4000, 4000})
+    ->Args({16000, 16000})
+    ->Args({64000, 64000})
+    ->Args({256000, 256000})
+    ->Args({64000, 1000})
+    ->Args({64000, 16000})
+    ->Unit(benchmark::kMillisecond);
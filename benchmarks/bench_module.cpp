@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "mem2reg.h"
+#include "module.h"
+
+// Module throughput: every function is generated, then DominatorTree and Mem2Reg run on it,
+// all inside the per-function job. Functions have 20 to 200 blocks. The argument is the
+// number of threads, 0 for one per hardware thread; items are functions.
+static void BM_ModulePipeline(benchmark::State& state) {
+    constexpr unsigned kNumFunctions = 500;
+    ModuleDriver driver(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto module = std::make_unique<Module>("bench");
+        for (unsigned i = 0; i < kNumFunctions; ++i) {
+            module->createFunction("f" + std::to_string(i));
+        }
+        state.ResumeTiming();
+        driver.run(*module, [](Graph& g, WorkerContext& ctx) {
+            unsigned seed = ctx.getFunctionIndex();
+            buildRandomLoopProgram(g, 20 + seed % 181, /*num_vars=*/8, /*trip_count=*/4, seed);
+            DominatorTree dom_tree(&g);
+            dom_tree.run();
+            Mem2Reg(&g, dom_tree).run();
+        });
+        state.PauseTiming();
+        module.reset();
+        state.ResumeTiming();
+    }
+    state.counters["threads"] = driver.getNumThreads();
+    state.SetItemsProcessed(state.iterations() * kNumFunctions);
+}
+BENCHMARK(BM_ModulePipeline)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(0)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
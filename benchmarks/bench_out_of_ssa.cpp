@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "interpreter.h"
+#include "mem2reg.h"
+#include "out_of_ssa.h"
+
+// Random nest of counted loops with range(0) blocks, in SSA form
+static std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+// The whole lowering, including its dominator tree, loops and liveness; the input is rebuilt
+// outside the timed region. Items are instructions.
+static void BM_OutOfSSA(benchmark::State& state) {
+    size_t num_insts = 0;
+    unsigned phi_copies = 0;
+    unsigned coalesced = 0;
+    unsigned moves = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = buildInput(state.range(0));
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        OutOfSSA lowering(g.get());
+        lowering.run();
+        phi_copies = lowering.getNumPhiCopies();
+        coalesced = lowering.getNumCoalesced();
+        moves = lowering.getNumMoves();
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+    state.counters["phi_copies"] = phi_copies;
+    state.counters["coalesced"] = coalesced;
+    state.counters["moves"] = moves;
+}
+BENCHMARK(BM_OutOfSSA)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// What coalescing saves at run time: the interpreter with a slot per value and phi moves on
+// every edge (0), and after lowering with a slot per variable (1)
+static void BM_OutOfSSAInterpreted(benchmark::State& state) {
+    auto g = buildInput(300);
+    Interpreter interpreter(g.get());
+    if (state.range(0) != 0) {
+        OutOfSSA lowering(g.get());
+        lowering.run();
+        interpreter.setVariables(lowering.getVariables());
+    }
+    if (!interpreter.compile()) {
+        state.SkipWithError(interpreter.getError().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.execute({3}));
+    }
+    size_t num_moves = 0;
+    for (const BytecodeInstr& instr : interpreter.getCode()) {
+        num_moves += instr.op == BytecodeOp::MOV;
+    }
+    state.counters["bytecode"] = interpreter.getCode().size();
+    state.counters["mov_bytecode"] = num_moves;
+}
+BENCHMARK(BM_OutOfSSAInterpreted)->Arg(0)->Arg(1);
@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "pass_manager.h"
+
+namespace {
+
+// Stands in for a pass that consults the dominator tree and rewrites instructions in place:
+// one dominance query per block
+class DominatorUserPass : public FunctionPass {
+   public:
+    explicit DominatorUserPass(bool preserves_cfg) : preserves_cfg_(preserves_cfg) {
+    }
+    const char* getName() const override {
+        return "dominator-user";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return analysisBit(Analysis::Dominators);
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override {
+        const DominatorTree& dom_tree = am.getDominatorTree();
+        BasicBlock* prev = g.getStartBlock();
+        unsigned dominated = 0;
+        for (BasicBlock* bb : g.getBasicBlocks()) {
+            dominated += dom_tree.dominates(prev, bb);
+            prev = bb;
+        }
+        benchmark::DoNotOptimize(dominated);
+        return preserves_cfg_ ? PreservedAnalyses::cfg() : PreservedAnalyses::none();
+    }
+
+   private:
+    bool preserves_cfg_;
+};
+
+}  // namespace
+
+// A 20-pass pipeline over a 2000-block function. With precise reports the dominator tree is
+// computed once; reporting none() after every pass recomputes it (and the predecessor lists)
+// 20 times. Items are passes.
+template <bool PreservesCFG>
+static void BM_PassPipeline(benchmark::State& state) {
+    Graph g("bench");
+    buildReducibleCFG(g, 2000);
+    PassManager pm;
+    for (int i = 0; i < 20; ++i) {
+        pm.addPass<DominatorUserPass>(PreservesCFG);
+    }
+    for (auto _ : state) {
+        AnalysisManager am(&g);
+        pm.run(g, am);
+        benchmark::DoNotOptimize(am.getNumComputations(Analysis::Dominators));
+    }
+    state.SetItemsProcessed(state.iterations() * pm.getNumPasses());
+}
+BENCHMARK_TEMPLATE(BM_PassPipeline, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_PassPipeline, false)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "mem2reg.h"
+#include "sccp.h"
+
+// SCCP over the SSA form of a random loop program with range(0) blocks; the input is rebuilt
+// outside the timed region. Items are instructions, so equal rates at both sizes mean
+// linear time.
+static void BM_SCCP(benchmark::State& state) {
+    size_t num_insts = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = std::make_unique<Graph>("bench");
+        buildRandomLoopProgram(*g, state.range(0), /*num_vars=*/16, /*trip_count=*/4);
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        Mem2Reg(g.get(), dom_tree).run();
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        SCCP sccp(g.get());
+        benchmark::DoNotOptimize(sccp.run());
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+}
+BENCHMARK(BM_SCCP)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "IR.h"
+#include "adce.h"
+#include "cfg_generators.h"
+#include "dominators.h"
+#include "mem2reg.h"
+#include "simplify_cfg.h"
+
+// Random loop program with range(0) blocks in SSA form
+static std::unique_ptr<Graph> buildInput(unsigned num_blocks) {
+    auto g = std::make_unique<Graph>("bench");
+    buildRandomLoopProgram(*g, num_blocks, /*num_vars=*/16, /*trip_count=*/4);
+    DominatorTree dom_tree(g.get());
+    dom_tree.run();
+    Mem2Reg(g.get(), dom_tree).run();
+    return g;
+}
+
+// ADCE followed by SimplifyCFG; the input is rebuilt outside the timed region. Items are
+// instructions, so equal rates at all sizes mean linear time.
+static void BM_ADCEAndSimplifyCFG(benchmark::State& state) {
+    size_t num_insts = 0;
+    unsigned removed_insts = 0;
+    unsigned removed_blocks = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto g = buildInput(state.range(0));
+        num_insts = g->getNumInsts();
+        state.ResumeTiming();
+
+        ADCE adce(g.get());
+        adce.run();
+        SimplifyCFG simplify(g.get());
+        simplify.run();
+        removed_insts = adce.getNumRemoved();
+        removed_blocks = simplify.getNumRemovedBlocks();
+
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_insts);
+    state.counters["removed_insts"] = removed_insts;
+    state.counters["removed_blocks"] = removed_blocks;
+}
+BENCHMARK(BM_ADCEAndSimplifyCFG)->Arg(1000)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+// What later analyses gain: the dominator tree of the same program as built (0) and after
+// ADCE and SimplifyCFG (1)
+static void BM_DominatorsAfterSimplify(benchmark::State& state) {
+    auto g = buildInput(100000);
+    if (state.range(0) != 0) {
+        ADCE(g.get()).run();
+        SimplifyCFG(g.get()).run();
+    }
+    for (auto _ : state) {
+        DominatorTree dom_tree(g.get());
+        dom_tree.run();
+        benchmark::DoNotOptimize(dom_tree.getRoot());
+    }
+    state.counters["blocks"] = g->getBasicBlocks().size();
+}
+BENCHMARK(BM_DominatorsAfterSimplify)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
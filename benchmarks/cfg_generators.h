@@ -0,0 +1,494 @@
+#ifndef CFG_GENERATORS_H
+#define CFG_GENERATORS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "IR.h"
+#include "dominators.h"
+
+// Random CFG with `num_blocks` blocks laid out as a chain. Each block falls through to its
+// successor and, with probability `branch_percent`%, also branches to a uniformly chosen
+// block, which creates loops, irreducible regions and cross edges.
+inline void buildRandomCFG(Graph& g, unsigned num_blocks, unsigned branch_percent = 50,
+                           uint32_t seed = 42) {
+    std::mt19937 rng(seed);
+    std::vector<BasicBlock*> blocks;
+    blocks.reserve(num_blocks);
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        blocks.push_back(g.createBB());
+    }
+    g.setStartBlock(blocks[0]);
+
+    std::uniform_int_distribution<unsigned> pick(0, num_blocks - 1);
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    for (unsigned i = 0; i + 1 < num_blocks; ++i) {
+        if (percent(rng) < branch_percent) {
+            Inst* cond = g.createInst<ConstInst>(blocks[i], 1);
+            g.createInst<CondJumpInst>(blocks[i], cond, blocks[pick(rng)], blocks[i + 1]);
+        } else {
+            g.createInst<JumpInst>(blocks[i], blocks[i + 1]);
+        }
+    }
+    g.createInst<ReturnInst>(blocks[num_blocks - 1]);
+    g.buildPredecessors();
+}
+
+// Structured (hence reducible) CFG of roughly `num_blocks` blocks: a random mix of
+// straight-line blocks, if/else diamonds and nested while loops whose only entry is the
+// loop header. Loop nests grow with num_blocks unless max_loop_blocks bounds the number of
+// blocks a loop may span.
+inline void buildReducibleCFG(Graph& g, unsigned num_blocks, uint32_t seed = 42,
+                              unsigned max_loop_blocks = 0) {
+    std::mt19937 rng(seed);
+    BasicBlock* cur = g.createBB();
+    g.setStartBlock(cur);
+    struct OpenLoop {
+        BasicBlock* header;
+        BasicBlock* exit;
+        size_t first_block;
+    };
+    std::vector<OpenLoop> loops;
+
+    while (g.getBasicBlocks().size() + 3 * loops.size() < num_blocks) {
+        unsigned action = rng() % 8;
+        if (max_loop_blocks != 0 && !loops.empty() &&
+            g.getBasicBlocks().size() - loops.front().first_block >= max_loop_blocks) {
+            action = 2;
+        }
+        switch (action) {
+            case 0:
+            case 1: {  // Open a loop: header tests, body follows, exit is patched in later
+                BasicBlock* header = g.createBB();
+                BasicBlock* body = g.createBB();
+                BasicBlock* exit = g.createBB();
+                g.createInst<JumpInst>(cur, header);
+                Inst* cond = g.createInst<ConstInst>(header, 1);
+                g.createInst<CondJumpInst>(header, cond, body, exit);
+                loops.push_back({header, exit, g.getBasicBlocks().size()});
+                cur = body;
+                break;
+            }
+            case 2:
+            case 3: {  // Close the innermost loop with a back edge
+                if (loops.empty()) {
+                    break;
+                }
+                g.createInst<JumpInst>(cur, loops.back().header);
+                cur = loops.back().exit;
+                loops.pop_back();
+                break;
+            }
+            case 4:
+            case 5: {  // Diamond
+                BasicBlock* then_bb = g.createBB();
+                BasicBlock* else_bb = g.createBB();
+                BasicBlock* join = g.createBB();
+                Inst* cond = g.createInst<ConstInst>(cur, 1);
+                g.createInst<CondJumpInst>(cur, cond, then_bb, else_bb);
+                g.createInst<JumpInst>(then_bb, join);
+                g.createInst<JumpInst>(else_bb, join);
+                cur = join;
+                break;
+            }
+            default: {
+                BasicBlock* next = g.createBB();
+                g.createInst<JumpInst>(cur, next);
+                cur = next;
+                break;
+            }
+        }
+    }
+    while (!loops.empty()) {
+        g.createInst<JumpInst>(cur, loops.back().header);
+        cur = loops.back().exit;
+        loops.pop_back();
+    }
+    g.createInst<ReturnInst>(cur);
+    g.buildPredecessors();
+}
+
+// Two chains of rungs L_i and R_i. L_i branches to L_{i+1} and R_{i+1}; R_i branches to
+// R_{i+1} and back to L_{i-1}. Every rung is entered from both sides, so the CFG is
+// irreducible end to end, which is the worst case for iterative dominator algorithms.
+inline void buildLadderCFG(Graph& g, unsigned num_blocks) {
+    unsigned rungs = std::max(2u, num_blocks / 2);
+    std::vector<BasicBlock*> left;
+    std::vector<BasicBlock*> right;
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    for (unsigned i = 0; i < rungs; ++i) {
+        left.push_back(g.createBB());
+        right.push_back(g.createBB());
+    }
+    BasicBlock* exit = g.createBB("exit");
+
+    Inst* cond = g.createInst<ConstInst>(entry, 1);
+    g.createInst<CondJumpInst>(entry, cond, left[0], right[0]);
+    for (unsigned i = 0; i < rungs; ++i) {
+        BasicBlock* next_left = i + 1 < rungs ? left[i + 1] : exit;
+        BasicBlock* next_right = i + 1 < rungs ? right[i + 1] : exit;
+        Inst* lcond = g.createInst<ConstInst>(left[i], 1);
+        g.createInst<CondJumpInst>(left[i], lcond, next_left, next_right);
+        Inst* rcond = g.createInst<ConstInst>(right[i], 1);
+        g.createInst<CondJumpInst>(right[i], rcond, next_right, left[i == 0 ? 0 : i - 1]);
+    }
+    g.createInst<ReturnInst>(exit);
+    g.buildPredecessors();
+}
+
+// Straight chain of `num_blocks` blocks, each adding a constant to a running value and
+// jumping to the next: the deepest possible dominator tree
+inline void buildChainCFG(Graph& g, unsigned num_blocks) {
+    BasicBlock* bb = g.createBB("entry");
+    g.setStartBlock(bb);
+    Inst* acc = g.createInst<ParamInst>(bb, 0);
+    for (unsigned i = 1; i < num_blocks; ++i) {
+        acc = g.createInst<BinaryInst>(bb, Opcode::ADD, acc, g.createInst<ConstInst>(bb, i));
+        BasicBlock* next = g.createBB();
+        g.createInst<JumpInst>(bb, next);
+        bb = next;
+    }
+    g.createInst<ReturnInst>(bb, acc);
+    g.buildPredecessors();
+}
+
+// A chain of two-entry loops, the shape of the irreducible examples in the tests: a head
+// branches into both blocks of a loop {A, B}, and each of them may leave to the next head.
+// One exit in four also branches back into the previous loop, merging neighbouring regions
+// into larger irreducible ones. Each region takes 3 blocks; conditions compare param #0
+// against random constants.
+inline void buildIrreducibleCFG(Graph& g, unsigned num_regions, uint32_t seed = 42) {
+    std::mt19937 rng(seed);
+    BasicBlock* cur = g.createBB("entry");
+    g.setStartBlock(cur);
+    Inst* x = g.createInst<ParamInst>(cur, 0);
+    auto cond = [&](BasicBlock* bb) {
+        Inst* bound = g.createInst<ConstInst>(bb, int64_t(rng() % 100));
+        return g.createInst<BinaryInst>(bb, Opcode::CMP, x, bound);
+    };
+    BasicBlock* prev_b = nullptr;
+    for (unsigned i = 0; i < num_regions; ++i) {
+        BasicBlock* a = g.createBB();
+        BasicBlock* b = g.createBB();
+        BasicBlock* exit = g.createBB();
+        if (prev_b != nullptr && rng() % 4 == 0) {
+            g.createInst<CondJumpInst>(cur, cond(cur), prev_b, a);
+            // This loop is then only entered through a
+            g.createInst<CondJumpInst>(a, cond(a), b, exit);
+        } else {
+            g.createInst<CondJumpInst>(cur, cond(cur), a, b);
+            g.createInst<CondJumpInst>(a, cond(a), b, exit);
+        }
+        if (rng() % 2 == 0) {
+            g.createInst<CondJumpInst>(b, cond(b), a, exit);
+        } else {
+            g.createInst<JumpInst>(b, a);
+        }
+        prev_b = b;
+        cur = exit;
+    }
+    g.createInst<ReturnInst>(cur, x);
+    g.buildPredecessors();
+}
+
+// Lowered `switch (param #0)` over `num_cases` sparse keys: a balanced binary search tree
+// of CMP/CondJump blocks, one leaf block per case, and a join block whose phi merges the
+// value each case computes. Takes about 2 * num_cases blocks.
+inline void buildSwitchTreeCFG(Graph& g, unsigned num_cases, uint32_t seed = 42) {
+    std::mt19937 rng(seed);
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    Inst* x = g.createInst<ParamInst>(entry, 0);
+    std::vector<int64_t> keys;
+    int64_t key = 0;
+    for (unsigned i = 0; i < num_cases; ++i) {
+        key += 1 + rng() % 8;
+        keys.push_back(key);
+    }
+    BasicBlock* join = g.createBB("join");
+    auto* result = g.createInst<PhiInst>(join);
+    g.createInst<ReturnInst>(join, result);
+
+    // Cases [lo, hi) are handled from bb on; CMP is x <= bound
+    struct Range {
+        BasicBlock* bb;
+        unsigned lo;
+        unsigned hi;
+    };
+    std::vector<Range> work = {{entry, 0, std::max(1u, num_cases)}};
+    while (!work.empty()) {
+        Range range = work.back();
+        work.pop_back();
+        if (range.hi - range.lo == 1) {
+            Inst* offset = g.createInst<ConstInst>(range.bb, int64_t(rng() % 100));
+            Inst* value = g.createInst<BinaryInst>(range.bb, Opcode::ADD, x, offset);
+            g.createInst<JumpInst>(range.bb, join);
+            result->addIncoming(value, range.bb);
+            continue;
+        }
+        unsigned mid = range.lo + (range.hi - range.lo) / 2;
+        Inst* bound = g.createInst<ConstInst>(range.bb, keys[mid - 1]);
+        Inst* cmp = g.createInst<BinaryInst>(range.bb, Opcode::CMP, x, bound);
+        BasicBlock* low = g.createBB();
+        BasicBlock* high = g.createBB();
+        g.createInst<CondJumpInst>(range.bb, cmp, low, high);
+        work.push_back({high, mid, range.hi});
+        work.push_back({low, range.lo, mid});
+    }
+    g.buildPredecessors();
+}
+
+// The factorial function from main.cpp, in SSA form: param #0 is n
+inline void buildFactorialFunction(Graph& g) {
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("loop.header");
+    BasicBlock* body = g.createBB("loop.body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* res_init = g.createInst<ConstInst>(entry, 1);
+    Inst* i_init = g.createInst<ConstInst>(entry, 2);
+    g.createInst<JumpInst>(entry, header);
+
+    auto* res = g.createInst<PhiInst>(header);
+    auto* i = g.createInst<PhiInst>(header);
+    Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, i, n);
+    g.createInst<CondJumpInst>(header, cmp, body, exit);
+
+    Inst* res_new = g.createInst<BinaryInst>(body, Opcode::MUL, res, i);
+    Inst* one = g.createInst<ConstInst>(body, 1);
+    Inst* i_new = g.createInst<BinaryInst>(body, Opcode::ADD, i, one);
+    g.createInst<JumpInst>(body, header);
+
+    res->addIncoming(res_init, entry);
+    res->addIncoming(res_new, body);
+    i->addIncoming(i_init, entry);
+    i->addIncoming(i_new, body);
+    g.createInst<ReturnInst>(exit, res);
+    g.buildPredecessors();
+}
+
+// `copies` factorial loops one after another, in SSA form; the function returns the sum of
+// their results. Each loop computes the factorial of param #0 plus its index.
+inline void buildFactorialChain(Graph& g, unsigned copies) {
+    BasicBlock* cur = g.createBB("entry");
+    g.setStartBlock(cur);
+    Inst* n = g.createInst<ParamInst>(cur, 0);
+    Inst* sum = g.createInst<ConstInst>(cur, 0);
+    for (unsigned k = 0; k < copies; ++k) {
+        BasicBlock* header = g.createBB();
+        BasicBlock* body = g.createBB();
+        BasicBlock* exit = g.createBB();
+        Inst* limit = g.createInst<BinaryInst>(cur, Opcode::ADD, n,
+                                               g.createInst<ConstInst>(cur, k));
+        Inst* res_init = g.createInst<ConstInst>(cur, 1);
+        Inst* i_init = g.createInst<ConstInst>(cur, 2);
+        g.createInst<JumpInst>(cur, header);
+
+        auto* res = g.createInst<PhiInst>(header);
+        auto* i = g.createInst<PhiInst>(header);
+        Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, i, limit);
+        g.createInst<CondJumpInst>(header, cmp, body, exit);
+
+        Inst* res_new = g.createInst<BinaryInst>(body, Opcode::MUL, res, i);
+        Inst* one = g.createInst<ConstInst>(body, 1);
+        Inst* i_new = g.createInst<BinaryInst>(body, Opcode::ADD, i, one);
+        g.createInst<JumpInst>(body, header);
+
+        res->addIncoming(res_init, cur);
+        res->addIncoming(res_new, body);
+        i->addIncoming(i_init, cur);
+        i->addIncoming(i_new, body);
+        sum = g.createInst<BinaryInst>(exit, Opcode::ADD, sum, res);
+        cur = exit;
+    }
+    g.createInst<ReturnInst>(cur, sum);
+    g.buildPredecessors();
+}
+
+// Terminating arithmetic program in the alloca form a front end emits; run Mem2Reg for SSA.
+// `num_vars` variables are seeded from param #0 and constants, then roughly `num_blocks`
+// blocks of straight-line code, if/else diamonds and counted loops nested at most
+// `max_depth` deep, each running `trip_count` times. Blocks add and multiply variables,
+// and diamonds branch on a comparison of two of them. Returns variable 0.
+inline void buildRandomLoopProgram(Graph& g, unsigned num_blocks, unsigned num_vars,
+                                   unsigned trip_count, uint32_t seed = 42,
+                                   unsigned max_depth = 3) {
+    std::mt19937 rng(seed);
+    BasicBlock* cur = g.createBB();
+    g.setStartBlock(cur);
+    Inst* param = g.createInst<ParamInst>(cur, 0);
+    Inst* zero = g.createInst<ConstInst>(cur, 0);
+    Inst* one = g.createInst<ConstInst>(cur, 1);
+    Inst* trips = g.createInst<ConstInst>(cur, trip_count);
+    std::vector<Inst*> slots;
+    for (unsigned i = 0; i < num_vars; ++i) {
+        slots.push_back(g.createInst<AllocaInst>(cur));
+        Inst* value = i % 2 == 0 ? param : g.createInst<ConstInst>(cur, rng() % 10);
+        g.createInst<StoreInst>(cur, slots.back(), value);
+    }
+    auto load = [&](BasicBlock* bb) { return g.createInst<LoadInst>(bb, slots[rng() % num_vars]); };
+    auto addArithmetic = [&](BasicBlock* bb) {
+        for (int op = 0; op < 2; ++op) {
+            Opcode opcode = rng() % 3 == 0 ? Opcode::MUL : Opcode::ADD;
+            Inst* lhs = load(bb);
+            Inst* value = g.createInst<BinaryInst>(bb, opcode, lhs, load(bb));
+            g.createInst<StoreInst>(bb, slots[rng() % num_vars], value);
+        }
+    };
+
+    struct OpenLoop {
+        BasicBlock* header;
+        BasicBlock* exit;
+    };
+    std::vector<OpenLoop> loops;
+    while (g.getBasicBlocks().size() + 3 * loops.size() < num_blocks) {
+        unsigned action = rng() % 8;
+        if (action < 2 && loops.size() >= max_depth) {
+            action = 2;
+        }
+        switch (action) {
+            case 0:
+            case 1: {  // Open a loop: the header counts its iterations in a slot of its own
+                BasicBlock* header = g.createBB();
+                BasicBlock* body = g.createBB();
+                BasicBlock* exit = g.createBB();
+                Inst* counter = g.createInst<AllocaInst>(cur);
+                g.createInst<StoreInst>(cur, counter, zero);
+                g.createInst<JumpInst>(cur, header);
+                Inst* count = g.createInst<LoadInst>(header, counter);
+                Inst* next = g.createInst<BinaryInst>(header, Opcode::ADD, count, one);
+                g.createInst<StoreInst>(header, counter, next);
+                Inst* cond = g.createInst<BinaryInst>(header, Opcode::CMP, next, trips);
+                g.createInst<CondJumpInst>(header, cond, body, exit);
+                loops.push_back({header, exit});
+                cur = body;
+                break;
+            }
+            case 2:
+            case 3: {  // Close the innermost loop with a back edge
+                if (loops.empty()) {
+                    break;
+                }
+                addArithmetic(cur);
+                g.createInst<JumpInst>(cur, loops.back().header);
+                cur = loops.back().exit;
+                loops.pop_back();
+                break;
+            }
+            case 4:
+            case 5: {  // Diamond
+                BasicBlock* then_bb = g.createBB();
+                BasicBlock* else_bb = g.createBB();
+                BasicBlock* join = g.createBB();
+                Inst* lhs = load(cur);
+                Inst* cond = g.createInst<BinaryInst>(cur, Opcode::CMP, lhs, load(cur));
+                g.createInst<CondJumpInst>(cur, cond, then_bb, else_bb);
+                addArithmetic(then_bb);
+                g.createInst<JumpInst>(then_bb, join);
+                addArithmetic(else_bb);
+                g.createInst<JumpInst>(else_bb, join);
+                cur = join;
+                break;
+            }
+            default: {
+                addArithmetic(cur);
+                BasicBlock* next = g.createBB();
+                g.createInst<JumpInst>(cur, next);
+                cur = next;
+                break;
+            }
+        }
+    }
+    while (!loops.empty()) {
+        g.createInst<JumpInst>(cur, loops.back().header);
+        cur = loops.back().exit;
+        loops.pop_back();
+    }
+    g.createInst<ReturnInst>(cur, g.createInst<LoadInst>(cur, slots[0]));
+    g.buildPredecessors();
+}
+
+// Lowers mutable locals the way a front end does: `num_vars` stack slots in the start block,
+// each variable initialized by a store in front of the block that declares it, and a few
+// random loads and stores in front of every block's code. Like scoped locals, a block only
+// accesses variables declared in itself or in one of its nearest dominators, plus a handful
+// of function-wide ones declared in the start block. Every load feeds an ADD.
+inline void addVariableAccesses(Graph& g, unsigned num_vars, uint32_t seed = 42) {
+    constexpr unsigned kMaxGlobalVars = 8;
+    constexpr unsigned kScopeDepth = 3;  // Dominators whose variables a block may access
+    std::mt19937 rng(seed);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    std::vector<Inst*> slots;
+    for (unsigned i = 0; i < num_vars; ++i) {
+        slots.push_back(g.createInst<AllocaInst>(nullptr));
+    }
+    // Block i declares the variables [first_var(i), first_var(i + 1))
+    const auto& blocks = g.getBasicBlocks();
+    unsigned num_globals = std::min(kMaxGlobalVars, num_vars);
+    auto first_var = [&](size_t i) {
+        return num_globals + unsigned(uint64_t(i) * (num_vars - num_globals) / blocks.size());
+    };
+    auto store_const = [&](std::vector<Inst*>& code, unsigned var) {
+        Inst* value = g.createInst<ConstInst>(nullptr, rng() % 100);
+        code.push_back(value);
+        code.push_back(g.createInst<StoreInst>(nullptr, slots[var], value));
+    };
+
+    std::vector<Inst*> code;
+    std::vector<std::pair<unsigned, unsigned>> scopes;  // [first, last) variable ranges
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        BasicBlock* bb = blocks[i];
+        code.clear();
+        if (bb == g.getStartBlock()) {
+            code = slots;
+            for (unsigned var = 0; var < num_globals; ++var) {
+                store_const(code, var);
+            }
+        }
+        for (unsigned var = first_var(i); var < first_var(i + 1); ++var) {
+            store_const(code, var);
+        }
+
+        scopes.clear();
+        BasicBlock* scope = bb;
+        for (unsigned depth = 0; depth <= kScopeDepth; ++depth) {
+            size_t id = scope->getId();
+            if (first_var(id) < first_var(id + 1)) {
+                scopes.emplace_back(first_var(id), first_var(id + 1));
+            }
+            BasicBlock* idom = dom_tree.getImmediateDominator(scope);
+            if (idom == nullptr || idom == scope) {
+                break;
+            }
+            scope = idom;
+        }
+        for (int op = 0; op < 4; ++op) {
+            unsigned var;
+            if (scopes.empty() || rng() % 4 == 0) {
+                if (num_globals == 0) {
+                    break;
+                }
+                var = rng() % num_globals;
+            } else {
+                auto [first, last] = scopes[rng() % scopes.size()];
+                var = first + rng() % (last - first);
+            }
+            if (rng() % 2 == 0) {
+                store_const(code, var);
+            } else {
+                Inst* load = g.createInst<LoadInst>(nullptr, slots[var]);
+                code.push_back(load);
+                code.push_back(g.createInst<BinaryInst>(nullptr, Opcode::ADD, load, load));
+            }
+        }
+        bb->insertInstructions(0, code);
+    }
+}
+
+#endif  // CFG_GENERATORS_H
@@ -0,0 +1,98 @@
+#ifndef IR_WALKER_H
+#define IR_WALKER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "span.h"
+
+// Evaluates a Graph in SSA form by walking its Inst objects, with values in a vector indexed
+// by instruction id. Kept only as a baseline for the interpreter benchmarks, and to count the
+// IR instructions a run executes.
+class IRWalker {
+   public:
+    explicit IRWalker(const Graph* g) : graph_(g), values_(g->getNumInsts(), 0) {
+    }
+
+    int64_t run(Span<const int64_t> args) {
+        num_executed_ = 0;
+        BasicBlock* prev = nullptr;
+        BasicBlock* bb = graph_->getStartBlock();
+        for (;;) {
+            // Phis read their operands simultaneously on entry
+            phi_values_.clear();
+            for (Inst* inst : bb->getInstructions()) {
+                if (inst->getOpcode() != Opcode::PHI) {
+                    continue;
+                }
+                for (auto [value, pred] : static_cast<PhiInst*>(inst)->getIncoming()) {
+                    if (pred == prev) {
+                        phi_values_.emplace_back(inst->getId(), values_[value->getId()]);
+                        break;
+                    }
+                }
+            }
+            for (auto [id, value] : phi_values_) {
+                values_[id] = value;
+            }
+
+            num_executed_ += bb->getInstructions().size();
+            BasicBlock* next = nullptr;
+            for (Inst* inst : bb->getInstructions()) {
+                int64_t& result = values_[inst->getId()];
+                switch (inst->getOpcode()) {
+                    case Opcode::PARAM: {
+                        unsigned index = static_cast<ParamInst*>(inst)->getIndex();
+                        result = index < args.size() ? args[index] : 0;
+                        break;
+                    }
+                    case Opcode::CONST:
+                        result = static_cast<ConstInst*>(inst)->getValue();
+                        break;
+                    case Opcode::ADD:
+                        result = int64_t(uint64_t(operand(inst, 0)) + uint64_t(operand(inst, 1)));
+                        break;
+                    case Opcode::MUL:
+                        result = int64_t(uint64_t(operand(inst, 0)) * uint64_t(operand(inst, 1)));
+                        break;
+                    case Opcode::CMP:
+                        result = operand(inst, 0) <= operand(inst, 1);
+                        break;
+                    case Opcode::JUMP:
+                        next = static_cast<JumpInst*>(inst)->getTarget();
+                        break;
+                    case Opcode::COND_JUMP: {
+                        auto* cond_jump = static_cast<CondJumpInst*>(inst);
+                        next = operand(inst, 0) != 0 ? cond_jump->getTrueTarget()
+                                                     : cond_jump->getFalseTarget();
+                        break;
+                    }
+                    case Opcode::RETURN:
+                        return inst->getNumOperands() ? operand(inst, 0) : 0;
+                    default:
+                        break;
+                }
+            }
+            prev = bb;
+            bb = next;
+        }
+    }
+
+    // IR instructions executed by the last run(), phis and terminators included
+    uint64_t getNumExecuted() const {
+        return num_executed_;
+    }
+
+   private:
+    int64_t operand(const Inst* inst, unsigned i) const {
+        return values_[inst->getOperand(i)->getId()];
+    }
+
+    const Graph* graph_;
+    std::vector<int64_t> values_;
+    std::vector<std::pair<unsigned, int64_t>> phi_values_;
+    uint64_t num_executed_ = 0;
+};
+
+#endif  // IR_WALKER_H
@@ -3,19 +3,26 @@
 
 #include <algorithm>
 #include <iostream>
-#include <map>
-#include <memory>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "arena.h"
+#include "span.h"
+#include "value_table.h"
+
 class BasicBlock;
+class Graph;
 class Inst;
 
+// Values are 64-bit integers; ADD and MUL wrap around on overflow
 enum class Opcode {
     // Binary operations
     ADD,
     MUL,
-    CMP,
+    CMP,  // 1 if lhs <= rhs (signed), 0 otherwise: the factorial loop test
     // Terminator instructions (end a basic block)
     JUMP,
     COND_JUMP,
@@ -26,14 +33,152 @@ enum class Opcode {
     CONST,
     MOV,
     CAST,
+    // Local variables, promoted to SSA values by Mem2Reg
+    ALLOCA,
+    LOAD,
+    STORE,
+};
+
+// One operand slot of an instruction. Every non-null Use is threaded onto the intrusive
+// user list of the value it refers to, so def-use chains cost no extra allocations.
+class Use {
+   public:
+    Inst* get() const {
+        return value_;
+    }
+    Inst* getUser() const {
+        return user_;
+    }
+    Use* getNext() const {
+        return next_;
+    }
+
+   private:
+    friend class Inst;
+
+    void set(Inst* value);
+    void addToList();
+    void removeFromList();
+
+    Inst* value_;
+    Inst* user_;
+    Use* next_;
+    Use** prev_;  // Address of the pointer that points at this Use
 };
 
 class Inst {
    public:
+    // Iterates over the values an instruction reads
+    class InputRange {
+       public:
+        class iterator {
+           public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Inst*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Inst*;
+
+            explicit iterator(const Use* use) : use_(use) {
+            }
+            Inst* operator*() const {
+                return use_->get();
+            }
+            iterator& operator++() {
+                ++use_;
+                return *this;
+            }
+            bool operator==(const iterator& other) const {
+                return use_ == other.use_;
+            }
+            bool operator!=(const iterator& other) const {
+                return use_ != other.use_;
+            }
+
+           private:
+            const Use* use_;
+        };
+
+        InputRange(const Use* uses, size_t size) : uses_(uses), size_(size) {
+        }
+        iterator begin() const {
+            return iterator(uses_);
+        }
+        iterator end() const {
+            return iterator(uses_ + size_);
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        Inst* operator[](size_t i) const {
+            return uses_[i].get();
+        }
+
+       private:
+        const Use* uses_;
+        size_t size_;
+    };
+
+    // Iterates over the instructions that use a value (once per use)
+    class UserRange {
+       public:
+        class iterator {
+           public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Inst*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Inst*;
+
+            explicit iterator(const Use* use) : use_(use) {
+            }
+            Inst* operator*() const {
+                return use_->getUser();
+            }
+            iterator& operator++() {
+                use_ = use_->getNext();
+                return *this;
+            }
+            bool operator==(const iterator& other) const {
+                return use_ == other.use_;
+            }
+            bool operator!=(const iterator& other) const {
+                return use_ != other.use_;
+            }
+
+           private:
+            const Use* use_;
+        };
+
+        explicit UserRange(const Use* first) : first_(first) {
+        }
+        iterator begin() const {
+            return iterator(first_);
+        }
+        iterator end() const {
+            return iterator(nullptr);
+        }
+
+       private:
+        const Use* first_;
+    };
+
     Inst(Opcode opcode, unsigned id) : opcode_(opcode), id_(id) {
     }
 
-    virtual ~Inst() = default;
+    // Instructions live in their graph's arena and are never destroyed one by one, so the
+    // destructor is deliberately non-virtual and every subclass must stay trivially
+    // destructible (see Graph::createInst).
+    ~Inst() = default;
+
+    Inst(const Inst&) = delete;
+    Inst& operator=(const Inst&) = delete;
+
+    friend class Use;
+    friend class Graph;  // Sets the arena, and renumbers instructions when compacting ids
 
     Opcode getOpcode() const {
         return opcode_;
@@ -41,8 +186,57 @@ class Inst {
     unsigned getId() const {
         return id_;
     }
-    const std::vector<Inst*>& getInputs() const {
-        return inputs_;
+    InputRange getInputs() const {
+        return InputRange(inputs_.data(), inputs_.size());
+    }
+    unsigned getNumOperands() const {
+        return inputs_.size();
+    }
+    Inst* getOperand(unsigned i) const {
+        return inputs_[i].get();
+    }
+    // Rewires operand i to `value`, moving the use between the two user lists
+    void setOperand(unsigned i, Inst* value) {
+        inputs_[i].set(value);
+    }
+
+    // Def-use chain: every use of this instruction's result
+    Use* getFirstUse() const {
+        return first_use_;
+    }
+    UserRange getUsers() const {
+        return UserRange(first_use_);
+    }
+    bool hasUses() const {
+        return first_use_ != nullptr;
+    }
+    unsigned getNumUses() const {
+        unsigned count = 0;
+        for (Use* use = first_use_; use; use = use->getNext()) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Points every use of this instruction at `value` instead, O(number of uses)
+    void replaceAllUsesWith(Inst* value) {
+        while (first_use_) {
+            first_use_->set(value);
+        }
+    }
+
+    // Clears all operands, unlinking them from their values' user lists
+    void dropAllReferences() {
+        for (unsigned i = 0; i < inputs_.size(); ++i) {
+            inputs_[i].set(nullptr);
+        }
+    }
+
+    BasicBlock* getParent() const {
+        return parent_;
+    }
+    void setParent(BasicBlock* bb) {
+        parent_ = bb;
     }
 
     virtual void dump(std::ostream& os) const {
@@ -74,26 +268,117 @@ class Inst {
                 return "mov";
             case Opcode::CAST:
                 return "cast";
+            case Opcode::ALLOCA:
+                return "alloca";
+            case Opcode::LOAD:
+                return "load";
+            case Opcode::STORE:
+                return "store";
             default:
                 return "unknown";
         }
     }
 
    protected:
+    // Appends an operand and registers this instruction as a user of `value`. Operands
+    // beyond the inline capacity are stored in the graph's arena.
+    void addInput(Inst* value) {
+        Arena* arena = nullptr;
+        bool relocates = inputs_.size() == inputs_.capacity();
+        if (relocates) {
+            // Growing moves every Use, so take them off their lists and relink afterwards
+            arena = getArena();
+            for (unsigned i = 0; i < inputs_.size(); ++i) {
+                if (inputs_[i].get()) {
+                    inputs_[i].removeFromList();
+                }
+            }
+        }
+        Use use;
+        use.value_ = value;
+        use.user_ = this;
+        use.next_ = nullptr;
+        use.prev_ = nullptr;
+        inputs_.push_back(use, arena);
+        if (relocates) {
+            for (unsigned i = 0; i + 1 < inputs_.size(); ++i) {
+                if (inputs_[i].get()) {
+                    inputs_[i].addToList();
+                }
+            }
+        }
+        if (value) {
+            inputs_[inputs_.size() - 1].addToList();
+        }
+    }
+
+    // Removes operand i and shifts the following ones down
+    void removeInput(unsigned i) {
+        for (unsigned j = i; j < inputs_.size(); ++j) {
+            if (inputs_[j].get()) {
+                inputs_[j].removeFromList();
+            }
+        }
+        for (unsigned j = i; j + 1 < inputs_.size(); ++j) {
+            inputs_[j] = inputs_[j + 1];
+        }
+        inputs_.truncate(inputs_.size() - 1);
+        for (unsigned j = i; j < inputs_.size(); ++j) {
+            if (inputs_[j].get()) {
+                inputs_[j].addToList();
+            }
+        }
+    }
+
+    // Arena used to grow operand storage beyond its inline capacity; the graph's, whether
+    // or not the instruction is placed in a block yet
+    Arena* getArena() const {
+        return arena_;
+    }
+
     Opcode opcode_;
     unsigned id_;
-    std::vector<Inst*> inputs_;  // Inputs: instructions whose results we use
+    BasicBlock* parent_ = nullptr;
+    Arena* arena_ = nullptr;  // Set by Graph::createInst, after the constructor's operands
+    ArenaVector<Use, 2> inputs_;  // Inputs: instructions whose results we use
+    Use* first_use_ = nullptr;    // Head of the list of uses of this instruction
 };
 
+inline void Use::addToList() {
+    next_ = value_->first_use_;
+    if (next_) {
+        next_->prev_ = &next_;
+    }
+    prev_ = &value_->first_use_;
+    value_->first_use_ = this;
+}
+
+inline void Use::removeFromList() {
+    *prev_ = next_;
+    if (next_) {
+        next_->prev_ = prev_;
+    }
+}
+
+inline void Use::set(Inst* value) {
+    if (value_) {
+        removeFromList();
+    }
+    value_ = value;
+    if (value_) {
+        addToList();
+    }
+}
+
 class BinaryInst : public Inst {
    public:
     BinaryInst(unsigned id, Opcode opcode, Inst* lhs, Inst* rhs) : Inst(opcode, id) {
-        inputs_.push_back(lhs);
-        inputs_.push_back(rhs);
+        addInput(lhs);
+        addInput(rhs);
     }
     void dump(std::ostream& os) const override {
         Inst::dump(os);
-        os << " i" << inputs_[0]->getId() << ", i" << inputs_[1]->getId();
+        os << " i" << getOperand(0)->getId() << ", i" << getOperand(1)->getId();
     }
 };
 
@@ -101,14 +386,14 @@ class ReturnInst : public Inst {
    public:
     ReturnInst(unsigned id, Inst* value = nullptr) : Inst(Opcode::RETURN, id) {
         if (value) {
-            inputs_.push_back(value);
+            addInput(value);
         }
     }
     void dump(std::ostream& os) const override {
         os << "  ";
         if (!inputs_.empty()) {
             Inst::dump(os);
-            os << " i" << inputs_[0]->getId();
+            os << " i" << getOperand(0)->getId();
         } else {
             os << opcodeToString(opcode_);
         }
@@ -117,32 +402,52 @@ class ReturnInst : public Inst {
 
 class JumpInst : public Inst {
    public:
-    JumpInst(unsigned id, BasicBlock* target) : Inst(Opcode::JUMP, id), target_(target) {
+    JumpInst(unsigned id, BasicBlock* target) : Inst(Opcode::JUMP, id), targets_{target} {
     }
 
     BasicBlock* getTarget() const {
-        return target_;
+        return targets_[0];
+    }
+    // Retargets the jump; predecessor lists and analyses are not updated
+    void setTarget(BasicBlock* target) {
+        targets_[0] = target;
+    }
+
+    Span<BasicBlock* const> getTargets() const {
+        return Span<BasicBlock* const>(targets_, 1);
     }
 
     void dump(std::ostream& os) const override;
 
    private:
     unsigned getTargetId() const;
-    BasicBlock* target_;
+    BasicBlock* targets_[1];  // Array form so successors can be exposed as a Span
 };
 
 class CondJumpInst : public Inst {
    public:
     CondJumpInst(unsigned id, Inst* cond, BasicBlock* true_target, BasicBlock* false_target)
-        : Inst(Opcode::COND_JUMP, id), true_target_(true_target), false_target_(false_target) {
-        inputs_.push_back(cond);
+        : Inst(Opcode::COND_JUMP, id), targets_{true_target, false_target} {
+        addInput(cond);
     }
 
     BasicBlock* getTrueTarget() const {
-        return true_target_;
+        return targets_[0];
     }
     BasicBlock* getFalseTarget() const {
-        return false_target_;
+        return targets_[1];
+    }
+    // Retarget one edge; predecessor lists and analyses are not updated
+    void setTrueTarget(BasicBlock* target) {
+        targets_[0] = target;
+    }
+    void setFalseTarget(BasicBlock* target) {
+        targets_[1] = target;
+    }
+
+    // [true_target, false_target]
+    Span<BasicBlock* const> getTargets() const {
+        return Span<BasicBlock* const>(targets_, 2);
     }
 
     void dump(std::ostream& os) const override;
@@ -150,14 +455,16 @@ class CondJumpInst : public Inst {
    private:
     unsigned getTrueTargetId() const;
     unsigned getFalseTargetId() const;
-    BasicBlock* true_target_;
-    BasicBlock* false_target_;
+    BasicBlock* targets_[2];
 };
 
 class ConstInst : public Inst {
    public:
     ConstInst(unsigned id, int64_t value) : Inst(Opcode::CONST, id), value_(value) {
     }
+    int64_t getValue() const {
+        return value_;
+    }
     void dump(std::ostream& os) const override {
         Inst::dump(os);
         os << " " << value_;
@@ -171,6 +478,9 @@ class ParamInst : public Inst {
    public:
     ParamInst(unsigned id, unsigned param_index) : Inst(Opcode::PARAM, id), index_(param_index) {
     }
+    unsigned getIndex() const {
+        return index_;
+    }
     void dump(std::ostream& os) const override {
         Inst::dump(os);
         os << " #" << index_;
@@ -180,55 +490,227 @@ class ParamInst : public Inst {
     unsigned index_;
 };
 
+// Conversion to a narrower signed integer, stored back in 64 bits: keeps the low `bits` bits
+// of the value and sign-extends them, like a C cast to int8_t for bits == 8. bits is in
+// [1, 64]; 64 copies the value.
+class CastInst : public Inst {
+   public:
+    CastInst(unsigned id, Inst* value, unsigned bits) : Inst(Opcode::CAST, id), bits_(bits) {
+        addInput(value);
+    }
+
+    unsigned getBits() const {
+        return bits_;
+    }
+
+    static int64_t apply(int64_t value, unsigned bits) {
+        unsigned shift = 64 - bits;
+        return int64_t(uint64_t(value) << shift) >> shift;
+    }
+
+    void dump(std::ostream& os) const override {
+        Inst::dump(os);
+        os << " i" << getOperand(0)->getId() << " to " << bits_ << " bits";
+    }
+
+   private:
+    unsigned bits_;
+};
+
+// Copy of a value. Out-of-SSA lowering (see out_of_ssa.h) creates them on CFG edges, where
+// each one moves a value into the storage of the phi it feeds.
+class MovInst : public Inst {
+   public:
+    MovInst(unsigned id, Inst* value) : Inst(Opcode::MOV, id) {
+        addInput(value);
+    }
+
+    void dump(std::ostream& os) const override {
+        Inst::dump(os);
+        os << " i" << getOperand(0)->getId();
+    }
+};
+
 class PhiInst : public Inst {
    public:
     PhiInst(unsigned id) : Inst(Opcode::PHI, id) {
     }
 
-    void addIncoming(Inst* value, BasicBlock* pred) {
-        incoming_values_.push_back({value, pred});
-        inputs_.push_back(value);
+    class IncomingIterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<Inst*, BasicBlock*>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        IncomingIterator(const PhiInst* phi, unsigned index) : phi_(phi), index_(index) {
+        }
+        value_type operator*() const {
+            return {phi_->getIncomingValue(index_), phi_->getIncomingBlock(index_)};
+        }
+        IncomingIterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const IncomingIterator& other) const {
+            return index_ == other.index_;
+        }
+        bool operator!=(const IncomingIterator& other) const {
+            return index_ != other.index_;
+        }
+
+       private:
+        const PhiInst* phi_;
+        unsigned index_;
+    };
+
+    struct IncomingRange {
+        IncomingIterator begin() const {
+            return IncomingIterator(phi, 0);
+        }
+        IncomingIterator end() const {
+            return IncomingIterator(phi, phi->getNumIncoming());
+        }
+        size_t size() const {
+            return phi->getNumIncoming();
+        }
+        const PhiInst* phi;
+    };
+
+    void addIncoming(Inst* value, BasicBlock* pred);
+
+    unsigned getNumIncoming() const {
+        return inputs_.size();
+    }
+    Inst* getIncomingValue(unsigned i) const {
+        return getOperand(i);
+    }
+    BasicBlock* getIncomingBlock(unsigned i) const {
+        return incoming_blocks_[i];
+    }
+
+    // Iterates over pairs of [value, predecessor_block]
+    IncomingRange getIncoming() const {
+        return IncomingRange{this};
+    }
+
+    // Makes incoming i come from `pred` instead, for edges that were redirected
+    void setIncomingBlock(unsigned i, BasicBlock* pred) {
+        incoming_blocks_[i] = pred;
     }
 
-    const std::vector<std::pair<Inst*, BasicBlock*>>& getIncoming() const {
-        return incoming_values_;
+    // Removes incoming i; the order of the others is kept
+    void removeIncoming(unsigned i) {
+        removeInput(i);
+        for (unsigned j = i; j + 1 < incoming_blocks_.size(); ++j) {
+            incoming_blocks_[j] = incoming_blocks_[j + 1];
+        }
+        incoming_blocks_.truncate(incoming_blocks_.size() - 1);
     }
 
     void dump(std::ostream& os) const override;
 
    private:
-    // Stores pairs of [value, predecessor_block]
-    std::vector<std::pair<Inst*, BasicBlock*>> incoming_values_;
+    // Parallel to inputs_: incoming_blocks_[i] is the predecessor that supplies inputs_[i]
+    ArenaVector<BasicBlock*, 2> incoming_blocks_;
+};
+
+// Stack slot of a mutable local variable. Front ends emit one per variable and access it
+// only through LoadInst and StoreInst; Mem2Reg turns such slots into SSA values.
+class AllocaInst : public Inst {
+   public:
+    explicit AllocaInst(unsigned id) : Inst(Opcode::ALLOCA, id) {
+    }
+};
+
+class LoadInst : public Inst {
+   public:
+    LoadInst(unsigned id, Inst* slot) : Inst(Opcode::LOAD, id) {
+        addInput(slot);
+    }
+
+    Inst* getSlot() const {
+        return getOperand(0);
+    }
+
+    void dump(std::ostream& os) const override {
+        Inst::dump(os);
+        os << " i" << getSlot()->getId();
+    }
+};
+
+class StoreInst : public Inst {
+   public:
+    StoreInst(unsigned id, Inst* slot, Inst* value) : Inst(Opcode::STORE, id) {
+        addInput(slot);
+        addInput(value);
+    }
+
+    Inst* getSlot() const {
+        return getOperand(0);
+    }
+    Inst* getValue() const {
+        return getOperand(1);
+    }
+
+    void dump(std::ostream& os) const override {
+        os << opcodeToString(opcode_) << " i" << getSlot()->getId() << ", i"
+           << getValue()->getId();
+    }
 };
 
 unsigned getBBId(const BasicBlock* bb);
 
 class BasicBlock final {
    public:
-    BasicBlock(unsigned id, const std::string& name);
+    BasicBlock(unsigned id, const std::string& name, Graph* graph = nullptr);
 
-    unsigned getId() const;
+    unsigned getId() const {
+        return id_;
+    }
     const std::string& getName() const;
-    const std::vector<std::unique_ptr<Inst>>& getInstructions() const;
+    Graph* getGraph() const;
+    Span<Inst* const> getInstructions() const;
 
-    void addInstruction(std::unique_ptr<Inst> inst);
+    void addInstruction(Inst* inst);
+    // Inserts insts before position `index`, shifting the following instructions once
+    void insertInstructions(unsigned index, Span<Inst* const> insts);
+    // Removes the instructions for which pred returns true and keeps the order of the rest.
+    // Removed instructions are detached from the block but keep their operands.
+    template <typename Pred>
+    void removeInstructionsIf(Pred pred);
 
     void addPredecessor(BasicBlock* pred);
+    // Removes every occurrence of pred
+    void removePredecessor(BasicBlock* pred);
 
-    const std::vector<BasicBlock*>& getPredecessors() const;
+    const std::vector<BasicBlock*>& getPredecessors() const {
+        return predecessors_;
+    }
 
     void clearPredecessors();
 
     Inst* getTerminator() const;
 
-    std::vector<BasicBlock*> getSuccessors() const;
+    // View of the targets stored in the terminator; never allocates
+    Span<BasicBlock* const> getSuccessors() const;
+
+    unsigned getNumSuccessors() const;
+    BasicBlock* getSuccessor(unsigned i) const;
+    // Points every edge of the terminator that goes to `from` at `to` instead; predecessor
+    // lists and phis are not updated
+    void replaceSuccessor(BasicBlock* from, BasicBlock* to);
 
     void dump(std::ostream& os) const;
 
    private:
+    friend class Graph;  // Renumbers blocks when removing some
+
     unsigned id_;
     std::string name_;
-    std::vector<std::unique_ptr<Inst>> instructions_;
+    Graph* graph_;
+    ArenaVector<Inst*, 4> instructions_;  // Instructions themselves live in the graph's arena
 
     // Control Flow Graph connections
     std::vector<BasicBlock*> predecessors_;
@@ -239,7 +721,7 @@ inline unsigned getBBId(const BasicBlock* bb) {
 }
 
 inline unsigned JumpInst::getTargetId() const {
-    return target_->getId();
+    return targets_[0]->getId();
 }
 
 inline void JumpInst::dump(std::ostream& os) const {
@@ -247,62 +729,333 @@ inline void JumpInst::dump(std::ostream& os) const {
 }
 
 inline unsigned CondJumpInst::getTrueTargetId() const {
-    return true_target_->getId();
+    return targets_[0]->getId();
 }
 
 inline unsigned CondJumpInst::getFalseTargetId() const {
-    return false_target_->getId();
+    return targets_[1]->getId();
 }
 
 inline void CondJumpInst::dump(std::ostream& os) const {
-    os << "  " << opcodeToString(opcode_) << " i" << inputs_[0]->getId() << " -> BB"
+    os << "  " << opcodeToString(opcode_) << " i" << getOperand(0)->getId() << " -> BB"
        << getTrueTargetId() << ", BB" << getFalseTargetId();
 }
 
+inline Inst* BasicBlock::getTerminator() const {
+    if (instructions_.empty()) {
+        return nullptr;
+    }
+    return instructions_[instructions_.size() - 1];
+}
+
+template <typename Pred>
+void BasicBlock::removeInstructionsIf(Pred pred) {
+    unsigned kept = 0;
+    for (unsigned i = 0; i < instructions_.size(); ++i) {
+        Inst* inst = instructions_[i];
+        if (pred(inst)) {
+            inst->setParent(nullptr);
+        } else {
+            instructions_[kept++] = inst;
+        }
+    }
+    instructions_.truncate(kept);
+}
+
+inline Span<BasicBlock* const> BasicBlock::getSuccessors() const {
+    Inst* terminator = getTerminator();
+    if (!terminator) {
+        return {};
+    }
+
+    switch (terminator->getOpcode()) {
+        case Opcode::JUMP:
+            return static_cast<JumpInst*>(terminator)->getTargets();
+
+        case Opcode::COND_JUMP:
+            return static_cast<CondJumpInst*>(terminator)->getTargets();
+
+        default:
+            return {};
+    }
+}
+
+inline unsigned BasicBlock::getNumSuccessors() const {
+    return getSuccessors().size();
+}
+
+inline BasicBlock* BasicBlock::getSuccessor(unsigned i) const {
+    return getSuccessors()[i];
+}
+
 inline void PhiInst::dump(std::ostream& os) const {
     Inst::dump(os);
     os << " [ ";
-    for (size_t i = 0; i < incoming_values_.size(); ++i) {
-        os << "[ i" << incoming_values_[i].first->getId() << ", %BB"
-           << getBBId(incoming_values_[i].second) << " ]";
-        if (i < incoming_values_.size() - 1) {
+    for (unsigned i = 0; i < getNumIncoming(); ++i) {
+        os << "[ i" << getIncomingValue(i)->getId() << ", %BB" << getBBId(getIncomingBlock(i))
+           << " ]";
+        if (i < getNumIncoming() - 1) {
             os << ", ";
         }
     }
     os << " ]";
 }
 
+// Graph-wide CFG adjacency in CSR form, indexed by block id. The edges of block `id` are
+// stored contiguously, which makes whole-CFG scans cache friendly. Filled by
+// Graph::buildPredecessors() and, like the predecessor lists, stale after CFG edits.
+class CFGEdgeTable {
+   public:
+    unsigned getNumBlocks() const {
+        return succ_offsets_.empty() ? 0 : succ_offsets_.size() - 1;
+    }
+    unsigned getNumEdges() const {
+        return succ_targets_.size();
+    }
+    Span<const unsigned> getSuccessors(unsigned id) const {
+        return Span<const unsigned>(succ_targets_.data() + succ_offsets_[id],
+                                    succ_offsets_[id + 1] - succ_offsets_[id]);
+    }
+    Span<const unsigned> getPredecessors(unsigned id) const {
+        return Span<const unsigned>(pred_targets_.data() + pred_offsets_[id],
+                                    pred_offsets_[id + 1] - pred_offsets_[id]);
+    }
+
+   private:
+    friend class Graph;
+
+    std::vector<unsigned> succ_offsets_;
+    std::vector<unsigned> succ_targets_;
+    std::vector<unsigned> pred_offsets_;
+    std::vector<unsigned> pred_targets_;
+};
+
+// Keys under which GVN and hash-consing identify pure values, see value_table.h
+inline bool isCommutative(Opcode opcode) {
+    return opcode == Opcode::ADD || opcode == Opcode::MUL;
+}
+
+inline ValueKey makeConstKey(int64_t value) {
+    ValueKey key;
+    key.opcode = uint32_t(Opcode::CONST);
+    key.payload = value;
+    return key;
+}
+
+inline ValueKey makeBinaryKey(Opcode opcode, const Inst* lhs, const Inst* rhs) {
+    ValueKey key;
+    key.opcode = uint32_t(opcode);
+    key.lhs = lhs->getId();
+    key.rhs = rhs->getId();
+    if (isCommutative(opcode) && key.rhs < key.lhs) {
+        std::swap(key.lhs, key.rhs);
+    }
+    return key;
+}
+
+inline ValueKey makeCastKey(const Inst* value, unsigned bits) {
+    ValueKey key;
+    key.opcode = uint32_t(Opcode::CAST);
+    key.lhs = value->getId();
+    key.payload = bits;
+    return key;
+}
+
+// False for anything but constants, binary operations and casts: phis, params, memory
+// accesses and terminators are not identified by their operands alone
+inline bool getValueKey(const Inst* inst, ValueKey* key) {
+    switch (inst->getOpcode()) {
+        case Opcode::CONST:
+            *key = makeConstKey(static_cast<const ConstInst*>(inst)->getValue());
+            return true;
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::CMP:
+            *key = makeBinaryKey(inst->getOpcode(), inst->getOperand(0), inst->getOperand(1));
+            return true;
+        case Opcode::CAST:
+            *key = makeCastKey(inst->getOperand(0), static_cast<const CastInst*>(inst)->getBits());
+            return true;
+        default:
+            return false;
+    }
+}
+
 class Graph {
    public:
     Graph(const std::string& name);
+    ~Graph();
+
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
+
+    const std::string& getName() const {
+        return name_;
+    }
+    void setName(const std::string& name) {
+        name_ = name;
+    }
 
     BasicBlock* createBB(const std::string& name = "");
 
+    // Deletes the blocks for which pred returns true and renumbers the others densely, in
+    // their previous order. Instructions of deleted blocks drop their operands and become
+    // unplaced; they keep their ids. Branches and phis must no longer refer to the deleted
+    // blocks, and the predecessor lists are stale until buildPredecessors().
+    template <typename Pred>
+    void removeBasicBlocksIf(Pred pred);
+
+    // Instructions are bump-allocated in the graph's arena and released together with it.
+    // With a null bb the instruction is created unplaced, for BasicBlock::insertInstructions.
     template <typename InstType, typename... Args>
     InstType* createInst(BasicBlock* bb, Args&&... args) {
+        static_assert(std::is_trivially_destructible<InstType>::value,
+                      "Arena-allocated instructions are never destroyed individually");
+        ValueKey key;
+        bool record = false;
+        if constexpr (kHashConsable<InstType>) {
+            if (hash_consing_ && bb) {
+                if (bb != cons_block_) {
+                    cons_table_.clear();
+                    cons_block_ = bb;
+                }
+                key = makeKeyFromArgs<InstType>(args...);
+                Inst* existing = cons_table_.lookup(key);
+                if (existing && existing->getParent() == bb) {
+                    return static_cast<InstType*>(existing);
+                }
+                // An entry whose instruction was moved or removed since stays unused
+                record = existing == nullptr;
+            }
+        }
         unsigned id = next_inst_id_++;
-        auto inst = std::make_unique<InstType>(id, std::forward<Args>(args)...);
-        auto* inst_ptr = static_cast<InstType*>(inst.get());
-        bb->addInstruction(std::move(inst));
-        return inst_ptr;
+        auto* inst = arena_.create<InstType>(id, std::forward<Args>(args)...);
+        inst->arena_ = &arena_;
+        if (bb) {
+            bb->addInstruction(inst);
+        }
+        all_insts_.push_back(inst);
+        if (record) {
+            cons_table_.insert(key, inst);
+        }
+        return inst;
+    }
+
+    // Hash-consing: while enabled, creating a constant, binary operation or cast equal to one
+    // created earlier in the same block returns the earlier instruction instead, so front
+    // ends emit fewer duplicates. Only the block appended to last is remembered, which keeps
+    // the table small and cache-resident for a front end that fills one block at a time;
+    // switching blocks starts over. The table does not follow instructions that are later
+    // replaced or moved, so turn it off before transforming the graph. Off by default.
+    void setHashConsing(bool enabled) {
+        hash_consing_ = enabled;
+        cons_table_.clear();
+        cons_block_ = nullptr;
+    }
+    bool isHashConsing() const {
+        return hash_consing_;
     }
 
+    // Leaves the next count instruction ids unused; getInst() returns nullptr for them. For
+    // readers that restore a graph together with the ids of instructions removed from it.
+    void skipInstIds(unsigned count) {
+        next_inst_id_ += count;
+        all_insts_.resize(next_inst_id_, nullptr);
+    }
+
+    Inst* getInst(unsigned id) const;
+
+    // Renumbers the instructions placed in blocks densely, in block order, and forgets all
+    // others, so id-indexed side tables shrink after passes removed instructions. Returns
+    // false if the ids were dense already. Unplaced instructions keep stale ids.
+    bool compactInstIds();
+
+    unsigned getNumInsts() const;
+
+    Arena& getArena();
+
+    // Rebuilds every block's predecessor list and the CSR edge table
     void buildPredecessors();
 
+    const CFGEdgeTable& getEdgeTable() const;
+
     void setStartBlock(BasicBlock* bb);
 
     BasicBlock* getStartBlock() const;
 
-    const std::vector<std::unique_ptr<BasicBlock>>& getBasicBlocks() const;
+    const std::vector<BasicBlock*>& getBasicBlocks() const;
 
     void dump(std::ostream& os) const;
 
    private:
     std::string name_;
-    std::vector<std::unique_ptr<BasicBlock>> basic_blocks_;
-    std::map<unsigned, Inst*> all_insts_;  // For quick access by ID
+    Arena arena_;  // Backing storage for blocks, instructions and operand arrays
+    std::vector<BasicBlock*> basic_blocks_;
+    std::vector<Inst*> all_insts_;  // For quick access by ID
+    CFGEdgeTable edges_;
     BasicBlock* start_block_ = nullptr;
     unsigned next_inst_id_ = 0;
+
+    template <typename InstType>
+    static constexpr bool kHashConsable = std::is_same<InstType, ConstInst>::value ||
+                                          std::is_same<InstType, BinaryInst>::value ||
+                                          std::is_same<InstType, CastInst>::value;
+
+    template <typename InstType, typename... Args>
+    static ValueKey makeKeyFromArgs(const Args&... args) {
+        if constexpr (std::is_same<InstType, ConstInst>::value) {
+            return makeConstKey(args...);
+        } else if constexpr (std::is_same<InstType, BinaryInst>::value) {
+            return makeBinaryKey(args...);
+        } else {
+            return makeCastKey(args...);
+        }
+    }
+
+    bool hash_consing_ = false;
+    ValueTable cons_table_;  // Values of cons_block_
+    BasicBlock* cons_block_ = nullptr;
 };
 
+inline const CFGEdgeTable& Graph::getEdgeTable() const {
+    return edges_;
+}
+
+inline Arena& Graph::getArena() {
+    return arena_;
+}
+
+inline Inst* Graph::getInst(unsigned id) const {
+    return id < all_insts_.size() ? all_insts_[id] : nullptr;
+}
+
+inline unsigned Graph::getNumInsts() const {
+    return all_insts_.size();
+}
+
+template <typename Pred>
+void Graph::removeBasicBlocksIf(Pred pred) {
+    unsigned kept = 0;
+    for (BasicBlock* bb : basic_blocks_) {
+        if (!pred(bb)) {
+            bb->id_ = kept;
+            basic_blocks_[kept++] = bb;
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            inst->dropAllReferences();
+        }
+        bb->removeInstructionsIf([](Inst*) { return true; });
+        bb->~BasicBlock();  // Its memory stays in the arena
+    }
+    basic_blocks_.resize(kept);
+    cons_table_.clear();
+    cons_block_ = nullptr;
+}
+
+inline void PhiInst::addIncoming(Inst* value, BasicBlock* pred) {
+    addInput(value);
+    incoming_blocks_.push_back(pred, getArena());
+}
+
 #endif  // IR_H
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef ADCE_H
+#define ADCE_H
+
+#include <vector>
+
+#include "IR.h"
+#include "bit_vector.h"
+#include "pass_manager.h"
+
+// Aggressive dead code elimination: instead of deleting values without uses, which never
+// removes a cycle of phis feeding each other, everything starts dead. Terminators and stores
+// are live, and so is every input of a live instruction; whatever was not reached that way
+// is deleted. Branches are always kept, so the CFG is not changed; SimplifyCFG removes the
+// blocks that became empty.
+class ADCE {
+   public:
+    explicit ADCE(Graph* g) : graph_(g) {
+    }
+
+    // Returns true if the graph changed
+    bool run();
+
+    // Instructions removed by the last run()
+    unsigned getNumRemoved() const {
+        return num_removed_;
+    }
+
+   private:
+    void markLive(Inst* inst);
+
+    Graph* graph_;
+    BitVector live_;  // Indexed by instruction id
+    std::vector<Inst*> worklist_;
+    unsigned num_removed_ = 0;
+};
+
+// ADCE in a PassManager pipeline
+class ADCEPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "adce";
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // ADCE_H
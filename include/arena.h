@@ -0,0 +1,149 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump-pointer allocator. Memory is carved out of slabs that grow geometrically and is
+// released all at once when the arena is destroyed; objects are never freed one by one.
+class Arena {
+   public:
+    static constexpr size_t kInitialSlabSize = 4096;
+    static constexpr size_t kMaxSlabSize = 1 << 20;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    void* allocate(size_t size, size_t align) {
+        uintptr_t ptr = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(uintptr_t(align) - 1);
+        if (cur_ == nullptr || ptr + size > reinterpret_cast<uintptr_t>(end_)) {
+            return allocateSlow(size, align);
+        }
+        cur_ = reinterpret_cast<char*>(ptr + size);
+        return reinterpret_cast<void*>(ptr);
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Releases everything allocated so far but keeps the current slab, so an arena reused
+    // for similar work stops calling the system allocator
+    void reset();
+
+    // Total bytes requested from the system allocator so far
+    size_t getBytesReserved() const {
+        return bytes_reserved_;
+    }
+    size_t getNumSlabs() const {
+        return slabs_.size();
+    }
+
+   private:
+    void* allocateSlow(size_t size, size_t align);
+
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    char* slab_ = nullptr;  // Start of the slab cur_ points into
+    size_t next_slab_size_ = kInitialSlabSize;
+    size_t bytes_reserved_ = 0;
+    std::vector<void*> slabs_;
+};
+
+// Growable array of trivially copyable elements. The first N elements live inline,
+// larger arrays are reallocated in an Arena (the old storage is simply abandoned).
+template <typename T, unsigned N>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector relocates with memcpy");
+
+   public:
+    ArenaVector() = default;
+
+    T* data() {
+        return capacity_ > N ? heap_ : inline_;
+    }
+    const T* data() const {
+        return capacity_ > N ? heap_ : inline_;
+    }
+    unsigned size() const {
+        return size_;
+    }
+    unsigned capacity() const {
+        return capacity_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    T& operator[](unsigned i) {
+        assert(i < size_);
+        return data()[i];
+    }
+    const T& operator[](unsigned i) const {
+        assert(i < size_);
+        return data()[i];
+    }
+
+    // `arena` may only be null while the vector still fits in its inline storage
+    void push_back(const T& value, Arena* arena) {
+        if (size_ == capacity_) {
+            grow(arena);
+        }
+        data()[size_++] = value;
+    }
+
+    // Inserts count elements before position index
+    void insert(unsigned index, const T* values, unsigned count, Arena* arena) {
+        assert(index <= size_);
+        while (size_ + count > capacity_) {
+            grow(arena);
+        }
+        T* storage = data();
+        std::memmove(static_cast<void*>(storage + index + count), storage + index,
+                     sizeof(T) * (size_ - index));
+        std::memcpy(static_cast<void*>(storage + index), values, sizeof(T) * count);
+        size_ += count;
+    }
+
+    // Drops the elements from position `size` on
+    void truncate(unsigned size) {
+        assert(size <= size_);
+        size_ = size;
+    }
+
+   private:
+    void grow(Arena* arena) {
+        if (arena == nullptr) {
+            assert(false && "ArenaVector outgrew its inline storage without an arena");
+            std::abort();
+        }
+        unsigned new_capacity = capacity_ * 2;
+        T* storage = arena->allocateArray<T>(new_capacity);
+        std::memcpy(static_cast<void*>(storage), data(), sizeof(T) * size_);
+        heap_ = storage;
+        capacity_ = new_capacity;
+    }
+
+    union {
+        T inline_[N];
+        T* heap_;
+    };
+    unsigned size_ = 0;
+    unsigned capacity_ = N;
+};
+
+#endif  // ARENA_H
@@ -0,0 +1,169 @@
+#ifndef BINARY_IR_H
+#define BINARY_IR_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "IR.h"
+#include "mapped_file.h"
+#include "span.h"
+
+// Binary IR format, version 1. A file is a header followed by five sections, each starting
+// at an 8-byte aligned offset: constants (int64), blocks, instructions, operands (uint32)
+// and strings. Numbers are little-endian. Instructions are numbered densely in block order,
+// so block b owns the instruction ids [first_inst, first_inst + num_insts) and operands
+// refer to values by those ids. The operands of an instruction are its value ids, followed
+// by the block ids its opcode needs: one per phi incoming value, the target of a JUMP, and
+// the true and false targets of a COND_JUMP. The opcode is the numeric value of Opcode;
+// changing that enum requires a new version.
+constexpr char kBinaryIRMagic[4] = {'S', 'S', 'A', 'B'};
+constexpr uint32_t kBinaryIRVersion = 1;
+constexpr uint32_t kBinaryIRByteOrder = 0x01020304;
+constexpr uint32_t kBinaryIRNoBlock = ~0u;
+
+struct BinaryIRHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t num_blocks;
+    uint32_t num_insts;
+    uint32_t num_operands;
+    uint32_t num_constants;
+    uint32_t strings_size;
+    uint32_t start_block;  // kBinaryIRNoBlock if the graph has none
+    uint32_t name_offset;  // Graph name, in the string section
+    uint32_t name_size;
+    uint32_t constants_offset;
+    uint32_t blocks_offset;
+    uint32_t insts_offset;
+    uint32_t operands_offset;
+    uint32_t strings_offset;
+    uint32_t file_size;
+    uint32_t reserved;
+};
+
+struct BinaryIRBlock {
+    uint32_t first_inst;
+    uint32_t num_insts;
+    uint32_t name_offset;
+    uint32_t name_size;
+};
+
+struct BinaryIRInst {
+    uint8_t opcode;
+    uint8_t reserved[3];
+    uint32_t num_operands;   // Value operands; phis: incoming values
+    uint32_t first_operand;  // Index into the operand section
+    uint32_t aux;            // CONST: constant index; PARAM: parameter index
+};
+
+// Serializes a Graph. Instructions that are not placed in a block are left out; MOV and CAST
+// have no encoding yet and are rejected.
+class BinaryIRWriter {
+   public:
+    explicit BinaryIRWriter(const Graph* g) : graph_(g) {
+    }
+
+    // Replaces the contents of out with the encoded graph; returns false on failure, see
+    // getError()
+    bool write(std::vector<uint8_t>& out);
+    bool writeFile(const std::string& path);
+    const std::string& getError() const {
+        return error_;
+    }
+
+   private:
+    bool fail(const Inst* inst, const char* reason);
+
+    const Graph* graph_;
+    std::string error_;
+};
+
+// Read-only view of an encoded graph, without per-instruction allocation. openFile() maps
+// the file into memory; openBuffer() reads bytes owned by the caller. Both check the header
+// and every record, so accessors and materialize() can trust ids and ranges.
+class BinaryIRView {
+   public:
+    BinaryIRView() = default;
+    ~BinaryIRView();
+    BinaryIRView(const BinaryIRView&) = delete;
+    BinaryIRView& operator=(const BinaryIRView&) = delete;
+
+    bool openFile(const std::string& path);
+    // data must be 8-byte aligned and outlive the view
+    bool openBuffer(const void* data, size_t size);
+    void close();
+    const std::string& getError() const {
+        return error_;
+    }
+
+    std::string_view getName() const {
+        return getString(header_->name_offset, header_->name_size);
+    }
+    unsigned getNumBlocks() const {
+        return header_->num_blocks;
+    }
+    unsigned getNumInsts() const {
+        return header_->num_insts;
+    }
+    // kBinaryIRNoBlock if the graph has no start block
+    unsigned getStartBlock() const {
+        return header_->start_block;
+    }
+
+    const BinaryIRBlock& getBlock(unsigned block) const {
+        return blocks_[block];
+    }
+    std::string_view getBlockName(unsigned block) const {
+        return getString(blocks_[block].name_offset, blocks_[block].name_size);
+    }
+
+    const BinaryIRInst& getInst(unsigned id) const {
+        return insts_[id];
+    }
+    Opcode getOpcode(unsigned id) const {
+        return static_cast<Opcode>(insts_[id].opcode);
+    }
+    // Ids of the value operands
+    Span<const uint32_t> getOperands(unsigned id) const {
+        return Span<const uint32_t>(operands_ + insts_[id].first_operand,
+                                    insts_[id].num_operands);
+    }
+    // Phi incoming blocks or jump targets
+    Span<const uint32_t> getBlockOperands(unsigned id) const {
+        const BinaryIRInst& inst = insts_[id];
+        return Span<const uint32_t>(operands_ + inst.first_operand + inst.num_operands,
+                                    getNumBlockOperands(inst));
+    }
+    int64_t getConstant(unsigned id) const {
+        return constants_[insts_[id].aux];
+    }
+    unsigned getParamIndex(unsigned id) const {
+        return insts_[id].aux;
+    }
+
+    // Builds the graph in g, which must be empty: ids are kept, and predecessor lists and
+    // the start block are set. Hash-consing is suspended meanwhile, so duplicates stay.
+    bool materialize(Graph& g) const;
+
+   private:
+    static unsigned getNumBlockOperands(const BinaryIRInst& inst);
+    std::string_view getString(uint32_t offset, uint32_t size) const {
+        return std::string_view(strings_ + offset, size);
+    }
+    bool validate(const uint8_t* data, size_t size);
+    bool validateInst(unsigned id);
+
+    const BinaryIRHeader* header_ = nullptr;
+    const int64_t* constants_ = nullptr;
+    const BinaryIRBlock* blocks_ = nullptr;
+    const BinaryIRInst* insts_ = nullptr;
+    const uint32_t* operands_ = nullptr;
+    const char* strings_ = nullptr;
+    MappedFile file_;  // Open when the view reads a file
+    mutable std::string error_;
+};
+
+#endif  // BINARY_IR_H
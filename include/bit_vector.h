@@ -0,0 +1,66 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size dense bitset, one bit per index, stored in 64-bit words
+class BitVector {
+   public:
+    BitVector() = default;
+    explicit BitVector(size_t size) : size_(size), words_(numWords(size), 0) {
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Clears all bits and resizes to `size`
+    void clearAndResize(size_t size) {
+        size_ = size;
+        words_.assign(numWords(size), 0);
+    }
+
+    bool test(size_t i) const {
+        assert(i < size_);
+        return (words_[i / 64] >> (i % 64)) & 1;
+    }
+    void set(size_t i) {
+        assert(i < size_);
+        words_[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    void clear(size_t i) {
+        assert(i < size_);
+        words_[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+
+    // Sets bit i and returns whether it was already set
+    bool testAndSet(size_t i) {
+        assert(i < size_);
+        uint64_t mask = uint64_t(1) << (i % 64);
+        uint64_t& word = words_[i / 64];
+        bool was_set = word & mask;
+        word |= mask;
+        return was_set;
+    }
+
+    size_t count() const {
+        size_t result = 0;
+        for (uint64_t word : words_) {
+            result += __builtin_popcountll(word);
+        }
+        return result;
+    }
+
+   private:
+    static size_t numWords(size_t size) {
+        return (size + 63) / 64;
+    }
+
+    size_t size_ = 0;
+    std::vector<uint64_t> words_;
+};
+
+#endif  // BIT_VECTOR_H
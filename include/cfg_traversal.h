@@ -0,0 +1,115 @@
+#ifndef CFG_TRAVERSAL_H
+#define CFG_TRAVERSAL_H
+
+#include <vector>
+
+#include "IR.h"
+#include "bit_vector.h"
+#include "span.h"
+
+// Edge directions for walks over the CFG. Forward follows successors from the start block.
+// Reverse follows predecessors and starts from a virtual exit block whose predecessors are
+// the blocks that end in a ReturnInst, so it needs up-to-date predecessor lists.
+struct ForwardCFG {
+    static constexpr bool kReverse = false;
+
+    static Span<BasicBlock* const> getSuccessors(const BasicBlock* bb) {
+        return bb->getSuccessors();
+    }
+
+    // exit is unused; it keeps the signature shared with ReverseCFG
+    template <typename Fn>
+    static void forEachPredecessor(const BasicBlock* bb, BasicBlock* /*exit*/, Fn fn) {
+        for (auto* pred : bb->getPredecessors()) {
+            fn(pred);
+        }
+    }
+};
+
+struct ReverseCFG {
+    static constexpr bool kReverse = true;
+
+    static bool isExitBlock(const BasicBlock* bb) {
+        Inst* terminator = bb->getTerminator();
+        return terminator != nullptr && terminator->getOpcode() == Opcode::RETURN;
+    }
+
+    static Span<BasicBlock* const> getSuccessors(const BasicBlock* bb) {
+        const auto& preds = bb->getPredecessors();
+        return Span<BasicBlock* const>(preds.data(), preds.size());
+    }
+
+    template <typename Fn>
+    static void forEachPredecessor(const BasicBlock* bb, BasicBlock* exit, Fn fn) {
+        for (auto* succ : bb->getSuccessors()) {
+            fn(succ);
+        }
+        if (isExitBlock(bb)) {
+            fn(exit);
+        }
+    }
+};
+
+// Depth-first orders of the blocks reachable from a root along Direction. The DFS keeps its
+// own stack, so arbitrarily deep CFGs cannot overflow the call stack, and reads edges
+// straight from the blocks without allocating.
+template <typename Direction>
+class CFGTraversalBase {
+   public:
+    static constexpr unsigned kUnreachable = ~0u;
+
+    explicit CFGTraversalBase(const Graph* g) : graph_(g) {
+    }
+
+    // Walks from the start block
+    void run();
+    // Walks from root; every visited block must have an id below num_ids
+    void run(BasicBlock* root, size_t num_ids);
+
+    const std::vector<BasicBlock*>& getPreOrder() const {
+        return pre_order_;
+    }
+    const std::vector<BasicBlock*>& getPostOrder() const {
+        return post_order_;
+    }
+    const std::vector<BasicBlock*>& getReversePostOrder() const {
+        return rpo_order_;
+    }
+
+    bool isReachable(const BasicBlock* bb) const {
+        return bb->getId() < visited_.size() && visited_.test(bb->getId());
+    }
+
+    // Position of the block in getReversePostOrder(), kUnreachable if not visited
+    unsigned getRPONumber(const BasicBlock* bb) const {
+        return rpo_number_[bb->getId()];
+    }
+
+    // Position of the block in getPreOrder(), kUnreachable if not visited
+    unsigned getPreOrderNumber(const BasicBlock* bb) const {
+        return pre_number_[bb->getId()];
+    }
+
+    // Parent in the DFS spanning tree; nullptr for the root and unreachable blocks
+    BasicBlock* getDFSParent(const BasicBlock* bb) const {
+        return dfs_parent_[bb->getId()];
+    }
+
+   private:
+    const Graph* graph_;
+    BitVector visited_;  // Indexed by block id
+    std::vector<BasicBlock*> pre_order_;
+    std::vector<BasicBlock*> post_order_;
+    std::vector<BasicBlock*> rpo_order_;
+    std::vector<unsigned> rpo_number_;  // Indexed by block id
+    std::vector<unsigned> pre_number_;  // Indexed by block id
+    std::vector<BasicBlock*> dfs_parent_;  // Indexed by block id
+};
+
+using CFGTraversal = CFGTraversalBase<ForwardCFG>;
+using ReverseCFGTraversal = CFGTraversalBase<ReverseCFG>;
+
+extern template class CFGTraversalBase<ForwardCFG>;
+extern template class CFGTraversalBase<ReverseCFG>;
+
+#endif  // CFG_TRAVERSAL_H
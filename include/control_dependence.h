@@ -0,0 +1,60 @@
+#ifndef CONTROL_DEPENDENCE_H
+#define CONTROL_DEPENDENCE_H
+
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "span.h"
+
+// Control dependence graph from "The Program Dependence Graph and Its Use in Optimization" by
+// Ferrante, Ottenstein and Warren. B is control dependent on A if one successor of A always
+// leads to B while another may avoid it, i.e. the branch in A decides whether B runs. Built
+// once by run() from a post-dominator tree of the same graph and stored as two CSR tables
+// indexed by block id, so both queries are a pair of loads. Blocks that cannot reach a return
+// are not in the post-dominator tree and have no dependences.
+class ControlDependenceGraph {
+   public:
+    ControlDependenceGraph(const Graph* g, const PostDominatorTree& pdt)
+        : graph_(g), pdt_(pdt) {
+    }
+
+    // Main function to run the analysis; pdt must be up to date
+    void run();
+
+    // Blocks whose branch decides whether bb runs
+    Span<BasicBlock* const> getControllingBlocks(const BasicBlock* bb) const {
+        return getRow(controllers_, controller_offsets_, bb);
+    }
+
+    // Blocks whose execution depends on how bb branches
+    Span<BasicBlock* const> getDependentBlocks(const BasicBlock* bb) const {
+        return getRow(dependents_, dependent_offsets_, bb);
+    }
+
+    bool isControlDependent(const BasicBlock* bb, const BasicBlock* on) const;
+
+    void dump(std::ostream& os) const;
+
+   private:
+    static Span<BasicBlock* const> getRow(const std::vector<BasicBlock*>& targets,
+                                          const std::vector<unsigned>& offsets,
+                                          const BasicBlock* bb) {
+        unsigned id = bb->getId();
+        if (id + 1 >= offsets.size()) {
+            return {};
+        }
+        return Span<BasicBlock* const>(targets.data() + offsets[id],
+                                       offsets[id + 1] - offsets[id]);
+    }
+
+    const Graph* graph_;
+    const PostDominatorTree& pdt_;
+    // CSR tables indexed by block id
+    std::vector<unsigned> controller_offsets_;
+    std::vector<BasicBlock*> controllers_;
+    std::vector<unsigned> dependent_offsets_;
+    std::vector<BasicBlock*> dependents_;
+};
+
+#endif  // CONTROL_DEPENDENCE_H
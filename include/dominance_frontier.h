@@ -0,0 +1,106 @@
+#ifndef DOMINANCE_FRONTIER_H
+#define DOMINANCE_FRONTIER_H
+
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "span.h"
+
+// Dominance frontier of every block, using the algorithm from "A Simple, Fast Dominance
+// Algorithm" by Cooper, Harvey and Kennedy: a join block belongs to the frontier of each
+// block on the dominator-tree path from one of its predecessors up to, but excluding, its
+// idom. The frontiers are stored in one CSR table indexed by block id.
+class DominanceFrontier {
+   public:
+    DominanceFrontier(const Graph* g, const DominatorTree& dom_tree)
+        : graph_(g), dom_tree_(dom_tree) {
+    }
+
+    // Main function to run the analysis; dom_tree must be up to date
+    void run();
+
+    // Blocks in the frontier of bb, in block id order
+    Span<BasicBlock* const> getFrontier(const BasicBlock* bb) const {
+        unsigned id = bb->getId();
+        if (id + 1 >= offsets_.size()) {
+            return {};
+        }
+        return Span<BasicBlock* const>(frontiers_.data() + offsets_[id],
+                                       offsets_[id + 1] - offsets_[id]);
+    }
+
+    void dump(std::ostream& os) const;
+
+   private:
+    const Graph* graph_;
+    const DominatorTree& dom_tree_;
+    std::vector<unsigned> offsets_;  // Indexed by block id
+    std::vector<BasicBlock*> frontiers_;
+};
+
+// Iterated dominance frontier of a set of defining blocks: the blocks where a variable
+// assigned in them needs a phi. Sreedhar and Gao's DJ-graph walk from "A Linear Time
+// Algorithm for Placing phi-Nodes", driven by a priority queue on dominator-tree depth:
+// each root sweeps its dominator subtree and collects the join edges that leave it, and no
+// block is swept twice. No frontier sets are materialized. The scratch arrays are stamped
+// per query rather than cleared, so a query costs time proportional to the blocks it
+// touches. With live-in blocks, the sweep only visits their predecessors, which makes a
+// query proportional to the variable's live range rather than to the subtrees of its
+// definitions, and keeps thousands of queries on one function near-linear overall.
+class IteratedDominanceFrontier {
+   public:
+    IteratedDominanceFrontier(const Graph* g, const DominatorTree& dom_tree)
+        : graph_(g), dom_tree_(dom_tree) {
+    }
+
+    // The spans must stay valid until calculate()
+    void setDefiningBlocks(Span<BasicBlock* const> blocks) {
+        def_blocks_ = blocks;
+    }
+    // Keeps only blocks where the variable is live on entry, which yields pruned SSA
+    void setLiveInBlocks(Span<BasicBlock* const> blocks) {
+        live_in_blocks_ = blocks;
+        use_live_in_ = true;
+    }
+    void resetLiveInBlocks() {
+        use_live_in_ = false;
+    }
+
+    // Replaces the contents of idf with the iterated dominance frontier (in no particular
+    // order). Blocks unreachable from the start are ignored.
+    void calculate(std::vector<BasicBlock*>& idf);
+
+   private:
+    void nextEpoch();
+    // Visits the not yet swept blocks of root's subtree that may have a join edge
+    template <typename Fn>
+    void sweepSubtree(BasicBlock* root, Fn visit);
+    template <typename Fn>
+    void sweepLiveSources(BasicBlock* root, Fn visit);
+
+    const Graph* graph_;
+    const DominatorTree& dom_tree_;
+    Span<BasicBlock* const> def_blocks_;
+    Span<BasicBlock* const> live_in_blocks_;
+    bool use_live_in_ = false;
+
+    // Per-block stamps, indexed by block id: the block is in the set iff the entry equals
+    // epoch_
+    unsigned epoch_ = 0;
+    std::vector<unsigned> is_def_;
+    std::vector<unsigned> is_live_in_;
+    std::vector<unsigned> queued_;   // Already in the IDF, or rejected as not live
+    std::vector<unsigned> visited_;  // Already swept as part of a dominator subtree
+    std::priority_queue<std::pair<unsigned, unsigned>> queue_;  // (depth, block id)
+    std::vector<BasicBlock*> worklist_;
+    // Predecessors of live-in blocks in dominator-tree preorder. next_source_ links each
+    // index to the next one not swept yet (a union-find with path halving).
+    std::vector<unsigned> is_source_;
+    std::vector<std::pair<unsigned, BasicBlock*>> sources_;  // (preorder number, block)
+    std::vector<unsigned> next_source_;
+};
+
+#endif  // DOMINANCE_FRONTIER_H
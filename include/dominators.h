@@ -2,16 +2,47 @@
 #define DOMINATORS_H
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-#include <map>
-#include <set>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "IR.h"
+#include "cfg_traversal.h"
 
-class DominatorTree {
+// Algorithms that compute the immediate dominators. Both produce identical trees.
+enum class DomAlgorithm {
+    // Iterative data-flow over the RPO; very fast on small, mostly reducible CFGs
+    CooperHarveyKennedy,
+    // Semi-dominators plus nearest common ancestors; near-linear on any CFG, including
+    // irreducible ones that need many passes of the iterative algorithm
+    SemiNCA,
+};
+
+enum class CFGUpdateKind { Insert, Delete };
+
+// One CFG edge change, as passed to DominatorTreeBase::applyUpdates
+struct CFGUpdate {
+    CFGUpdateKind kind;
+    BasicBlock* from;
+    BasicBlock* to;
+};
+
+// Dominator tree over a Graph, walking edges along Direction (see cfg_traversal.h). With
+// ReverseCFG it is the post-dominator tree, rooted at a virtual exit block that the tree
+// owns. Blocks are identified by their dense ids, so every per-block table (RPO numbers,
+// idoms, children) is a flat vector indexed by BasicBlock::getId(); the virtual exit takes
+// the id after the last block. The direction is resolved at compile time.
+template <typename Direction>
+class DominatorTreeBase {
    public:
-    explicit DominatorTree(Graph* g) : graph_(g) {
+    explicit DominatorTreeBase(const Graph* g,
+                               DomAlgorithm algorithm = DomAlgorithm::CooperHarveyKennedy)
+        : graph_(g), algorithm_(algorithm), traversal_(g) {
     }
 
     // Main function to run the analysis
@@ -19,49 +50,183 @@ class DominatorTree {
         computeRPO();
         computeIDom();
         buildDomTree();
+        computeDFSNumbers();
+    }
+
+    // Repairs the tree after a batch of CFG edge changes instead of recomputing it. The
+    // terminators must already reflect all updates; the predecessor lists are patched here,
+    // so do not rebuild them. Edges have set semantics: Insert means `to` became a
+    // successor of `from`, Delete that it no longer is. Opposite updates of one edge cancel.
+    void applyUpdates(const std::vector<CFGUpdate>& updates) {
+        std::vector<CFGUpdate> legal = legalizeUpdates(updates);
+        for (const CFGUpdate& update : legal) {
+            const auto& preds = update.to->getPredecessors();
+            if (update.kind == CFGUpdateKind::Delete) {
+                update.to->removePredecessor(update.from);
+            } else if (std::find(preds.begin(), preds.end(), update.from) == preds.end()) {
+                update.to->addPredecessor(update.from);
+            }
+        }
+
+        if (legal.empty()) {
+            return;
+        }
+        size_t num_blocks = graph_->getBasicBlocks().size();
+        bool large_batch = legal.size() > 1 && legal.size() > num_blocks / kRecomputeRatio;
+        // New blocks would collide with the virtual exit's id
+        bool exit_moved = Direction::kReverse && num_blocks + 1 != num_ids_;
+        if (interval_.empty() || large_batch || exit_moved) {
+            run();
+        } else {
+            rpo_stale_ = true;
+            beginUpdates(legal);
+            for (const CFGUpdate& update : legal) {
+                auto [from, to] = getTreeEdge(update);
+                removePending(pending_succs_, from, to);
+                removePending(pending_preds_, to, from);
+                if (update.kind == CFGUpdateKind::Insert) {
+                    insertEdge(from, to);
+                } else {
+                    deleteEdge(from, to);
+                }
+                if (work_budget_ < 0) {
+                    break;
+                }
+            }
+            pending_succs_.clear();
+            pending_preds_.clear();
+            if (work_budget_ < 0) {
+                run();
+            } else {
+                buildDomTree();
+                computeDFSNumbers();
+            }
+        }
+
+        if (verify_updates_ && !verify(&std::cerr)) {
+            std::cerr << "DominatorTree::applyUpdates diverged from a fresh run()\n";
+            std::abort();
+        }
+    }
+
+    // Debug mode: check every applyUpdates() result against a fresh run() and abort on
+    // mismatch
+    void setVerifyUpdates(bool enabled) {
+        verify_updates_ = enabled;
     }
 
+    // Compares the idoms against a tree computed from scratch; differences go to `os`
+    bool verify(std::ostream* os = nullptr) const {
+        DominatorTreeBase fresh(graph_, algorithm_);
+        fresh.run();
+        bool same = true;
+        for (auto* bb : graph_->getBasicBlocks()) {
+            // Compared by id: each tree owns its own virtual exit
+            unsigned expected = fresh.getIDomId(bb);
+            unsigned actual = getIDomId(bb);
+            if (expected == actual &&
+                (expected == kUndefined || fresh.getDepth(bb) == getDepth(bb))) {
+                continue;
+            }
+            same = false;
+            if (os != nullptr) {
+                *os << "BB" << bb->getId() << ": idom ";
+                printBlock(*os, getImmediateDominator(bb));
+                *os << ", expected ";
+                printBlock(*os, fresh.getImmediateDominator(bb));
+                *os << "\n";
+            }
+        }
+        return same;
+    }
+
+    // The root maps to itself; nullptr if bb is not in the tree
     BasicBlock* getImmediateDominator(BasicBlock* bb) const {
-        auto it = idom_.find(bb);
-        if (it != idom_.end()) {
-            return it->second;
+        unsigned id = bb->getId();
+        return id < idom_.size() && idom_[id] != kUndefined ? getBlock(idom_[id]) : nullptr;
+    }
+
+    // The start block, or the virtual exit of a post-dominator tree; valid after run()
+    BasicBlock* getRoot() const {
+        if constexpr (Direction::kReverse) {
+            return exit_.get();
+        } else {
+            return graph_->getStartBlock();
         }
-        return nullptr;
     }
 
     // Returns the children of a block in the dominator tree
-    const std::vector<BasicBlock*>& getChildren(BasicBlock* bb) const {
-        static const std::vector<BasicBlock*> empty_children;
-        auto it = dom_tree_.find(bb);
-        if (it != dom_tree_.end()) {
-            return it->second;
+    Span<BasicBlock* const> getChildren(BasicBlock* bb) const {
+        unsigned id = bb->getId();
+        if (id + 1 >= child_offsets_.size()) {
+            return {};
         }
-        return empty_children;
+        return Span<BasicBlock* const>(children_.data() + child_offsets_[id],
+                                       child_offsets_[id + 1] - child_offsets_[id]);
     }
 
+    // A dominates B iff B's dominator-tree DFS interval is nested in A's
     bool dominates(BasicBlock* A, BasicBlock* B) const {
         if (A == B) {
             return true;
         }
-        BasicBlock* current = B;
-        while (current != nullptr && current != graph_->getStartBlock()) {
-            current = getImmediateDominator(current);
-            if (current == A) {
-                return true;
-            }
+        return dominatesById(A->getId(), B->getId());
+    }
+
+    // Answers a batch of (A, B) dominance queries; result[i] is dominates(A_i, B_i)
+    std::vector<bool> dominates(Span<const std::pair<BasicBlock*, BasicBlock*>> queries) const {
+        std::vector<bool> result(queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            result[i] = queries[i].first == queries[i].second ||
+                        dominatesById(queries[i].first->getId(), queries[i].second->getId());
         }
-        return false;
+        return result;
+    }
+
+    // Deepest block that dominates both A and B, nullptr if either is unreachable.
+    // Climbs from A along skew-binary jump pointers, O(log depth) interval checks.
+    BasicBlock* findNearestCommonDominator(BasicBlock* A, BasicBlock* B) const {
+        unsigned a = A->getId();
+        unsigned b = B->getId();
+        if (a >= interval_.size() || b >= interval_.size() ||
+            interval_[a].pre == kUndefined || interval_[b].pre == kUndefined) {
+            return nullptr;
+        }
+        while (!dominatesById(a, b)) {
+            a = dominatesById(jump_[a], b) ? idom_[a] : jump_[a];
+        }
+        return getBlock(a);
+    }
+
+    // Depth in the tree (the root has depth 0)
+    unsigned getDepth(BasicBlock* bb) const {
+        return depth_[bb->getId()];
+    }
+
+    // Position in a preorder walk of the tree, so every subtree is a contiguous range of
+    // positions that starts at its root; ~0u if bb is not in the tree
+    unsigned getPreOrderNumber(BasicBlock* bb) const {
+        unsigned id = bb->getId();
+        return id < interval_.size() ? interval_[id].pre : kUndefined;
     }
 
     void dump(std::ostream& os) const {
+        // applyUpdates() does not maintain the RPO; recompute it for printing only
+        CFGTraversalBase<Direction> fresh_traversal(graph_);
+        if (rpo_stale_) {
+            fresh_traversal.run(getRoot(), num_ids_);
+        }
+        const auto& rpo_order =
+            (rpo_stale_ ? fresh_traversal : traversal_).getReversePostOrder();
         os << "Reverse Post-Order (RPO):\n";
-        for (const auto& bb : rpo_order_) {
+        for (const auto& bb : rpo_order) {
             os << "  BB" << bb->getId() << " (" << bb->getName() << ")" << std::endl;
         }
         os << std::endl;
 
-        os << "Dominator Tree (Child -> Parent):\n";
-        for (const auto& bb : rpo_order_) {
+        const char* tree_name = Direction::kReverse ? "Post-Dominator Tree" : "Dominator Tree";
+        os << tree_name << " (Child -> Parent):\n";
+        for (const auto& bb : rpo_order) {
             BasicBlock* idom = getImmediateDominator(bb);
             if (idom) {
                 os << "  BB" << bb->getId() << " -> BB" << idom->getId() << "\n";
@@ -71,8 +236,8 @@ class DominatorTree {
         }
         os << "\n";
 
-        os << "Dominator Tree (Parent -> Children):\n";
-        for (const auto& bb : rpo_order_) {
+        os << tree_name << " (Parent -> Children):\n";
+        for (const auto& bb : rpo_order) {
             os << "  BB" << bb->getId() << " dominates { ";
             const auto& children = getChildren(bb);
             for (size_t i = 0; i < children.size(); ++i) {
@@ -83,94 +248,777 @@ class DominatorTree {
     }
 
    private:
-    void computeRPO() {
-        std::set<BasicBlock*> visited;
-        std::vector<BasicBlock*> post_order;
-        dfsVisit(graph_->getStartBlock(), visited, post_order);
+    static constexpr unsigned kUndefined = ~0u;
+    // applyUpdates() recomputes from scratch once a batch of several edge changes has more
+    // than num_blocks / kRecomputeRatio of them
+    static constexpr size_t kRecomputeRatio = 16;
 
-        rpo_order_.assign(post_order.rbegin(), post_order.rend());
+    // (neighbour id, kind) of the updates of a batch that have not been applied yet
+    using PendingEdges = std::vector<std::pair<unsigned, CFGUpdateKind>>;
 
-        for (size_t i = 0; i < rpo_order_.size(); ++i) {
-            rpo_map_[rpo_order_[i]] = i;
+    // Preorder/postorder numbers of a block in a DFS of the dominator tree
+    struct DFSInterval {
+        unsigned pre = kUndefined;
+        unsigned post = kUndefined;
+    };
+
+    bool dominatesById(unsigned a, unsigned b) const {
+        const DFSInterval& ia = interval_[a];
+        const DFSInterval& ib = interval_[b];
+        return ia.pre != kUndefined && ib.pre != kUndefined && ia.pre <= ib.pre &&
+               ib.post <= ia.post;
+    }
+
+    unsigned getIDomId(const BasicBlock* bb) const {
+        unsigned id = bb->getId();
+        return id < idom_.size() ? idom_[id] : kUndefined;
+    }
+
+    BasicBlock* getBlock(unsigned id) const {
+        if constexpr (Direction::kReverse) {
+            if (id + 1 == num_ids_) {
+                return exit_.get();
+            }
+        }
+        return graph_->getBasicBlocks()[id];
+    }
+
+    // Edge of the walked graph that a CFG update changes
+    static std::pair<unsigned, unsigned> getTreeEdge(const CFGUpdate& update) {
+        if constexpr (Direction::kReverse) {
+            return {update.to->getId(), update.from->getId()};
+        } else {
+            return {update.from->getId(), update.to->getId()};
         }
     }
 
-    void dfsVisit(BasicBlock* u, std::set<BasicBlock*>& visited,
-                  std::vector<BasicBlock*>& post_order) {
-        visited.insert(u);
-        for (auto* v : u->getSuccessors()) {
-            if (visited.find(v) == visited.end()) {
-                dfsVisit(v, visited, post_order);
+    void computeRPO() {
+        const auto& blocks = graph_->getBasicBlocks();
+        num_ids_ = blocks.size();
+        if constexpr (Direction::kReverse) {
+            // Ids past the last block are free, so the exit takes the next one
+            if (exit_ == nullptr || exit_->getId() != blocks.size()) {
+                exit_ = std::make_unique<BasicBlock>(blocks.size(), "exit");
             }
+            exit_->clearPredecessors();
+            for (auto* bb : blocks) {
+                if (ReverseCFG::isExitBlock(bb)) {
+                    exit_->addPredecessor(bb);
+                }
+            }
+            ++num_ids_;
         }
-        post_order.push_back(u);
+        traversal_.run(getRoot(), num_ids_);
+        rpo_stale_ = false;
     }
 
-    // Based on "A Simple, Fast Dominator Algorithm" by Cooper
     void computeIDom() {
-        BasicBlock* start_node = graph_->getStartBlock();
-        idom_[start_node] = start_node;
+        switch (algorithm_) {
+            case DomAlgorithm::CooperHarveyKennedy:
+                computeIDomIterative();
+                break;
+            case DomAlgorithm::SemiNCA:
+                computeIDomSemiNCA();
+                break;
+        }
+    }
+
+    // Translates the predecessors of order[0..n) into a CSR array of positions in `order`,
+    // as given by `number` (a CFGTraversal numbering). Unreachable preds are dropped.
+    void buildPredecessorTable(const std::vector<BasicBlock*>& order,
+                               unsigned (CFGTraversalBase<Direction>::*number)(
+                                   const BasicBlock*) const,
+                               std::vector<unsigned>& pred_offsets,
+                               std::vector<unsigned>& preds) const {
+        size_t n = order.size();
+        pred_offsets.assign(n + 1, 0);
+        preds.clear();
+        for (size_t b = 0; b < n; ++b) {
+            Direction::forEachPredecessor(order[b], exit_.get(), [&](BasicBlock* p) {
+                unsigned p_num = (traversal_.*number)(p);
+                if (p_num != CFGTraversalBase<Direction>::kUnreachable) {
+                    preds.push_back(p_num);
+                }
+            });
+            pred_offsets[b + 1] = preds.size();
+        }
+    }
+
+    // Based on "A Simple, Fast Dominator Algorithm" by Cooper. The iteration runs entirely
+    // in RPO-number space: predecessors are pre-translated into a CSR array of RPO numbers
+    // and doms[] holds the RPO number of each block's current idom candidate.
+    void computeIDomIterative() {
+        const auto& rpo_order = traversal_.getReversePostOrder();
+        size_t n = rpo_order.size();
+        std::vector<unsigned> pred_offsets;
+        std::vector<unsigned> preds;
+        buildPredecessorTable(rpo_order, &CFGTraversalBase<Direction>::getRPONumber, pred_offsets,
+                              preds);
+
+        std::vector<unsigned> doms(n, kUndefined);
+        if (n != 0) {
+            doms[0] = 0;
+        }
 
         bool changed = true;
         while (changed) {
             changed = false;
 
-            for (auto* b : rpo_order_) {
-                if (b == start_node) continue;
+            for (size_t b = 1; b < n; ++b) {
+                unsigned new_idom = kUndefined;
 
-                BasicBlock* new_idom = nullptr;
-
-                // Find the first processed predecessor in the RPO
-                for (auto* p : b->getPredecessors()) {
-                    if (idom_.count(p)) {
-                        new_idom = p;
-                        break;
+                // Find the first processed predecessor in the RPO, then intersect it with
+                // all other processed predecessors
+                for (unsigned i = pred_offsets[b]; i < pred_offsets[b + 1]; ++i) {
+                    unsigned p = preds[i];
+                    if (doms[p] == kUndefined) {
+                        continue;
                     }
+                    new_idom = new_idom == kUndefined ? p : intersect(doms, p, new_idom);
                 }
 
-                // For all other predecessors, find the common dominator
-                for (auto* p : b->getPredecessors()) {
-                    if (p != new_idom && idom_.count(p)) {
-                        new_idom = intersect(p, new_idom);
-                    }
+                if (doms[b] != new_idom) {
+                    doms[b] = new_idom;
+                    changed = true;
                 }
+            }
+        }
 
-                if (!idom_.count(b) || idom_[b] != new_idom) {
-                    idom_[b] = new_idom;
-                    changed = true;
+        idom_.assign(num_ids_, kUndefined);
+        for (size_t b = 0; b < n; ++b) {
+            idom_[rpo_order[b]->getId()] = rpo_order[doms[b]]->getId();
+        }
+    }
+
+    // Semi-NCA from "Finding Dominators in Practice" by Georgiadis, Tarjan and Werneck.
+    // Vertices are DFS preorder numbers. Semi-dominators come from a path-compressed
+    // link-eval forest; each idom is then the nearest ancestor of the DFS parent whose
+    // number does not exceed the vertex's semi-dominator.
+    void computeIDomSemiNCA() {
+        const auto& pre_order = traversal_.getPreOrder();
+        size_t n = pre_order.size();
+        std::vector<unsigned> pred_offsets;
+        std::vector<unsigned> preds;
+        buildPredecessorTable(pre_order, &CFGTraversalBase<Direction>::getPreOrderNumber,
+                              pred_offsets, preds);
+
+        std::vector<unsigned> parent(n, 0);
+        for (size_t v = 1; v < n; ++v) {
+            parent[v] = traversal_.getPreOrderNumber(traversal_.getDFSParent(pre_order[v]));
+        }
+        std::vector<unsigned> doms;
+        semiNCA(parent, pred_offsets, preds, doms);
+
+        idom_.assign(num_ids_, kUndefined);
+        for (size_t v = 0; v < n; ++v) {
+            idom_[pre_order[v]->getId()] = pre_order[doms[v]]->getId();
+        }
+    }
+
+    // Core of Semi-NCA over preorder numbers [0, n): parent[] is the DFS tree (parent[0] is
+    // ignored) and the CSR preds hold the predecessors of each vertex. doms[v] is set to
+    // the preorder number of v's idom.
+    static void semiNCA(const std::vector<unsigned>& parent,
+                        const std::vector<unsigned>& pred_offsets,
+                        const std::vector<unsigned>& preds, std::vector<unsigned>& doms) {
+        size_t n = parent.size();
+        std::vector<unsigned> semi(n);
+        std::vector<unsigned> label(n);
+        std::vector<unsigned> ancestor(n, kUndefined);  // Link-eval forest, kUndefined = root
+        for (size_t v = 0; v < n; ++v) {
+            semi[v] = v;
+            label[v] = v;
+        }
+
+        std::vector<unsigned> stack;
+        for (size_t w = n; w-- > 1;) {
+            for (unsigned i = pred_offsets[w]; i < pred_offsets[w + 1]; ++i) {
+                unsigned v = preds[i];
+                unsigned u = v;
+                if (ancestor[v] != kUndefined) {
+                    compress(v, ancestor, label, semi, stack);
+                    u = label[v];
                 }
+                semi[w] = std::min(semi[w], semi[u]);
             }
+            ancestor[w] = parent[w];
+        }
+
+        doms.assign(n, 0);
+        for (size_t w = 1; w < n; ++w) {
+            unsigned d = parent[w];
+            while (d > semi[w]) {
+                d = doms[d];
+            }
+            doms[w] = d;
         }
     }
 
-    // Helper to find the common dominator of two blocks
-    BasicBlock* intersect(BasicBlock* b1, BasicBlock* b2) {
-        BasicBlock* finger1 = b1;
-        BasicBlock* finger2 = b2;
+    // Path compression for the link-eval forest, iterative so deep DFS trees are safe.
+    // Afterwards label[v] is the vertex with minimal semi on the path from v to (but
+    // excluding) its forest root, and ancestor[v] points directly below that root.
+    static void compress(unsigned v, std::vector<unsigned>& ancestor, std::vector<unsigned>& label,
+                         const std::vector<unsigned>& semi, std::vector<unsigned>& stack) {
+        stack.clear();
+        while (ancestor[ancestor[v]] != kUndefined) {
+            stack.push_back(v);
+            v = ancestor[v];
+        }
+        while (!stack.empty()) {
+            unsigned x = stack.back();
+            stack.pop_back();
+            unsigned a = ancestor[x];
+            if (semi[label[a]] < semi[label[x]]) {
+                label[x] = label[a];
+            }
+            ancestor[x] = ancestor[a];
+        }
+    }
+
+    // Helper to find the common dominator of two blocks given by RPO number
+    static unsigned intersect(const std::vector<unsigned>& doms, unsigned finger1,
+                              unsigned finger2) {
         while (finger1 != finger2) {
-            while (rpo_map_[finger1] < rpo_map_[finger2]) {
-                finger2 = idom_[finger2];
+            while (finger1 > finger2) {
+                finger1 = doms[finger1];
             }
-            while (rpo_map_[finger2] < rpo_map_[finger1]) {
-                finger1 = idom_[finger1];
+            while (finger2 > finger1) {
+                finger2 = doms[finger2];
             }
         }
         return finger1;
     }
 
+    // ---- Incremental updates ----
+    // Dynamic algorithms from "An Experimental Study of Dynamic Dominators" by Georgiadis,
+    // Italiano, Laura and Santaroni. While a batch is applied the tree is kept as idom_ plus
+    // depth_ and intrusive sibling lists; the CSR children, DFS intervals and jump pointers
+    // are rebuilt once at the end. Each update sees the CFG as it was right after that
+    // update: edges of later updates are hidden (inserts) or kept (deletes) by the
+    // pending lists.
+
+    static std::vector<CFGUpdate> legalizeUpdates(const std::vector<CFGUpdate>& updates) {
+        // Net effect per (from, to), in order of first appearance
+        std::unordered_map<uint64_t, size_t> index;
+        std::vector<std::pair<CFGUpdate, int>> net;
+        for (const CFGUpdate& update : updates) {
+            uint64_t key = (uint64_t(update.from->getId()) << 32) | update.to->getId();
+            auto [it, inserted] = index.emplace(key, net.size());
+            if (inserted) {
+                net.push_back({update, 0});
+            }
+            net[it->second].second += update.kind == CFGUpdateKind::Insert ? 1 : -1;
+        }
+
+        std::vector<CFGUpdate> legal;
+        for (auto& [update, count] : net) {
+            if (count != 0) {
+                update.kind = count > 0 ? CFGUpdateKind::Insert : CFGUpdateKind::Delete;
+                legal.push_back(update);
+            }
+        }
+        return legal;
+    }
+
+    void beginUpdates(const std::vector<CFGUpdate>& updates) {
+        if constexpr (!Direction::kReverse) {
+            num_ids_ = graph_->getBasicBlocks().size();
+        }
+        idom_.resize(num_ids_, kUndefined);  // Blocks created since run() start unreachable
+        depth_.resize(num_ids_, 0);
+        first_child_.assign(num_ids_, kUndefined);
+        next_sibling_.assign(num_ids_, kUndefined);
+        prev_sibling_.assign(num_ids_, kUndefined);
+        mark_.assign(num_ids_, 0);
+        local_num_.resize(num_ids_);
+        epoch_ = 0;
+        // Measured on structured CFGs: past about a quarter of the blocks, a batch that ends
+        // in run() anyway would have been cheaper to recompute right away
+        work_budget_ = num_ids_ / 4;
+        for (size_t id = 0; id < num_ids_; ++id) {
+            if (idom_[id] != kUndefined && idom_[id] != id) {
+                attach(id, idom_[id]);
+            }
+        }
+
+        pending_succs_.clear();
+        pending_preds_.clear();
+        for (const CFGUpdate& update : updates) {
+            auto [from, to] = getTreeEdge(update);
+            pending_succs_[from].push_back({to, update.kind});
+            pending_preds_[to].push_back({from, update.kind});
+        }
+    }
+
+    static void removePending(std::unordered_map<unsigned, PendingEdges>& pending, unsigned v,
+                              unsigned other) {
+        auto it = pending.find(v);
+        PendingEdges& edges = it->second;
+        for (auto& edge : edges) {
+            if (edge.first == other) {
+                edge = edges.back();
+                edges.pop_back();
+                break;
+            }
+        }
+        if (edges.empty()) {
+            pending.erase(it);  // Keeps lookups free once the batch is drained
+        }
+    }
+
+    static const PendingEdges* findPending(
+        const std::unordered_map<unsigned, PendingEdges>& pending, unsigned v) {
+        if (pending.empty()) {
+            return nullptr;
+        }
+        auto it = pending.find(v);
+        return it == pending.end() ? nullptr : &it->second;
+    }
+
+    static bool isLaterInsert(const PendingEdges* pending, unsigned id) {
+        if (pending != nullptr) {
+            for (const auto& [other, kind] : *pending) {
+                if (other == id && kind == CFGUpdateKind::Insert) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <typename Fn>
+    static void forEachLaterDelete(const PendingEdges* pending, Fn fn) {
+        if (pending != nullptr) {
+            for (const auto& [other, kind] : *pending) {
+                if (kind == CFGUpdateKind::Delete) {
+                    fn(other);
+                }
+            }
+        }
+    }
+
+    // Call fn(id) for the neighbours of v along Direction in the CFG as seen by the current
+    // update
+    template <typename Fn>
+    void forEachSuccessor(unsigned v, Fn fn) const {
+        const PendingEdges* pending = findPending(pending_succs_, v);
+        for (auto* succ : Direction::getSuccessors(getBlock(v))) {
+            if (!isLaterInsert(pending, succ->getId())) {
+                fn(succ->getId());
+            }
+        }
+        forEachLaterDelete(pending, fn);
+    }
+
+    template <typename Fn>
+    void forEachPredecessor(unsigned v, Fn fn) const {
+        const PendingEdges* pending = findPending(pending_preds_, v);
+        Direction::forEachPredecessor(getBlock(v), exit_.get(), [&](BasicBlock* pred) {
+            if (!isLaterInsert(pending, pred->getId())) {
+                fn(pred->getId());
+            }
+        });
+        forEachLaterDelete(pending, fn);
+    }
+
+    bool isReachable(unsigned v) const {
+        return idom_[v] != kUndefined;
+    }
+
+    unsigned parentOf(unsigned v) const {
+        return idom_[v];
+    }
+
+    // Tree queries by climbing idoms; the DFS intervals are stale during a batch
+    unsigned nearestCommonDominatorByDepth(unsigned a, unsigned b) const {
+        while (a != b) {
+            if (depth_[a] < depth_[b]) {
+                b = parentOf(b);
+            } else {
+                a = parentOf(a);
+            }
+        }
+        return a;
+    }
+
+    bool dominatesByDepth(unsigned a, unsigned b) const {
+        while (depth_[b] > depth_[a]) {
+            b = parentOf(b);
+        }
+        return a == b;
+    }
+
+    void attach(unsigned v, unsigned parent) {
+        idom_[v] = parent;
+        prev_sibling_[v] = kUndefined;
+        next_sibling_[v] = first_child_[parent];
+        if (first_child_[parent] != kUndefined) {
+            prev_sibling_[first_child_[parent]] = v;
+        }
+        first_child_[parent] = v;
+    }
+
+    void detach(unsigned v) {
+        unsigned prev = prev_sibling_[v];
+        unsigned next = next_sibling_[v];
+        if (prev != kUndefined) {
+            next_sibling_[prev] = next;
+        } else {
+            first_child_[parentOf(v)] = next;
+        }
+        if (next != kUndefined) {
+            prev_sibling_[next] = prev;
+        }
+    }
+
+    // Collects root and all its tree descendants into out (root first)
+    void collectSubtree(unsigned root, std::vector<unsigned>& out) const {
+        out.clear();
+        out.push_back(root);
+        for (size_t i = 0; i < out.size(); ++i) {
+            for (unsigned c = first_child_[out[i]]; c != kUndefined; c = next_sibling_[c]) {
+                out.push_back(c);
+            }
+        }
+    }
+
+    // Recomputes depth_ below v from depth_[v]; returns the size of v's subtree
+    size_t updateDepthsBelow(unsigned v) {
+        collectSubtree(v, work_);
+        for (unsigned u : work_) {
+            for (unsigned c = first_child_[u]; c != kUndefined; c = next_sibling_[c]) {
+                depth_[c] = depth_[u] + 1;
+            }
+        }
+        return work_.size();
+    }
+
+    // Semi-NCA restricted to the blocks reached from root through edges (from, to) with
+    // descend(from, to). Fills local_order_ with their ids in DFS preorder and local_idom_
+    // with each one's idom as a position in local_order_. Only edges seen by the DFS count
+    // as predecessors, which is exact for the regions the callers pass in.
+    template <typename Descend>
+    void runLocalSemiNCA(unsigned root, Descend descend) {
+        ++epoch_;
+        local_order_.clear();
+        std::vector<unsigned> parent;
+        std::vector<std::pair<unsigned, unsigned>> edges;  // (to, from) preorder numbers
+        // Marking on pop, with the parent being the block that pushed the entry, still
+        // yields a valid DFS tree
+        std::vector<std::pair<unsigned, unsigned>> worklist = {{root, kUndefined}};
+        while (!worklist.empty()) {
+            auto [v, from] = worklist.back();
+            worklist.pop_back();
+            if (mark_[v] == epoch_) {
+                edges.push_back({local_num_[v], from});
+                continue;
+            }
+            mark_[v] = epoch_;
+            unsigned num = local_order_.size();
+            local_num_[v] = num;
+            local_order_.push_back(v);
+            parent.push_back(from == kUndefined ? 0 : from);
+            if (from != kUndefined) {
+                edges.push_back({num, from});
+            }
+            forEachSuccessor(v, [&](unsigned succ) {
+                if (descend(v, succ)) {
+                    worklist.push_back({succ, num});
+                }
+            });
+        }
+
+        size_t n = local_order_.size();
+        std::vector<unsigned> pred_offsets(n + 1, 0);
+        for (const auto& edge : edges) {
+            ++pred_offsets[edge.first + 1];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            pred_offsets[i + 1] += pred_offsets[i];
+        }
+        std::vector<unsigned> preds(edges.size());
+        std::vector<unsigned> fill(pred_offsets.begin(), pred_offsets.end() - 1);
+        for (const auto& edge : edges) {
+            preds[fill[edge.first]++] = edge.second;
+        }
+        semiNCA(parent, pred_offsets, preds, local_idom_);
+    }
+
+    void insertEdge(unsigned from, unsigned to) {
+        if (!isReachable(from)) {
+            return;  // Edges out of unreachable code change nothing
+        }
+        if (isReachable(to)) {
+            insertReachable(from, to);
+        } else {
+            insertUnreachable(from, to);
+        }
+    }
+
+    // Depth-based search: the blocks whose idom becomes nca(from, to) are exactly those
+    // reached from `to` through blocks deeper than nca + 1, visiting in decreasing depth and
+    // only counting a block as affected if it is no deeper than the block it was reached
+    // from.
+    void insertReachable(unsigned from, unsigned to) {
+        unsigned nca = nearestCommonDominatorByDepth(from, to);
+        if (nca == to || parentOf(to) == nca) {
+            return;
+        }
+        unsigned nca_depth = depth_[nca];
+        ++epoch_;
+        std::priority_queue<std::pair<unsigned, unsigned>> bucket;  // (depth, id), deepest first
+        std::vector<unsigned> affected;
+        std::vector<unsigned> unaffected;
+        bucket.push({depth_[to], to});
+        mark_[to] = epoch_;
+        while (!bucket.empty()) {
+            unsigned v = bucket.top().second;
+            bucket.pop();
+            affected.push_back(v);
+            unsigned level = depth_[v];
+            while (true) {
+                forEachSuccessor(v, [&](unsigned succ) {
+                    if (!isReachable(succ) || depth_[succ] <= nca_depth + 1 ||
+                        mark_[succ] == epoch_) {
+                        return;
+                    }
+                    mark_[succ] = epoch_;
+                    --work_budget_;
+                    if (depth_[succ] > level) {
+                        unaffected.push_back(succ);
+                    } else {
+                        bucket.push({depth_[succ], succ});
+                    }
+                });
+                if (unaffected.empty()) {
+                    break;
+                }
+                v = unaffected.back();
+                unaffected.pop_back();
+            }
+        }
+        for (unsigned v : affected) {
+            detach(v);
+            attach(v, nca);
+            depth_[v] = nca_depth + 1;
+        }
+        // The moved subtrees are disjoint now, so each depth is fixed once
+        for (unsigned v : affected) {
+            work_budget_ -= updateDepthsBelow(v);
+        }
+    }
+
+    // `to` and every block only reachable through it join the tree under `from`. Their idoms
+    // come from a local Semi-NCA; edges from that region into the old tree are then
+    // inserted one by one.
+    void insertUnreachable(unsigned from, unsigned to) {
+        std::vector<std::pair<unsigned, unsigned>> connecting;
+        runLocalSemiNCA(to, [&](unsigned v, unsigned succ) {
+            if (isReachable(succ)) {
+                connecting.push_back({v, succ});
+                return false;
+            }
+            return true;
+        });
+        work_budget_ -= local_order_.size();
+        attach(to, from);
+        depth_[to] = depth_[from] + 1;
+        for (size_t i = 1; i < local_order_.size(); ++i) {
+            attach(local_order_[i], local_order_[local_idom_[i]]);
+        }
+        updateDepthsBelow(to);
+        for (const auto& [v, succ] : connecting) {
+            insertReachable(v, succ);
+        }
+    }
+
+    void deleteEdge(unsigned from, unsigned to) {
+        if (!isReachable(from) || !isReachable(to)) {
+            return;
+        }
+        unsigned nca = nearestCommonDominatorByDepth(from, to);
+        if (nca == to) {
+            return;  // Back edge: any path using it already went through `to`
+        }
+        if (parentOf(to) != from || hasProperSupport(to)) {
+            // `to` stays reachable; only idoms inside the subtree of nca can change
+            rebuildSubtree(nca);
+        } else {
+            deleteUnreachable(to);
+        }
+    }
+
+    // True if some reachable predecessor of v is not dominated by v
+    bool hasProperSupport(unsigned v) const {
+        bool supported = false;
+        forEachPredecessor(v, [&](unsigned pred) {
+            supported = supported || (isReachable(pred) && !dominatesByDepth(v, pred));
+        });
+        return supported;
+    }
+
+    // The subtree of `to` became unreachable. Blocks outside it that it branched to may get
+    // deeper idoms, so the smallest subtree containing all of them is recomputed.
+    void deleteUnreachable(unsigned to) {
+        std::vector<unsigned> subtree;
+        collectSubtree(to, subtree);
+        unsigned level = depth_[to];
+        unsigned min_node = to;
+        for (unsigned v : subtree) {
+            forEachSuccessor(v, [&](unsigned succ) {
+                // Successors outside the subtree are never deeper than `to`
+                if (!isReachable(succ) || depth_[succ] > level) {
+                    return;
+                }
+                unsigned nca = nearestCommonDominatorByDepth(succ, to);
+                if (nca != succ && depth_[nca] < depth_[min_node]) {
+                    min_node = nca;
+                }
+            });
+        }
+
+        detach(to);
+        for (unsigned v : subtree) {
+            idom_[v] = kUndefined;
+            first_child_[v] = kUndefined;
+        }
+        if (min_node != to) {
+            rebuildSubtree(min_node);
+        }
+    }
+
+    // Recomputes every idom below root (root's own idom is unaffected). Any block outside
+    // the subtree that a block inside branches to is no deeper than root, so the depth test
+    // keeps the search inside the subtree.
+    void rebuildSubtree(unsigned root) {
+        std::vector<unsigned> subtree;
+        collectSubtree(root, subtree);
+        work_budget_ -= subtree.size();
+        if (work_budget_ < 0) {
+            return;
+        }
+        unsigned level = depth_[root];
+        runLocalSemiNCA(root, [&](unsigned, unsigned succ) {
+            return isReachable(succ) && depth_[succ] > level;
+        });
+        for (unsigned v : subtree) {
+            first_child_[v] = kUndefined;
+            if (v != root) {
+                idom_[v] = kUndefined;
+            }
+        }
+        for (size_t i = 1; i < local_order_.size(); ++i) {
+            attach(local_order_[i], local_order_[local_idom_[i]]);
+        }
+        updateDepthsBelow(root);
+    }
+
+    static void printBlock(std::ostream& os, const BasicBlock* bb) {
+        if (bb != nullptr) {
+            os << "BB" << bb->getId();
+        } else {
+            os << "(none)";
+        }
+    }
+
+    // Builds the children lists as a CSR array (children ordered by block id)
     void buildDomTree() {
-        for (auto const& [node, idom] : idom_) {
-            if (node != idom) {
-                dom_tree_[idom].push_back(node);
+        size_t num_blocks = num_ids_;
+        child_offsets_.assign(num_blocks + 1, 0);
+        for (size_t id = 0; id < num_blocks; ++id) {
+            if (idom_[id] != kUndefined && idom_[id] != id) {
+                ++child_offsets_[idom_[id] + 1];
+            }
+        }
+        for (size_t i = 0; i < num_blocks; ++i) {
+            child_offsets_[i + 1] += child_offsets_[i];
+        }
+
+        children_.resize(child_offsets_[num_blocks]);
+        child_ids_.resize(child_offsets_[num_blocks]);
+        std::vector<unsigned> fill(child_offsets_.begin(), child_offsets_.end() - 1);
+        for (size_t id = 0; id < num_blocks; ++id) {
+            if (idom_[id] != kUndefined && idom_[id] != id) {
+                unsigned slot = fill[idom_[id]]++;
+                children_[slot] = getBlock(id);
+                child_ids_[slot] = id;
             }
         }
     }
 
-    Graph* graph_;
-    std::vector<BasicBlock*> rpo_order_;
-    std::map<BasicBlock*, size_t> rpo_map_;
-    std::map<BasicBlock*, BasicBlock*> idom_;
-    std::map<BasicBlock*, std::vector<BasicBlock*>> dom_tree_;
+    // Numbers the dominator tree in one iterative DFS and builds the jump pointers used by
+    // findNearestCommonDominator: jump_[v] is either idom(v) or a node 2^k - 1 levels up.
+    void computeDFSNumbers() {
+        size_t num_blocks = num_ids_;
+        interval_.assign(num_blocks, DFSInterval());
+        depth_.assign(num_blocks, 0);
+        jump_.assign(num_blocks, kUndefined);
+        const auto& rpo_order = traversal_.getReversePostOrder();
+        if (rpo_order.empty()) {
+            return;
+        }
+
+        unsigned pre = 0;
+        unsigned post = 0;
+        unsigned root = rpo_order[0]->getId();
+        jump_[root] = root;
+        // Stack of (block id, index of the next child to visit)
+        std::vector<std::pair<unsigned, unsigned>> stack;
+        stack.reserve(rpo_order.size());
+        stack.push_back({root, child_offsets_[root]});
+        interval_[root].pre = pre++;
+        while (!stack.empty()) {
+            auto& [v, next] = stack.back();
+            if (next == child_offsets_[v + 1]) {
+                interval_[v].post = post++;
+                stack.pop_back();
+                continue;
+            }
+            unsigned child = child_ids_[next++];
+            unsigned jump = jump_[v];
+            depth_[child] = depth_[v] + 1;
+            jump_[child] = depth_[v] - depth_[jump] == depth_[jump] - depth_[jump_[jump]]
+                               ? jump_[jump]
+                               : v;
+            interval_[child].pre = pre++;
+            stack.push_back({child, child_offsets_[child]});
+        }
+    }
+
+    const Graph* graph_;
+    DomAlgorithm algorithm_;
+    CFGTraversalBase<Direction> traversal_;
+    std::unique_ptr<BasicBlock> exit_;  // Virtual exit, post-dominator trees only
+    size_t num_ids_ = 0;                // Blocks in the tables, plus the virtual exit
+    std::vector<unsigned> idom_;         // Block id -> idom id, kUndefined if unreachable
+    std::vector<unsigned> child_offsets_;  // CSR offsets into children_, indexed by block id
+    std::vector<BasicBlock*> children_;
+    std::vector<unsigned> child_ids_;  // children_ as ids, so walks need not touch the blocks
+    std::vector<DFSInterval> interval_;  // Indexed by block id
+    std::vector<unsigned> depth_;        // Indexed by block id
+    std::vector<unsigned> jump_;         // Indexed by block id, see computeDFSNumbers
+    bool rpo_stale_ = false;             // Set by applyUpdates until the next run()
+    bool verify_updates_ = false;
+
+    // applyUpdates() state, indexed by block id and reused across batches
+    std::vector<unsigned> first_child_;
+    std::vector<unsigned> next_sibling_;
+    std::vector<unsigned> prev_sibling_;
+    std::vector<unsigned> mark_;  // Visited iff mark_[v] == epoch_
+    unsigned epoch_ = 0;
+    std::vector<unsigned> local_num_;  // Preorder number in runLocalSemiNCA
+    std::vector<unsigned> local_order_;
+    std::vector<unsigned> local_idom_;
+    std::vector<unsigned> work_;
+    // Blocks a batch may still visit before giving up and finishing with a run()
+    int64_t work_budget_ = 0;
+    std::unordered_map<unsigned, PendingEdges> pending_succs_;
+    std::unordered_map<unsigned, PendingEdges> pending_preds_;
 };
 
+using DominatorTree = DominatorTreeBase<ForwardCFG>;
+// B post-dominates A if every path from A to a return goes through B. Blocks that cannot
+// reach a ReturnInst are not in the tree.
+using PostDominatorTree = DominatorTreeBase<ReverseCFG>;
+
 #endif  // DOMINATORS_H
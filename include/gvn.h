@@ -0,0 +1,52 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include <cstddef>
+
+#include "IR.h"
+#include "dominators.h"
+#include "pass_manager.h"
+#include "value_table.h"
+
+// Dominator-based global value numbering. Walks the dominator tree in preorder with a
+// scoped ValueTable of the constants, binary operations and casts available at the walk's
+// position; an instruction whose key (opcode, operand ids, constant or cast width) is
+// already in the table is redundant: its uses move to the dominating equivalent and it is
+// removed. Operands were renumbered before their users are reached, so one walk finds
+// chains of redundancies, and the work is linear in the instructions. Phis, loads and
+// params are left alone. The CFG is not changed, so dom_tree stays valid.
+class GVN {
+   public:
+    GVN(Graph* g, const DominatorTree& dom_tree) : graph_(g), dom_tree_(dom_tree) {
+    }
+
+    // Returns true if the graph changed
+    bool run();
+
+    // Instructions removed by the last run()
+    unsigned getNumEliminated() const {
+        return num_eliminated_;
+    }
+
+   private:
+    void numberBlock(BasicBlock* bb);
+
+    Graph* graph_;
+    const DominatorTree& dom_tree_;
+    ValueTable table_;
+    unsigned num_eliminated_ = 0;
+};
+
+// GVN in a PassManager pipeline
+class GVNPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "gvn";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return analysisBit(Analysis::Dominators);
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // GVN_H
@@ -0,0 +1,101 @@
+#ifndef IND_VAR_SIMPLIFY_H
+#define IND_VAR_SIMPLIFY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "induction_variables.h"
+#include "loop_info.h"
+#include "pass_manager.h"
+
+// Induction variable simplification, driven by InductionVariables. For every loop, innermost
+// first:
+//  - strength reduction: a MUL that is a recurrence becomes a new header phi that the latch
+//    advances with an ADD, starting from a value computed in the preheader;
+//  - exit values: when the back-edge-taken count is a constant, recurrences that are live
+//    after the loop are replaced outside of it by their value in the last iteration,
+//    computed in the preheader;
+//  - exit test replacement: when the loop's own test is the only thing keeping an induction
+//    variable alive, it is rewritten against another one, with the bound derived from the
+//    constant count;
+//  - elimination: an induction variable that duplicates another one at a constant distance
+//    is replaced by it, and induction variables that only feed their own increments are
+//    deleted.
+// The CFG does not change; loops without a preheader or with several latches are skipped.
+class IndVarSimplify {
+   public:
+    IndVarSimplify(Graph* g, const LoopInfo& loops, const DominatorTree& dom_tree)
+        : graph_(g), loops_(loops), dom_tree_(dom_tree) {
+    }
+
+    // Returns true if the graph changed
+    bool run();
+
+    // Statistics of the last run()
+    unsigned getNumStrengthReduced() const {
+        return num_strength_reduced_;
+    }
+    unsigned getNumExitValuesReplaced() const {
+        return num_exit_values_replaced_;
+    }
+    unsigned getNumExitTestsReplaced() const {
+        return num_exit_tests_replaced_;
+    }
+    unsigned getNumEliminated() const {
+        return num_eliminated_;
+    }
+
+   private:
+    bool hasChanged() const {
+        return num_strength_reduced_ != 0 || num_exit_values_replaced_ != 0 ||
+               num_exit_tests_replaced_ != 0 || num_eliminated_ != 0;
+    }
+    void reduceStrength(const Loop* loop);
+    void replaceExitValues(const Loop* loop);
+    void replaceExitTest(const Loop* loop);
+    void eliminateInductionVariables(const Loop* loop);
+    // True if phi and its increment chain are only used by each other and by `other`
+    static bool isSelfContained(const PhiInst* phi, const std::vector<Inst*>& chain,
+                                const Inst* other);
+    // Deletes phi and its increments if nothing else uses them
+    bool deleteIfDead(PhiInst* phi, const std::vector<Inst*>& chain);
+
+    // Creates unplaced instructions computing the recurrence's value in iteration k
+    Inst* materialize(const Recurrence& rec, uint64_t k);
+    Inst* emit(Inst* inst) {
+        code_.push_back(inst);
+        return inst;
+    }
+    // Places the instructions of code_ at the end of bb, before its terminator
+    void flushCode(BasicBlock* bb);
+    void removeInstructions(const std::vector<Inst*>& insts);
+
+    Graph* graph_;
+    const LoopInfo& loops_;
+    const DominatorTree& dom_tree_;
+    InductionVariables* ivs_ = nullptr;  // Of the current run()
+    std::vector<PhiInst*> phis_;         // Induction variables of the current loop
+    std::vector<Inst*> code_;            // Created by materialize(), not placed yet
+    std::vector<uint8_t> removed_;       // Instruction id -> being removed
+
+    unsigned num_strength_reduced_ = 0;
+    unsigned num_exit_values_replaced_ = 0;
+    unsigned num_exit_tests_replaced_ = 0;
+    unsigned num_eliminated_ = 0;
+};
+
+// IndVarSimplify in a PassManager pipeline
+class IndVarSimplifyPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "indvars";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return analysisBit(Analysis::Loops);
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // IND_VAR_SIMPLIFY_H
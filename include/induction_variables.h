@@ -0,0 +1,118 @@
+#ifndef INDUCTION_VARIABLES_H
+#define INDUCTION_VARIABLES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "loop_info.h"
+
+// An affine recurrence of a loop: in the loop's k-th iteration, counting from 0, the value is
+// start * scale + offset + step * k, in the wrap-around arithmetic of ADD and MUL. start is
+// defined outside the loop; without one (nullptr, scale 0) the value of every iteration is a
+// known constant.
+struct Recurrence {
+    const Loop* loop = nullptr;
+    Inst* start = nullptr;
+    int64_t scale = 0;
+    int64_t offset = 0;
+    int64_t step = 0;
+
+    bool hasConstantStart() const {
+        return start == nullptr;
+    }
+    // offset + step * k: the whole value if the start is constant
+    int64_t evaluateConstantPart(uint64_t k) const {
+        return int64_t(uint64_t(offset) + uint64_t(step) * k);
+    }
+
+    bool operator==(const Recurrence& other) const {
+        return loop == other.loop && start == other.start && scale == other.scale &&
+               offset == other.offset && step == other.step;
+    }
+};
+
+// Scalar evolution of the affine values of loops. A basic induction variable is a header phi
+// that enters with a loop-invariant value from the preheader and comes back from the only
+// latch as itself plus constants, through a chain of ADDs. Sums and constant multiples of
+// induction variables, and their sums with invariant values, are derived recurrences of the
+// same loop. Only loops with a preheader and a single latch have recurrences, and only
+// instructions of the loop's own blocks, not those of its subloops.
+//
+// The exit test of a loop is the COND_JUMP of its only exiting block, if that block runs on
+// every iteration. When it compares a recurrence with a constant start against a constant,
+// the iteration in which the loop leaves is computed exactly: the back edge is taken that
+// many times, and the blocks up to the exiting one run once more. Tests whose recurrence
+// would wrap around before failing get no count.
+class InductionVariables {
+   public:
+    InductionVariables(const Graph* g, const LoopInfo& loops, const DominatorTree& dom_tree)
+        : graph_(g), loops_(loops), dom_tree_(dom_tree) {
+    }
+
+    // Main function to run the analysis; loops and dom_tree must be up to date
+    void run();
+    // Analyzes one loop again, after a transform changed its code or that of its subloops;
+    // the results for other loops are kept
+    void analyzeLoop(const Loop* loop);
+
+    // nullptr unless inst is a recurrence of the innermost loop containing it
+    const Recurrence* getRecurrence(const Inst* inst) const {
+        unsigned id = inst->getId();
+        return id < recurrence_of_.size() && recurrence_of_[id] != kNone
+                   ? &recurrences_[recurrence_of_[id]]
+                   : nullptr;
+    }
+    // Records the recurrence of an instruction a transform created
+    void addRecurrence(const Inst* inst, const Recurrence& rec);
+
+    // Basic induction variables of the loop, in block order
+    const std::vector<PhiInst*>& getInductionVariables(const Loop* loop) const {
+        return getSummary(loop).phis;
+    }
+    // The ADDs from a basic induction variable to its latch input, in execution order; the
+    // first reads the phi, the last is the latch input. Empty if the phi no longer has the
+    // shape it had when analyzed.
+    std::vector<Inst*> getIncrementChain(const PhiInst* phi) const;
+
+    // The block holding the exit test, nullptr if the loop has none
+    BasicBlock* getExitingBlock(const Loop* loop) const {
+        return getSummary(loop).exiting;
+    }
+    bool hasConstantBackedgeTakenCount(const Loop* loop) const {
+        return getSummary(loop).has_count;
+    }
+    uint64_t getBackedgeTakenCount(const Loop* loop) const {
+        return getSummary(loop).count;
+    }
+
+   private:
+    static constexpr unsigned kNone = ~0u;
+    // Longest chain of constant ADDs accepted between a phi and its latch input
+    static constexpr unsigned kMaxChain = 8;
+
+    struct LoopSummary {
+        std::vector<PhiInst*> phis;
+        BasicBlock* exiting = nullptr;
+        bool has_count = false;
+        uint64_t count = 0;
+    };
+
+    const LoopSummary& getSummary(const Loop* loop) const {
+        return summaries_[loop->getHeader()->getId()];
+    }
+    bool isInvariant(const Loop* loop, const Inst* inst) const;
+    bool findBasicInductionVariable(const Loop* loop, PhiInst* phi, Recurrence* rec) const;
+    bool deriveRecurrence(const Loop* loop, const Inst* inst, Recurrence* rec) const;
+    void computeExit(const Loop* loop, LoopSummary* summary) const;
+
+    const Graph* graph_;
+    const LoopInfo& loops_;
+    const DominatorTree& dom_tree_;
+    std::vector<Recurrence> recurrences_;
+    std::vector<unsigned> recurrence_of_;  // Instruction id -> index in recurrences_
+    std::vector<LoopSummary> summaries_;   // Indexed by header block id
+};
+
+#endif  // INDUCTION_VARIABLES_H
@@ -0,0 +1,109 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "IR.h"
+#include "span.h"
+
+// Operations of the interpreter's register bytecode. Operands name value slots; for
+// branches, dst holds the index of the target instruction.
+enum class BytecodeOp : uint32_t {
+    ADD,            // dst = lhs + rhs
+    MUL,            // dst = lhs * rhs
+    CMP,            // dst = lhs <= rhs
+    MOV,            // dst = lhs: a MOV, or a phi move on a CFG edge
+    JUMP,           // goto dst
+    BRANCH_IF,      // if (lhs != 0) goto dst
+    BRANCH_IF_NOT,  // if (lhs == 0) goto dst
+    JUMP_IF_LE,     // if (lhs <= rhs) goto dst, a CMP fused with the COND_JUMP it feeds
+    JUMP_IF_GT,     // if (lhs > rhs) goto dst
+    RETURN,         // return lhs
+    RETURN_VOID,    // return 0
+};
+
+struct BytecodeInstr {
+    const void* handler;  // Address of the op's handler in the dispatch loop
+    BytecodeOp op;
+    uint32_t dst;
+    uint32_t lhs;
+    uint32_t rhs;
+};
+
+// Executes a Graph without walking its Inst objects. compile() lowers the graph once into
+// linear register bytecode: every value gets a dense int64 slot, and parameters and
+// constants are preloaded into the frame. Phis become parallel moves on their incoming
+// edges; a critical edge gets a small stub for its moves. Blocks are laid out in RPO so that
+// most jumps fall through. execute() runs the bytecode with a direct-threaded dispatch loop:
+// every instruction holds the address of its handler, and each handler jumps straight to
+// the next one.
+class Interpreter {
+   public:
+    explicit Interpreter(const Graph* g) : graph_(g) {
+    }
+
+    static constexpr unsigned kNoVariable = ~0u;
+
+    // Lowers the graph; returns false if it cannot be interpreted, see getError().
+    // Supports PARAM, CONST, ADD, MUL, CMP, MOV, JUMP, COND_JUMP, PHI and RETURN.
+    // Unreachable blocks are ignored.
+    bool compile();
+    const std::string& getError() const {
+        return error_;
+    }
+
+    // Values of the same variable share one slot, so copies between them disappear; used
+    // with the variables of OutOfSSA, whose phis then need no moves. Indexed by instruction
+    // id, kNoVariable for values of their own; parameters and constants always keep their
+    // own slots. Takes effect at the next compile().
+    void setVariables(Span<const unsigned> variables) {
+        variables_.assign(variables.begin(), variables.end());
+    }
+
+    // Runs the compiled function. args[i] is the value of ParamInst #i; missing arguments
+    // read as 0. A RETURN without a value returns 0. Thread-safe.
+    int64_t execute(Span<const int64_t> args) const;
+    int64_t execute(std::initializer_list<int64_t> args) const {
+        return execute(Span<const int64_t>(args.begin(), args.size()));
+    }
+
+    const std::vector<BytecodeInstr>& getCode() const {
+        return code_;
+    }
+    unsigned getNumSlots() const {
+        return num_slots_;
+    }
+
+    void dump(std::ostream& os) const;
+
+   private:
+    static constexpr unsigned kNoSlot = ~0u;
+    // Frames up to this many slots live on the native stack
+    static constexpr unsigned kInlineFrameSlots = 64;
+
+    bool assignSlots(const std::vector<BasicBlock*>& order);
+    // Appends moves that perform the phi copies of edge pred -> succ, all at once
+    bool emitPhiMoves(BasicBlock* pred, BasicBlock* succ);
+    void emit(BytecodeOp op, uint32_t dst, uint32_t lhs = 0, uint32_t rhs = 0) {
+        code_.push_back({nullptr, op, dst, lhs, rhs});
+    }
+    bool fail(const Inst* inst, const char* reason);
+
+    const Graph* graph_;
+    std::vector<BytecodeInstr> code_;
+    std::vector<unsigned> slots_;      // Indexed by instruction id
+    std::vector<unsigned> variables_;  // Indexed by instruction id, may be empty
+    // Slot layout: parameters by index, then constants, then the other values, then a
+    // scratch slot for breaking cycles of phi moves
+    std::vector<int64_t> constants_;
+    unsigned num_params_ = 0;
+    unsigned scratch_slot_ = 0;
+    unsigned num_slots_ = 0;
+    std::string error_;
+};
+
+#endif  // INTERPRETER_H
@@ -0,0 +1,47 @@
+#ifndef IR_PARSER_H
+#define IR_PARSER_H
+
+#include <string>
+#include <string_view>
+
+#include "IR.h"
+
+// Reads the text written by Graph::dump back into a Graph, so that dumping the result
+// reproduces the input. The text is lexed in one pass, in place, and the graph is built once
+// all of it has been read, so values and blocks may be used before they are defined.
+//
+// Values keep their ids. The instructions dump prints without an id (store, jmp, cond_jump
+// and a return without a value) take the unused ids in text order; ids left over are
+// skipped (see Graph::skipInstIds), as after a pass removed instructions. BB0 is the start
+// block, and the "; preds" comments are recomputed from the terminators.
+class IRParser {
+   public:
+    explicit IRParser(Graph* g) : graph_(g) {
+    }
+
+    // Builds the graph in g, which must be empty. Returns false on the first error, see
+    // getError(); g is left unchanged then.
+    bool parse(std::string_view text);
+    // Parses a memory-mapped file
+    bool parseFile(const std::string& path);
+
+    // "<line>:<column>: <message>", prefixed by the path for files
+    const std::string& getError() const {
+        return error_;
+    }
+    // 1-based position of the error, 0 if it has none
+    unsigned getErrorLine() const {
+        return error_line_;
+    }
+    unsigned getErrorColumn() const {
+        return error_column_;
+    }
+
+   private:
+    Graph* graph_;
+    std::string error_;
+    unsigned error_line_ = 0;
+    unsigned error_column_ = 0;
+};
+
+#endif  // IR_PARSER_H
@@ -0,0 +1,70 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "IR.h"
+
+// Compiles a Graph to x86-64 machine code in an executable mapping, callable as a System V
+// function: ParamInst #i receives the i-th argument (rdi, rsi, rdx, rcx, r8, r9, then the
+// stack) and RETURN leaves its value in rax.
+//
+// Registers come from LinearScan (see linear_scan.h) over twelve allocatable registers,
+// caller-saved ones first; the values it spills live in stack slots below the saved
+// registers, and rax and r11 stay free as scratch. Its layout, which keeps loops
+// contiguous, is the code layout, and the phi moves of an edge are emitted in the order it
+// gives, in a stub for edges that leave a COND_JUMP. Constants become immediates, values
+// without uses are not computed, and a CMP that only feeds its block's COND_JUMP becomes a
+// compare-and-branch.
+class JitFunction {
+   public:
+    explicit JitFunction(const Graph* g) : graph_(g) {
+    }
+    ~JitFunction();
+    JitFunction(const JitFunction&) = delete;
+    JitFunction& operator=(const JitFunction&) = delete;
+
+    // Whether this build can generate and run native code
+    static bool isSupported();
+
+    // Generates the code; returns false if the graph cannot be compiled, see getError().
+    // Supports the same instructions as the Interpreter. Unreachable blocks are ignored;
+    // the predecessor lists must be up to date.
+    bool compile();
+    const std::string& getError() const {
+        return error_;
+    }
+
+    // Calls the compiled code with one argument per parameter index
+    template <typename... Args>
+    int64_t operator()(Args... args) const {
+        return getFunction<int64_t (*)(decltype(static_cast<int64_t>(args))...)>()(
+            static_cast<int64_t>(args)...);
+    }
+    template <typename Fn>
+    Fn getFunction() const {
+        return reinterpret_cast<Fn>(code_);
+    }
+
+    size_t getCodeSize() const {
+        return code_size_;
+    }
+    // Values that did not get a register
+    unsigned getNumSpills() const {
+        return num_spills_;
+    }
+
+   private:
+    void release();
+
+    const Graph* graph_;
+    void* code_ = nullptr;
+    size_t mapping_size_ = 0;
+    size_t code_size_ = 0;
+    unsigned num_spills_ = 0;
+    std::string error_;
+};
+
+#endif  // JIT_H
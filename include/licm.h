@@ -0,0 +1,64 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "loop_info.h"
+#include "pass_manager.h"
+
+// Loop-invariant code motion. Constants, binary operations and casts whose operands are all
+// defined outside a loop, or are hoisted themselves, move to the end of the loop's
+// preheader, so they run once per loop entry instead of once per iteration. None of them
+// can trap, so they are hoisted from any block of the loop, not only from blocks that run
+// on every iteration. Loops are handled innermost first, so a value can climb out of a
+// whole nest.
+//
+// A loop with candidates but no preheader gets one first: a new block that takes over
+// the header's edges from outside the loop, with phis for header inputs that differed
+// between those edges. Then the predecessor lists and dom_tree are recomputed, so dom_tree
+// stays valid for the caller. Loops headed by the start block are skipped.
+class LICM {
+   public:
+    LICM(Graph* g, DominatorTree* dom_tree) : graph_(g), dom_tree_(dom_tree) {
+    }
+
+    // Returns true if the graph changed
+    bool run();
+
+    // Statistics of the last run()
+    unsigned getNumHoisted() const {
+        return num_hoisted_;
+    }
+    unsigned getNumPreheadersCreated() const {
+        return num_preheaders_created_;
+    }
+
+   private:
+    static bool isHoistable(const Inst* inst);
+    bool hasCandidates(const Loop* loop, const LoopInfo& loops) const;
+    void createPreheader(const Loop* loop, const LoopInfo& loops);
+    void hoist(const Loop* loop, const LoopInfo& loops);
+
+    Graph* graph_;
+    DominatorTree* dom_tree_;
+    std::vector<unsigned> hoisted_from_;  // Instruction id -> loop stamp of its hoisting
+    unsigned stamp_ = 0;
+    unsigned num_hoisted_ = 0;
+    unsigned num_preheaders_created_ = 0;
+};
+
+// LICM in a PassManager pipeline
+class LICMPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "licm";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return analysisBit(Analysis::Dominators);
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // LICM_H
@@ -0,0 +1,207 @@
+#ifndef LINEAR_SCAN_H
+#define LINEAR_SCAN_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "IR.h"
+#include "loop_info.h"
+#include "span.h"
+
+// Where LinearScan keeps a value. Registers are numbered 0..n-1 in the target's register
+// file; the emitter maps them to machine registers and prefers low numbers for registers
+// that are cheap to use.
+struct Location {
+    enum Kind : uint8_t {
+        NONE,        // Nothing: a value without uses, or a compare fused into its branch
+        REGISTER,    // Register `index`
+        STACK_SLOT,  // Stack slot `index`, 8 bytes each
+        CONSTANT,    // A CONST, which the emitter materializes itself
+        SCRATCH,     // The emitter's scratch register; only edge moves use it
+    };
+
+    static Location reg(unsigned index) {
+        return {REGISTER, index};
+    }
+    static Location slot(unsigned index) {
+        return {STACK_SLOT, index};
+    }
+
+    bool operator==(const Location& other) const {
+        return kind == other.kind && index == other.index;
+    }
+    bool operator!=(const Location& other) const {
+        return !(*this == other);
+    }
+
+    Kind kind = NONE;
+    unsigned index = 0;
+};
+
+// Live positions [from, to) of a value
+struct LiveRange {
+    unsigned from;
+    unsigned to;
+};
+
+// One move of an edge: dst = src. For a CONSTANT source, value is the ConstInst.
+struct EdgeMove {
+    Location dst;
+    Location src;
+    const Inst* value;
+};
+
+// Register allocation on SSA live intervals (Poletto and Sarkar; Wimmer and Franz), for a
+// backend with num_registers registers and as many stack slots as it needs.
+//
+// The reachable blocks are laid out in reverse post-order, except that every loop is kept
+// contiguous, its blocks starting at its header. Instructions then get even positions in
+// that order: a block's phis are defined at its start position, the k-th instruction at
+// start + 2(k + 1), and the block ends at start + 2(n + 1), where the next block starts.
+// Parameters are defined at position 0, before the first block. A value's live interval
+// is the list of ranges it is live in, one per block of its liveness, so it has holes
+// wherever the layout leaves its live region. Liveness comes from walking up the CFG from
+// each use to the definition, so building an interval costs as much as it is long. An
+// operand is live up to, not including, the position that reads it, so the result of an
+// instruction may take the register of an operand that dies there. A CMP whose only use
+// is its block's COND_JUMP is fused into the branch: it gets no location and its operands
+// are read at the branch.
+//
+// Intervals are handled in order of their start. Each holds its register for its whole
+// lifetime, holes included, but another interval can use the register in a hole. A phi
+// prefers the register of an input, and a value the register of the phi it feeds, which
+// removes their move. When no register is free for a whole interval, the interval or the
+// ones in the register they conflict least with are spilled, whichever weighs less: every
+// definition and use weighs 10^(loop depth), over the length of the interval. Spilled
+// intervals live in one stack slot for their whole lifetime and are not split; emitters
+// read and write stack slots in place. Slots are shared by spilled intervals that do not
+// overlap. A phi reads its input at the end of the predecessor: the phis of each edge are
+// one parallel copy between locations, sequentialized into getEdgeMoves(), with cycles
+// broken through the SCRATCH location. Allocation is linear in the number of instructions
+// plus a sort of the intervals, times the registers and the intervals in holes checked at
+// each step.
+class LinearScan {
+   public:
+    static constexpr unsigned kNoPosition = ~0u;
+
+    LinearScan(const Graph* g, unsigned num_registers)
+        : graph_(g), num_registers_(num_registers) {
+    }
+
+    // Allocates everything again; the predecessor lists must be up to date
+    void run();
+
+    // A CMP whose only use is the COND_JUMP of its own block: emitters branch on the compare
+    static bool isFusedCompare(const Inst* inst);
+
+    Location getLocation(const Inst* value) const;
+    // Ranges of the value's interval in increasing order, empty if it has none
+    Span<const LiveRange> getRanges(const Inst* value) const;
+    // Reachable blocks in layout order, starting with the start block
+    const std::vector<BasicBlock*>& getBlockOrder() const {
+        return order_;
+    }
+    // Positions of a block and of an instruction, kNoPosition if unreachable
+    unsigned getBlockStart(const BasicBlock* bb) const {
+        return bb->getId() < block_start_.size() ? block_start_[bb->getId()] : kNoPosition;
+    }
+    unsigned getBlockEnd(const BasicBlock* bb) const;
+    unsigned getPosition(const Inst* inst) const {
+        unsigned id = inst->getId();
+        return id < position_.size() ? position_[id] : kNoPosition;
+    }
+    // Moves that perform the phi copies of the edge pred -> succ, in order. Empty if the
+    // edge needs none, in particular when every phi input is already in its phi's location.
+    Span<const EdgeMove> getEdgeMoves(const BasicBlock* pred, const BasicBlock* succ) const;
+
+    unsigned getNumRegisters() const {
+        return num_registers_;
+    }
+    bool isRegisterUsed(unsigned index) const {
+        return used_registers_[index];
+    }
+    unsigned getNumStackSlots() const {
+        return num_stack_slots_;
+    }
+
+    // Statistics of the last run()
+    unsigned getNumIntervals() const {
+        return intervals_.size();
+    }
+    // Intervals that ended up in stack slots, including evicted ones
+    unsigned getNumSpilled() const {
+        return num_spilled_;
+    }
+    // Intervals that lost their register to a heavier one
+    unsigned getNumEvicted() const {
+        return num_evicted_;
+    }
+    // Phi inputs on reachable edges, and the moves left for them, including saves into
+    // the scratch location
+    unsigned getNumPhiCopies() const {
+        return num_phi_copies_;
+    }
+    unsigned getNumEdgeMoves() const {
+        return edge_moves_.size();
+    }
+
+    void dump(std::ostream& os) const;
+
+   private:
+    static constexpr unsigned kNone = ~0u;
+
+    struct Interval {
+        Inst* value;
+        unsigned first_range;  // Ranges [first_range, end_range) of ranges_
+        unsigned end_range;
+        unsigned cursor;  // First range that does not end before the current position
+        double weight;
+        Location location;
+    };
+
+    void layoutBlocks(const std::vector<BasicBlock*>& rpo, const LoopInfo& loops);
+    void buildIntervals(const LoopInfo& loops);
+    unsigned getStart(const Interval& it) const {
+        return ranges_[it.first_range].from;
+    }
+    unsigned getEnd(const Interval& it) const {
+        return ranges_[it.end_range - 1].to;
+    }
+    bool covers(Interval& it, unsigned position);
+    unsigned nextIntersection(const Interval& it, const Interval& current) const;
+    unsigned findHint(const Interval& current) const;
+    void allocate(unsigned current);
+    void assignStackSlots();
+    void resolveEdges();
+
+    const Graph* graph_;
+    unsigned num_registers_;
+    std::vector<BasicBlock*> order_;
+    std::vector<unsigned> block_start_;  // Indexed by block id
+    std::vector<unsigned> position_;     // Indexed by instruction id
+    std::vector<unsigned> interval_of_;  // Indexed by instruction id, kNone if none
+    std::vector<Interval> intervals_;
+    std::vector<LiveRange> ranges_;
+
+    // Allocation state: interval indices, and what each register holds
+    std::vector<unsigned> active_;
+    std::vector<unsigned> inactive_;
+    std::vector<unsigned> spilled_;
+    std::vector<unsigned> free_until_;
+    std::vector<double> conflict_weight_;
+    std::vector<bool> used_registers_;
+    unsigned num_stack_slots_ = 0;
+
+    // Moves of the edge into the k-th predecessor entry of block b:
+    // [edge_begin_[first_edge_[b] + k], edge_begin_[first_edge_[b] + k + 1])
+    std::vector<EdgeMove> edge_moves_;
+    std::vector<unsigned> edge_begin_;
+    std::vector<unsigned> first_edge_;  // Indexed by block id
+
+    unsigned num_spilled_ = 0;
+    unsigned num_evicted_ = 0;
+    unsigned num_phi_copies_ = 0;
+};
+
+#endif  // LINEAR_SCAN_H
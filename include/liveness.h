@@ -0,0 +1,136 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "cfg_traversal.h"
+#include "span.h"
+
+// Live-in and live-out sets of the blocks of an SSA graph. A value is live-in to a block if
+// some path from the block's entry reaches a use of it, and live-out if such a path starts
+// at the block's exit. A phi reads its input at the end of the corresponding predecessor,
+// so the input is live-out of that predecessor and not live-in to the phi's block; the phi
+// itself is defined at the top of its block. Unreachable blocks have empty sets and their
+// uses are ignored.
+//
+// Only values used outside their own block, or by a phi, can be in any set. They get dense
+// indices in reverse post-order, so the values a block defines form one index range. A
+// value live at a block dominates it and so comes earlier in reverse post-order: a block's
+// rows stop after its own values, padded to whole 256-bit lanes, which about halves the
+// table of a dense bit matrix. All rows live in one flat, 32-byte aligned table.
+//
+// The data-flow problem is solved on a worklist that always evaluates the pending block
+// earliest in post-order: successors come before their predecessors, and a loop's body
+// settles before the blocks above its header are revisited. A block only takes in the
+// live-in rows of the successors that grew since its last evaluation. Rows are combined
+// with AVX2 kernels when the CPU has them and with plain word loops otherwise.
+class Liveness {
+   public:
+    static constexpr unsigned kNoIndex = ~0u;
+
+    explicit Liveness(const Graph* g) : graph_(g), traversal_(g) {
+    }
+
+    // Main function to run the analysis; the predecessor lists must be up to date
+    void run();
+
+    // Index of a value that can be live across blocks, kNoIndex for the others
+    unsigned getIndex(const Inst* value) const {
+        unsigned id = value->getId();
+        return id < index_of_.size() ? index_of_[id] : kNoIndex;
+    }
+    size_t getNumValues() const {
+        return values_.size();
+    }
+    Inst* getValue(unsigned index) const {
+        return values_[index];
+    }
+
+    // Constant time: one bit of the block's row
+    bool isLiveIn(const Inst* value, const BasicBlock* bb) const {
+        return hasBit(getIndex(value), bb) && testBit(liveIn(bb->getId()), getIndex(value));
+    }
+    bool isLiveOut(const Inst* value, const BasicBlock* bb) const {
+        return hasBit(getIndex(value), bb) && testBit(liveOut(bb->getId()), getIndex(value));
+    }
+
+    // The sets as rows of words, bit i standing for getValue(i); the words after the end of
+    // a row are zero
+    Span<const uint64_t> getLiveInWords(const BasicBlock* bb) const {
+        size_t size = getRowSize(bb);
+        return size != 0 ? Span<const uint64_t>(liveIn(bb->getId()), size)
+                         : Span<const uint64_t>();
+    }
+    Span<const uint64_t> getLiveOutWords(const BasicBlock* bb) const {
+        size_t size = getRowSize(bb);
+        return size != 0 ? Span<const uint64_t>(liveOut(bb->getId()), size)
+                         : Span<const uint64_t>();
+    }
+    // The sets as values, in index order
+    std::vector<Inst*> getLiveIn(const BasicBlock* bb) const;
+    std::vector<Inst*> getLiveOut(const BasicBlock* bb) const;
+
+    // Words of all rows together
+    size_t getTableSize() const {
+        return table_size_;
+    }
+    // Block evaluations the last run() needed to reach the fixed point
+    unsigned getNumEvaluations() const {
+        return num_evaluations_;
+    }
+    // True if the sets are combined with AVX2
+    static bool usesSIMD();
+
+   private:
+    size_t getRowSize(const BasicBlock* bb) const {
+        return bb->getId() < num_blocks_ ? row_size_[bb->getId()] : 0;
+    }
+    // The live-in row of a block, followed by its live-out row
+    const uint64_t* liveIn(unsigned block) const {
+        return storage_.data() + base_ + row_offset_[block];
+    }
+    const uint64_t* liveOut(unsigned block) const {
+        return liveIn(block) + row_size_[block];
+    }
+    uint64_t* liveIn(unsigned block) {
+        return storage_.data() + base_ + row_offset_[block];
+    }
+    uint64_t* liveOut(unsigned block) {
+        return liveIn(block) + row_size_[block];
+    }
+    bool hasBit(unsigned index, const BasicBlock* bb) const {
+        return index != kNoIndex && index / 64 < getRowSize(bb);
+    }
+    static bool testBit(const uint64_t* words, unsigned index) {
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+
+    void numberValues();
+    void initializeSets();
+    void solve();
+    std::vector<Inst*> collect(Span<const uint64_t> words) const;
+
+    const Graph* graph_;
+    CFGTraversal traversal_;
+    std::vector<unsigned> index_of_;  // Instruction id -> index, kNoIndex if never live
+    std::vector<Inst*> values_;       // Index -> value
+    // Indices of the values each block defines, indexed by block id: [first, first + count)
+    std::vector<unsigned> first_def_;
+    std::vector<unsigned> num_defs_;
+
+    // The rows, then a row of killed values as long as the longest one, all zero between
+    // evaluations. Offsets are in words and multiples of a lane, from base_, the first word
+    // of storage_ on a 32-byte boundary.
+    std::vector<uint64_t> storage_;
+    size_t base_ = 0;
+    std::vector<size_t> row_offset_;  // Indexed by block id
+    std::vector<size_t> row_size_;    // Indexed by block id, in words
+    size_t kill_offset_ = 0;
+    size_t table_size_ = 0;
+    unsigned num_blocks_ = 0;
+    unsigned num_evaluations_ = 0;
+};
+
+#endif  // LIVENESS_H
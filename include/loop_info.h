@@ -0,0 +1,136 @@
+#ifndef LOOP_INFO_H
+#define LOOP_INFO_H
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+
+// A natural loop: the header, which dominates the whole loop, and every block that reaches
+// one of its back edges without passing through the header. Loops with the same header are
+// one loop. Nested loops are fully contained in their parent.
+class Loop {
+   public:
+    BasicBlock* getHeader() const {
+        return header_;
+    }
+    // The innermost loop containing this one, nullptr for a top-level loop
+    Loop* getParent() const {
+        return parent_;
+    }
+    // 1 for a top-level loop
+    unsigned getDepth() const {
+        return depth_;
+    }
+    const std::vector<Loop*>& getSubLoops() const {
+        return sub_loops_;
+    }
+    // All blocks, including those of subloops, in reverse post-order; the header comes first
+    const std::vector<BasicBlock*>& getBlocks() const {
+        return blocks_;
+    }
+    // Sources of the back edges
+    const std::vector<BasicBlock*>& getLatches() const {
+        return latches_;
+    }
+    // The only predecessor of the header outside the loop, if the header is its only
+    // successor; nullptr otherwise
+    BasicBlock* getPreheader() const {
+        return preheader_;
+    }
+
+    // True if other is this loop or nested in it
+    bool contains(const Loop* other) const {
+        while (other != nullptr && other->depth_ > depth_) {
+            other = other->parent_;
+        }
+        return other == this;
+    }
+
+   private:
+    friend class LoopInfo;
+
+    explicit Loop(BasicBlock* header) : header_(header) {
+    }
+
+    BasicBlock* header_;
+    Loop* parent_ = nullptr;
+    unsigned depth_ = 0;
+    std::vector<Loop*> sub_loops_;
+    std::vector<BasicBlock*> blocks_;
+    std::vector<BasicBlock*> latches_;
+    BasicBlock* preheader_ = nullptr;
+};
+
+// Natural loops of a graph and their nesting. A back edge is an edge whose target dominates
+// its source. Headers are visited in post-order, so inner loops are found first; a loop's
+// body is collected by walking predecessors back from its latches, and whenever the walk
+// enters a loop found earlier it jumps to that loop's header and adopts the loop as a
+// child, so the bodies of inner loops are not walked again.
+//
+// A cycle entered other than through a block that dominates it is irreducible and forms no
+// loop here. Such cycles are detected from the retreating edges of the DFS: an edge to a
+// block earlier in reverse post-order whose target does not dominate its source. Unreachable
+// blocks belong to no loop.
+class LoopInfo {
+   public:
+    LoopInfo(const Graph* g, const DominatorTree& dom_tree) : graph_(g), dom_tree_(dom_tree) {
+    }
+
+    // Main function to run the analysis; dom_tree and the predecessor lists must be up to date
+    void run();
+
+    // Inner loops come before the loops that contain them
+    size_t getNumLoops() const {
+        return loops_.size();
+    }
+    Loop* getLoop(size_t i) const {
+        return loops_[i].get();
+    }
+    const std::vector<Loop*>& getTopLevelLoops() const {
+        return top_level_loops_;
+    }
+
+    // The innermost loop containing bb, nullptr if there is none
+    Loop* getLoopFor(const BasicBlock* bb) const {
+        unsigned id = bb->getId();
+        return id < innermost_.size() ? innermost_[id] : nullptr;
+    }
+    // 0 outside of loops
+    unsigned getLoopDepth(const BasicBlock* bb) const {
+        Loop* loop = getLoopFor(bb);
+        return loop != nullptr ? loop->getDepth() : 0;
+    }
+    bool contains(const Loop* loop, const BasicBlock* bb) const {
+        return loop->contains(getLoopFor(bb));
+    }
+    bool isLoopHeader(const BasicBlock* bb) const {
+        Loop* loop = getLoopFor(bb);
+        return loop != nullptr && loop->getHeader() == bb;
+    }
+
+    bool isReducible() const {
+        return irreducible_entries_.empty();
+    }
+    // Targets of the retreating edges that are not back edges, in reverse post-order
+    const std::vector<BasicBlock*>& getIrreducibleEntries() const {
+        return irreducible_entries_;
+    }
+
+    void dump(std::ostream& os) const;
+
+   private:
+    void discoverLoop(BasicBlock* header, const CFGTraversal& traversal);
+
+    const Graph* graph_;
+    const DominatorTree& dom_tree_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::vector<Loop*> top_level_loops_;
+    std::vector<Loop*> innermost_;  // Indexed by block id
+    std::vector<BasicBlock*> irreducible_entries_;
+    std::vector<BasicBlock*> worklist_;
+};
+
+#endif  // LOOP_INFO_H
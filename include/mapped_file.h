@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file; the data is page-aligned. An empty file opens
+// with no data.
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file cannot be mapped, see getError()
+    bool open(const std::string& path);
+    void close();
+    const std::string& getError() const {
+        return error_;
+    }
+
+    const void* getData() const {
+        return data_;
+    }
+    size_t getSize() const {
+        return size_;
+    }
+    std::string_view getText() const {
+        return std::string_view(static_cast<const char*>(data_), size_);
+    }
+
+   private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    std::string error_;
+};
+
+#endif  // MAPPED_FILE_H
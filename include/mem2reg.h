@@ -0,0 +1,83 @@
+#ifndef MEM2REG_H
+#define MEM2REG_H
+
+#include <vector>
+
+#include "IR.h"
+#include "dominance_frontier.h"
+#include "dominators.h"
+#include "pass_manager.h"
+
+// Promotes AllocaInst slots that are only loaded from and stored to into SSA values. Phis
+// are pruned: a variable gets one only in the iterated dominance frontier of its stores
+// and only where it is live on entry, so no dead phis are created. Renaming then replaces
+// every load with the value that reaches it in one walk of the dominator tree, and the
+// slots, loads and stores are removed. A load that no store reaches reads a zero constant,
+// which is placed in the start block. The CFG is not changed, so dom_tree stays valid.
+// The start block must have no predecessors; otherwise nothing is promoted.
+class Mem2Reg {
+   public:
+    Mem2Reg(Graph* g, const DominatorTree& dom_tree)
+        : graph_(g), dom_tree_(dom_tree), idf_(g, dom_tree) {
+    }
+
+    // Main function to run the pass; returns the number of promoted slots
+    unsigned run();
+
+    // Phis created by the last run()
+    const std::vector<PhiInst*>& getInsertedPhis() const {
+        return inserted_phis_;
+    }
+
+   private:
+    static constexpr unsigned kNotPromoted = ~0u;
+
+    // Variable index of a load or store of a promoted slot, kNotPromoted otherwise
+    unsigned getVariable(const Inst* inst) const;
+    bool isPromotable(const Inst* alloca) const;
+    void placePhis(unsigned var, const std::vector<BasicBlock*>& def_blocks,
+                   const std::vector<BasicBlock*>& live_seeds);
+    void rename();
+    Inst* getZero();
+
+    Graph* graph_;
+    const DominatorTree& dom_tree_;
+    IteratedDominanceFrontier idf_;
+
+    std::vector<unsigned> slot_var_;  // Indexed by instruction id
+    unsigned num_vars_ = 0;
+    // Phis per block (indexed by block id), each with its variable, in variable order
+    std::vector<std::vector<std::pair<PhiInst*, unsigned>>> block_phis_;
+    std::vector<PhiInst*> inserted_phis_;
+    Inst* zero_ = nullptr;
+
+    // Scratch for placePhis(); per-block stamps hold the variable index + 1
+    std::vector<unsigned> live_mark_;
+    std::vector<unsigned> def_mark_;
+    std::vector<BasicBlock*> live_in_;
+    std::vector<BasicBlock*> worklist_;
+    std::vector<BasicBlock*> phi_blocks_;
+};
+
+// Mem2Reg in a PassManager pipeline; it changes instructions only, so every CFG analysis
+// survives it
+class Mem2RegPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "mem2reg";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return analysisBit(Analysis::Dominators);
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+
+    // Slots promoted by the last run()
+    unsigned getNumPromoted() const {
+        return num_promoted_;
+    }
+
+   private:
+    unsigned num_promoted_ = 0;
+};
+
+#endif  // MEM2REG_H
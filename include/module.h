@@ -0,0 +1,90 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "IR.h"
+#include "arena.h"
+
+// Collection of functions. Graphs share nothing, so different functions of a module may be
+// analysed and transformed concurrently (see ModuleDriver); the module itself is not
+// thread-safe and must not be changed while a driver runs over it.
+class Module {
+   public:
+    explicit Module(const std::string& name) : name_(name) {
+    }
+    Module(const Module&) = delete;
+    Module& operator=(const Module&) = delete;
+
+    const std::string& getName() const {
+        return name_;
+    }
+
+    Graph* createFunction(const std::string& name) {
+        functions_.push_back(std::make_unique<Graph>(name));
+        return functions_.back().get();
+    }
+    size_t getNumFunctions() const {
+        return functions_.size();
+    }
+    Graph* getFunction(size_t index) const {
+        return functions_[index].get();
+    }
+
+    // Dumps every function in creation order
+    void dump(std::ostream& os) const;
+
+   private:
+    std::string name_;
+    std::vector<std::unique_ptr<Graph>> functions_;
+};
+
+// What a job running on a ModuleDriver thread may use besides its function. Each thread owns
+// one context; the scratch arena is emptied after every function.
+class alignas(64) WorkerContext {
+   public:
+    unsigned getWorker() const {
+        return worker_;
+    }
+    size_t getFunctionIndex() const {
+        return function_index_;
+    }
+    Arena& getScratch() {
+        return scratch_;
+    }
+
+   private:
+    friend class ModuleDriver;
+
+    unsigned worker_ = 0;
+    size_t function_index_ = 0;
+    Arena scratch_;
+};
+
+// Runs a per-function job over all functions of a module on several threads (see
+// parallelFor). The job may only touch the graph it is given and its context, which keeps the
+// functions independent and the result the same for any number of threads.
+class ModuleDriver {
+   public:
+    using Job = std::function<void(Graph& g, WorkerContext& ctx)>;
+
+    // 0 uses one thread per hardware thread
+    explicit ModuleDriver(unsigned num_threads = 0);
+
+    unsigned getNumThreads() const {
+        return contexts_.size();
+    }
+
+    // Largest functions are started first, so that a big one does not end up running alone
+    // at the end
+    void run(Module& module, const Job& job);
+
+   private:
+    std::vector<WorkerContext> contexts_;  // One per thread
+};
+
+#endif  // MODULE_H
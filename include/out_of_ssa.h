@@ -0,0 +1,128 @@
+#ifndef OUT_OF_SSA_H
+#define OUT_OF_SSA_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "IR.h"
+#include "dominators.h"
+#include "liveness.h"
+#include "loop_info.h"
+#include "pass_manager.h"
+
+// Lowers phis to copies, for backends that give every variable one storage location.
+//
+// First every critical edge into a block with phis is split with a new block, so each phi
+// copy has a block of its own to go in: the end of its predecessor. Then each phi and its
+// inputs are coalesced into one congruence class where possible, so that the copy
+// disappears. Two classes merge only if no member of one interferes with a member of the
+// other, checked in linear time by walking both in dominance order (Budimlic et al.): in
+// SSA, two values interfere iff the dominating one is live at the other's definition, and
+// it is enough to check each value against its closest dominating member. Copies on the
+// edges of the deepest loops are coalesced first. Constants and parameters are never
+// coalesced.
+//
+// The copies that remain on an edge form a parallel copy between classes, which is
+// sequentialized into MovInsts at the end of the predecessor. A class is written only
+// after the copies that read it; a cycle is broken by saving one class in a temporary
+// first, so it costs one extra move (Boissinot et al.). The phis stay, now only taking
+// their MOVs or coalesced values, so the graph is still valid SSA, and every phi is in
+// the class of all its inputs. getVariables() numbers the classes with phis: a backend
+// that keeps each variable in one location, like Interpreter::setVariables, needs no code
+// for phis at all.
+class OutOfSSA {
+   public:
+    static constexpr unsigned kNoVariable = ~0u;
+
+    explicit OutOfSSA(Graph* g) : graph_(g) {
+    }
+
+    // Returns true if the graph changed; the predecessor lists are rebuilt if edges were
+    // split
+    bool run();
+
+    // Variable of each value by instruction id, kNoVariable for values outside the
+    // classes of phis. Temporaries share a variable of their own.
+    const std::vector<unsigned>& getVariables() const {
+        return variables_;
+    }
+    unsigned getVariable(const Inst* value) const {
+        unsigned id = value->getId();
+        return id < variables_.size() ? variables_[id] : kNoVariable;
+    }
+    unsigned getNumVariables() const {
+        return num_variables_;
+    }
+
+    // Statistics of the last run(). Every phi input on a reachable edge is one phi copy; it
+    // is either coalesced or becomes a move.
+    unsigned getNumEdgesSplit() const {
+        return num_edges_split_;
+    }
+    unsigned getNumPhiCopies() const {
+        return num_phi_copies_;
+    }
+    unsigned getNumCoalesced() const {
+        return num_coalesced_;
+    }
+    // MovInsts created, including the saves into temporaries
+    unsigned getNumMoves() const {
+        return num_moves_;
+    }
+    unsigned getNumTemporaries() const {
+        return num_temporaries_;
+    }
+
+   private:
+    void splitCriticalEdges();
+    void numberInstructions();
+    unsigned find(unsigned id);
+    bool interfere(const Inst* a, const Inst* b) const;
+    bool tryMerge(unsigned x, unsigned y);
+    void coalesce(const LoopInfo& loops);
+    void lowerParallelCopy(BasicBlock* pred, BasicBlock* succ);
+    void assignVariables();
+
+    Graph* graph_;
+    const DominatorTree* dom_tree_ = nullptr;
+    const Liveness* liveness_ = nullptr;
+    std::vector<uint64_t> order_;   // Instruction id -> (dominator preorder, position) key
+    std::vector<unsigned> parent_;  // Union-find over instruction ids
+    // Members of each class root in dominance order
+    std::vector<std::vector<Inst*>> members_;
+    std::vector<Inst*> merged_;  // Scratch of tryMerge
+    std::vector<Inst*> stack_;
+    // Scratch of lowerParallelCopy, indexed by class root, then one more for the temporary
+    std::vector<unsigned> loc_;
+    std::vector<unsigned> pred_;
+    std::vector<bool> written_;
+    std::vector<Inst*> holder_;
+    std::vector<unsigned> variables_;
+    unsigned num_variables_ = 0;
+    Inst* temporary_ = nullptr;  // First temporary, whose class the others join
+
+    unsigned num_edges_split_ = 0;
+    unsigned num_phi_copies_ = 0;
+    unsigned num_coalesced_ = 0;
+    unsigned num_moves_ = 0;
+    unsigned num_temporaries_ = 0;
+};
+
+// OutOfSSA in a PassManager pipeline; with a report stream, prints the statistics of every
+// function it lowers
+class OutOfSSAPass : public FunctionPass {
+   public:
+    explicit OutOfSSAPass(std::ostream* report = nullptr) : report_(report) {
+    }
+
+    const char* getName() const override {
+        return "out-of-ssa";
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+
+   private:
+    std::ostream* report_;
+};
+
+#endif  // OUT_OF_SSA_H
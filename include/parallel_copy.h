@@ -0,0 +1,58 @@
+#ifndef PARALLEL_COPY_H
+#define PARALLEL_COPY_H
+
+#include <algorithm>
+#include <vector>
+
+// One copy dst = src of a parallel copy between locations of type L
+template <typename L>
+struct ParallelMove {
+    L dst;
+    L src;
+};
+
+// Sequentializes a parallel copy between a backend's locations, such as the phi moves of an
+// edge, calling emit(move) in an order that reads every source before it is overwritten.
+// Move is any type with comparable dst and src members, such as ParallelMove; moves with
+// dst == src are dropped. A move is safe once no pending move reads its destination. When
+// only cycles remain, one destination is saved in scratch and its readers read from there
+// instead; that path then unwinds completely before scratch could be needed again. The save
+// is emitted as a copy of one of those readers, so any other members of Move stay with the
+// value. Empties moves; quadratic in their number, which stays small per edge.
+template <typename Move, typename L, typename Emit>
+void sequentializeParallelCopy(std::vector<Move>& moves, const L& scratch, Emit&& emit) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [](const Move& move) { return move.dst == move.src; }),
+                moves.end());
+    while (!moves.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < moves.size();) {
+            const auto& dst = moves[i].dst;
+            bool is_read = std::any_of(moves.begin(), moves.end(),
+                                       [&dst](const Move& move) { return move.src == dst; });
+            if (is_read) {
+                ++i;
+                continue;
+            }
+            emit(moves[i]);
+            moves[i] = moves.back();
+            moves.pop_back();
+            progress = true;
+        }
+        if (!progress) {
+            auto saved = moves.front().dst;
+            Move save = moves.front();
+            for (Move& move : moves) {
+                if (move.src == saved) {
+                    save = move;
+                    move.src = scratch;
+                }
+            }
+            save.dst = scratch;
+            save.src = saved;
+            emit(save);
+        }
+    }
+}
+
+#endif  // PARALLEL_COPY_H
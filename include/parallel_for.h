@@ -0,0 +1,19 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <cstddef>
+#include <functional>
+
+// Calls job(index, worker) for every index in [0, count) on num_threads threads and returns
+// once all calls finished; 0 threads uses one per hardware thread. Indices are handed out one
+// at a time through an atomic counter, so items of very different cost balance themselves.
+// worker is in [0, num_threads) and calls with the same worker never overlap; the calling
+// thread takes part as worker 0. Threads are started for each call, which is cheap next to
+// loops over whole functions.
+void parallelFor(unsigned num_threads, size_t count,
+                 const std::function<void(size_t index, unsigned worker)>& job);
+
+// Number of threads parallelFor uses for num_threads == 0
+unsigned getHardwareThreads();
+
+#endif  // PARALLEL_FOR_H
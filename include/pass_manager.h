@@ -0,0 +1,211 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "IR.h"
+#include "cfg_traversal.h"
+#include "control_dependence.h"
+#include "dominance_frontier.h"
+#include "dominators.h"
+#include "loop_info.h"
+
+// Function analyses the AnalysisManager computes and caches. An analysis is listed after
+// the ones it is built from.
+enum class Analysis : unsigned {
+    Predecessors,       // BasicBlock predecessor lists and the CFG edge table
+    ReversePostOrder,   // CFGTraversal from the start block
+    Dominators,         // DominatorTree
+    PostDominators,     // PostDominatorTree
+    DominanceFrontier,  // DominanceFrontier, built from Dominators
+    ControlDependence,  // ControlDependenceGraph, built from PostDominators
+    Loops,              // LoopInfo, built from Dominators
+};
+
+constexpr unsigned kNumAnalyses = 7;
+
+// Set of analyses, one bit per Analysis
+using AnalysisSet = uint32_t;
+
+constexpr AnalysisSet analysisBit(Analysis analysis) {
+    return AnalysisSet(1) << unsigned(analysis);
+}
+
+// Analyses that only read the CFG: terminators and the block list
+constexpr AnalysisSet kCFGAnalyses =
+    analysisBit(Analysis::Predecessors) | analysisBit(Analysis::ReversePostOrder) |
+    analysisBit(Analysis::Dominators) | analysisBit(Analysis::PostDominators) |
+    analysisBit(Analysis::DominanceFrontier) | analysisBit(Analysis::ControlDependence) |
+    analysisBit(Analysis::Loops);
+
+constexpr AnalysisSet kAllAnalyses = (AnalysisSet(1) << kNumAnalyses) - 1;
+
+// What a pass reports back: the analyses whose cached results are still correct
+class PreservedAnalyses {
+   public:
+    // The pass changed nothing
+    static PreservedAnalyses all() {
+        return PreservedAnalyses(kAllAnalyses);
+    }
+    // The pass may have changed anything, including the CFG
+    static PreservedAnalyses none() {
+        return PreservedAnalyses(0);
+    }
+    // The pass changed instructions but no terminator and no block
+    static PreservedAnalyses cfg() {
+        return PreservedAnalyses(kCFGAnalyses);
+    }
+
+    PreservedAnalyses& preserve(Analysis analysis) {
+        preserved_ |= analysisBit(analysis);
+        return *this;
+    }
+    PreservedAnalyses& abandon(Analysis analysis) {
+        preserved_ &= ~analysisBit(analysis);
+        return *this;
+    }
+    // Keeps only what both preserve, for passes run one after the other
+    PreservedAnalyses& intersect(const PreservedAnalyses& other) {
+        preserved_ &= other.preserved_;
+        return *this;
+    }
+
+    bool isPreserved(Analysis analysis) const {
+        return (preserved_ & analysisBit(analysis)) != 0;
+    }
+    bool areAllPreserved() const {
+        return preserved_ == kAllAnalyses;
+    }
+    AnalysisSet getSet() const {
+        return preserved_;
+    }
+
+   private:
+    explicit PreservedAnalyses(AnalysisSet preserved) : preserved_(preserved) {
+    }
+
+    AnalysisSet preserved_;
+};
+
+// Computes the analyses of one graph on first use and keeps them until a pass reports a
+// change they depend on. A result stays cached only if it is preserved and so is everything
+// it was built from: dropping Dominators also drops the DominanceFrontier that points into
+// it. Returned references are valid until the next invalidate().
+class AnalysisManager {
+   public:
+    explicit AnalysisManager(Graph* g) : graph_(g) {
+    }
+    AnalysisManager(const AnalysisManager&) = delete;
+    AnalysisManager& operator=(const AnalysisManager&) = delete;
+    ~AnalysisManager();
+
+    Graph* getGraph() const {
+        return graph_;
+    }
+
+    // Rebuilds the predecessor lists unless they are known to be up to date
+    void requirePredecessors();
+    const CFGTraversal& getRPO();
+    // Not const, so that a pass may keep the tree up to date with applyUpdates() and then
+    // report it as preserved
+    DominatorTree& getDominatorTree();
+    PostDominatorTree& getPostDominatorTree();
+    const DominanceFrontier& getDominanceFrontier();
+    const ControlDependenceGraph& getControlDependence();
+    const LoopInfo& getLoopInfo();
+
+    // Computes every analysis in the set that is not cached yet
+    void require(AnalysisSet analyses);
+
+    void invalidate(const PreservedAnalyses& preserved);
+    void clear() {
+        invalidate(PreservedAnalyses::none());
+    }
+
+    bool isCached(Analysis analysis) const {
+        return (cached_ & analysisBit(analysis)) != 0;
+    }
+    AnalysisSet getCached() const {
+        return cached_;
+    }
+    // How often the analysis was computed, for tests and statistics
+    unsigned getNumComputations(Analysis analysis) const {
+        return num_computations_[unsigned(analysis)];
+    }
+
+   private:
+    void markComputed(Analysis analysis) {
+        cached_ |= analysisBit(analysis);
+        ++num_computations_[unsigned(analysis)];
+    }
+
+    Graph* graph_;
+    AnalysisSet cached_ = 0;
+    unsigned num_computations_[kNumAnalyses] = {};
+    std::unique_ptr<CFGTraversal> rpo_;
+    std::unique_ptr<DominatorTree> dom_tree_;
+    std::unique_ptr<PostDominatorTree> post_dom_tree_;
+    std::unique_ptr<DominanceFrontier> frontier_;
+    std::unique_ptr<ControlDependenceGraph> control_dependence_;
+    std::unique_ptr<LoopInfo> loop_info_;
+};
+
+// A transformation or analysis of one function. Required analyses are computed before run()
+// so that the pass may simply fetch them from the AnalysisManager.
+class FunctionPass {
+   public:
+    virtual ~FunctionPass() = default;
+
+    virtual const char* getName() const = 0;
+    virtual AnalysisSet getRequiredAnalyses() const {
+        return 0;
+    }
+    // Returns what the pass left intact; be precise, everything else is recomputed
+    virtual PreservedAnalyses run(Graph& g, AnalysisManager& am) = 0;
+};
+
+// Runs a sequence of function passes, invalidating cached analyses after each pass from
+// what it reports preserved
+class PassManager {
+   public:
+    void addPass(std::unique_ptr<FunctionPass> pass) {
+        passes_.push_back(std::move(pass));
+    }
+    template <typename Pass, typename... Args>
+    Pass* addPass(Args&&... args) {
+        auto pass = std::make_unique<Pass>(std::forward<Args>(args)...);
+        Pass* result = pass.get();
+        passes_.push_back(std::move(pass));
+        return result;
+    }
+    size_t getNumPasses() const {
+        return passes_.size();
+    }
+
+    // Returns what the whole pipeline preserved
+    PreservedAnalyses run(Graph& g, AnalysisManager& am);
+
+    // Debug mode: after every pass, compare the dominator trees it claims to preserve
+    // against fresh ones and abort on mismatch
+    void setVerifyAnalyses(bool enabled) {
+        verify_analyses_ = enabled;
+    }
+    // Prints the name of every pass and the analyses it invalidated
+    void setTrace(std::ostream* os) {
+        trace_ = os;
+    }
+
+   private:
+    void verifyPreserved(const FunctionPass& pass, const PreservedAnalyses& preserved,
+                         AnalysisManager& am) const;
+
+    std::vector<std::unique_ptr<FunctionPass>> passes_;
+    bool verify_analyses_ = false;
+    std::ostream* trace_ = nullptr;
+};
+
+#endif  // PASS_MANAGER_H
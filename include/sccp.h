@@ -0,0 +1,86 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "pass_manager.h"
+
+// Sparse conditional constant propagation, from "Constant Propagation with Conditional
+// Branches" by Wegman and Zadeck. Every value starts unknown and only moves down the lattice
+// unknown -> constant -> overdefined; a block is only evaluated once an edge into it is found
+// executable, and phis only meet the values on executable edges. Values are revisited along
+// their def-use chains when they change, so the analysis is linear in the SSA edges.
+//
+// run() then rewrites the graph: folded values used elsewhere become ConstInsts, unused ones
+// disappear, conditional jumps with a single executable edge become JumpInsts, phis lose the
+// inputs of dead edges, and blocks that never became executable are deleted (the remaining
+// blocks are renumbered, see Graph::removeBasicBlocksIf). Folded phis are replaced by
+// constants placed after the block's phis. The predecessor lists are rebuilt if the CFG
+// changed.
+class SCCP {
+   public:
+    explicit SCCP(Graph* g) : graph_(g) {
+    }
+
+    // Returns true if the graph changed
+    bool run();
+
+    // Statistics of the last run()
+    unsigned getNumFoldedValues() const {
+        return num_folded_values_;
+    }
+    unsigned getNumFoldedBranches() const {
+        return num_folded_branches_;
+    }
+    unsigned getNumRemovedBlocks() const {
+        return num_removed_blocks_;
+    }
+
+   private:
+    enum class Lattice : uint8_t { Unknown, Constant, Overdefined };
+
+    struct Value {
+        Lattice state = Lattice::Unknown;
+        int64_t constant = 0;
+    };
+
+    void solve();
+    void visit(Inst* inst);
+    void visitPhi(PhiInst* phi);
+    void visitCondJump(CondJumpInst* jump);
+    // Moves inst down to value, queueing its users if that changed anything
+    void lower(Inst* inst, Value value);
+    void markEdge(BasicBlock* from, unsigned succ_index);
+    bool isEdgeFeasible(const BasicBlock* from, const BasicBlock* to) const;
+    Value getValue(const Inst* inst) const {
+        return values_[inst->getId()];
+    }
+
+    bool rewrite();
+    void removeDeadIncoming(BasicBlock* bb);
+    bool foldInstructions(BasicBlock* bb);
+
+    Graph* graph_;
+    std::vector<Value> values_;                // Indexed by instruction id
+    std::vector<uint8_t> executable_;          // Indexed by block id
+    std::vector<uint8_t> feasible_succs_;      // Indexed by block id, bit i for successor i
+    std::vector<Inst*> value_worklist_;        // Values whose lattice value changed
+    std::vector<BasicBlock*> block_worklist_;  // Blocks that just became executable
+
+    unsigned num_folded_values_ = 0;
+    unsigned num_folded_branches_ = 0;
+    unsigned num_removed_blocks_ = 0;
+};
+
+// SCCP in a PassManager pipeline
+class SCCPPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "sccp";
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // SCCP_H
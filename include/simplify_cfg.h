@@ -0,0 +1,72 @@
+#ifndef SIMPLIFY_CFG_H
+#define SIMPLIFY_CFG_H
+
+#include <cstdint>
+#include <vector>
+
+#include "IR.h"
+#include "pass_manager.h"
+
+// Shrinks the CFG without changing what the function computes:
+//  - blocks unreachable from the start block are deleted, together with the phi inputs
+//    they supplied;
+//  - a block that only jumps somewhere else is bypassed: its predecessors branch to the
+//    target directly. If the target has phis this is done only for a single predecessor
+//    that is not already a predecessor of the target, so every phi input keeps its own edge;
+//  - a block that is the only successor of its single predecessor, through a jump, is
+//    merged into that predecessor, so straight-line chains become one block.
+// Rounds repeat until nothing changes; each is linear in the size of the graph. Finally
+// the surviving blocks and instructions are renumbered densely (Graph::removeBasicBlocksIf,
+// Graph::compactInstIds) and the predecessor lists are rebuilt.
+class SimplifyCFG {
+   public:
+    explicit SimplifyCFG(Graph* g) : graph_(g) {
+    }
+
+    // Returns true if the graph changed, including only the instruction ids
+    bool run();
+
+    // Statistics of the last run(); removed blocks include the bypassed and merged ones
+    unsigned getNumRemovedBlocks() const {
+        return num_removed_blocks_;
+    }
+    unsigned getNumForwardedBlocks() const {
+        return num_forwarded_blocks_;
+    }
+    unsigned getNumMergedBlocks() const {
+        return num_merged_blocks_;
+    }
+    bool hasChangedCFG() const {
+        return num_removed_blocks_ + num_forwarded_blocks_ + num_merged_blocks_ != 0;
+    }
+
+   private:
+    bool removeUnreachableBlocks();
+    bool forwardBlock(BasicBlock* bb);
+    bool mergeSuccessors(BasicBlock* bb);
+    // Phi inputs follow the edges that forwardBlock() and mergeSuccessors() moved; batched
+    // per round, so a block with many predecessors has its phis scanned once
+    void renamePhiInputs();
+
+    Graph* graph_;
+    std::vector<uint8_t> reachable_;  // Indexed by block id
+    std::vector<uint8_t> dead_;       // Bypassed or merged in this round, by block id
+    // Block id -> the block whose edges it handed over in this round, or nullptr
+    std::vector<BasicBlock*> replacement_;
+    std::vector<BasicBlock*> stack_;
+
+    unsigned num_removed_blocks_ = 0;
+    unsigned num_forwarded_blocks_ = 0;
+    unsigned num_merged_blocks_ = 0;
+};
+
+// SimplifyCFG in a PassManager pipeline
+class SimplifyCFGPass : public FunctionPass {
+   public:
+    const char* getName() const override {
+        return "simplify-cfg";
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override;
+};
+
+#endif  // SIMPLIFY_CFG_H
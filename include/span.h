@@ -0,0 +1,53 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Non-owning view over a contiguous array (a minimal C++17 stand-in for std::span).
+template <typename T>
+class Span {
+   public:
+    using value_type = T;
+    using iterator = T*;
+
+    Span() = default;
+    Span(T* data, size_t size) : data_(data), size_(size) {
+    }
+    template <typename U, typename Alloc>
+    Span(const std::vector<U, Alloc>& vec) : data_(vec.data()), size_(vec.size()) {
+    }
+
+    T* begin() const {
+        return data_;
+    }
+    T* end() const {
+        return data_ + size_;
+    }
+    T* data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    T& operator[](size_t i) const {
+        assert(i < size_);
+        return data_[i];
+    }
+    T& front() const {
+        return (*this)[0];
+    }
+    T& back() const {
+        return (*this)[size_ - 1];
+    }
+
+   private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif  // SPAN_H
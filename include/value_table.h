@@ -0,0 +1,131 @@
+#ifndef VALUE_TABLE_H
+#define VALUE_TABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Inst;
+
+// Structural identity of a pure instruction: two instructions with equal keys compute the
+// same value when both operands are the same. Operands are identified by instruction id, and
+// the operands of commutative opcodes are ordered by id, so `add i1, i2` and `add i2, i1`
+// share a key.
+struct ValueKey {
+    static constexpr uint32_t kNoOperand = ~0u;
+
+    uint32_t opcode = 0;
+    uint32_t lhs = kNoOperand;
+    uint32_t rhs = kNoOperand;
+    int64_t payload = 0;  // Constant value or cast width
+
+    bool operator==(const ValueKey& other) const {
+        return opcode == other.opcode && lhs == other.lhs && rhs == other.rhs &&
+               payload == other.payload;
+    }
+
+    uint64_t hash() const {
+        uint64_t h = (uint64_t(lhs) << 32 | rhs) ^ uint64_t(opcode) << 59 ^
+                     uint64_t(payload) * 0x9e3779b97f4a7c15ull;
+        // Finalizer of MurmurHash3: every input bit reaches the low bits the table uses
+        h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdull;
+        h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ull;
+        return h ^ (h >> 33);
+    }
+};
+
+// Open-addressing map from ValueKey to Inst*, with linear probing in a power-of-two array
+// that is allocated on first insert and kept at most half full. Entries cannot be erased one
+// by one; instead rollback() removes everything inserted after a mark(), which is what a
+// scoped walk over the dominator tree needs. Undoing insertions in reverse order never breaks
+// a probe sequence: an entry that probed past a slot was inserted after it, so it is already
+// gone when the slot is cleared.
+class ValueTable {
+   public:
+    // Makes room for `count` entries without rehashing
+    void reserve(size_t count) {
+        size_t capacity = std::max(slots_.size(), kMinCapacity);
+        while (capacity < 2 * count) {
+            capacity *= 2;
+        }
+        if (capacity != slots_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // nullptr if the key is not in the table
+    Inst* lookup(const ValueKey& key) const {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        size_t mask = slots_.size() - 1;
+        for (size_t i = key.hash() & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots_[i];
+            if (slot.value == nullptr || slot.key == key) {
+                return slot.value;
+            }
+        }
+    }
+
+    // The key must not be in the table yet
+    void insert(const ValueKey& key, Inst* value) {
+        if (2 * (log_.size() + 1) > slots_.size()) {
+            rehash(std::max(2 * slots_.size(), kMinCapacity));
+        }
+        log_.push_back(place(key, value));
+    }
+
+    size_t size() const {
+        return log_.size();
+    }
+
+    // Marks the current contents, for rollback()
+    size_t mark() const {
+        return log_.size();
+    }
+    // Removes every entry inserted since `mark`, newest first
+    void rollback(size_t mark) {
+        while (log_.size() > mark) {
+            slots_[log_.back()].value = nullptr;
+            log_.pop_back();
+        }
+    }
+
+    void clear() {
+        rollback(0);
+    }
+
+   private:
+    static constexpr size_t kMinCapacity = 16;
+
+    struct Slot {
+        ValueKey key;
+        Inst* value = nullptr;  // nullptr marks an empty slot
+    };
+
+    uint32_t place(const ValueKey& key, Inst* value) {
+        size_t mask = slots_.size() - 1;
+        size_t i = key.hash() & mask;
+        while (slots_[i].value != nullptr) {
+            i = (i + 1) & mask;
+        }
+        slots_[i].key = key;
+        slots_[i].value = value;
+        return uint32_t(i);
+    }
+
+    // Reinserts in insertion order, so rollback() stays valid
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(slots_);
+        for (uint32_t& index : log_) {
+            index = place(old[index].key, old[index].value);
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> log_;  // Slot of every entry, in insertion order
+};
+
+#endif  // VALUE_TABLE_H
@@ -0,0 +1,53 @@
+#include "adce.h"
+
+bool ADCE::run() {
+    num_removed_ = 0;
+    live_.clearAndResize(graph_->getNumInsts());
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        for (Inst* inst : bb->getInstructions()) {
+            switch (inst->getOpcode()) {
+                case Opcode::JUMP:
+                case Opcode::COND_JUMP:
+                case Opcode::RETURN:
+                case Opcode::STORE:
+                    markLive(inst);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    while (!worklist_.empty()) {
+        Inst* inst = worklist_.back();
+        worklist_.pop_back();
+        for (Inst* input : inst->getInputs()) {
+            if (input != nullptr) {
+                markLive(input);
+            }
+        }
+    }
+
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        bb->removeInstructionsIf([this](Inst* inst) {
+            if (live_.test(inst->getId())) {
+                return false;
+            }
+            // Dead values are only used by other dead instructions
+            inst->dropAllReferences();
+            ++num_removed_;
+            return true;
+        });
+    }
+    return num_removed_ != 0;
+}
+
+void ADCE::markLive(Inst* inst) {
+    if (!live_.testAndSet(inst->getId())) {
+        worklist_.push_back(inst);
+    }
+}
+
+PreservedAnalyses ADCEPass::run(Graph& g, AnalysisManager& /*am*/) {
+    ADCE adce(&g);
+    return adce.run() ? PreservedAnalyses::cfg() : PreservedAnalyses::all();
+}
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "arena.h"
+
+Arena::~Arena() {
+    for (void* slab : slabs_) {
+        std::free(slab);
+    }
+}
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+    size_t needed = size + align - 1;
+    size_t slab_size = std::max(next_slab_size_, needed);
+    void* slab = std::malloc(slab_size);
+    if (!slab) {
+        throw std::bad_alloc();
+    }
+    slabs_.push_back(slab);
+    bytes_reserved_ += slab_size;
+
+    // Oversized requests get a dedicated slab and keep the current one for small objects
+    if (slab_size > next_slab_size_ && cur_ != nullptr) {
+        uintptr_t ptr = (reinterpret_cast<uintptr_t>(slab) + align - 1) & ~(uintptr_t(align) - 1);
+        return reinterpret_cast<void*>(ptr);
+    }
+
+    next_slab_size_ = std::min(next_slab_size_ * 2, kMaxSlabSize);
+    slab_ = static_cast<char*>(slab);
+    cur_ = slab_;
+    end_ = cur_ + slab_size;
+    return allocate(size, align);
+}
+
+void Arena::reset() {
+    if (slab_ == nullptr) {
+        return;
+    }
+    for (void* slab : slabs_) {
+        if (slab != slab_) {
+            std::free(slab);
+        }
+    }
+    slabs_.assign(1, slab_);
+    cur_ = slab_;
+    bytes_reserved_ = end_ - slab_;
+}
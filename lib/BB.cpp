@@ -1,61 +1,55 @@
+#include <algorithm>
 #include <vector>
 
 #include "IR.h"
 
-BasicBlock::BasicBlock(unsigned id, const std::string& name) : id_(id), name_(name) {
-}
-
-unsigned BasicBlock::getId() const {
-    return id_;
+BasicBlock::BasicBlock(unsigned id, const std::string& name, Graph* graph)
+    : id_(id), name_(name), graph_(graph) {
 }
 
 const std::string& BasicBlock::getName() const {
     return name_;
 }
 
-const std::vector<std::unique_ptr<Inst>>& BasicBlock::getInstructions() const {
-    return instructions_;
+Graph* BasicBlock::getGraph() const {
+    return graph_;
+}
+
+Span<Inst* const> BasicBlock::getInstructions() const {
+    return Span<Inst* const>(instructions_.data(), instructions_.size());
 }
 
 void BasicBlock::addPredecessor(BasicBlock* pred) {
     predecessors_.push_back(pred);
 }
 
-const std::vector<BasicBlock*>& BasicBlock::getPredecessors() const {
-    return predecessors_;
+void BasicBlock::removePredecessor(BasicBlock* pred) {
+    predecessors_.erase(std::remove(predecessors_.begin(), predecessors_.end(), pred),
+                        predecessors_.end());
 }
 
 void BasicBlock::clearPredecessors() {
     predecessors_.clear();
 }
 
-Inst* BasicBlock::getTerminator() const {
-    if (instructions_.empty()) {
-        return nullptr;
-    }
-    return instructions_.back().get();
-}
-
-std::vector<BasicBlock*> BasicBlock::getSuccessors() const {
+void BasicBlock::replaceSuccessor(BasicBlock* from, BasicBlock* to) {
     Inst* terminator = getTerminator();
-    if (!terminator) {
-        return {};
+    if (terminator == nullptr) {
+        return;
     }
-
-    switch (terminator->getOpcode()) {
-        case Opcode::JUMP:
-            return {static_cast<JumpInst*>(terminator)->getTarget()};
-
-        case Opcode::COND_JUMP: {
-            auto* condJump = static_cast<CondJumpInst*>(terminator);
-            return {condJump->getTrueTarget(), condJump->getFalseTarget()};
+    if (terminator->getOpcode() == Opcode::JUMP) {
+        auto* jump = static_cast<JumpInst*>(terminator);
+        if (jump->getTarget() == from) {
+            jump->setTarget(to);
+        }
+    } else if (terminator->getOpcode() == Opcode::COND_JUMP) {
+        auto* cond_jump = static_cast<CondJumpInst*>(terminator);
+        if (cond_jump->getTrueTarget() == from) {
+            cond_jump->setTrueTarget(to);
+        }
+        if (cond_jump->getFalseTarget() == from) {
+            cond_jump->setFalseTarget(to);
         }
-
-        case Opcode::RETURN:
-            return {};
-
-        default:
-            return {};
     }
 }
 
@@ -69,13 +63,21 @@ void BasicBlock::dump(std::ostream& os) const {
     }
     os << std::endl;
 
-    for (const auto& inst : instructions_) {
+    for (auto* inst : getInstructions()) {
         os << "  ";
         inst->dump(os);
         os << std::endl;
     }
 }
 
-void BasicBlock::addInstruction(std::unique_ptr<Inst> inst) {
-    instructions_.push_back(std::move(inst));
+void BasicBlock::addInstruction(Inst* inst) {
+    inst->setParent(this);
+    instructions_.push_back(inst, graph_ ? &graph_->getArena() : nullptr);
+}
+
+void BasicBlock::insertInstructions(unsigned index, Span<Inst* const> insts) {
+    for (auto* inst : insts) {
+        inst->setParent(this);
+    }
+    instructions_.insert(index, insts.data(), insts.size(), graph_ ? &graph_->getArena() : nullptr);
 }
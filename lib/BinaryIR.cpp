@@ -0,0 +1,427 @@
+#include "binary_ir.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t kUnplaced = ~0u;
+
+size_t alignTo8(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+// Number of value operands an opcode takes, or -1 if any number is allowed
+int getArity(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::CMP:
+        case Opcode::STORE:
+            return 2;
+        case Opcode::COND_JUMP:
+        case Opcode::LOAD:
+            return 1;
+        case Opcode::PHI:
+        case Opcode::RETURN:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+}  // namespace
+
+bool BinaryIRWriter::fail(const Inst* inst, const char* reason) {
+    std::ostringstream os;
+    inst->dump(os);
+    error_ = os.str() + ": " + reason;
+    return false;
+}
+
+bool BinaryIRWriter::write(std::vector<uint8_t>& out) {
+    out.clear();
+    error_.clear();
+    const auto& blocks = graph_->getBasicBlocks();
+    std::vector<uint32_t> dense_ids(graph_->getNumInsts(), kUnplaced);
+    uint32_t num_insts = 0;
+    for (BasicBlock* bb : blocks) {
+        for (Inst* inst : bb->getInstructions()) {
+            dense_ids[inst->getId()] = num_insts++;
+        }
+    }
+
+    std::string strings = graph_->getName();
+    std::vector<int64_t> constants;
+    std::vector<BinaryIRBlock> block_records;
+    std::vector<BinaryIRInst> inst_records;
+    std::vector<uint32_t> operands;
+    block_records.reserve(blocks.size());
+    inst_records.reserve(num_insts);
+    for (BasicBlock* bb : blocks) {
+        block_records.push_back({static_cast<uint32_t>(inst_records.size()),
+                                 static_cast<uint32_t>(bb->getInstructions().size()),
+                                 static_cast<uint32_t>(strings.size()),
+                                 static_cast<uint32_t>(bb->getName().size())});
+        strings += bb->getName();
+        for (Inst* inst : bb->getInstructions()) {
+            BinaryIRInst record{};
+            record.opcode = static_cast<uint8_t>(inst->getOpcode());
+            record.num_operands = inst->getNumOperands();
+            record.first_operand = operands.size();
+            for (unsigned i = 0; i < inst->getNumOperands(); ++i) {
+                Inst* value = inst->getOperand(i);
+                if (value == nullptr || dense_ids[value->getId()] == kUnplaced) {
+                    return fail(inst, "uses a value that is not placed in a block");
+                }
+                operands.push_back(dense_ids[value->getId()]);
+            }
+            switch (inst->getOpcode()) {
+                case Opcode::PHI: {
+                    auto* phi = static_cast<PhiInst*>(inst);
+                    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+                        operands.push_back(phi->getIncomingBlock(i)->getId());
+                    }
+                    break;
+                }
+                case Opcode::JUMP:
+                    operands.push_back(static_cast<JumpInst*>(inst)->getTarget()->getId());
+                    break;
+                case Opcode::COND_JUMP:
+                    for (BasicBlock* target : static_cast<CondJumpInst*>(inst)->getTargets()) {
+                        operands.push_back(target->getId());
+                    }
+                    break;
+                case Opcode::CONST:
+                    record.aux = constants.size();
+                    constants.push_back(static_cast<ConstInst*>(inst)->getValue());
+                    break;
+                case Opcode::PARAM:
+                    record.aux = static_cast<ParamInst*>(inst)->getIndex();
+                    break;
+                case Opcode::MOV:
+                case Opcode::CAST:
+                    return fail(inst, "has no binary encoding");
+                default:
+                    break;
+            }
+            inst_records.push_back(record);
+        }
+    }
+
+    BinaryIRHeader header{};
+    std::memcpy(header.magic, kBinaryIRMagic, sizeof(header.magic));
+    header.version = kBinaryIRVersion;
+    header.byte_order = kBinaryIRByteOrder;
+    header.num_blocks = blocks.size();
+    header.num_insts = num_insts;
+    header.num_operands = operands.size();
+    header.num_constants = constants.size();
+    header.strings_size = strings.size();
+    BasicBlock* start = graph_->getStartBlock();
+    header.start_block = start ? start->getId() : kBinaryIRNoBlock;
+    header.name_offset = 0;
+    header.name_size = graph_->getName().size();
+
+    size_t offset = alignTo8(sizeof(BinaryIRHeader));
+    auto place = [&offset](size_t bytes) {
+        size_t section = offset;
+        offset = alignTo8(offset + bytes);
+        return section;
+    };
+    size_t constants_offset = place(constants.size() * sizeof(int64_t));
+    size_t blocks_offset = place(block_records.size() * sizeof(BinaryIRBlock));
+    size_t insts_offset = place(inst_records.size() * sizeof(BinaryIRInst));
+    size_t operands_offset = place(operands.size() * sizeof(uint32_t));
+    size_t strings_offset = place(strings.size());
+    if (offset > UINT32_MAX) {
+        error_ = "the graph does not fit in a 4 GiB file";
+        return false;
+    }
+    header.constants_offset = constants_offset;
+    header.blocks_offset = blocks_offset;
+    header.insts_offset = insts_offset;
+    header.operands_offset = operands_offset;
+    header.strings_offset = strings_offset;
+    header.file_size = offset;
+
+    out.assign(offset, 0);
+    auto copy = [&out](size_t at, const void* data, size_t bytes) {
+        if (bytes != 0) {
+            std::memcpy(out.data() + at, data, bytes);
+        }
+    };
+    copy(0, &header, sizeof(header));
+    copy(constants_offset, constants.data(), constants.size() * sizeof(int64_t));
+    copy(blocks_offset, block_records.data(), block_records.size() * sizeof(BinaryIRBlock));
+    copy(insts_offset, inst_records.data(), inst_records.size() * sizeof(BinaryIRInst));
+    copy(operands_offset, operands.data(), operands.size() * sizeof(uint32_t));
+    copy(strings_offset, strings.data(), strings.size());
+    return true;
+}
+
+bool BinaryIRWriter::writeFile(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    if (!write(bytes)) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!file) {
+        error_ = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+BinaryIRView::~BinaryIRView() {
+    close();
+}
+
+void BinaryIRView::close() {
+    file_.close();
+    header_ = nullptr;
+}
+
+bool BinaryIRView::openFile(const std::string& path) {
+    close();
+    if (!file_.open(path)) {
+        error_ = file_.getError();
+        return false;
+    }
+    if (!validate(static_cast<const uint8_t*>(file_.getData()), file_.getSize())) {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+bool BinaryIRView::openBuffer(const void* data, size_t size) {
+    close();
+    return validate(static_cast<const uint8_t*>(data), size);
+}
+
+unsigned BinaryIRView::getNumBlockOperands(const BinaryIRInst& inst) {
+    switch (static_cast<Opcode>(inst.opcode)) {
+        case Opcode::PHI:
+            return inst.num_operands;
+        case Opcode::JUMP:
+            return 1;
+        case Opcode::COND_JUMP:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+bool BinaryIRView::validate(const uint8_t* data, size_t size) {
+    header_ = nullptr;
+    error_.clear();
+    auto reject = [this](const char* reason) {
+        error_ = reason;
+        header_ = nullptr;
+        return false;
+    };
+    if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+        return reject("the buffer is not 8-byte aligned");
+    }
+    if (size < sizeof(BinaryIRHeader)) {
+        return reject("too small for a header");
+    }
+    header_ = reinterpret_cast<const BinaryIRHeader*>(data);
+    if (std::memcmp(header_->magic, kBinaryIRMagic, sizeof(kBinaryIRMagic)) != 0) {
+        return reject("not a binary IR file");
+    }
+    if (header_->byte_order != kBinaryIRByteOrder) {
+        return reject("written with a different byte order");
+    }
+    if (header_->version != kBinaryIRVersion) {
+        error_ = "unsupported version " + std::to_string(header_->version);
+        header_ = nullptr;
+        return false;
+    }
+    if (header_->file_size != size) {
+        return reject("the file size does not match the header");
+    }
+
+    // Sections must be aligned and inside the file
+    auto section = [&](uint32_t offset, uint64_t count, size_t record_size) {
+        return offset % 8 == 0 && offset >= sizeof(BinaryIRHeader) &&
+               offset + count * record_size <= size;
+    };
+    if (!section(header_->constants_offset, header_->num_constants, sizeof(int64_t)) ||
+        !section(header_->blocks_offset, header_->num_blocks, sizeof(BinaryIRBlock)) ||
+        !section(header_->insts_offset, header_->num_insts, sizeof(BinaryIRInst)) ||
+        !section(header_->operands_offset, header_->num_operands, sizeof(uint32_t)) ||
+        !section(header_->strings_offset, header_->strings_size, 1)) {
+        return reject("a section lies outside the file");
+    }
+    constants_ = reinterpret_cast<const int64_t*>(data + header_->constants_offset);
+    blocks_ = reinterpret_cast<const BinaryIRBlock*>(data + header_->blocks_offset);
+    insts_ = reinterpret_cast<const BinaryIRInst*>(data + header_->insts_offset);
+    operands_ = reinterpret_cast<const uint32_t*>(data + header_->operands_offset);
+    strings_ = reinterpret_cast<const char*>(data + header_->strings_offset);
+
+    auto validString = [this](uint32_t offset, uint32_t string_size) {
+        return uint64_t(offset) + string_size <= header_->strings_size;
+    };
+    if (!validString(header_->name_offset, header_->name_size)) {
+        return reject("the graph name lies outside the string section");
+    }
+    if (header_->start_block != kBinaryIRNoBlock && header_->start_block >= header_->num_blocks) {
+        return reject("invalid start block");
+    }
+    // Blocks own consecutive ranges that cover every instruction
+    uint64_t next_inst = 0;
+    for (unsigned b = 0; b < header_->num_blocks; ++b) {
+        const BinaryIRBlock& block = blocks_[b];
+        if (block.first_inst != next_inst || !validString(block.name_offset, block.name_size)) {
+            error_ = "invalid record for block " + std::to_string(b);
+            header_ = nullptr;
+            return false;
+        }
+        next_inst += block.num_insts;
+    }
+    if (next_inst != header_->num_insts) {
+        return reject("the blocks do not cover all instructions");
+    }
+    for (unsigned id = 0; id < header_->num_insts; ++id) {
+        if (!validateInst(id)) {
+            header_ = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BinaryIRView::validateInst(unsigned id) {
+    const BinaryIRInst& inst = insts_[id];
+    auto reject = [this, id](const char* reason) {
+        error_ = "instruction " + std::to_string(id) + ": " + reason;
+        return false;
+    };
+    if (inst.opcode > static_cast<uint8_t>(Opcode::STORE) ||
+        inst.opcode == static_cast<uint8_t>(Opcode::MOV) ||
+        inst.opcode == static_cast<uint8_t>(Opcode::CAST)) {
+        return reject("unknown opcode");
+    }
+    Opcode opcode = static_cast<Opcode>(inst.opcode);
+    int arity = getArity(opcode);
+    if ((arity >= 0 && inst.num_operands != unsigned(arity)) ||
+        (opcode == Opcode::RETURN && inst.num_operands > 1)) {
+        return reject("wrong number of operands");
+    }
+    uint64_t end = uint64_t(inst.first_operand) + inst.num_operands + getNumBlockOperands(inst);
+    if (end > header_->num_operands) {
+        return reject("operands lie outside the operand section");
+    }
+    for (uint32_t value : getOperands(id)) {
+        if (value >= header_->num_insts) {
+            return reject("operand out of range");
+        }
+    }
+    for (uint32_t block : getBlockOperands(id)) {
+        if (block >= header_->num_blocks) {
+            return reject("block operand out of range");
+        }
+    }
+    if (opcode == Opcode::CONST && inst.aux >= header_->num_constants) {
+        return reject("constant out of range");
+    }
+    return true;
+}
+
+bool BinaryIRView::materialize(Graph& g) const {
+    if (header_ == nullptr) {
+        error_ = "no file is open";
+        return false;
+    }
+    if (!g.getBasicBlocks().empty() || g.getNumInsts() != 0) {
+        error_ = "the graph is not empty";
+        return false;
+    }
+    // Ids must follow the file, so no instruction may be merged into an earlier one
+    bool hash_consing = g.isHashConsing();
+    g.setHashConsing(false);
+    std::vector<BasicBlock*> blocks(header_->num_blocks);
+    for (unsigned b = 0; b < header_->num_blocks; ++b) {
+        blocks[b] = g.createBB(std::string(getBlockName(b)));
+    }
+
+    // Operands defined later in the file start out pointing at a placeholder and are
+    // patched once every instruction exists
+    AllocaInst placeholder(~0u);
+    std::vector<Inst*> insts(header_->num_insts);
+    std::vector<std::pair<Inst*, unsigned>> forward_refs;  // (user, operand index)
+    for (unsigned b = 0; b < header_->num_blocks; ++b) {
+        BasicBlock* bb = blocks[b];
+        unsigned first = blocks_[b].first_inst;
+        for (unsigned id = first; id < first + blocks_[b].num_insts; ++id) {
+            auto ops = getOperands(id);
+            auto targets = getBlockOperands(id);
+            auto value = [&](unsigned i) { return ops[i] < id ? insts[ops[i]] : &placeholder; };
+            Inst* inst = nullptr;
+            Opcode opcode = getOpcode(id);
+            switch (opcode) {
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP:
+                    inst = g.createInst<BinaryInst>(bb, opcode, value(0), value(1));
+                    break;
+                case Opcode::JUMP:
+                    inst = g.createInst<JumpInst>(bb, blocks[targets[0]]);
+                    break;
+                case Opcode::COND_JUMP:
+                    inst = g.createInst<CondJumpInst>(bb, value(0), blocks[targets[0]],
+                                                      blocks[targets[1]]);
+                    break;
+                case Opcode::RETURN:
+                    inst = g.createInst<ReturnInst>(bb, ops.empty() ? nullptr : value(0));
+                    break;
+                case Opcode::PHI: {
+                    auto* phi = g.createInst<PhiInst>(bb);
+                    for (unsigned i = 0; i < ops.size(); ++i) {
+                        phi->addIncoming(value(i), blocks[targets[i]]);
+                    }
+                    inst = phi;
+                    break;
+                }
+                case Opcode::PARAM:
+                    inst = g.createInst<ParamInst>(bb, getParamIndex(id));
+                    break;
+                case Opcode::CONST:
+                    inst = g.createInst<ConstInst>(bb, getConstant(id));
+                    break;
+                case Opcode::ALLOCA:
+                    inst = g.createInst<AllocaInst>(bb);
+                    break;
+                case Opcode::LOAD:
+                    inst = g.createInst<LoadInst>(bb, value(0));
+                    break;
+                case Opcode::STORE:
+                    inst = g.createInst<StoreInst>(bb, value(0), value(1));
+                    break;
+                default:
+                    break;  // Rejected by validate()
+            }
+            insts[id] = inst;
+            for (unsigned i = 0; i < ops.size(); ++i) {
+                if (ops[i] >= id) {
+                    forward_refs.emplace_back(inst, i);
+                }
+            }
+        }
+    }
+    for (const auto& [user, i] : forward_refs) {
+        unsigned id = insts_[user->getId()].first_operand + i;
+        user->setOperand(i, insts[operands_[id]]);
+    }
+
+    if (header_->start_block != kBinaryIRNoBlock) {
+        g.setStartBlock(blocks[header_->start_block]);
+    }
+    g.buildPredecessors();
+    g.setHashConsing(hash_consing);
+    return true;
+}
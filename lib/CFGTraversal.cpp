@@ -0,0 +1,58 @@
+#include "cfg_traversal.h"
+
+template <typename Direction>
+void CFGTraversalBase<Direction>::run() {
+    run(graph_->getStartBlock(), graph_->getBasicBlocks().size());
+}
+
+template <typename Direction>
+void CFGTraversalBase<Direction>::run(BasicBlock* root, size_t num_ids) {
+    visited_.clearAndResize(num_ids);
+    pre_order_.clear();
+    post_order_.clear();
+    rpo_number_.assign(num_ids, kUnreachable);
+    pre_number_.assign(num_ids, kUnreachable);
+    dfs_parent_.assign(num_ids, nullptr);
+
+    if (root == nullptr) {
+        rpo_order_.clear();
+        return;
+    }
+
+    // Each frame is a block plus the index of the next successor to explore, which
+    // reproduces the visiting order of the recursive formulation exactly.
+    struct Frame {
+        BasicBlock* bb;
+        unsigned next_succ;
+        Span<BasicBlock* const> succs;
+    };
+    std::vector<Frame> stack;
+    visited_.set(root->getId());
+    pre_number_[root->getId()] = 0;
+    pre_order_.push_back(root);
+    stack.push_back({root, 0, Direction::getSuccessors(root)});
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.next_succ == frame.succs.size()) {
+            post_order_.push_back(frame.bb);
+            stack.pop_back();
+            continue;
+        }
+        BasicBlock* succ = frame.succs[frame.next_succ++];
+        if (!visited_.testAndSet(succ->getId())) {
+            pre_number_[succ->getId()] = pre_order_.size();
+            dfs_parent_[succ->getId()] = frame.bb;
+            pre_order_.push_back(succ);
+            stack.push_back({succ, 0, Direction::getSuccessors(succ)});
+        }
+    }
+
+    rpo_order_.assign(post_order_.rbegin(), post_order_.rend());
+    for (size_t i = 0; i < rpo_order_.size(); ++i) {
+        rpo_number_[rpo_order_[i]->getId()] = i;
+    }
+}
+
+template class CFGTraversalBase<ForwardCFG>;
+template class CFGTraversalBase<ReverseCFG>;
@@ -0,0 +1,80 @@
+#include "control_dependence.h"
+
+#include <algorithm>
+
+void ControlDependenceGraph::run() {
+    const auto& blocks = graph_->getBasicBlocks();
+    size_t num_blocks = blocks.size();
+
+    // For every edge A -> S where S does not post-dominate A, the blocks on the post-dominator
+    // tree path from S up to (but excluding) ipdom(A) are control dependent on A. Paths of
+    // different successors of A may share a tail, so last_controller suppresses duplicates.
+    std::vector<std::pair<unsigned, BasicBlock*>> deps;  // (dependent id, controller)
+    std::vector<unsigned> last_controller(num_blocks, ~0u);
+    for (BasicBlock* a : blocks) {
+        BasicBlock* stop = pdt_.getImmediateDominator(a);
+        if (stop == nullptr) {
+            continue;
+        }
+        for (BasicBlock* succ : a->getSuccessors()) {
+            // A self-loop makes a depend on itself, so only strict post-dominance skips
+            if (pdt_.getImmediateDominator(succ) == nullptr ||
+                (succ != a && pdt_.dominates(succ, a))) {
+                continue;
+            }
+            for (BasicBlock* runner = succ; runner != stop;
+                 runner = pdt_.getImmediateDominator(runner)) {
+                if (last_controller[runner->getId()] != a->getId()) {
+                    last_controller[runner->getId()] = a->getId();
+                    deps.emplace_back(runner->getId(), a);
+                }
+            }
+        }
+    }
+
+    // Counting sort into both CSR tables, keeping both rows in block id order. deps is
+    // grouped by controller, so the controllers come out sorted; the dependents are then
+    // filled from the controller table, which is grouped by dependent.
+    controller_offsets_.assign(num_blocks + 1, 0);
+    dependent_offsets_.assign(num_blocks + 1, 0);
+    for (const auto& [dependent, controller] : deps) {
+        ++controller_offsets_[dependent + 1];
+        ++dependent_offsets_[controller->getId() + 1];
+    }
+    for (size_t i = 0; i < num_blocks; ++i) {
+        controller_offsets_[i + 1] += controller_offsets_[i];
+        dependent_offsets_[i + 1] += dependent_offsets_[i];
+    }
+    controllers_.resize(deps.size());
+    dependents_.resize(deps.size());
+    std::vector<unsigned> controller_pos(controller_offsets_.begin(),
+                                         controller_offsets_.end() - 1);
+    std::vector<unsigned> dependent_pos(dependent_offsets_.begin(),
+                                        dependent_offsets_.end() - 1);
+    for (const auto& [dependent, controller] : deps) {
+        controllers_[controller_pos[dependent]++] = controller;
+    }
+    for (size_t dependent = 0; dependent < num_blocks; ++dependent) {
+        for (BasicBlock* controller : getControllingBlocks(blocks[dependent])) {
+            dependents_[dependent_pos[controller->getId()]++] = blocks[dependent];
+        }
+    }
+}
+
+bool ControlDependenceGraph::isControlDependent(const BasicBlock* bb,
+                                                const BasicBlock* on) const {
+    auto controllers = getControllingBlocks(bb);
+    return std::find(controllers.begin(), controllers.end(), on) != controllers.end();
+}
+
+void ControlDependenceGraph::dump(std::ostream& os) const {
+    os << "Control Dependences (Block -> Controllers):\n";
+    for (const auto& bb : graph_->getBasicBlocks()) {
+        os << "  BB" << bb->getId() << " depends on { ";
+        auto controllers = getControllingBlocks(bb);
+        for (size_t i = 0; i < controllers.size(); ++i) {
+            os << "BB" << controllers[i]->getId() << (i == controllers.size() - 1 ? "" : ", ");
+        }
+        os << " }\n";
+    }
+}
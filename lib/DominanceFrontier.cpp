@@ -0,0 +1,176 @@
+#include "dominance_frontier.h"
+
+#include <algorithm>
+
+void DominanceFrontier::run() {
+    const auto& blocks = graph_->getBasicBlocks();
+    size_t num_blocks = blocks.size();
+
+    // (block id, join block) pairs, generated in join block order. A runner that already has
+    // the join in its frontier has had the rest of the path up to the idom handled too. The
+    // start block has an implicit entry edge, so when it has predecessors the walk goes all
+    // the way up and it ends up in its own frontier.
+    std::vector<std::pair<unsigned, BasicBlock*>> entries;
+    std::vector<unsigned> last_join(num_blocks, ~0u);
+    for (BasicBlock* join : blocks) {
+        BasicBlock* idom = dom_tree_.getImmediateDominator(join);
+        if (idom == nullptr) {
+            continue;
+        }
+        BasicBlock* stop = join == dom_tree_.getRoot() ? nullptr : idom;
+        for (BasicBlock* pred : join->getPredecessors()) {
+            BasicBlock* runner = pred;
+            while (runner != stop && dom_tree_.getImmediateDominator(runner) != nullptr &&
+                   last_join[runner->getId()] != join->getId()) {
+                last_join[runner->getId()] = join->getId();
+                entries.emplace_back(runner->getId(), join);
+                runner = dom_tree_.getImmediateDominator(runner);
+            }
+        }
+    }
+
+    // Stable counting sort by block id keeps every frontier in join block order
+    offsets_.assign(num_blocks + 1, 0);
+    for (const auto& entry : entries) {
+        ++offsets_[entry.first + 1];
+    }
+    for (size_t i = 0; i < num_blocks; ++i) {
+        offsets_[i + 1] += offsets_[i];
+    }
+    frontiers_.resize(entries.size());
+    std::vector<unsigned> fill(offsets_.begin(), offsets_.end() - 1);
+    for (const auto& [id, join] : entries) {
+        frontiers_[fill[id]++] = join;
+    }
+}
+
+void DominanceFrontier::dump(std::ostream& os) const {
+    os << "Dominance Frontiers:\n";
+    for (const auto& bb : graph_->getBasicBlocks()) {
+        os << "  BB" << bb->getId() << ": { ";
+        auto frontier = getFrontier(bb);
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            os << "BB" << frontier[i]->getId() << (i == frontier.size() - 1 ? "" : ", ");
+        }
+        os << " }\n";
+    }
+}
+
+void IteratedDominanceFrontier::nextEpoch() {
+    size_t num_blocks = graph_->getBasicBlocks().size();
+    if (++epoch_ == 0 || is_def_.size() < num_blocks) {
+        // First use, new blocks, or the stamps wrapped around: start over from zero
+        if (epoch_ == 0) {
+            epoch_ = 1;
+        }
+        is_def_.assign(num_blocks, 0);
+        is_live_in_.assign(num_blocks, 0);
+        queued_.assign(num_blocks, 0);
+        visited_.assign(num_blocks, 0);
+        is_source_.assign(num_blocks, 0);
+    }
+}
+
+template <typename Fn>
+void IteratedDominanceFrontier::sweepSubtree(BasicBlock* root, Fn visit) {
+    worklist_.push_back(root);
+    visited_[root->getId()] = epoch_;
+    while (!worklist_.empty()) {
+        BasicBlock* node = worklist_.back();
+        worklist_.pop_back();
+        visit(node);
+        for (BasicBlock* child : dom_tree_.getChildren(node)) {
+            if (visited_[child->getId()] != epoch_) {
+                visited_[child->getId()] = epoch_;
+                worklist_.push_back(child);
+            }
+        }
+    }
+}
+
+// Equivalent to sweepSubtree() when only edges into live-in blocks matter: a source is
+// swept by the first root whose subtree contains it, and subtrees are contiguous in
+// preorder, so each root scans a range of sources_ and skips the ones swept before.
+template <typename Fn>
+void IteratedDominanceFrontier::sweepLiveSources(BasicBlock* root, Fn visit) {
+    auto find = [this](unsigned i) {
+        while (next_source_[i] != i) {
+            next_source_[i] = next_source_[next_source_[i]];
+            i = next_source_[i];
+        }
+        return i;
+    };
+    unsigned begin = std::lower_bound(sources_.begin(), sources_.end(),
+                                      std::make_pair(dom_tree_.getPreOrderNumber(root),
+                                                     static_cast<BasicBlock*>(nullptr))) -
+                     sources_.begin();
+    for (unsigned i = find(begin);
+         i < sources_.size() && dom_tree_.dominates(root, sources_[i].second); i = find(i)) {
+        next_source_[i] = i + 1;
+        visit(sources_[i].second);
+    }
+}
+
+void IteratedDominanceFrontier::calculate(std::vector<BasicBlock*>& idf) {
+    idf.clear();
+    nextEpoch();
+    if (use_live_in_) {
+        sources_.clear();
+        for (BasicBlock* bb : live_in_blocks_) {
+            is_live_in_[bb->getId()] = epoch_;
+            for (BasicBlock* pred : bb->getPredecessors()) {
+                unsigned pre = dom_tree_.getPreOrderNumber(pred);
+                if (pre != ~0u && is_source_[pred->getId()] != epoch_) {
+                    is_source_[pred->getId()] = epoch_;
+                    sources_.emplace_back(pre, pred);
+                }
+            }
+        }
+        std::sort(sources_.begin(), sources_.end());
+        next_source_.resize(sources_.size() + 1);
+        for (unsigned i = 0; i < next_source_.size(); ++i) {
+            next_source_[i] = i;
+        }
+    }
+    for (BasicBlock* bb : def_blocks_) {
+        unsigned id = bb->getId();
+        if (dom_tree_.getImmediateDominator(bb) == nullptr || is_def_[id] == epoch_) {
+            continue;
+        }
+        is_def_[id] = epoch_;
+        visited_[id] = epoch_;
+        queue_.emplace(dom_tree_.getDepth(bb), id);
+    }
+
+    const auto& blocks = graph_->getBasicBlocks();
+    while (!queue_.empty()) {
+        auto [root_depth, root_id] = queue_.top();
+        queue_.pop();
+
+        // A CFG edge from the root's subtree into a block no deeper than the root is a join
+        // edge whose target is in the root's frontier; deeper targets belong to the
+        // frontiers of deeper roots, which were processed before
+        auto visit = [&, root_depth = root_depth](BasicBlock* node) {
+            for (BasicBlock* succ : node->getSuccessors()) {
+                unsigned succ_id = succ->getId();
+                if (dom_tree_.getDepth(succ) > root_depth || queued_[succ_id] == epoch_) {
+                    continue;
+                }
+                queued_[succ_id] = epoch_;
+                if (use_live_in_ && is_live_in_[succ_id] != epoch_) {
+                    continue;
+                }
+                idf.push_back(succ);
+                // A phi is a new definition, so its own frontier is needed as well
+                if (is_def_[succ_id] != epoch_) {
+                    queue_.emplace(dom_tree_.getDepth(succ), succ_id);
+                }
+            }
+        };
+        if (use_live_in_) {
+            sweepLiveSources(blocks[root_id], visit);
+        } else {
+            sweepSubtree(blocks[root_id], visit);
+        }
+    }
+}
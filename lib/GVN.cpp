@@ -0,0 +1,60 @@
+#include "gvn.h"
+
+#include <vector>
+
+bool GVN::run() {
+    num_eliminated_ = 0;
+    table_.clear();
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+
+    // Preorder walk of the dominator tree with an explicit stack; leaving a block drops the
+    // values it made available
+    struct Frame {
+        BasicBlock* bb;
+        unsigned next_child;
+        size_t mark;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({graph_->getStartBlock(), 0, table_.mark()});
+    numberBlock(graph_->getStartBlock());
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        auto children = dom_tree_.getChildren(frame.bb);
+        if (frame.next_child < children.size()) {
+            BasicBlock* child = children[frame.next_child++];
+            stack.push_back({child, 0, table_.mark()});
+            numberBlock(child);
+        } else {
+            table_.rollback(frame.mark);
+            stack.pop_back();
+        }
+    }
+    return num_eliminated_ != 0;
+}
+
+void GVN::numberBlock(BasicBlock* bb) {
+    // removeInstructionsIf visits the instructions in order, so an instruction is numbered
+    // after everything before it in the block
+    bb->removeInstructionsIf([this](Inst* inst) {
+        ValueKey key;
+        if (!getValueKey(inst, &key)) {
+            return false;
+        }
+        Inst* leader = table_.lookup(key);
+        if (leader == nullptr) {
+            table_.insert(key, inst);
+            return false;
+        }
+        inst->replaceAllUsesWith(leader);
+        inst->dropAllReferences();
+        ++num_eliminated_;
+        return true;
+    });
+}
+
+PreservedAnalyses GVNPass::run(Graph& g, AnalysisManager& am) {
+    GVN gvn(&g, am.getDominatorTree());
+    return gvn.run() ? PreservedAnalyses::cfg() : PreservedAnalyses::all();
+}
@@ -3,24 +3,82 @@
 Graph::Graph(const std::string& name) : name_(name) {
 }
 
+Graph::~Graph() {
+    // Instructions are trivially destructible; blocks own std containers and must be
+    // destroyed before the arena releases their memory.
+    for (auto* bb : basic_blocks_) {
+        bb->~BasicBlock();
+    }
+}
+
 BasicBlock* Graph::createBB(const std::string& name) {
     unsigned id = basic_blocks_.size();
-    basic_blocks_.push_back(std::make_unique<BasicBlock>(id, name));
-    return basic_blocks_.back().get();
+    basic_blocks_.push_back(arena_.create<BasicBlock>(id, name, this));
+    return basic_blocks_.back();
 }
 
 void Graph::buildPredecessors() {
-    // clear old connections
-    for (const auto& bb : basic_blocks_) {
+    size_t num_blocks = basic_blocks_.size();
+    auto& succ_offsets = edges_.succ_offsets_;
+    auto& succ_targets = edges_.succ_targets_;
+    auto& pred_offsets = edges_.pred_offsets_;
+    auto& pred_targets = edges_.pred_targets_;
+
+    // Successor CSR, counting in-degrees on the way
+    succ_offsets.assign(num_blocks + 1, 0);
+    pred_offsets.assign(num_blocks + 1, 0);
+    succ_targets.clear();
+    for (size_t id = 0; id < num_blocks; ++id) {
+        for (auto* succ : basic_blocks_[id]->getSuccessors()) {
+            succ_targets.push_back(succ->getId());
+            ++pred_offsets[succ->getId() + 1];
+        }
+        succ_offsets[id + 1] = succ_targets.size();
+    }
+
+    // Predecessor CSR: prefix sums, then scatter the edges in source-block order
+    for (size_t id = 0; id < num_blocks; ++id) {
+        pred_offsets[id + 1] += pred_offsets[id];
+    }
+    pred_targets.resize(succ_targets.size());
+    std::vector<unsigned> fill(pred_offsets.begin(), pred_offsets.end() - 1);
+    for (size_t id = 0; id < num_blocks; ++id) {
+        for (unsigned i = succ_offsets[id]; i < succ_offsets[id + 1]; ++i) {
+            pred_targets[fill[succ_targets[i]]++] = id;
+        }
+    }
+
+    // Per-block predecessor lists mirror the table
+    for (size_t id = 0; id < num_blocks; ++id) {
+        BasicBlock* bb = basic_blocks_[id];
         bb->clearPredecessors();
+        for (unsigned pred : edges_.getPredecessors(id)) {
+            bb->addPredecessor(basic_blocks_[pred]);
+        }
     }
+}
 
-    for (const auto& bb : basic_blocks_) {
-        auto successors = bb->getSuccessors();
-        for (auto* succ : successors) {
-            succ->addPredecessor(bb.get());
+bool Graph::compactInstIds() {
+    unsigned next_id = 0;
+    bool dense = true;
+    for (BasicBlock* bb : basic_blocks_) {
+        for (Inst* inst : bb->getInstructions()) {
+            dense &= inst->id_ == next_id++;
+        }
+    }
+    if (dense && next_id == all_insts_.size()) {
+        return false;
+    }
+    all_insts_.clear();
+    for (BasicBlock* bb : basic_blocks_) {
+        for (Inst* inst : bb->getInstructions()) {
+            inst->id_ = all_insts_.size();
+            all_insts_.push_back(inst);
         }
     }
+    next_inst_id_ = all_insts_.size();
+    cons_table_.clear();  // Keyed by the old operand ids
+    return true;
 }
 
 void Graph::setStartBlock(BasicBlock* bb) {
@@ -31,7 +89,7 @@ BasicBlock* Graph::getStartBlock() const {
     return start_block_;
 }
 
-const std::vector<std::unique_ptr<BasicBlock>>& Graph::getBasicBlocks() const {
+const std::vector<BasicBlock*>& Graph::getBasicBlocks() const {
     return basic_blocks_;
 }
 
@@ -0,0 +1,721 @@
+#include "ir_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace {
+
+constexpr uint32_t kNone = ~0u;
+
+// One instruction line. Like in the binary format, the operands are value ids followed by
+// block ids: one per phi incoming value, the target of a jmp, or the two of a cond_jump.
+struct Record {
+    Opcode opcode;
+    uint32_t id;  // kNone for the instructions dump prints without one
+    uint32_t first_operand;
+    uint32_t num_values;
+    size_t offset;  // Start of the instruction, for errors
+    int64_t imm;    // CONST: value; PARAM: index
+};
+
+struct BlockRecord {
+    std::string_view name;
+    uint32_t first_record;
+    uint32_t num_records;
+};
+
+// Indexed by Opcode, as Inst::dump prints them
+constexpr std::string_view kOpcodeNames[] = {
+    "add", "mul", "cmp", "jmp", "cond_jump", "return", "phi",
+    "param", "const", "mov", "cast", "alloca", "load", "store",
+};
+
+// Picks the candidate by first letter and length, then checks the whole word. CAST is not
+// read yet.
+bool lookupOpcode(std::string_view word, Opcode& opcode) {
+    Opcode candidate;
+    switch (word[0]) {
+        case 'a':
+            candidate = word.size() == 3 ? Opcode::ADD : Opcode::ALLOCA;
+            break;
+        case 'c':
+            candidate = word.size() == 3   ? Opcode::CMP
+                        : word.size() == 5 ? Opcode::CONST
+                                           : Opcode::COND_JUMP;
+            break;
+        case 'j':
+            candidate = Opcode::JUMP;
+            break;
+        case 'l':
+            candidate = Opcode::LOAD;
+            break;
+        case 'm':
+            candidate = word.size() > 1 && word[1] == 'o' ? Opcode::MOV : Opcode::MUL;
+            break;
+        case 'p':
+            candidate = word.size() == 3 ? Opcode::PHI : Opcode::PARAM;
+            break;
+        case 'r':
+            candidate = Opcode::RETURN;
+            break;
+        case 's':
+            candidate = Opcode::STORE;
+            break;
+        default:
+            return false;
+    }
+    if (word != kOpcodeNames[static_cast<int>(candidate)]) {
+        return false;
+    }
+    opcode = candidate;
+    return true;
+}
+
+uint32_t getNumBlocks(const Record& record) {
+    switch (record.opcode) {
+        case Opcode::PHI:
+            return record.num_values;
+        case Opcode::JUMP:
+            return 1;
+        case Opcode::COND_JUMP:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Whether dump prints "iN = " before an instruction; RETURN depends on its operand
+bool hasResultId(Opcode opcode) {
+    return opcode != Opcode::STORE && opcode != Opcode::JUMP && opcode != Opcode::COND_JUMP;
+}
+
+// Lexes and records the whole text in one pass, without copying it, then checks every
+// reference before anything is built
+class TextReader {
+   public:
+    explicit TextReader(std::string_view text)
+        : begin_(text.data()), pos_(text.data()), end_(text.data() + text.size()) {
+    }
+
+    bool read();
+    bool resolve();
+    // Only after read() and resolve() succeeded
+    void build(Graph& g) const;
+
+    size_t getErrorOffset() const {
+        return error_offset_;
+    }
+    const std::string& getError() const {
+        return error_;
+    }
+
+   private:
+    bool fail(const char* at, std::string message) {
+        error_offset_ = at - begin_;
+        error_ = std::move(message);
+        return false;
+    }
+
+    void skipBlanks() {
+        while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r')) {
+            ++pos_;
+        }
+    }
+    // Moves to the first character of the next non-blank line; false at the end of the text
+    bool nextLine() {
+        for (;;) {
+            skipBlanks();
+            if (pos_ == end_) {
+                return false;
+            }
+            if (*pos_ != '\n') {
+                return true;
+            }
+            ++pos_;
+        }
+    }
+    bool atLineEnd() {
+        skipBlanks();
+        return pos_ == end_ || *pos_ == '\n';
+    }
+    const char* findLineEnd() const {
+        return std::find(pos_, end_, '\n');
+    }
+
+    bool endLine();
+    bool expect(char c);
+    bool expectWord(std::string_view word);
+    std::string_view readWord();
+    bool readNumber(uint32_t& value);
+    bool readInteger(int64_t& value);
+    bool readValue(Record& record);
+    bool readBlock(uint32_t& id);
+    bool readPhi(Record& record);
+    bool readDashes();
+    bool readBlockHeader();
+    bool readInstruction();
+    const char* findOperand(const Record& record, uint32_t i) const;
+
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+    std::string_view name_;
+    std::vector<BlockRecord> blocks_;
+    std::vector<Record> records_;
+    std::vector<uint32_t> operands_;
+    std::vector<uint32_t> phi_blocks_;
+    std::vector<uint32_t> def_of_;  // Value id -> record
+    uint32_t num_ids_ = 0;          // Including the ids of instructions without one
+    size_t error_offset_ = 0;
+    std::string error_;
+};
+
+bool TextReader::endLine() {
+    if (!atLineEnd()) {
+        return fail(pos_, "expected the end of the line");
+    }
+    if (pos_ < end_) {
+        ++pos_;
+    }
+    return true;
+}
+
+bool TextReader::expect(char c) {
+    skipBlanks();
+    if (pos_ == end_ || *pos_ != c) {
+        return fail(pos_, std::string("expected '") + c + "'");
+    }
+    ++pos_;
+    return true;
+}
+
+bool TextReader::expectWord(std::string_view word) {
+    skipBlanks();
+    if (size_t(end_ - pos_) < word.size() || std::memcmp(pos_, word.data(), word.size()) != 0) {
+        return fail(pos_, "expected '" + std::string(word) + "'");
+    }
+    pos_ += word.size();
+    return true;
+}
+
+std::string_view TextReader::readWord() {
+    skipBlanks();
+    const char* start = pos_;
+    while (pos_ < end_ && ((*pos_ >= 'a' && *pos_ <= 'z') || *pos_ == '_')) {
+        ++pos_;
+    }
+    return std::string_view(start, pos_ - start);
+}
+
+bool TextReader::readNumber(uint32_t& value) {
+    skipBlanks();
+    const char* start = pos_;
+    uint64_t number = 0;
+    while (pos_ < end_ && unsigned(*pos_ - '0') < 10 && pos_ - start <= 10) {
+        number = number * 10 + (*pos_ - '0');
+        ++pos_;
+    }
+    if (pos_ == start) {
+        return fail(start, "expected a number");
+    }
+    if (number > UINT32_MAX) {
+        return fail(start, "number out of range");
+    }
+    value = number;
+    return true;
+}
+
+bool TextReader::readInteger(int64_t& value) {
+    skipBlanks();
+    const char* start = pos_;
+    bool negative = pos_ < end_ && *pos_ == '-';
+    if (negative) {
+        ++pos_;
+    }
+    const uint64_t limit = negative ? uint64_t(1) << 63 : (uint64_t(1) << 63) - 1;
+    const char* digits = pos_;
+    uint64_t magnitude = 0;
+    while (pos_ < end_ && unsigned(*pos_ - '0') < 10) {
+        unsigned digit = *pos_ - '0';
+        if (magnitude > (limit - digit) / 10) {
+            return fail(start, "number out of range");
+        }
+        magnitude = magnitude * 10 + digit;
+        ++pos_;
+    }
+    if (pos_ == digits) {
+        return fail(start, "expected a number");
+    }
+    value = negative ? static_cast<int64_t>(~magnitude + 1) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+bool TextReader::readValue(Record& record) {
+    skipBlanks();
+    const char* start = pos_;
+    uint32_t id;
+    if (pos_ == end_ || *pos_ != 'i') {
+        return fail(start, "expected a value");
+    }
+    ++pos_;
+    if (!readNumber(id)) {
+        return false;
+    }
+    operands_.push_back(id);
+    ++record.num_values;
+    return true;
+}
+
+bool TextReader::readBlock(uint32_t& id) {
+    return expectWord("BB") && readNumber(id);
+}
+
+// [ [ iX, %BBy ], ... ]; the values go first in the operand list, the blocks after them
+bool TextReader::readPhi(Record& record) {
+    if (!expect('[')) {
+        return false;
+    }
+    phi_blocks_.clear();
+    skipBlanks();
+    if (pos_ < end_ && *pos_ != ']') {
+        do {
+            uint32_t block;
+            if (!expect('[') || !readValue(record) || !expect(',') || !expect('%') ||
+                !readBlock(block) || !expect(']')) {
+                return false;
+            }
+            phi_blocks_.push_back(block);
+            skipBlanks();
+        } while (pos_ < end_ && *pos_ == ',' && ++pos_);
+    }
+    if (!expect(']')) {
+        return false;
+    }
+    operands_.insert(operands_.end(), phi_blocks_.begin(), phi_blocks_.end());
+    return true;
+}
+
+bool TextReader::readDashes() {
+    if (pos_ == end_ || *pos_ != '-') {
+        return fail(pos_, "expected a line of dashes");
+    }
+    while (pos_ < end_ && *pos_ == '-') {
+        ++pos_;
+    }
+    return endLine();
+}
+
+// BB<n> (<name>):  ; preds = %BBa, %BBb
+bool TextReader::readBlockHeader() {
+    const char* start = pos_;
+    uint32_t id;
+    if (!readBlock(id)) {
+        return false;
+    }
+    if (id != blocks_.size()) {
+        return fail(start, "expected BB" + std::to_string(blocks_.size()));
+    }
+    if (!expect('(')) {
+        return false;
+    }
+    // Names are printed verbatim, so the name ends at the first "):" of the line
+    const char* eol = findLineEnd();
+    const char* close = pos_;
+    while (close + 1 < eol && !(close[0] == ')' && close[1] == ':')) {
+        ++close;
+    }
+    if (close + 1 >= eol) {
+        return fail(pos_, "expected '):'");
+    }
+    blocks_.push_back({std::string_view(pos_, close - pos_),
+                       static_cast<uint32_t>(records_.size()), 0});
+    pos_ = close + 2;
+
+    // The predecessors are recomputed from the terminators, so they are only checked
+    skipBlanks();
+    if (pos_ < end_ && *pos_ == ';') {
+        ++pos_;
+        if (!expectWord("preds") || !expect('=')) {
+            return false;
+        }
+        if (!atLineEnd()) {
+            do {
+                uint32_t pred;
+                if (!expect('%') || !readBlock(pred)) {
+                    return false;
+                }
+                skipBlanks();
+            } while (pos_ < end_ && *pos_ == ',' && ++pos_);
+        }
+    }
+    return endLine();
+}
+
+bool TextReader::readInstruction() {
+    Record record{};
+    record.id = kNone;
+    record.first_operand = operands_.size();
+    record.offset = pos_ - begin_;
+    if (*pos_ == 'i' && pos_ + 1 < end_ && unsigned(pos_[1] - '0') < 10) {
+        ++pos_;
+        if (!readNumber(record.id) || !expect('=')) {
+            return false;
+        }
+    }
+    skipBlanks();
+    const char* at = pos_;
+    std::string_view word = readWord();
+    if (word.empty()) {
+        return fail(at, "expected an instruction");
+    }
+    if (!lookupOpcode(word, record.opcode)) {
+        return fail(at, "unknown instruction '" + std::string(word) + "'");
+    }
+    bool has_id = record.id != kNone;
+    bool needs_id = record.opcode == Opcode::RETURN ? !atLineEnd() : hasResultId(record.opcode);
+    if (has_id && !needs_id) {
+        if (record.opcode == Opcode::RETURN) {
+            return fail(pos_, "expected a value");
+        }
+        return fail(begin_ + record.offset, "'" + std::string(word) + "' has no result");
+    }
+    if (!has_id && needs_id) {
+        return fail(at, "'" + std::string(word) + "' needs a result id");
+    }
+
+    uint32_t block;
+    bool ok = true;
+    switch (record.opcode) {
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::CMP:
+        case Opcode::STORE:
+            ok = readValue(record) && expect(',') && readValue(record);
+            break;
+        case Opcode::RETURN:
+            ok = !has_id || readValue(record);
+            break;
+        case Opcode::LOAD:
+        case Opcode::MOV:
+            ok = readValue(record);
+            break;
+        case Opcode::JUMP:
+            ok = expectWord("->") && readBlock(block);
+            if (ok) {
+                operands_.push_back(block);
+            }
+            break;
+        case Opcode::COND_JUMP:
+            ok = readValue(record) && expectWord("->") && readBlock(block);
+            if (ok) {
+                operands_.push_back(block);
+                ok = expect(',') && readBlock(block);
+            }
+            if (ok) {
+                operands_.push_back(block);
+            }
+            break;
+        case Opcode::PHI:
+            ok = readPhi(record);
+            break;
+        case Opcode::PARAM: {
+            uint32_t index;
+            ok = expect('#') && readNumber(index);
+            record.imm = index;
+            break;
+        }
+        case Opcode::CONST:
+            ok = readInteger(record.imm);
+            break;
+        default:
+            break;  // ALLOCA
+    }
+    if (!ok || !endLine()) {
+        return false;
+    }
+    records_.push_back(record);
+    ++blocks_.back().num_records;
+    return true;
+}
+
+bool TextReader::read() {
+    // Dumps take 20 to 40 bytes per instruction and operand
+    size_t size = end_ - begin_;
+    records_.reserve(size / 32);
+    operands_.reserve(size / 16);
+    if (!nextLine() || !expectWord("Function Graph:")) {
+        return fail(pos_, "expected 'Function Graph:'");
+    }
+    if (pos_ < end_ && *pos_ == ' ') {
+        ++pos_;
+    }
+    const char* eol = findLineEnd();
+    const char* name_end = eol;
+    while (name_end > pos_ && name_end[-1] == '\r') {
+        --name_end;
+    }
+    name_ = std::string_view(pos_, name_end - pos_);
+    pos_ = eol;
+    if (!endLine() || !nextLine() || !readDashes()) {
+        return fail(pos_, "expected a line of dashes");
+    }
+    for (;;) {
+        if (!nextLine()) {
+            return fail(pos_, "expected a line of dashes after the last block");
+        }
+        bool ok;
+        if (*pos_ == '-') {
+            if (!readDashes()) {
+                return false;
+            }
+            break;
+        } else if (*pos_ == 'B') {
+            ok = readBlockHeader();
+        } else if (blocks_.empty()) {
+            return fail(pos_, "expected a block");
+        } else {
+            ok = readInstruction();
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (nextLine()) {
+        return fail(pos_, "unexpected text after the graph");
+    }
+    return true;
+}
+
+// Operand positions are not kept while reading; for an error, the i-th value or block of
+// the instruction is looked up again in its line
+const char* TextReader::findOperand(const Record& record, uint32_t i) const {
+    bool value = i < record.num_values;
+    uint32_t skip = value ? i : i - record.num_values;
+    const char* p = begin_ + record.offset;
+    if (record.id != kNone) {
+        p = std::find(p, end_, '=');  // Past the result
+    }
+    for (; p + 1 < end_ && *p != '\n'; ++p) {
+        bool found = value ? p[0] == 'i' && unsigned(p[1] - '0') < 10 &&
+                                 !((p[-1] >= 'a' && p[-1] <= 'z') || p[-1] == '_')
+                           : p[0] == 'B' && p[1] == 'B';
+        if (found && skip-- == 0) {
+            return p;
+        }
+    }
+    return begin_ + record.offset;
+}
+
+bool TextReader::resolve() {
+    // Unused ids still take a slot in the graph, so they are bounded by the size of the
+    // input; passes leave far smaller gaps
+    const size_t id_limit = 16 * records_.size() + 4096;
+    uint32_t num_named = 0;
+    num_ids_ = 0;
+    for (const Record& record : records_) {
+        if (record.id == kNone) {
+            continue;
+        }
+        if (record.id >= id_limit) {
+            return fail(begin_ + record.offset, "instruction id out of range");
+        }
+        num_ids_ = std::max(num_ids_, record.id + 1);
+        ++num_named;
+    }
+    def_of_.assign(num_ids_, kNone);
+    for (uint32_t index = 0; index < records_.size(); ++index) {
+        const Record& record = records_[index];
+        if (record.id == kNone) {
+            continue;
+        }
+        if (def_of_[record.id] != kNone) {
+            return fail(begin_ + record.offset, "i" + std::to_string(record.id) +
+                                                    " is already defined");
+        }
+        def_of_[record.id] = index;
+    }
+    for (const Record& record : records_) {
+        for (uint32_t i = 0; i < record.num_values + getNumBlocks(record); ++i) {
+            uint32_t operand = operands_[record.first_operand + i];
+            if (i < record.num_values && (operand >= num_ids_ || def_of_[operand] == kNone)) {
+                return fail(findOperand(record, i),
+                            "undefined value i" + std::to_string(operand));
+            }
+            if (i >= record.num_values && operand >= blocks_.size()) {
+                return fail(findOperand(record, i),
+                            "undefined block BB" + std::to_string(operand));
+            }
+        }
+    }
+    // Instructions without an id fill the gaps first
+    uint32_t num_unnamed = records_.size() - num_named;
+    uint32_t num_gaps = num_ids_ - num_named;
+    if (num_unnamed > num_gaps) {
+        num_ids_ += num_unnamed - num_gaps;
+    }
+    return true;
+}
+
+void TextReader::build(Graph& g) const {
+    std::vector<BasicBlock*> blocks;
+    blocks.reserve(blocks_.size());
+    for (const BlockRecord& block : blocks_) {
+        blocks.push_back(g.createBB(std::string(block.name)));
+    }
+
+    // Graph ids are handed out in creation order, so the instructions are created by id,
+    // unplaced, and put into their blocks afterwards. Operands with larger ids start out
+    // pointing at a placeholder; phis get their incoming values once everything exists.
+    AllocaInst placeholder(~0u);
+    std::vector<Inst*> insts(records_.size());
+    std::vector<uint32_t> forward_refs;  // Records with a placeholder operand
+    uint32_t next_unnamed = 0;
+    for (uint32_t id = 0; id < num_ids_; ++id) {
+        uint32_t index = id < def_of_.size() ? def_of_[id] : kNone;
+        if (index == kNone) {
+            while (next_unnamed < records_.size() && records_[next_unnamed].id != kNone) {
+                ++next_unnamed;
+            }
+            if (next_unnamed == records_.size()) {
+                // The remaining gaps stay unused
+                uint32_t next = id + 1;
+                while (next < num_ids_ && def_of_[next] == kNone) {
+                    ++next;
+                }
+                g.skipInstIds(next - id);
+                id = next - 1;
+                continue;
+            }
+            index = next_unnamed++;
+        }
+        const Record& record = records_[index];
+        const uint32_t* ops = operands_.data() + record.first_operand;
+        bool forward = false;
+        auto value = [&](unsigned i) -> Inst* {
+            if (ops[i] < id) {
+                return g.getInst(ops[i]);
+            }
+            forward = true;
+            return &placeholder;
+        };
+        Inst* inst = nullptr;
+        switch (record.opcode) {
+            case Opcode::ADD:
+            case Opcode::MUL:
+            case Opcode::CMP:
+                inst = g.createInst<BinaryInst>(nullptr, record.opcode, value(0), value(1));
+                break;
+            case Opcode::JUMP:
+                inst = g.createInst<JumpInst>(nullptr, blocks[ops[0]]);
+                break;
+            case Opcode::COND_JUMP:
+                inst = g.createInst<CondJumpInst>(nullptr, value(0), blocks[ops[1]],
+                                                  blocks[ops[2]]);
+                break;
+            case Opcode::RETURN:
+                inst = g.createInst<ReturnInst>(nullptr,
+                                                record.num_values == 0 ? nullptr : value(0));
+                break;
+            case Opcode::PHI:
+                inst = g.createInst<PhiInst>(nullptr);
+                break;
+            case Opcode::PARAM:
+                inst = g.createInst<ParamInst>(nullptr, static_cast<unsigned>(record.imm));
+                break;
+            case Opcode::CONST:
+                inst = g.createInst<ConstInst>(nullptr, record.imm);
+                break;
+            case Opcode::ALLOCA:
+                inst = g.createInst<AllocaInst>(nullptr);
+                break;
+            case Opcode::LOAD:
+                inst = g.createInst<LoadInst>(nullptr, value(0));
+                break;
+            case Opcode::MOV:
+                inst = g.createInst<MovInst>(nullptr, value(0));
+                break;
+            case Opcode::STORE:
+                inst = g.createInst<StoreInst>(nullptr, value(0), value(1));
+                break;
+            default:
+                break;  // Rejected by lookupOpcode()
+        }
+        insts[index] = inst;
+        if (forward) {
+            forward_refs.push_back(index);
+        }
+    }
+
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        blocks[b]->insertInstructions(
+            0, Span<Inst* const>(insts.data() + blocks_[b].first_record, blocks_[b].num_records));
+    }
+    for (uint32_t index = 0; index < records_.size(); ++index) {
+        const Record& record = records_[index];
+        if (record.opcode != Opcode::PHI) {
+            continue;
+        }
+        auto* phi = static_cast<PhiInst*>(insts[index]);
+        const uint32_t* ops = operands_.data() + record.first_operand;
+        for (uint32_t i = 0; i < record.num_values; ++i) {
+            phi->addIncoming(g.getInst(ops[i]), blocks[ops[record.num_values + i]]);
+        }
+    }
+    for (uint32_t index : forward_refs) {
+        const uint32_t* ops = operands_.data() + records_[index].first_operand;
+        for (uint32_t i = 0; i < records_[index].num_values; ++i) {
+            insts[index]->setOperand(i, g.getInst(ops[i]));
+        }
+    }
+
+    if (!blocks.empty()) {
+        g.setStartBlock(blocks[0]);
+    }
+    g.buildPredecessors();
+    g.setName(std::string(name_));
+}
+
+}  // namespace
+
+bool IRParser::parse(std::string_view text) {
+    error_.clear();
+    error_line_ = 0;
+    error_column_ = 0;
+    if (!graph_->getBasicBlocks().empty() || graph_->getNumInsts() != 0) {
+        error_ = "the graph is not empty";
+        return false;
+    }
+    TextReader reader(text);
+    if (!reader.read() || !reader.resolve()) {
+        size_t offset = reader.getErrorOffset();
+        size_t newline = offset == 0 ? std::string_view::npos : text.rfind('\n', offset - 1);
+        size_t line_start = newline == std::string_view::npos ? 0 : newline + 1;
+        error_line_ = 1 + std::count(text.begin(), text.begin() + offset, '\n');
+        error_column_ = 1 + offset - line_start;
+        error_ = std::to_string(error_line_) + ":" + std::to_string(error_column_) + ": " +
+                 reader.getError();
+        return false;
+    }
+    reader.build(*graph_);
+    return true;
+}
+
+bool IRParser::parseFile(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        error_ = file.getError();
+        error_line_ = 0;
+        error_column_ = 0;
+        return false;
+    }
+    if (!parse(file.getText())) {
+        if (error_line_ != 0) {
+            error_ = path + ":" + error_;
+        }
+        return false;
+    }
+    return true;
+}
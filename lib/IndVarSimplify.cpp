@@ -0,0 +1,338 @@
+#include "ind_var_simplify.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Exact arithmetic for the bounds of rewritten exit tests
+__extension__ typedef __int128 Wide;
+
+bool isInChain(const std::vector<Inst*>& chain, const Inst* inst) {
+    return std::find(chain.begin(), chain.end(), inst) != chain.end();
+}
+
+}  // namespace
+
+bool IndVarSimplify::run() {
+    num_strength_reduced_ = 0;
+    num_exit_values_replaced_ = 0;
+    num_exit_tests_replaced_ = 0;
+    num_eliminated_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+    InductionVariables ivs(graph_, loops_, dom_tree_);
+    ivs.run();
+    ivs_ = &ivs;
+    for (size_t i = 0; i < loops_.getNumLoops(); ++i) {
+        const Loop* loop = loops_.getLoop(i);
+        // Exit values and start values of the loops done so far may have placed new
+        // recurrences in this one
+        if (hasChanged()) {
+            ivs.analyzeLoop(loop);
+        }
+        phis_ = ivs.getInductionVariables(loop);
+        if (phis_.empty()) {
+            continue;
+        }
+        reduceStrength(loop);
+        replaceExitValues(loop);
+        replaceExitTest(loop);
+        eliminateInductionVariables(loop);
+    }
+    ivs_ = nullptr;
+    return hasChanged();
+}
+
+void IndVarSimplify::reduceStrength(const Loop* loop) {
+    BasicBlock* latch = loop->getLatches()[0];
+    std::vector<Inst*> reduced;
+    std::vector<Inst*> new_phis;
+    std::vector<Inst*> increments;
+    for (BasicBlock* bb : loop->getBlocks()) {
+        if (loops_.getLoopFor(bb) != loop) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            const Recurrence* found = ivs_->getRecurrence(inst);
+            if (inst->getOpcode() != Opcode::MUL || !inst->hasUses() || found == nullptr ||
+                found->step == 0) {
+                continue;
+            }
+            // Copied: recording new recurrences may move the analysis' storage
+            Recurrence rec = *found;
+            PhiInst* phi = nullptr;
+            for (PhiInst* candidate : phis_) {
+                if (*ivs_->getRecurrence(candidate) == rec) {
+                    phi = candidate;
+                    break;
+                }
+            }
+            if (phi == nullptr) {
+                phi = graph_->createInst<PhiInst>(nullptr);
+                Inst* step = emit(graph_->createInst<ConstInst>(nullptr, rec.step));
+                Inst* next = graph_->createInst<BinaryInst>(nullptr, Opcode::ADD, phi, step);
+                phi->addIncoming(materialize(rec, 0), loop->getPreheader());
+                phi->addIncoming(next, latch);
+                Recurrence advanced = rec;
+                advanced.offset = rec.evaluateConstantPart(1);
+                ivs_->addRecurrence(phi, rec);
+                ivs_->addRecurrence(next, advanced);
+                phis_.push_back(phi);
+                new_phis.push_back(phi);
+                increments.push_back(next);
+            }
+            inst->replaceAllUsesWith(phi);
+            inst->dropAllReferences();
+            reduced.push_back(inst);
+            ++num_strength_reduced_;
+        }
+    }
+    if (reduced.empty()) {
+        return;
+    }
+    removeInstructions(reduced);
+    loop->getHeader()->insertInstructions(0, Span<Inst* const>(new_phis.data(), new_phis.size()));
+    latch->insertInstructions(latch->getInstructions().size() - 1,
+                              Span<Inst* const>(increments.data(), increments.size()));
+    flushCode(loop->getPreheader());
+}
+
+void IndVarSimplify::replaceExitValues(const Loop* loop) {
+    if (!ivs_->hasConstantBackedgeTakenCount(loop)) {
+        return;
+    }
+    uint64_t count = ivs_->getBackedgeTakenCount(loop);
+    BasicBlock* exiting = ivs_->getExitingBlock(loop);
+    // Values computed on the way to the exit test hold their last iteration's value after it
+    std::vector<Inst*> users;
+    for (BasicBlock* bb : loop->getBlocks()) {
+        if (loops_.getLoopFor(bb) != loop || !dom_tree_.dominates(bb, exiting)) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            const Recurrence* rec = ivs_->getRecurrence(inst);
+            if (rec == nullptr) {
+                continue;
+            }
+            users.clear();
+            for (Inst* user : inst->getUsers()) {
+                if (!loops_.contains(loop, user->getParent()) && !isInChain(users, user)) {
+                    users.push_back(user);
+                }
+            }
+            if (users.empty()) {
+                continue;
+            }
+            Inst* value = materialize(*rec, count);
+            for (Inst* user : users) {
+                for (unsigned i = 0; i < user->getNumOperands(); ++i) {
+                    if (user->getOperand(i) == inst) {
+                        user->setOperand(i, value);
+                    }
+                }
+            }
+            ++num_exit_values_replaced_;
+        }
+    }
+    flushCode(loop->getPreheader());
+}
+
+void IndVarSimplify::replaceExitTest(const Loop* loop) {
+    if (!ivs_->hasConstantBackedgeTakenCount(loop) || ivs_->getBackedgeTakenCount(loop) == 0) {
+        return;
+    }
+    uint64_t count = ivs_->getBackedgeTakenCount(loop);
+    BasicBlock* exiting = ivs_->getExitingBlock(loop);
+    auto* jump = static_cast<CondJumpInst*>(exiting->getTerminator());
+    Inst* cond = jump->getOperand(0);
+    if (cond->getNumUses() != 1) {
+        return;
+    }
+    // Only worth it if the test is the last use of the induction variable it reads
+    PhiInst* tested = nullptr;
+    for (PhiInst* phi : phis_) {
+        std::vector<Inst*> chain = ivs_->getIncrementChain(phi);
+        for (Inst* operand : cond->getInputs()) {
+            if (operand == phi || isInChain(chain, operand)) {
+                tested = phi;
+            }
+        }
+        if (tested != nullptr) {
+            if (!isSelfContained(tested, chain, cond)) {
+                return;
+            }
+            break;
+        }
+    }
+    if (tested == nullptr) {
+        return;
+    }
+
+    bool continue_on_true = loops_.contains(loop, jump->getTrueTarget());
+    for (PhiInst* phi : phis_) {
+        const Recurrence* rec = ivs_->getRecurrence(phi);
+        // An induction variable that is dead apart from its increments would only take
+        // over the problem
+        if (phi == tested || !rec->hasConstantStart() || rec->step == 0 ||
+            isSelfContained(phi, ivs_->getIncrementChain(phi), nullptr)) {
+            continue;
+        }
+        Wide last = Wide(rec->offset) + Wide(rec->step) * Wide(count);
+        if (last > std::numeric_limits<int64_t>::max() ||
+            last < std::numeric_limits<int64_t>::min()) {
+            continue;
+        }
+        // Without wrapping, the loop goes on in iteration k <= count iff k < count, which is
+        // phi <= last - 1 if phi climbs and phi >= last + 1 if it descends
+        bool up = rec->step > 0;
+        Wide bound = !continue_on_true ? last : up ? last - 1 : last + 1;
+        Inst* limit = emit(graph_->createInst<ConstInst>(nullptr, int64_t(bound)));
+        Inst* test = up == continue_on_true
+                         ? graph_->createInst<BinaryInst>(nullptr, Opcode::CMP, phi, limit)
+                         : graph_->createInst<BinaryInst>(nullptr, Opcode::CMP, limit, phi);
+        exiting->insertInstructions(exiting->getInstructions().size() - 1,
+                                    Span<Inst* const>(&test, 1));
+        jump->setOperand(0, test);
+        cond->dropAllReferences();
+        removeInstructions({cond});
+        flushCode(loop->getPreheader());
+        ++num_exit_tests_replaced_;
+        return;
+    }
+}
+
+void IndVarSimplify::eliminateInductionVariables(const Loop* loop) {
+    BasicBlock* header = loop->getHeader();
+    // Two induction variables with the same start, scale and step differ by a constant
+    for (size_t i = 0; i < phis_.size(); ++i) {
+        PhiInst* phi = phis_[i];
+        const Recurrence* rec = ivs_->getRecurrence(phi);
+        for (size_t j = 0; j < i; ++j) {
+            PhiInst* kept = phis_[j];
+            const Recurrence* kept_rec = kept != nullptr ? ivs_->getRecurrence(kept) : nullptr;
+            if (kept_rec == nullptr || kept_rec->start != rec->start ||
+                kept_rec->scale != rec->scale || kept_rec->step != rec->step) {
+                continue;
+            }
+            std::vector<Inst*> chain = ivs_->getIncrementChain(phi);
+            auto delta = int64_t(uint64_t(rec->offset) - uint64_t(kept_rec->offset));
+            // An ADD per iteration instead of the phi is only a gain if the increments go
+            bool chain_dies = true;
+            for (Inst* inst : chain) {
+                for (Inst* user : inst->getUsers()) {
+                    chain_dies &= user == phi || isInChain(chain, user);
+                }
+            }
+            if (delta != 0 && !chain_dies) {
+                continue;
+            }
+            Inst* replacement = kept;
+            if (delta != 0) {
+                Inst* distance = emit(graph_->createInst<ConstInst>(nullptr, delta));
+                replacement = graph_->createInst<BinaryInst>(nullptr, Opcode::ADD, kept, distance);
+                unsigned num_phis = 0;
+                while (header->getInstructions()[num_phis]->getOpcode() == Opcode::PHI) {
+                    ++num_phis;
+                }
+                header->insertInstructions(num_phis, Span<Inst* const>(&replacement, 1));
+                flushCode(loop->getPreheader());
+            }
+            phi->replaceAllUsesWith(replacement);
+            if (chain_dies) {
+                deleteIfDead(phi, chain);
+            } else {
+                deleteIfDead(phi, {});
+            }
+            phis_[i] = nullptr;
+            break;
+        }
+    }
+    // Induction variables that only feed their own increments
+    for (PhiInst* phi : phis_) {
+        if (phi != nullptr) {
+            deleteIfDead(phi, ivs_->getIncrementChain(phi));
+        }
+    }
+}
+
+bool IndVarSimplify::isSelfContained(const PhiInst* phi, const std::vector<Inst*>& chain,
+                                     const Inst* other) {
+    for (Inst* user : phi->getUsers()) {
+        if (user != phi && user != other && !isInChain(chain, user)) {
+            return false;
+        }
+    }
+    for (Inst* inst : chain) {
+        for (Inst* user : inst->getUsers()) {
+            if (user != phi && user != other && !isInChain(chain, user)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool IndVarSimplify::deleteIfDead(PhiInst* phi, const std::vector<Inst*>& chain) {
+    if (!isSelfContained(phi, chain, nullptr)) {
+        return false;
+    }
+    std::vector<Inst*> dead = chain;
+    dead.push_back(phi);
+    for (Inst* inst : dead) {
+        inst->dropAllReferences();
+    }
+    removeInstructions(dead);
+    ++num_eliminated_;
+    return true;
+}
+
+Inst* IndVarSimplify::materialize(const Recurrence& rec, uint64_t k) {
+    int64_t constant = rec.evaluateConstantPart(k);
+    if (rec.hasConstantStart()) {
+        return emit(graph_->createInst<ConstInst>(nullptr, constant));
+    }
+    Inst* value = rec.start;
+    if (rec.scale != 1) {
+        Inst* scale = emit(graph_->createInst<ConstInst>(nullptr, rec.scale));
+        value = emit(graph_->createInst<BinaryInst>(nullptr, Opcode::MUL, value, scale));
+    }
+    if (constant != 0) {
+        Inst* offset = emit(graph_->createInst<ConstInst>(nullptr, constant));
+        value = emit(graph_->createInst<BinaryInst>(nullptr, Opcode::ADD, value, offset));
+    }
+    return value;
+}
+
+void IndVarSimplify::flushCode(BasicBlock* bb) {
+    if (code_.empty()) {
+        return;
+    }
+    bb->insertInstructions(bb->getInstructions().size() - 1,
+                           Span<Inst* const>(code_.data(), code_.size()));
+    code_.clear();
+}
+
+void IndVarSimplify::removeInstructions(const std::vector<Inst*>& insts) {
+    removed_.resize(graph_->getNumInsts(), 0);
+    std::vector<BasicBlock*> blocks;
+    for (Inst* inst : insts) {
+        removed_[inst->getId()] = 1;
+        if (std::find(blocks.begin(), blocks.end(), inst->getParent()) == blocks.end()) {
+            blocks.push_back(inst->getParent());
+        }
+    }
+    for (BasicBlock* bb : blocks) {
+        bb->removeInstructionsIf([this](Inst* inst) { return removed_[inst->getId()] != 0; });
+    }
+    for (Inst* inst : insts) {
+        removed_[inst->getId()] = 0;
+    }
+}
+
+PreservedAnalyses IndVarSimplifyPass::run(Graph& g, AnalysisManager& am) {
+    IndVarSimplify indvars(&g, am.getLoopInfo(), am.getDominatorTree());
+    // Instructions change, blocks and edges do not
+    return indvars.run() ? PreservedAnalyses::cfg() : PreservedAnalyses::all();
+}
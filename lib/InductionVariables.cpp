@@ -0,0 +1,279 @@
+#include "induction_variables.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Exact arithmetic for trip counts, wide enough for any difference of two int64_t
+__extension__ typedef __int128 Wide;
+
+int64_t wrapAdd(int64_t a, int64_t b) {
+    return int64_t(uint64_t(a) + uint64_t(b));
+}
+
+int64_t wrapMul(int64_t a, int64_t b) {
+    return int64_t(uint64_t(a) * uint64_t(b));
+}
+
+}  // namespace
+
+void InductionVariables::run() {
+    recurrences_.clear();
+    recurrence_of_.assign(graph_->getNumInsts(), kNone);
+    summaries_.assign(graph_->getBasicBlocks().size(), LoopSummary());
+    for (size_t i = 0; i < loops_.getNumLoops(); ++i) {
+        analyzeLoop(loops_.getLoop(i));
+    }
+}
+
+void InductionVariables::addRecurrence(const Inst* inst, const Recurrence& rec) {
+    unsigned id = inst->getId();
+    if (id >= recurrence_of_.size()) {
+        recurrence_of_.resize(id + 1, kNone);
+    }
+    recurrence_of_[id] = recurrences_.size();
+    recurrences_.push_back(rec);
+}
+
+std::vector<Inst*> InductionVariables::getIncrementChain(const PhiInst* phi) const {
+    std::vector<Inst*> chain;
+    const Loop* loop = loops_.getLoopFor(phi->getParent());
+    BasicBlock* latch = loop->getLatches()[0];
+    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+        if (phi->getIncomingBlock(i) == latch) {
+            Inst* v = phi->getIncomingValue(i);
+            for (unsigned length = 0; v != phi; ++length) {
+                if (length == kMaxChain || v->getOpcode() != Opcode::ADD) {
+                    return {};
+                }
+                chain.push_back(v);
+                Inst* rhs = v->getOperand(1);
+                v = rhs->getOpcode() == Opcode::CONST ? v->getOperand(0) : rhs;
+            }
+            break;
+        }
+    }
+    std::reverse(chain.begin(), chain.end());
+    return chain;
+}
+
+bool InductionVariables::isInvariant(const Loop* loop, const Inst* inst) const {
+    return inst->getOpcode() == Opcode::CONST ||
+           (inst->getParent() != nullptr && !loops_.contains(loop, inst->getParent()));
+}
+
+void InductionVariables::analyzeLoop(const Loop* loop) {
+    if (loop->getPreheader() == nullptr || loop->getLatches().size() != 1) {
+        return;
+    }
+    LoopSummary& summary = summaries_[loop->getHeader()->getId()];
+    summary = LoopSummary();
+    for (BasicBlock* bb : loop->getBlocks()) {
+        if (loops_.getLoopFor(bb) != loop) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getId() < recurrence_of_.size()) {
+                recurrence_of_[inst->getId()] = kNone;
+            }
+        }
+    }
+    for (Inst* inst : loop->getHeader()->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            break;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        Recurrence rec;
+        if (findBasicInductionVariable(loop, phi, &rec)) {
+            addRecurrence(phi, rec);
+            summary.phis.push_back(phi);
+        }
+    }
+    if (summary.phis.empty()) {
+        return;
+    }
+    // Reverse post-order visits operands before their users
+    for (BasicBlock* bb : loop->getBlocks()) {
+        if (loops_.getLoopFor(bb) != loop) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            Recurrence rec;
+            if (deriveRecurrence(loop, inst, &rec)) {
+                addRecurrence(inst, rec);
+            }
+        }
+    }
+    computeExit(loop, &summary);
+}
+
+bool InductionVariables::findBasicInductionVariable(const Loop* loop, PhiInst* phi,
+                                                    Recurrence* rec) const {
+    if (phi->getNumIncoming() != 2) {
+        return false;
+    }
+    Inst* init = nullptr;
+    Inst* next = nullptr;
+    for (auto [value, pred] : phi->getIncoming()) {
+        if (pred == loop->getPreheader()) {
+            init = value;
+        } else if (pred == loop->getLatches()[0]) {
+            next = value;
+        }
+    }
+    if (init == nullptr || next == nullptr || !isInvariant(loop, init)) {
+        return false;
+    }
+    int64_t step = 0;
+    Inst* v = next;
+    for (unsigned length = 0; v != phi; ++length) {
+        if (length == kMaxChain || v->getOpcode() != Opcode::ADD) {
+            return false;
+        }
+        Inst* lhs = v->getOperand(0);
+        Inst* rhs = v->getOperand(1);
+        if (rhs->getOpcode() == Opcode::CONST) {
+            step = wrapAdd(step, static_cast<ConstInst*>(rhs)->getValue());
+            v = lhs;
+        } else if (lhs->getOpcode() == Opcode::CONST) {
+            step = wrapAdd(step, static_cast<ConstInst*>(lhs)->getValue());
+            v = rhs;
+        } else {
+            return false;
+        }
+    }
+    rec->loop = loop;
+    if (init->getOpcode() == Opcode::CONST) {
+        rec->offset = static_cast<ConstInst*>(init)->getValue();
+    } else {
+        rec->start = init;
+        rec->scale = 1;
+    }
+    rec->step = step;
+    return true;
+}
+
+bool InductionVariables::deriveRecurrence(const Loop* loop, const Inst* inst,
+                                          Recurrence* rec) const {
+    if (inst->getOpcode() != Opcode::ADD && inst->getOpcode() != Opcode::MUL) {
+        return false;
+    }
+    // Both operands as recurrences; invariant operands are recurrences with step 0
+    Recurrence terms[2];
+    bool varies = false;
+    for (unsigned i = 0; i < 2; ++i) {
+        Inst* operand = inst->getOperand(i);
+        Recurrence& term = terms[i];
+        term.loop = loop;
+        if (operand->getOpcode() == Opcode::CONST) {
+            term.offset = static_cast<ConstInst*>(operand)->getValue();
+        } else if (isInvariant(loop, operand)) {
+            term.start = operand;
+            term.scale = 1;
+        } else if (const Recurrence* known = getRecurrence(operand);
+                   known != nullptr && known->loop == loop) {
+            term = *known;
+            varies = true;
+        } else {
+            return false;
+        }
+    }
+    if (!varies) {
+        return false;
+    }
+    Recurrence& a = terms[0];
+    Recurrence& b = terms[1];
+    if (inst->getOpcode() == Opcode::MUL) {
+        // A product of two varying values is not affine, and neither is a product with an
+        // unknown invariant
+        if (!b.hasConstantStart() || b.step != 0) {
+            std::swap(a, b);
+        }
+        if (!b.hasConstantStart() || b.step != 0) {
+            return false;
+        }
+        int64_t factor = b.offset;
+        *rec = a;
+        rec->scale = wrapMul(a.scale, factor);
+        rec->offset = wrapMul(a.offset, factor);
+        rec->step = wrapMul(a.step, factor);
+    } else {
+        if (!a.hasConstantStart() && !b.hasConstantStart() && a.start != b.start) {
+            return false;
+        }
+        *rec = a.hasConstantStart() ? b : a;
+        rec->scale = wrapAdd(a.scale, b.scale);
+        rec->offset = wrapAdd(a.offset, b.offset);
+        rec->step = wrapAdd(a.step, b.step);
+    }
+    if (rec->scale == 0) {
+        rec->start = nullptr;
+    }
+    return true;
+}
+
+void InductionVariables::computeExit(const Loop* loop, LoopSummary* summary) const {
+    BasicBlock* exiting = nullptr;
+    for (BasicBlock* bb : loop->getBlocks()) {
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (!loops_.contains(loop, succ)) {
+                if (exiting != nullptr && exiting != bb) {
+                    return;
+                }
+                exiting = bb;
+            }
+        }
+    }
+    if (exiting == nullptr || loops_.getLoopFor(exiting) != loop ||
+        !dom_tree_.dominates(exiting, loop->getLatches()[0]) ||
+        exiting->getTerminator()->getOpcode() != Opcode::COND_JUMP) {
+        return;
+    }
+    summary->exiting = exiting;
+
+    auto* jump = static_cast<CondJumpInst*>(exiting->getTerminator());
+    Inst* cond = jump->getOperand(0);
+    if (cond->getOpcode() != Opcode::CMP) {
+        return;
+    }
+    bool rec_on_lhs = true;
+    const Recurrence* rec = getRecurrence(cond->getOperand(0));
+    Inst* bound = cond->getOperand(1);
+    if (rec == nullptr || rec->loop != loop) {
+        rec_on_lhs = false;
+        rec = getRecurrence(cond->getOperand(1));
+        bound = cond->getOperand(0);
+    }
+    if (rec == nullptr || rec->loop != loop || !rec->hasConstantStart() ||
+        bound->getOpcode() != Opcode::CONST) {
+        return;
+    }
+    // The loop goes on while the value climbs up to limit, or while it descends to it
+    bool continue_on_true = loops_.contains(loop, jump->getTrueTarget());
+    Wide value = static_cast<ConstInst*>(bound)->getValue();
+    bool up = rec_on_lhs == continue_on_true;
+    Wide limit = continue_on_true ? value : rec_on_lhs ? value + 1 : value - 1;
+
+    Wide x0 = rec->offset;
+    Wide step = rec->step;
+    Wide count = 0;
+    if (up && x0 <= limit) {
+        if (step <= 0) {
+            return;
+        }
+        count = (limit - x0) / step + 1;
+    } else if (!up && x0 >= limit) {
+        if (step >= 0) {
+            return;
+        }
+        count = (x0 - limit) / -step + 1;
+    }
+    // The value that fails the test must not have wrapped around
+    Wide last = x0 + step * count;
+    if (last > std::numeric_limits<int64_t>::max() || last < std::numeric_limits<int64_t>::min()) {
+        return;
+    }
+    summary->has_count = true;
+    summary->count = uint64_t(count);
+}
@@ -0,0 +1,462 @@
+#include "interpreter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+#include "cfg_traversal.h"
+#include "parallel_copy.h"
+
+namespace {
+
+constexpr unsigned kNumOps = static_cast<unsigned>(BytecodeOp::RETURN_VOID) + 1;
+
+// Arithmetic goes through uint64_t so that overflow wraps instead of being undefined
+int64_t wrapAdd(int64_t lhs, int64_t rhs) {
+    return static_cast<int64_t>(static_cast<uint64_t>(lhs) + static_cast<uint64_t>(rhs));
+}
+
+int64_t wrapMul(int64_t lhs, int64_t rhs) {
+    return static_cast<int64_t>(static_cast<uint64_t>(lhs) * static_cast<uint64_t>(rhs));
+}
+
+// The dispatch loop. With a non-null `handlers` it only reports the address of each op's
+// handler, indexed by BytecodeOp, so that compile() can thread the code. Compilers without
+// computed goto get a switch loop instead, and the handler addresses stay unused.
+int64_t dispatch(const BytecodeInstr* code, int64_t* regs, const void* const** handlers) {
+    const BytecodeInstr* pc = code;
+#if defined(__GNUC__)
+    static const void* const kHandlers[] = {
+        &&op_ADD,           &&op_MUL,        &&op_CMP,        &&op_MOV,
+        &&op_JUMP,          &&op_BRANCH_IF,  &&op_BRANCH_IF_NOT,
+        &&op_JUMP_IF_LE,    &&op_JUMP_IF_GT, &&op_RETURN,     &&op_RETURN_VOID,
+    };
+    static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) == kNumOps,
+                  "one handler per BytecodeOp");
+    if (handlers != nullptr) {
+        *handlers = kHandlers;
+        return 0;
+    }
+#define HANDLER(op) op_##op:
+#define NEXT() goto* pc->handler
+    NEXT();
+#else
+    if (handlers != nullptr) {
+        *handlers = nullptr;
+        return 0;
+    }
+#define HANDLER(op) case BytecodeOp::op:
+#define NEXT() continue
+    for (;;) {
+        switch (pc->op) {
+#endif
+    HANDLER(ADD) {
+        regs[pc->dst] = wrapAdd(regs[pc->lhs], regs[pc->rhs]);
+        ++pc;
+        NEXT();
+    }
+    HANDLER(MUL) {
+        regs[pc->dst] = wrapMul(regs[pc->lhs], regs[pc->rhs]);
+        ++pc;
+        NEXT();
+    }
+    HANDLER(CMP) {
+        regs[pc->dst] = regs[pc->lhs] <= regs[pc->rhs];
+        ++pc;
+        NEXT();
+    }
+    HANDLER(MOV) {
+        regs[pc->dst] = regs[pc->lhs];
+        ++pc;
+        NEXT();
+    }
+    HANDLER(JUMP) {
+        pc = code + pc->dst;
+        NEXT();
+    }
+    HANDLER(BRANCH_IF) {
+        pc = regs[pc->lhs] != 0 ? code + pc->dst : pc + 1;
+        NEXT();
+    }
+    HANDLER(BRANCH_IF_NOT) {
+        pc = regs[pc->lhs] == 0 ? code + pc->dst : pc + 1;
+        NEXT();
+    }
+    HANDLER(JUMP_IF_LE) {
+        pc = regs[pc->lhs] <= regs[pc->rhs] ? code + pc->dst : pc + 1;
+        NEXT();
+    }
+    HANDLER(JUMP_IF_GT) {
+        pc = regs[pc->lhs] > regs[pc->rhs] ? code + pc->dst : pc + 1;
+        NEXT();
+    }
+    HANDLER(RETURN) {
+        return regs[pc->lhs];
+    }
+    HANDLER(RETURN_VOID) {
+        return 0;
+    }
+#undef HANDLER
+#undef NEXT
+#if !defined(__GNUC__)
+        }
+    }
+#endif
+}
+
+const char* opName(BytecodeOp op) {
+    switch (op) {
+        case BytecodeOp::ADD:
+            return "add";
+        case BytecodeOp::MUL:
+            return "mul";
+        case BytecodeOp::CMP:
+            return "cmp";
+        case BytecodeOp::MOV:
+            return "mov";
+        case BytecodeOp::JUMP:
+            return "jmp";
+        case BytecodeOp::BRANCH_IF:
+            return "br_if";
+        case BytecodeOp::BRANCH_IF_NOT:
+            return "br_if_not";
+        case BytecodeOp::JUMP_IF_LE:
+            return "jmp_if_le";
+        case BytecodeOp::JUMP_IF_GT:
+            return "jmp_if_gt";
+        case BytecodeOp::RETURN:
+            return "ret";
+        case BytecodeOp::RETURN_VOID:
+            return "ret_void";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+bool Interpreter::compile() {
+    code_.clear();
+    constants_.clear();
+    error_.clear();
+    num_slots_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        error_ = "the graph has no start block";
+        return false;
+    }
+    CFGTraversal traversal(graph_);
+    traversal.run();
+    const auto& order = traversal.getReversePostOrder();
+    if (!assignSlots(order)) {
+        return false;
+    }
+
+    unsigned num_blocks = graph_->getBasicBlocks().size();
+    std::vector<bool> has_phis(num_blocks, false);
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() == Opcode::PHI) {
+                has_phis[bb->getId()] = true;
+                break;
+            }
+        }
+    }
+
+    // Branches name labels until everything is laid out: a block id, or num_blocks + k for
+    // the k-th edge stub
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> stubs;
+    std::vector<std::pair<size_t, unsigned>> fixups;  // (instruction index, label)
+    auto emitBranch = [&](BytecodeOp op, unsigned label, uint32_t lhs = 0, uint32_t rhs = 0) {
+        fixups.emplace_back(code_.size(), label);
+        emit(op, 0, lhs, rhs);
+    };
+    // The phi moves of an edge out of a block with two successors cannot go in either block
+    auto edgeLabel = [&](BasicBlock* pred, BasicBlock* succ) {
+        if (!has_phis[succ->getId()]) {
+            return succ->getId();
+        }
+        stubs.emplace_back(pred, succ);
+        return static_cast<unsigned>(num_blocks + stubs.size() - 1);
+    };
+    auto slotOf = [this](const Inst* inst, unsigned operand) {
+        return slots_[inst->getOperand(operand)->getId()];
+    };
+
+    std::vector<unsigned> label_offsets(num_blocks, kNoSlot);
+    for (size_t i = 0; i < order.size(); ++i) {
+        BasicBlock* bb = order[i];
+        unsigned next_label = i + 1 < order.size() ? order[i + 1]->getId() : kNoSlot;
+        label_offsets[bb->getId()] = code_.size();
+        Inst* terminator = bb->getTerminator();
+        if (terminator == nullptr) {
+            error_ = "BB" + std::to_string(bb->getId()) + " has no terminator";
+            return false;
+        }
+
+        // A CMP whose only use is this block's COND_JUMP is fused into the branch, which then
+        // reads its operands. With variables, an instruction between the two may write an
+        // operand's slot; the compare then stays where it is.
+        Inst* fused = nullptr;
+        if (terminator->getOpcode() == Opcode::COND_JUMP) {
+            Inst* cond = terminator->getOperand(0);
+            if (cond->getOpcode() == Opcode::CMP && cond->getParent() == bb &&
+                cond->getNumUses() == 1) {
+                fused = cond;
+                Span<Inst* const> insts = bb->getInstructions();
+                auto it = std::find(insts.begin(), insts.end(), cond);
+                for (++it; fused != nullptr && *it != terminator; ++it) {
+                    unsigned slot = slots_[(*it)->getId()];
+                    if (slot == slotOf(cond, 0) || slot == slotOf(cond, 1)) {
+                        fused = nullptr;
+                    }
+                }
+            }
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            BytecodeOp op;
+            switch (inst->getOpcode()) {
+                case Opcode::ADD:
+                    op = BytecodeOp::ADD;
+                    break;
+                case Opcode::MUL:
+                    op = BytecodeOp::MUL;
+                    break;
+                case Opcode::CMP:
+                    op = BytecodeOp::CMP;
+                    break;
+                case Opcode::MOV:
+                    if (slots_[inst->getId()] != slotOf(inst, 0)) {
+                        emit(BytecodeOp::MOV, slots_[inst->getId()], slotOf(inst, 0));
+                    }
+                    continue;
+                default:
+                    continue;
+            }
+            if (inst != fused) {
+                emit(op, slots_[inst->getId()], slotOf(inst, 0), slotOf(inst, 1));
+            }
+        }
+
+        switch (terminator->getOpcode()) {
+            case Opcode::RETURN:
+                if (terminator->getNumOperands() == 0) {
+                    emit(BytecodeOp::RETURN_VOID, 0);
+                } else {
+                    emit(BytecodeOp::RETURN, 0, slotOf(terminator, 0));
+                }
+                break;
+            case Opcode::JUMP: {
+                BasicBlock* target = static_cast<JumpInst*>(terminator)->getTarget();
+                if (!emitPhiMoves(bb, target)) {
+                    return false;
+                }
+                if (target->getId() != next_label) {
+                    emitBranch(BytecodeOp::JUMP, target->getId());
+                }
+                break;
+            }
+            case Opcode::COND_JUMP: {
+                auto* cond_jump = static_cast<CondJumpInst*>(terminator);
+                unsigned true_label = edgeLabel(bb, cond_jump->getTrueTarget());
+                unsigned false_label = edgeLabel(bb, cond_jump->getFalseTarget());
+                uint32_t lhs = fused ? slotOf(fused, 0) : slotOf(cond_jump, 0);
+                uint32_t rhs = fused ? slotOf(fused, 1) : 0;
+                if (true_label == next_label) {
+                    auto op = fused ? BytecodeOp::JUMP_IF_GT : BytecodeOp::BRANCH_IF_NOT;
+                    emitBranch(op, false_label, lhs, rhs);
+                } else {
+                    auto op = fused ? BytecodeOp::JUMP_IF_LE : BytecodeOp::BRANCH_IF;
+                    emitBranch(op, true_label, lhs, rhs);
+                    if (false_label != next_label) {
+                        emitBranch(BytecodeOp::JUMP, false_label);
+                    }
+                }
+                break;
+            }
+            default:
+                return fail(terminator, "is not a supported terminator");
+        }
+    }
+
+    // Edge stubs go after all blocks, off the fall-through paths
+    label_offsets.resize(num_blocks + stubs.size());
+    for (size_t k = 0; k < stubs.size(); ++k) {
+        label_offsets[num_blocks + k] = code_.size();
+        if (!emitPhiMoves(stubs[k].first, stubs[k].second)) {
+            return false;
+        }
+        emitBranch(BytecodeOp::JUMP, stubs[k].second->getId());
+    }
+    for (const auto& [index, label] : fixups) {
+        assert(label_offsets[label] != kNoSlot);
+        code_[index].dst = label_offsets[label];
+    }
+
+    const void* const* handlers = nullptr;
+    dispatch(nullptr, nullptr, &handlers);
+    if (handlers != nullptr) {
+        for (BytecodeInstr& instr : code_) {
+            instr.handler = handlers[static_cast<unsigned>(instr.op)];
+        }
+    }
+    return true;
+}
+
+bool Interpreter::assignSlots(const std::vector<BasicBlock*>& order) {
+    slots_.assign(graph_->getNumInsts(), kNoSlot);
+    num_params_ = 0;
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            switch (inst->getOpcode()) {
+                case Opcode::PARAM:
+                    num_params_ =
+                        std::max(num_params_, static_cast<ParamInst*>(inst)->getIndex() + 1);
+                    break;
+                case Opcode::CONST:
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP:
+                case Opcode::MOV:
+                case Opcode::PHI:
+                case Opcode::JUMP:
+                case Opcode::COND_JUMP:
+                case Opcode::RETURN:
+                    break;
+                default:
+                    return fail(inst, "is not supported by the interpreter");
+            }
+        }
+    }
+
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() == Opcode::PARAM) {
+                slots_[inst->getId()] = static_cast<ParamInst*>(inst)->getIndex();
+            } else if (inst->getOpcode() == Opcode::CONST) {
+                slots_[inst->getId()] = num_params_ + constants_.size();
+                constants_.push_back(static_cast<ConstInst*>(inst)->getValue());
+            }
+        }
+    }
+    unsigned next_slot = num_params_ + constants_.size();
+    std::vector<unsigned> variable_slots;  // Indexed by variable, kNoSlot until first seen
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            switch (inst->getOpcode()) {
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP:
+                case Opcode::MOV:
+                case Opcode::PHI:
+                    break;
+                default:
+                    continue;
+            }
+            unsigned id = inst->getId();
+            unsigned variable = id < variables_.size() ? variables_[id] : kNoVariable;
+            if (variable == kNoVariable) {
+                slots_[id] = next_slot++;
+                continue;
+            }
+            if (variable >= variable_slots.size()) {
+                variable_slots.resize(variable + 1, kNoSlot);
+            }
+            if (variable_slots[variable] == kNoSlot) {
+                variable_slots[variable] = next_slot++;
+            }
+            slots_[id] = variable_slots[variable];
+        }
+    }
+    scratch_slot_ = next_slot++;
+    num_slots_ = next_slot;
+    return true;
+}
+
+bool Interpreter::emitPhiMoves(BasicBlock* pred, BasicBlock* succ) {
+    // Every phi has its own destination slot
+    std::vector<ParallelMove<unsigned>> moves;
+    for (Inst* inst : succ->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            continue;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        unsigned i = 0;
+        while (i < phi->getNumIncoming() && phi->getIncomingBlock(i) != pred) {
+            ++i;
+        }
+        if (i == phi->getNumIncoming()) {
+            return fail(phi, "has no incoming value for one of its predecessors");
+        }
+        unsigned src = slots_[phi->getIncomingValue(i)->getId()];
+        assert(src != kNoSlot && "an incoming value must dominate its block");
+        if (src != slots_[phi->getId()]) {
+            moves.push_back({slots_[phi->getId()], src});
+        }
+    }
+
+    sequentializeParallelCopy(moves, scratch_slot_, [this](const ParallelMove<unsigned>& move) {
+        emit(BytecodeOp::MOV, move.dst, move.src);
+    });
+    return true;
+}
+
+bool Interpreter::fail(const Inst* inst, const char* reason) {
+    std::ostringstream os;
+    inst->dump(os);
+    error_ = os.str() + ": " + reason;
+    return false;
+}
+
+int64_t Interpreter::execute(Span<const int64_t> args) const {
+    assert(!code_.empty() && "compile() must succeed first");
+    int64_t inline_frame[kInlineFrameSlots];
+    std::vector<int64_t> heap_frame;
+    int64_t* regs = inline_frame;
+    if (num_slots_ > kInlineFrameSlots) {
+        heap_frame.resize(num_slots_);
+        regs = heap_frame.data();
+    }
+    size_t num_args = std::min<size_t>(args.size(), num_params_);
+    std::copy(args.begin(), args.begin() + num_args, regs);
+    std::fill(regs + num_args, regs + num_params_, 0);
+    std::copy(constants_.begin(), constants_.end(), regs + num_params_);
+    return dispatch(code_.data(), regs, nullptr);
+}
+
+void Interpreter::dump(std::ostream& os) const {
+    os << "Bytecode: " << num_params_ << " params, " << constants_.size() << " constants, "
+       << num_slots_ << " slots\n";
+    for (size_t i = 0; i < constants_.size(); ++i) {
+        os << "  s" << num_params_ + i << " = " << constants_[i] << "\n";
+    }
+    for (size_t i = 0; i < code_.size(); ++i) {
+        const BytecodeInstr& instr = code_[i];
+        os << "  " << i << ": " << opName(instr.op);
+        switch (instr.op) {
+            case BytecodeOp::ADD:
+            case BytecodeOp::MUL:
+            case BytecodeOp::CMP:
+                os << " s" << instr.dst << ", s" << instr.lhs << ", s" << instr.rhs;
+                break;
+            case BytecodeOp::MOV:
+                os << " s" << instr.dst << ", s" << instr.lhs;
+                break;
+            case BytecodeOp::JUMP:
+                os << " -> " << instr.dst;
+                break;
+            case BytecodeOp::BRANCH_IF:
+            case BytecodeOp::BRANCH_IF_NOT:
+                os << " s" << instr.lhs << " -> " << instr.dst;
+                break;
+            case BytecodeOp::JUMP_IF_LE:
+            case BytecodeOp::JUMP_IF_GT:
+                os << " s" << instr.lhs << ", s" << instr.rhs << " -> " << instr.dst;
+                break;
+            case BytecodeOp::RETURN:
+                os << " s" << instr.lhs;
+                break;
+            case BytecodeOp::RETURN_VOID:
+                break;
+        }
+        os << "\n";
+    }
+}
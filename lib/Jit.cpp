@@ -0,0 +1,624 @@
+#include "jit.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "linear_scan.h"
+#include "parallel_copy.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_NATIVE_X86_64 1
+#endif
+
+namespace {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Condition codes, the low nibble of the Jcc and SETcc opcodes
+enum Cond : uint8_t { COND_E = 0x4, COND_NE = 0x5, COND_LE = 0xE, COND_G = 0xF };
+
+constexpr Reg kArgRegs[] = {RDI, RSI, RDX, RCX, R8, R9};
+// rax and r11 are scratch. Callee-saved registers come last since each costs a push and a
+// pop; rbp is the frame pointer.
+constexpr Reg kAllocatable[] = {RCX, RDX, RSI, RDI, R8, R9, R10, RBX, R12, R13, R14, R15};
+
+bool isCalleeSaved(Reg reg) {
+    return reg == RBX || reg >= R12;
+}
+
+bool fitsInt32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// Where a value lives: a register, the stack slot at [rbp + disp], or an immediate
+struct Loc {
+    enum Kind : uint8_t { REG, MEM, IMM };
+
+    static Loc reg(Reg r) {
+        return {REG, r, 0, 0};
+    }
+    static Loc mem(int32_t disp) {
+        return {MEM, RBP, disp, 0};
+    }
+    static Loc imm(int64_t value) {
+        return {IMM, RAX, 0, value};
+    }
+
+    bool operator==(const Loc& other) const {
+        if (kind != other.kind) {
+            return false;
+        }
+        return kind == REG ? r == other.r : kind == MEM ? disp == other.disp : value == other.value;
+    }
+    bool operator!=(const Loc& other) const {
+        return !(*this == other);
+    }
+
+    Kind kind;
+    Reg r;
+    int32_t disp;
+    int64_t value;
+};
+
+// Just enough of an x86-64 encoder for the JIT: 64-bit moves and ALU operations between
+// registers, rbp-relative stack slots and immediates, and jumps to labels. Jumps always
+// take a rel32, patched by finish().
+class X86Assembler {
+   public:
+    using Label = unsigned;
+
+    std::vector<uint8_t>& getBytes() {
+        return bytes_;
+    }
+
+    void bind(Label label) {
+        if (label >= label_offsets_.size()) {
+            label_offsets_.resize(label + 1, kUnbound);
+        }
+        label_offsets_[label] = bytes_.size();
+    }
+
+    void move(Loc dst, Loc src) {
+        if (dst == src) {
+            return;
+        }
+        if (dst.kind == Loc::REG) {
+            movToReg(dst.r, src);
+        } else if (src.kind == Loc::REG) {
+            emitOp({0x89}, src.r, dst);  // mov r/m64, r64
+        } else if (src.kind == Loc::IMM && fitsInt32(src.value)) {
+            emitOp({0xC7}, 0, dst);  // mov r/m64, imm32
+            emit32(src.value);
+        } else {
+            movToReg(R11, src);
+            emitOp({0x89}, R11, dst);
+        }
+    }
+
+    void movToReg(Reg dst, Loc src) {
+        if (src.kind == Loc::IMM) {
+            if (fitsInt32(src.value)) {
+                emitOp({0xC7}, 0, Loc::reg(dst));
+                emit32(src.value);
+            } else {
+                emit8(0x48 | (dst >> 3));  // movabs r64, imm64
+                emit8(0xB8 + (dst & 7));
+                emit64(src.value);
+            }
+        } else if (src != Loc::reg(dst)) {
+            emitOp({0x8B}, dst, src);  // mov r64, r/m64
+        }
+    }
+
+    void add(Reg dst, Loc src) {
+        if (src.kind == Loc::IMM && fitsInt32(src.value)) {
+            emitOp({0x81}, 0, Loc::reg(dst));  // add r/m64, imm32
+            emit32(src.value);
+        } else {
+            emitOp({0x03}, dst, toRegOrMem(src));  // add r64, r/m64
+        }
+    }
+
+    void imul(Reg dst, Loc src) {
+        if (src.kind == Loc::IMM && fitsInt32(src.value)) {
+            emitOp({0x69}, dst, Loc::reg(dst));  // imul r64, r/m64, imm32
+            emit32(src.value);
+        } else {
+            emitOp({0x0F, 0xAF}, dst, toRegOrMem(src));  // imul r64, r/m64
+        }
+    }
+
+    // Sets the flags for lhs - rhs
+    void cmp(Loc lhs, Loc rhs) {
+        if (lhs.kind == Loc::IMM || (lhs.kind == Loc::MEM && rhs.kind == Loc::MEM)) {
+            movToReg(R11, lhs);
+            lhs = Loc::reg(R11);
+        }
+        if (rhs.kind == Loc::IMM && fitsInt32(rhs.value)) {
+            emitOp({0x81}, 7, lhs);  // cmp r/m64, imm32
+            emit32(rhs.value);
+        } else if (rhs.kind == Loc::MEM) {
+            emitOp({0x3B}, lhs.r, rhs);  // cmp r64, r/m64
+        } else {
+            if (rhs.kind == Loc::IMM) {
+                movToReg(RAX, rhs);
+                rhs = Loc::reg(RAX);
+            }
+            emitOp({0x39}, rhs.r, lhs);  // cmp r/m64, r64
+        }
+    }
+
+    // rax = cond ? 1 : 0
+    void setToRax(Cond cond) {
+        emit8(0x0F);  // setcc al
+        emit8(0x90 | cond);
+        emit8(0xC0);
+        emit8(0x0F);  // movzx eax, al
+        emit8(0xB6);
+        emit8(0xC0);
+    }
+
+    void jmp(Label label) {
+        emit8(0xE9);
+        emitRel32(label);
+    }
+
+    void jcc(Cond cond, Label label) {
+        emit8(0x0F);
+        emit8(0x80 | cond);
+        emitRel32(label);
+    }
+
+    void push(Reg reg) {
+        if (reg >= R8) {
+            emit8(0x41);
+        }
+        emit8(0x50 + (reg & 7));
+    }
+
+    void pop(Reg reg) {
+        if (reg >= R8) {
+            emit8(0x41);
+        }
+        emit8(0x58 + (reg & 7));
+    }
+
+    void ret() {
+        emit8(0xC3);
+    }
+
+    // Frame setup and teardown: mov rbp, rsp / sub rsp, imm32 / lea rsp, [rbp + disp]
+    void movRbpRsp() {
+        emitOp({0x89}, RSP, Loc::reg(RBP));
+    }
+    void subRsp(int32_t bytes) {
+        emitOp({0x81}, 5, Loc::reg(RSP));
+        emit32(bytes);
+    }
+    void leaRspFromRbp(int32_t disp) {
+        emitOp({0x8D}, RSP, Loc::mem(disp));
+    }
+
+    // Resolves the jumps; every label they use must be bound
+    void finish() {
+        for (const auto& [pos, label] : fixups_) {
+            int32_t rel = static_cast<int32_t>(label_offsets_[label] - (pos + 4));
+            std::memcpy(&bytes_[pos], &rel, sizeof(rel));
+        }
+        fixups_.clear();
+    }
+
+   private:
+    static constexpr size_t kUnbound = ~size_t(0);
+
+    // Immediates never reach an r/m operand; larger ones go through r11
+    Loc toRegOrMem(Loc src) {
+        if (src.kind == Loc::IMM) {
+            movToReg(R11, src);
+            return Loc::reg(R11);
+        }
+        return src;
+    }
+
+    // REX.W prefix, opcode, ModRM and displacement; memory operands are always rbp-based,
+    // which needs a displacement even when it is 0
+    void emitOp(std::initializer_list<uint8_t> opcode, uint8_t reg, Loc rm) {
+        uint8_t rm_reg = rm.kind == Loc::REG ? rm.r : RBP;
+        emit8(0x48 | ((reg >> 3) << 2) | (rm_reg >> 3));
+        for (uint8_t byte : opcode) {
+            emit8(byte);
+        }
+        if (rm.kind == Loc::REG) {
+            emit8(0xC0 | ((reg & 7) << 3) | (rm_reg & 7));
+        } else if (rm.disp >= INT8_MIN && rm.disp <= INT8_MAX) {
+            emit8(0x40 | ((reg & 7) << 3) | (rm_reg & 7));
+            emit8(static_cast<uint8_t>(rm.disp));
+        } else {
+            emit8(0x80 | ((reg & 7) << 3) | (rm_reg & 7));
+            emit32(rm.disp);
+        }
+    }
+
+    void emitRel32(Label label) {
+        fixups_.emplace_back(bytes_.size(), label);
+        emit32(0);
+    }
+
+    void emit8(uint8_t byte) {
+        bytes_.push_back(byte);
+    }
+    void emit32(int64_t value) {
+        auto bits = static_cast<uint32_t>(value);
+        for (int i = 0; i < 4; ++i) {
+            emit8(bits >> (8 * i));
+        }
+    }
+    void emit64(int64_t value) {
+        auto bits = static_cast<uint64_t>(value);
+        for (int i = 0; i < 8; ++i) {
+            emit8(bits >> (8 * i));
+        }
+    }
+
+    std::vector<uint8_t> bytes_;
+    std::vector<size_t> label_offsets_;
+    std::vector<std::pair<size_t, Label>> fixups_;  // (rel32 position, label)
+};
+
+// Lowers one graph; the labels are block ids, then num_blocks + k for the k-th edge stub
+class CodeGenerator {
+   public:
+    explicit CodeGenerator(const Graph* g)
+        : graph_(g), allocator_(g, std::size(kAllocatable)) {
+    }
+
+    bool run();
+    std::vector<uint8_t>& getCode() {
+        return as_.getBytes();
+    }
+    const std::string& getError() const {
+        return error_;
+    }
+    unsigned getNumSpills() const {
+        return num_spills_;
+    }
+
+   private:
+    bool validate(const std::vector<BasicBlock*>& order);
+    void assignHomes(const std::vector<BasicBlock*>& order);
+    Loc locOf(Location location, const Inst* value) const;
+    Loc locOf(const Inst* value) const {
+        if (value->getOpcode() == Opcode::CONST) {
+            return Loc::imm(static_cast<const ConstInst*>(value)->getValue());
+        }
+        return homes_[value->getId()];
+    }
+    void emitPhiMoves(BasicBlock* pred, BasicBlock* succ);
+    void emitBinary(Inst* inst);
+    void emitEpilogue();
+    bool fail(const Inst* inst, const char* reason);
+
+    const Graph* graph_;
+    LinearScan allocator_;  // Register i is kAllocatable[i]
+    X86Assembler as_;
+    std::vector<Loc> homes_;  // Indexed by instruction id
+    std::vector<Reg> saved_regs_;
+    unsigned num_spills_ = 0;
+    unsigned num_slots_ = 0;
+    std::string error_;
+};
+
+bool CodeGenerator::fail(const Inst* inst, const char* reason) {
+    std::ostringstream os;
+    inst->dump(os);
+    error_ = os.str() + ": " + reason;
+    return false;
+}
+
+bool CodeGenerator::validate(const std::vector<BasicBlock*>& order) {
+    for (BasicBlock* bb : order) {
+        if (bb->getTerminator() == nullptr) {
+            error_ = "BB" + std::to_string(bb->getId()) + " has no terminator";
+            return false;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            switch (inst->getOpcode()) {
+                case Opcode::PARAM:
+                case Opcode::CONST:
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP:
+                case Opcode::MOV:
+                case Opcode::PHI:
+                case Opcode::JUMP:
+                case Opcode::COND_JUMP:
+                case Opcode::RETURN:
+                    break;
+                default:
+                    return fail(inst, "is not supported by the JIT");
+            }
+            if (inst->getOpcode() != Opcode::PHI || !inst->hasUses()) {
+                continue;
+            }
+            auto* phi = static_cast<PhiInst*>(inst);
+            for (BasicBlock* pred : bb->getPredecessors()) {
+                unsigned i = 0;
+                while (i < phi->getNumIncoming() && phi->getIncomingBlock(i) != pred) {
+                    ++i;
+                }
+                if (i == phi->getNumIncoming() &&
+                    allocator_.getBlockStart(pred) != LinearScan::kNoPosition) {
+                    return fail(phi, "has no incoming value for one of its predecessors");
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void CodeGenerator::assignHomes(const std::vector<BasicBlock*>& order) {
+    saved_regs_.clear();
+    for (unsigned i = 0; i < std::size(kAllocatable); ++i) {
+        if (allocator_.isRegisterUsed(i) && isCalleeSaved(kAllocatable[i])) {
+            saved_regs_.push_back(kAllocatable[i]);
+        }
+    }
+    num_spills_ = allocator_.getNumSpilled();
+    num_slots_ = allocator_.getNumStackSlots();
+    homes_.assign(graph_->getNumInsts(), Loc::imm(0));
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            Location location = allocator_.getLocation(inst);
+            if (location.kind == Location::REGISTER || location.kind == Location::STACK_SLOT) {
+                homes_[inst->getId()] = locOf(location, inst);
+            }
+        }
+    }
+}
+
+Loc CodeGenerator::locOf(Location location, const Inst* value) const {
+    switch (location.kind) {
+        case Location::REGISTER:
+            return Loc::reg(kAllocatable[location.index]);
+        case Location::STACK_SLOT:
+            // Spill slots sit below the saved registers: [rbp - 8 * (saved + 1 + k)]
+            return Loc::mem(-8 * static_cast<int32_t>(saved_regs_.size() + 1 + location.index));
+        case Location::SCRATCH:
+            return Loc::reg(RAX);
+        default:
+            return locOf(value);
+    }
+}
+
+// The allocator already ordered the moves and broke their cycles through rax
+void CodeGenerator::emitPhiMoves(BasicBlock* pred, BasicBlock* succ) {
+    for (const EdgeMove& move : allocator_.getEdgeMoves(pred, succ)) {
+        as_.move(locOf(move.dst, move.value), locOf(move.src, move.value));
+    }
+}
+
+void CodeGenerator::emitBinary(Inst* inst) {
+    Loc dst = locOf(inst);
+    Loc lhs = locOf(inst->getOperand(0));
+    Loc rhs = locOf(inst->getOperand(1));
+    if (inst->getOpcode() == Opcode::CMP) {
+        as_.cmp(lhs, rhs);
+        as_.setToRax(COND_LE);
+        as_.move(dst, Loc::reg(RAX));
+        return;
+    }
+
+    // ADD and MUL commute, so the operand already in the target register goes first
+    Reg target = dst.kind == Loc::REG ? dst.r : RAX;
+    if (rhs == Loc::reg(target) || (lhs.kind == Loc::IMM && rhs.kind != Loc::IMM)) {
+        std::swap(lhs, rhs);
+    }
+    as_.movToReg(target, lhs);
+    if (inst->getOpcode() == Opcode::ADD) {
+        as_.add(target, rhs);
+    } else {
+        as_.imul(target, rhs);
+    }
+    as_.move(dst, Loc::reg(target));
+}
+
+void CodeGenerator::emitEpilogue() {
+    as_.leaRspFromRbp(-8 * static_cast<int32_t>(saved_regs_.size()));
+    for (auto it = saved_regs_.rbegin(); it != saved_regs_.rend(); ++it) {
+        as_.pop(*it);
+    }
+    as_.pop(RBP);
+    as_.ret();
+}
+
+bool CodeGenerator::run() {
+    if (graph_->getStartBlock() == nullptr) {
+        error_ = "the graph has no start block";
+        return false;
+    }
+    allocator_.run();
+    const auto& order = allocator_.getBlockOrder();
+    if (!validate(order)) {
+        return false;
+    }
+    assignHomes(order);
+    unsigned num_blocks = graph_->getBasicBlocks().size();
+
+    // The prologue and the parameter moves come before the start block's label, so a back
+    // edge to the start block does not run them again
+    as_.push(RBP);
+    as_.movRbpRsp();
+    for (Reg reg : saved_regs_) {
+        as_.push(reg);
+    }
+    if (num_slots_ != 0) {
+        as_.subRsp(8 * num_slots_);
+    }
+    // The parameters go from the argument registers to their homes as one parallel copy
+    std::vector<ParallelMove<Loc>> moves;
+    for (BasicBlock* bb : order) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PARAM || !inst->hasUses()) {
+                continue;
+            }
+            unsigned index = static_cast<ParamInst*>(inst)->getIndex();
+            // Stack arguments start above the return address and the saved rbp
+            Loc arg = index < std::size(kArgRegs) ? Loc::reg(kArgRegs[index])
+                                                  : Loc::mem(16 + 8 * (index - 6));
+            moves.push_back({locOf(inst), arg});
+        }
+    }
+    sequentializeParallelCopy(moves, Loc::reg(RAX), [this](const ParallelMove<Loc>& move) {
+        as_.move(move.dst, move.src);
+    });
+
+    std::vector<std::pair<BasicBlock*, BasicBlock*>> stubs;
+    auto edgeLabel = [&](BasicBlock* pred, BasicBlock* succ) {
+        if (allocator_.getEdgeMoves(pred, succ).empty()) {
+            return succ->getId();
+        }
+        stubs.emplace_back(pred, succ);
+        return static_cast<unsigned>(num_blocks + stubs.size() - 1);
+    };
+    for (size_t i = 0; i < order.size(); ++i) {
+        BasicBlock* bb = order[i];
+        unsigned next_label = i + 1 < order.size() ? order[i + 1]->getId() : ~0u;
+        as_.bind(bb->getId());
+        for (Inst* inst : bb->getInstructions()) {
+            Opcode opcode = inst->getOpcode();
+            if ((opcode == Opcode::ADD || opcode == Opcode::MUL || opcode == Opcode::CMP) &&
+                inst->hasUses() && !LinearScan::isFusedCompare(inst)) {
+                emitBinary(inst);
+            } else if (opcode == Opcode::MOV && inst->hasUses()) {
+                as_.move(locOf(inst), locOf(inst->getOperand(0)));
+            }
+        }
+
+        Inst* terminator = bb->getTerminator();
+        switch (terminator->getOpcode()) {
+            case Opcode::RETURN:
+                as_.movToReg(RAX, terminator->getNumOperands() == 0
+                                      ? Loc::imm(0)
+                                      : locOf(terminator->getOperand(0)));
+                emitEpilogue();
+                break;
+            case Opcode::JUMP: {
+                BasicBlock* target = static_cast<JumpInst*>(terminator)->getTarget();
+                emitPhiMoves(bb, target);
+                if (target->getId() != next_label) {
+                    as_.jmp(target->getId());
+                }
+                break;
+            }
+            case Opcode::COND_JUMP: {
+                auto* cond_jump = static_cast<CondJumpInst*>(terminator);
+                unsigned true_label = edgeLabel(bb, cond_jump->getTrueTarget());
+                unsigned false_label = edgeLabel(bb, cond_jump->getFalseTarget());
+                Inst* cond = cond_jump->getOperand(0);
+                Cond if_true = COND_NE;
+                if (LinearScan::isFusedCompare(cond)) {
+                    as_.cmp(locOf(cond->getOperand(0)), locOf(cond->getOperand(1)));
+                    if_true = COND_LE;
+                } else if (cond->getOpcode() == Opcode::CONST) {
+                    unsigned taken = locOf(cond).value != 0 ? true_label : false_label;
+                    if (taken != next_label) {
+                        as_.jmp(taken);
+                    }
+                    break;
+                } else {
+                    as_.cmp(locOf(cond), Loc::imm(0));
+                }
+                Cond if_false = if_true == COND_LE ? COND_G : COND_E;
+                if (true_label == next_label) {
+                    as_.jcc(if_false, false_label);
+                } else {
+                    as_.jcc(if_true, true_label);
+                    if (false_label != next_label) {
+                        as_.jmp(false_label);
+                    }
+                }
+                break;
+            }
+            default:
+                return fail(terminator, "is not a supported terminator");
+        }
+    }
+
+    // Edge stubs go after all blocks, off the fall-through paths
+    for (size_t k = 0; k < stubs.size(); ++k) {
+        as_.bind(num_blocks + k);
+        emitPhiMoves(stubs[k].first, stubs[k].second);
+        as_.jmp(stubs[k].second->getId());
+    }
+    as_.finish();
+    return true;
+}
+
+}  // namespace
+
+JitFunction::~JitFunction() {
+    release();
+}
+
+bool JitFunction::isSupported() {
+#ifdef JIT_NATIVE_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void JitFunction::release() {
+#ifdef JIT_NATIVE_X86_64
+    if (code_ != nullptr) {
+        munmap(code_, mapping_size_);
+    }
+#endif
+    code_ = nullptr;
+    mapping_size_ = 0;
+    code_size_ = 0;
+}
+
+bool JitFunction::compile() {
+    release();
+    error_.clear();
+    num_spills_ = 0;
+#ifdef JIT_NATIVE_X86_64
+    CodeGenerator generator(graph_);
+    if (!generator.run()) {
+        error_ = generator.getError();
+        return false;
+    }
+    num_spills_ = generator.getNumSpills();
+
+    // Written while writable, then flipped to read+execute, never both at once
+    const std::vector<uint8_t>& code = generator.getCode();
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t mapping_size = (code.size() + page_size - 1) / page_size * page_size;
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        error_ = "mmap failed";
+        return false;
+    }
+    std::memcpy(mapping, code.data(), code.size());
+    if (mprotect(mapping, mapping_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mapping, mapping_size);
+        error_ = "mprotect failed";
+        return false;
+    }
+    code_ = mapping;
+    mapping_size_ = mapping_size;
+    code_size_ = code.size();
+    return true;
+#else
+    error_ = "native code generation needs x86-64 and mmap";
+    return false;
+#endif
+}
@@ -0,0 +1,163 @@
+#include "licm.h"
+
+#include <algorithm>
+
+bool LICM::run() {
+    num_hoisted_ = 0;
+    num_preheaders_created_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+    LoopInfo loops(graph_, *dom_tree_);
+    loops.run();
+    for (size_t i = 0; i < loops.getNumLoops(); ++i) {
+        const Loop* loop = loops.getLoop(i);
+        if (loop->getPreheader() == nullptr &&
+            loop->getHeader() != graph_->getStartBlock() && hasCandidates(loop, loops)) {
+            createPreheader(loop, loops);
+        }
+    }
+    if (num_preheaders_created_ != 0) {
+        graph_->buildPredecessors();
+        dom_tree_->run();
+        loops.run();
+    }
+
+    hoisted_from_.assign(graph_->getNumInsts(), 0);
+    stamp_ = 0;
+    for (size_t i = 0; i < loops.getNumLoops(); ++i) {
+        hoist(loops.getLoop(i), loops);
+    }
+    return num_hoisted_ != 0 || num_preheaders_created_ != 0;
+}
+
+bool LICM::isHoistable(const Inst* inst) {
+    switch (inst->getOpcode()) {
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::CMP:
+        case Opcode::CONST:
+        case Opcode::CAST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool LICM::hasCandidates(const Loop* loop, const LoopInfo& loops) const {
+    // Chains of invariant values start with an instruction whose operands are all outside
+    for (BasicBlock* bb : loop->getBlocks()) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (!isHoistable(inst)) {
+                continue;
+            }
+            bool invariant = true;
+            for (Inst* input : inst->getInputs()) {
+                invariant &= !loops.contains(loop, input->getParent());
+            }
+            if (invariant) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void LICM::createPreheader(const Loop* loop, const LoopInfo& loops) {
+    BasicBlock* header = loop->getHeader();
+    std::vector<BasicBlock*> outside;  // One entry per edge
+    for (BasicBlock* pred : header->getPredecessors()) {
+        if (!loops.contains(loop, pred)) {
+            outside.push_back(pred);
+        }
+    }
+    const std::string& name = header->getName();
+    BasicBlock* preheader = graph_->createBB(name.empty() ? "preheader" : name + ".preheader");
+    for (BasicBlock* pred : outside) {
+        pred->replaceSuccessor(header, preheader);
+    }
+
+    // Header inputs from outside the loop now arrive through the preheader
+    auto is_outside = [&](BasicBlock* bb) {
+        return std::find(outside.begin(), outside.end(), bb) != outside.end();
+    };
+    for (Inst* inst : header->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            break;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        std::vector<std::pair<Inst*, BasicBlock*>> entering;
+        for (unsigned i = phi->getNumIncoming(); i-- > 0;) {
+            if (is_outside(phi->getIncomingBlock(i))) {
+                entering.emplace_back(phi->getIncomingValue(i), phi->getIncomingBlock(i));
+                phi->removeIncoming(i);
+            }
+        }
+        if (entering.empty()) {
+            continue;
+        }
+        Inst* value = entering[0].first;
+        bool same = std::all_of(entering.begin(), entering.end(),
+                                [&](const auto& in) { return in.first == value; });
+        if (!same) {
+            auto* merged = graph_->createInst<PhiInst>(preheader);
+            for (auto it = entering.rbegin(); it != entering.rend(); ++it) {
+                merged->addIncoming(it->first, it->second);
+            }
+            value = merged;
+        }
+        phi->addIncoming(value, preheader);
+    }
+    graph_->createInst<JumpInst>(preheader, header);
+    ++num_preheaders_created_;
+}
+
+void LICM::hoist(const Loop* loop, const LoopInfo& loops) {
+    BasicBlock* preheader = loop->getPreheader();
+    if (preheader == nullptr) {
+        return;
+    }
+    ++stamp_;
+    // Blocks come in reverse post-order, so operands are seen before their users
+    std::vector<Inst*> hoisted;
+    for (BasicBlock* bb : loop->getBlocks()) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (!isHoistable(inst)) {
+                continue;
+            }
+            bool invariant = true;
+            for (Inst* input : inst->getInputs()) {
+                invariant &= hoisted_from_[input->getId()] == stamp_ ||
+                             !loops.contains(loop, input->getParent());
+            }
+            if (invariant) {
+                hoisted_from_[inst->getId()] = stamp_;
+                hoisted.push_back(inst);
+            }
+        }
+    }
+    if (hoisted.empty()) {
+        return;
+    }
+    for (BasicBlock* bb : loop->getBlocks()) {
+        bb->removeInstructionsIf(
+            [this](Inst* inst) { return hoisted_from_[inst->getId()] == stamp_; });
+    }
+    preheader->insertInstructions(preheader->getInstructions().size() - 1,
+                                  Span<Inst* const>(hoisted.data(), hoisted.size()));
+    num_hoisted_ += hoisted.size();
+}
+
+PreservedAnalyses LICMPass::run(Graph& g, AnalysisManager& am) {
+    LICM licm(&g, &am.getDominatorTree());
+    if (!licm.run()) {
+        return PreservedAnalyses::all();
+    }
+    if (licm.getNumPreheadersCreated() == 0) {
+        return PreservedAnalyses::cfg();
+    }
+    // The predecessor lists and the dominator tree were recomputed
+    return PreservedAnalyses::none()
+        .preserve(Analysis::Predecessors)
+        .preserve(Analysis::Dominators);
+}
@@ -0,0 +1,622 @@
+#include "linear_scan.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+#include "cfg_traversal.h"
+#include "dominators.h"
+#include "parallel_copy.h"
+
+namespace {
+
+// Deeper loops stop adding weight beyond this depth
+constexpr unsigned kMaxWeightDepth = 8;
+
+double frequency(unsigned loop_depth) {
+    double result = 1;
+    for (unsigned i = 0; i < std::min(loop_depth, kMaxWeightDepth); ++i) {
+        result *= 10;
+    }
+    return result;
+}
+
+// Index of the first incoming value of `phi` from `pred`, ~0u if there is none
+unsigned findIncoming(const PhiInst* phi, const BasicBlock* pred) {
+    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+        if (phi->getIncomingBlock(i) == pred) {
+            return i;
+        }
+    }
+    return ~0u;
+}
+
+void printLocation(std::ostream& os, Location location, const Inst* value) {
+    switch (location.kind) {
+        case Location::NONE:
+            os << "-";
+            break;
+        case Location::REGISTER:
+            os << "r" << location.index;
+            break;
+        case Location::STACK_SLOT:
+            os << "s" << location.index;
+            break;
+        case Location::CONSTANT:
+            os << static_cast<const ConstInst*>(value)->getValue();
+            break;
+        case Location::SCRATCH:
+            os << "tmp";
+            break;
+    }
+}
+
+}  // namespace
+
+bool LinearScan::isFusedCompare(const Inst* inst) {
+    if (inst->getOpcode() != Opcode::CMP || inst->getNumUses() != 1) {
+        return false;
+    }
+    Inst* user = inst->getFirstUse()->getUser();
+    return user->getOpcode() == Opcode::COND_JUMP && user->getParent() == inst->getParent();
+}
+
+void LinearScan::run() {
+    order_.clear();
+    intervals_.clear();
+    ranges_.clear();
+    active_.clear();
+    inactive_.clear();
+    spilled_.clear();
+    edge_moves_.clear();
+    used_registers_.assign(num_registers_, false);
+    free_until_.assign(num_registers_, 0);
+    conflict_weight_.assign(num_registers_, 0);
+    num_stack_slots_ = 0;
+    num_spilled_ = 0;
+    num_evicted_ = 0;
+    num_phi_copies_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        block_start_.clear();
+        position_.clear();
+        interval_of_.clear();
+        edge_begin_.clear();
+        first_edge_.clear();
+        return;
+    }
+
+    DominatorTree dom_tree(graph_);
+    dom_tree.run();
+    LoopInfo loops(graph_, dom_tree);
+    loops.run();
+    CFGTraversal traversal(graph_);
+    traversal.run();
+    layoutBlocks(traversal.getReversePostOrder(), loops);
+    buildIntervals(loops);
+
+    std::vector<unsigned> unhandled(intervals_.size());
+    std::iota(unhandled.begin(), unhandled.end(), 0);
+    std::stable_sort(unhandled.begin(), unhandled.end(), [this](unsigned a, unsigned b) {
+        return getStart(intervals_[a]) < getStart(intervals_[b]);
+    });
+    for (unsigned current : unhandled) {
+        allocate(current);
+    }
+    assignStackSlots();
+    resolveEdges();
+}
+
+// Walks the RPO with a stack of regions, each a loop (nullptr for the whole function) and
+// its blocks in RPO. A block of a nested loop is that loop's header, since a header comes
+// first among its loop's blocks: the whole loop is laid out before the region goes on.
+void LinearScan::layoutBlocks(const std::vector<BasicBlock*>& rpo, const LoopInfo& loops) {
+    struct Region {
+        const Loop* loop;
+        const std::vector<BasicBlock*>* blocks;
+        size_t next;
+    };
+    std::vector<bool> placed(graph_->getBasicBlocks().size(), false);
+    std::vector<Region> regions{{nullptr, &rpo, 0}};
+    while (!regions.empty()) {
+        Region& region = regions.back();
+        if (region.next == region.blocks->size()) {
+            regions.pop_back();
+            continue;
+        }
+        BasicBlock* bb = (*region.blocks)[region.next++];
+        if (placed[bb->getId()]) {
+            continue;
+        }
+        const Loop* loop = loops.getLoopFor(bb);
+        if (loop == region.loop) {
+            placed[bb->getId()] = true;
+            order_.push_back(bb);
+            continue;
+        }
+        while (loop->getParent() != region.loop) {
+            loop = loop->getParent();
+        }
+        // The header is taken again as the first block of the nested region
+        regions.push_back({loop, &loop->getBlocks(), 0});
+    }
+}
+
+// Liveness by path exploration: from every use, the value is live-in to the block of the
+// use and live-out of its predecessors, up to the definition; a phi use makes it live-out
+// of the predecessor. A value gets one range per block it is live in, from the block's
+// start or its definition to the block's end or its last use there.
+void LinearScan::buildIntervals(const LoopInfo& loops) {
+    size_t num_insts = graph_->getNumInsts();
+    size_t num_blocks = graph_->getBasicBlocks().size();
+    block_start_.assign(num_blocks, kNoPosition);
+    position_.assign(num_insts, kNoPosition);
+    interval_of_.assign(num_insts, kNone);
+    std::vector<double> block_weight(num_blocks, 0);
+    unsigned position = 0;
+    for (BasicBlock* bb : order_) {
+        block_start_[bb->getId()] = position;
+        block_weight[bb->getId()] = frequency(loops.getLoopDepth(bb));
+        Span<Inst* const> insts = bb->getInstructions();
+        for (size_t k = 0; k < insts.size(); ++k) {
+            Inst* inst = insts[k];
+            bool is_phi = inst->getOpcode() == Opcode::PHI;
+            position_[inst->getId()] = is_phi ? position : position + 2 * (k + 1);
+            if (inst->hasUses() && inst->getOpcode() != Opcode::CONST && !isFusedCompare(inst)) {
+                interval_of_[inst->getId()] = intervals_.size();
+                intervals_.push_back({inst, 0, 0, 0, 0, Location()});
+            }
+        }
+        position += 2 * (insts.size() + 1);
+    }
+
+    // The uses of each interval, grouped by a counting sort. A phi use is at kNoPosition
+    // in the predecessor.
+    struct Use {
+        unsigned interval;
+        BasicBlock* block;
+        unsigned position;
+    };
+    std::vector<Use> uses;
+    auto addUse = [&](const Inst* value, BasicBlock* bb, unsigned at) {
+        unsigned interval = interval_of_[value->getId()];
+        if (interval != kNone && block_start_[bb->getId()] != kNoPosition) {
+            uses.push_back({interval, bb, at});
+        }
+    };
+    for (BasicBlock* bb : order_) {
+        for (Inst* inst : bb->getInstructions()) {
+            unsigned at = position_[inst->getId()];
+            if (inst->getOpcode() == Opcode::PHI) {
+                for (auto [value, pred] : static_cast<PhiInst*>(inst)->getIncoming()) {
+                    addUse(value, pred, kNoPosition);
+                }
+            } else if (inst->getOpcode() == Opcode::COND_JUMP &&
+                       isFusedCompare(inst->getOperand(0))) {
+                for (Inst* input : inst->getOperand(0)->getInputs()) {
+                    addUse(input, bb, at);
+                }
+            } else if (!isFusedCompare(inst)) {
+                for (Inst* input : inst->getInputs()) {
+                    addUse(input, bb, at);
+                }
+            }
+        }
+    }
+    std::vector<unsigned> first_use(intervals_.size() + 1, 0);
+    for (const Use& use : uses) {
+        ++first_use[use.interval + 1];
+    }
+    std::partial_sum(first_use.begin(), first_use.end(), first_use.begin());
+    std::vector<Use> sorted_uses(uses.size());
+    for (const Use& use : uses) {
+        sorted_uses[first_use[use.interval]++] = use;
+    }
+    uses.clear();
+
+    // Per block, stamped with the interval being built
+    std::vector<unsigned> seen(num_blocks, kNone);
+    std::vector<unsigned> live_in(num_blocks, kNone);
+    std::vector<unsigned> live_out(num_blocks, kNone);
+    std::vector<unsigned> last_use(num_blocks, 0);
+    std::vector<BasicBlock*> blocks;
+    std::vector<BasicBlock*> worklist;
+    unsigned use_index = 0;
+    for (unsigned i = 0; i < intervals_.size(); ++i) {
+        Interval& it = intervals_[i];
+        BasicBlock* def_block = it.value->getParent();
+        auto touch = [&](BasicBlock* bb) {
+            if (seen[bb->getId()] != i) {
+                seen[bb->getId()] = i;
+                last_use[bb->getId()] = 0;
+                blocks.push_back(bb);
+            }
+        };
+        auto liveOut = [&](BasicBlock* bb) {
+            if (live_out[bb->getId()] != i) {
+                live_out[bb->getId()] = i;
+                touch(bb);
+                if (bb != def_block) {
+                    worklist.push_back(bb);
+                }
+            }
+        };
+        blocks.clear();
+        touch(def_block);
+        double cost = block_weight[def_block->getId()];
+        for (; use_index < first_use[i]; ++use_index) {
+            const Use& use = sorted_uses[use_index];
+            cost += block_weight[use.block->getId()];
+            if (use.position == kNoPosition) {
+                liveOut(use.block);
+                continue;
+            }
+            touch(use.block);
+            last_use[use.block->getId()] = std::max(last_use[use.block->getId()], use.position);
+            if (use.block != def_block) {
+                worklist.push_back(use.block);
+            }
+        }
+        while (!worklist.empty()) {
+            BasicBlock* bb = worklist.back();
+            worklist.pop_back();
+            if (live_in[bb->getId()] == i) {
+                continue;
+            }
+            live_in[bb->getId()] = i;
+            for (BasicBlock* pred : bb->getPredecessors()) {
+                if (block_start_[pred->getId()] != kNoPosition) {
+                    liveOut(pred);
+                }
+            }
+        }
+
+        std::sort(blocks.begin(), blocks.end(), [this](BasicBlock* a, BasicBlock* b) {
+            return block_start_[a->getId()] < block_start_[b->getId()];
+        });
+        it.first_range = ranges_.size();
+        Opcode opcode = it.value->getOpcode();
+        unsigned def_start = block_start_[def_block->getId()];
+        unsigned length = 0;
+        if (opcode == Opcode::PARAM && def_start != 0) {
+            ranges_.push_back({0, def_start});
+            length = def_start;
+        }
+        for (BasicBlock* bb : blocks) {
+            unsigned id = bb->getId();
+            unsigned from = block_start_[id];
+            if (bb == def_block && opcode != Opcode::PHI && opcode != Opcode::PARAM) {
+                from = position_[it.value->getId()];
+            }
+            unsigned to = live_out[id] == i ? getBlockEnd(bb) : std::max(last_use[id], from + 1);
+            if (ranges_.size() != it.first_range && ranges_.back().to == from) {
+                ranges_.back().to = to;
+            } else {
+                ranges_.push_back({from, to});
+            }
+            length += to - from;
+        }
+        it.end_range = ranges_.size();
+        it.cursor = it.first_range;
+        // Per instruction covered; positions come two per instruction
+        it.weight = cost / (1 + length / 2.0);
+    }
+}
+
+bool LinearScan::covers(Interval& it, unsigned position) {
+    while (ranges_[it.cursor].to <= position) {
+        ++it.cursor;
+    }
+    return ranges_[it.cursor].from <= position;
+}
+
+unsigned LinearScan::nextIntersection(const Interval& it, const Interval& current) const {
+    unsigned i = it.cursor;
+    unsigned j = current.first_range;
+    while (i < it.end_range && j < current.end_range) {
+        const LiveRange& a = ranges_[i];
+        const LiveRange& b = ranges_[j];
+        unsigned from = std::max(a.from, b.from);
+        if (from < std::min(a.to, b.to)) {
+            return from;
+        }
+        if (a.to <= b.to) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    return kNoPosition;
+}
+
+// A register that is free for the whole interval and already holds a value the interval
+// is copied to or from, kNone if there is none
+unsigned LinearScan::findHint(const Interval& current) const {
+    unsigned end = getEnd(current);
+    auto registerOf = [&](const Inst* value) {
+        unsigned interval = interval_of_[value->getId()];
+        if (interval == kNone) {
+            return kNone;
+        }
+        Location location = intervals_[interval].location;
+        return location.kind == Location::REGISTER && free_until_[location.index] >= end
+                   ? location.index
+                   : kNone;
+    };
+    Opcode opcode = current.value->getOpcode();
+    if (opcode == Opcode::PHI || opcode == Opcode::MOV) {
+        for (Inst* input : current.value->getInputs()) {
+            if (unsigned reg = registerOf(input); reg != kNone) {
+                return reg;
+            }
+        }
+    }
+    for (Inst* user : current.value->getUsers()) {
+        if (user->getOpcode() == Opcode::PHI || user->getOpcode() == Opcode::MOV) {
+            if (unsigned reg = registerOf(user); reg != kNone) {
+                return reg;
+            }
+        }
+    }
+    return kNone;
+}
+
+void LinearScan::allocate(unsigned current) {
+    Interval& cur = intervals_[current];
+    unsigned position = getStart(cur);
+
+    // Retire the intervals that ended and move the others between active and inactive
+    size_t num_active = active_.size();
+    size_t kept = 0;
+    for (unsigned i : inactive_) {
+        Interval& it = intervals_[i];
+        if (getEnd(it) <= position) {
+            continue;
+        }
+        if (covers(it, position)) {
+            active_.push_back(i);
+        } else {
+            inactive_[kept++] = i;
+        }
+    }
+    inactive_.resize(kept);
+    kept = 0;
+    for (size_t k = 0; k < active_.size(); ++k) {
+        unsigned i = active_[k];
+        Interval& it = intervals_[i];
+        if (k >= num_active) {
+            active_[kept++] = i;
+        } else if (getEnd(it) > position) {
+            if (covers(it, position)) {
+                active_[kept++] = i;
+            } else {
+                inactive_.push_back(i);
+            }
+        }
+    }
+    active_.resize(kept);
+
+    // A register is free until the next use of it that overlaps the interval
+    std::fill(free_until_.begin(), free_until_.end(), kNoPosition);
+    for (unsigned i : active_) {
+        free_until_[intervals_[i].location.index] = 0;
+    }
+    for (unsigned i : inactive_) {
+        unsigned reg = intervals_[i].location.index;
+        if (free_until_[reg] != 0) {
+            free_until_[reg] = std::min(free_until_[reg], nextIntersection(intervals_[i], cur));
+        }
+    }
+    unsigned end = getEnd(cur);
+    unsigned reg = findHint(cur);
+    for (unsigned r = 0; r < num_registers_ && reg == kNone; ++r) {
+        if (free_until_[r] >= end) {
+            reg = r;
+        }
+    }
+    if (reg != kNone) {
+        cur.location = Location::reg(reg);
+        used_registers_[reg] = true;
+        active_.push_back(current);
+        return;
+    }
+
+    // Every register is taken somewhere in the interval: spill it, or what overlaps it in
+    // the register where that weighs least
+    std::fill(conflict_weight_.begin(), conflict_weight_.end(), 0);
+    for (unsigned i : active_) {
+        conflict_weight_[intervals_[i].location.index] += intervals_[i].weight;
+    }
+    for (unsigned i : inactive_) {
+        if (nextIntersection(intervals_[i], cur) != kNoPosition) {
+            conflict_weight_[intervals_[i].location.index] += intervals_[i].weight;
+        }
+    }
+    unsigned best = 0;
+    for (unsigned r = 1; r < num_registers_; ++r) {
+        if (conflict_weight_[r] < conflict_weight_[best]) {
+            best = r;
+        }
+    }
+    if (num_registers_ == 0 || conflict_weight_[best] >= cur.weight) {
+        cur.location = Location::slot(0);
+        spilled_.push_back(current);
+        ++num_spilled_;
+        return;
+    }
+    auto spill = [&](unsigned i) {
+        intervals_[i].location = Location::slot(0);
+        spilled_.push_back(i);
+        ++num_spilled_;
+        ++num_evicted_;
+    };
+    auto evictActive = [&](unsigned i) {
+        if (intervals_[i].location.index != best) {
+            return false;
+        }
+        spill(i);
+        return true;
+    };
+    auto evictInactive = [&](unsigned i) {
+        if (intervals_[i].location.index != best ||
+            nextIntersection(intervals_[i], cur) == kNoPosition) {
+            return false;
+        }
+        spill(i);
+        return true;
+    };
+    active_.erase(std::remove_if(active_.begin(), active_.end(), evictActive), active_.end());
+    inactive_.erase(std::remove_if(inactive_.begin(), inactive_.end(), evictInactive),
+                    inactive_.end());
+    cur.location = Location::reg(best);
+    used_registers_[best] = true;
+    active_.push_back(current);
+}
+
+// Interval graph coloring on whole lifetimes: a slot is free again once its interval ends
+void LinearScan::assignStackSlots() {
+    std::stable_sort(spilled_.begin(), spilled_.end(), [this](unsigned a, unsigned b) {
+        return getStart(intervals_[a]) < getStart(intervals_[b]);
+    });
+    using Busy = std::pair<unsigned, unsigned>;  // (end, slot)
+    std::priority_queue<Busy, std::vector<Busy>, std::greater<Busy>> busy;
+    std::vector<unsigned> free_slots;
+    for (unsigned i : spilled_) {
+        Interval& it = intervals_[i];
+        while (!busy.empty() && busy.top().first <= getStart(it)) {
+            free_slots.push_back(busy.top().second);
+            busy.pop();
+        }
+        unsigned slot = num_stack_slots_;
+        if (free_slots.empty()) {
+            ++num_stack_slots_;
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        it.location = Location::slot(slot);
+        busy.emplace(getEnd(it), slot);
+    }
+}
+
+void LinearScan::resolveEdges() {
+    const auto& blocks = graph_->getBasicBlocks();
+    first_edge_.assign(blocks.size(), 0);
+    unsigned num_edges = 0;
+    for (BasicBlock* bb : blocks) {
+        first_edge_[bb->getId()] = num_edges;
+        num_edges += bb->getPredecessors().size();
+    }
+    edge_begin_.assign(num_edges + 1, 0);
+    std::vector<EdgeMove> copies;
+    Location scratch{Location::SCRATCH, 0};
+    for (BasicBlock* bb : blocks) {
+        const auto& preds = bb->getPredecessors();
+        for (size_t k = 0; k < preds.size(); ++k) {
+            edge_begin_[first_edge_[bb->getId()] + k] = edge_moves_.size();
+            if (getBlockStart(bb) == kNoPosition || getBlockStart(preds[k]) == kNoPosition) {
+                continue;
+            }
+            for (Inst* inst : bb->getInstructions()) {
+                if (inst->getOpcode() != Opcode::PHI) {
+                    break;
+                }
+                auto* phi = static_cast<PhiInst*>(inst);
+                unsigned i = findIncoming(phi, preds[k]);
+                if (interval_of_[phi->getId()] == kNone || i == ~0u) {
+                    continue;
+                }
+                ++num_phi_copies_;
+                Inst* value = phi->getIncomingValue(i);
+                Location src = getLocation(value);
+                Location dst = getLocation(phi);
+                if (src != dst && src.kind != Location::NONE) {
+                    copies.push_back({dst, src, value});
+                }
+            }
+            sequentializeParallelCopy(copies, scratch, [this](const EdgeMove& move) {
+                edge_moves_.push_back(move);
+            });
+        }
+    }
+    edge_begin_[num_edges] = edge_moves_.size();
+}
+
+Location LinearScan::getLocation(const Inst* value) const {
+    if (value->getOpcode() == Opcode::CONST) {
+        return {Location::CONSTANT, 0};
+    }
+    unsigned id = value->getId();
+    if (id >= interval_of_.size() || interval_of_[id] == kNone) {
+        return Location();
+    }
+    return intervals_[interval_of_[id]].location;
+}
+
+Span<const LiveRange> LinearScan::getRanges(const Inst* value) const {
+    unsigned id = value->getId();
+    if (id >= interval_of_.size() || interval_of_[id] == kNone) {
+        return Span<const LiveRange>();
+    }
+    const Interval& it = intervals_[interval_of_[id]];
+    return Span<const LiveRange>(ranges_.data() + it.first_range, it.end_range - it.first_range);
+}
+
+unsigned LinearScan::getBlockEnd(const BasicBlock* bb) const {
+    unsigned start = getBlockStart(bb);
+    return start == kNoPosition ? kNoPosition
+                                : start + 2 * (bb->getInstructions().size() + 1);
+}
+
+Span<const EdgeMove> LinearScan::getEdgeMoves(const BasicBlock* pred,
+                                              const BasicBlock* succ) const {
+    if (succ->getId() >= first_edge_.size()) {
+        return Span<const EdgeMove>();
+    }
+    const auto& preds = succ->getPredecessors();
+    for (size_t k = 0; k < preds.size(); ++k) {
+        if (preds[k] == pred) {
+            unsigned edge = first_edge_[succ->getId()] + k;
+            return Span<const EdgeMove>(edge_moves_.data() + edge_begin_[edge],
+                                        edge_begin_[edge + 1] - edge_begin_[edge]);
+        }
+    }
+    return Span<const EdgeMove>();
+}
+
+void LinearScan::dump(std::ostream& os) const {
+    os << "Layout:";
+    for (BasicBlock* bb : order_) {
+        os << " BB" << bb->getId() << " [" << getBlockStart(bb) << ", " << getBlockEnd(bb)
+           << ")";
+    }
+    os << "\nIntervals:\n";
+    for (const Interval& it : intervals_) {
+        os << "  i" << it.value->getId() << ":";
+        for (unsigned r = it.first_range; r < it.end_range; ++r) {
+            os << " [" << ranges_[r].from << ", " << ranges_[r].to << ")";
+        }
+        os << " -> ";
+        printLocation(os, it.location, it.value);
+        os << "\n";
+    }
+    os << "Edge moves:\n";
+    for (BasicBlock* succ : order_) {
+        for (BasicBlock* pred : succ->getPredecessors()) {
+            Span<const EdgeMove> moves = getEdgeMoves(pred, succ);
+            if (moves.empty()) {
+                continue;
+            }
+            os << "  BB" << pred->getId() << " -> BB" << succ->getId() << ":";
+            for (size_t i = 0; i < moves.size(); ++i) {
+                const EdgeMove& move = moves[i];
+                os << (i == 0 ? " " : ", ");
+                printLocation(os, move.dst, move.value);
+                os << " = ";
+                printLocation(os, move.src, move.value);
+            }
+            os << "\n";
+        }
+    }
+}
@@ -0,0 +1,270 @@
+#include "liveness.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LIVENESS_AVX2 1
+#endif
+
+namespace {
+
+// Rows are padded to whole 256-bit lanes
+constexpr size_t kWordsPerLane = 4;
+
+// dst |= src over n words; returns true if dst gained a bit
+bool unionWords(uint64_t* dst, const uint64_t* src, size_t n) {
+    uint64_t added = 0;
+    for (size_t i = 0; i < n; ++i) {
+        added |= src[i] & ~dst[i];
+        dst[i] |= src[i];
+    }
+    return added != 0;
+}
+
+// dst |= src & ~kill over n words; returns true if dst gained a bit
+bool unionDifferenceWords(uint64_t* dst, const uint64_t* src, const uint64_t* kill, size_t n) {
+    uint64_t added = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t bits = src[i] & ~kill[i];
+        added |= bits & ~dst[i];
+        dst[i] |= bits;
+    }
+    return added != 0;
+}
+
+#ifdef LIVENESS_AVX2
+// Same on aligned rows whose length is a multiple of kWordsPerLane
+__attribute__((target("avx2"))) bool unionWordsAVX2(uint64_t* dst, const uint64_t* src,
+                                                    size_t n) {
+    __m256i added = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += kWordsPerLane) {
+        auto* d = reinterpret_cast<__m256i*>(dst + i);
+        __m256i old_bits = _mm256_load_si256(d);
+        __m256i bits = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i));
+        added = _mm256_or_si256(added, _mm256_andnot_si256(old_bits, bits));
+        _mm256_store_si256(d, _mm256_or_si256(old_bits, bits));
+    }
+    return !_mm256_testz_si256(added, added);
+}
+
+__attribute__((target("avx2"))) bool unionDifferenceWordsAVX2(uint64_t* dst,
+                                                              const uint64_t* src,
+                                                              const uint64_t* kill, size_t n) {
+    __m256i added = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += kWordsPerLane) {
+        auto* d = reinterpret_cast<__m256i*>(dst + i);
+        __m256i old_bits = _mm256_load_si256(d);
+        __m256i bits = _mm256_andnot_si256(
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(kill + i)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i)));
+        added = _mm256_or_si256(added, _mm256_andnot_si256(old_bits, bits));
+        _mm256_store_si256(d, _mm256_or_si256(old_bits, bits));
+    }
+    return !_mm256_testz_si256(added, added);
+}
+#endif
+
+struct Kernels {
+    bool (*union_words)(uint64_t*, const uint64_t*, size_t);
+    bool (*union_difference_words)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+    bool simd;
+};
+
+// Picked once, by what the CPU running the program supports
+const Kernels& getKernels() {
+    static const Kernels kernels = [] {
+#ifdef LIVENESS_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernels{unionWordsAVX2, unionDifferenceWordsAVX2, true};
+        }
+#endif
+        return Kernels{unionWords, unionDifferenceWords, false};
+    }();
+    return kernels;
+}
+
+// True if the value is read outside its block, or by a phi, which reads it at the end of a
+// predecessor
+bool isUsedAcrossBlocks(const Inst* inst, const BasicBlock* bb) {
+    for (Inst* user : inst->getUsers()) {
+        if (user->getParent() != bb || user->getOpcode() == Opcode::PHI) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool Liveness::usesSIMD() {
+    return getKernels().simd;
+}
+
+void Liveness::run() {
+    traversal_.run();
+    numberValues();
+    initializeSets();
+    solve();
+}
+
+void Liveness::numberValues() {
+    num_blocks_ = graph_->getBasicBlocks().size();
+    index_of_.assign(graph_->getNumInsts(), kNoIndex);
+    values_.clear();
+    first_def_.assign(num_blocks_, 0);
+    num_defs_.assign(num_blocks_, 0);
+    for (BasicBlock* bb : traversal_.getReversePostOrder()) {
+        unsigned first = values_.size();
+        for (Inst* inst : bb->getInstructions()) {
+            if (isUsedAcrossBlocks(inst, bb)) {
+                index_of_[inst->getId()] = values_.size();
+                values_.push_back(inst);
+            }
+        }
+        first_def_[bb->getId()] = first;
+        num_defs_[bb->getId()] = values_.size() - first;
+    }
+}
+
+void Liveness::initializeSets() {
+    // A block's values end its rows; unreachable blocks get empty ones
+    constexpr size_t kBitsPerLane = 64 * kWordsPerLane;
+    row_size_.assign(num_blocks_, 0);
+    row_offset_.assign(num_blocks_, 0);
+    size_t max_row_size = 0;
+    for (BasicBlock* bb : traversal_.getReversePostOrder()) {
+        unsigned id = bb->getId();
+        size_t bits = first_def_[id] + num_defs_[id];
+        row_size_[id] = (bits + kBitsPerLane - 1) / kBitsPerLane * kWordsPerLane;
+        max_row_size = std::max(max_row_size, row_size_[id]);
+    }
+    size_t offset = 0;
+    for (unsigned id = 0; id < num_blocks_; ++id) {
+        row_offset_[id] = offset;
+        offset += 2 * row_size_[id];
+    }
+    kill_offset_ = offset;
+    table_size_ = offset;
+    storage_.assign(offset + max_row_size + kWordsPerLane - 1, 0);
+    auto address = reinterpret_cast<uintptr_t>(storage_.data());
+    base_ = (-address % (kWordsPerLane * sizeof(uint64_t))) / sizeof(uint64_t);
+
+    // Uses seed the sets; each seeded live-out bit is also passed on to the live-in row here,
+    // so that evaluations only have to propagate what the successors add
+    auto set = [](uint64_t* words, unsigned index) {
+        words[index / 64] |= uint64_t(1) << (index % 64);
+    };
+    for (BasicBlock* bb : traversal_.getReversePostOrder()) {
+        unsigned id = bb->getId();
+        for (Inst* inst : bb->getInstructions()) {
+            // Inputs that do not dominate their use would fall outside of the rows
+            if (inst->getOpcode() != Opcode::PHI) {
+                for (Inst* input : inst->getInputs()) {
+                    unsigned index = getIndex(input);
+                    if (index < first_def_[id]) {
+                        set(liveIn(id), index);
+                    }
+                }
+                continue;
+            }
+            for (auto [value, pred] : static_cast<PhiInst*>(inst)->getIncoming()) {
+                unsigned index = getIndex(value);
+                if (!traversal_.isReachable(pred) || index == kNoIndex ||
+                    index / 64 >= row_size_[pred->getId()]) {
+                    continue;
+                }
+                set(liveOut(pred->getId()), index);
+                if (index < first_def_[pred->getId()]) {
+                    set(liveIn(pred->getId()), index);
+                }
+            }
+        }
+    }
+}
+
+void Liveness::solve() {
+    const Kernels& kernels = getKernels();
+    const std::vector<BasicBlock*>& post_order = traversal_.getPostOrder();
+    size_t num_reachable = post_order.size();
+
+    // Pending blocks by post-order number; no word below `cursor` has a bit set
+    std::vector<uint64_t> pending((num_reachable + 63) / 64, ~uint64_t(0));
+    if (num_reachable % 64 != 0) {
+        pending.back() = (uint64_t(1) << (num_reachable % 64)) - 1;
+    }
+    size_t cursor = 0;
+    // Evaluation after which each block's live-in row last grew, and before which it was
+    // last evaluated; every row counts as grown before the first evaluation
+    std::vector<unsigned> grown_at(num_blocks_, 0);
+    std::vector<unsigned> evaluated_at(num_blocks_, 0);
+    num_evaluations_ = 0;
+    uint64_t* kill = storage_.data() + base_ + kill_offset_;
+    while (true) {
+        while (cursor < pending.size() && pending[cursor] == 0) {
+            ++cursor;
+        }
+        if (cursor == pending.size()) {
+            break;
+        }
+        size_t number = cursor * 64 + __builtin_ctzll(pending[cursor]);
+        pending[cursor] &= pending[cursor] - 1;
+        BasicBlock* bb = post_order[number];
+        unsigned id = bb->getId();
+        unsigned evaluation = ++num_evaluations_;
+        unsigned last_evaluation = evaluated_at[id];
+        evaluated_at[id] = evaluation;
+
+        uint64_t* out = liveOut(id);
+        bool grew = false;
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            unsigned succ_id = succ->getId();
+            if (grown_at[succ_id] >= last_evaluation) {
+                size_t size = std::min(row_size_[id], row_size_[succ_id]);
+                grew |= kernels.union_words(out, liveIn(succ_id), size);
+            }
+        }
+        if (!grew) {
+            continue;
+        }
+        // live-in |= live-out minus the values the block defines
+        unsigned first = first_def_[id];
+        unsigned last = first + num_defs_[id];
+        for (unsigned i = first; i < last; ++i) {
+            kill[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        bool in_grew = kernels.union_difference_words(liveIn(id), out, kill, row_size_[id]);
+        for (unsigned i = first; i < last; ++i) {
+            kill[i / 64] = 0;
+        }
+        if (!in_grew) {
+            continue;
+        }
+        grown_at[id] = evaluation;
+        for (BasicBlock* pred : bb->getPredecessors()) {
+            if (traversal_.isReachable(pred)) {
+                size_t pred_number = num_reachable - 1 - traversal_.getRPONumber(pred);
+                pending[pred_number / 64] |= uint64_t(1) << (pred_number % 64);
+                cursor = std::min(cursor, pred_number / 64);
+            }
+        }
+    }
+}
+
+std::vector<Inst*> Liveness::getLiveIn(const BasicBlock* bb) const {
+    return collect(getLiveInWords(bb));
+}
+
+std::vector<Inst*> Liveness::getLiveOut(const BasicBlock* bb) const {
+    return collect(getLiveOutWords(bb));
+}
+
+std::vector<Inst*> Liveness::collect(Span<const uint64_t> words) const {
+    std::vector<Inst*> result;
+    for (size_t i = 0; i < words.size(); ++i) {
+        for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+            result.push_back(values_[i * 64 + __builtin_ctzll(word)]);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,133 @@
+#include "loop_info.h"
+
+#include "cfg_traversal.h"
+
+void LoopInfo::run() {
+    loops_.clear();
+    top_level_loops_.clear();
+    irreducible_entries_.clear();
+    innermost_.assign(graph_->getBasicBlocks().size(), nullptr);
+    if (graph_->getStartBlock() == nullptr) {
+        return;
+    }
+    CFGTraversal traversal(graph_);
+    traversal.run();
+
+    for (BasicBlock* bb : traversal.getPostOrder()) {
+        discoverLoop(bb, traversal);
+    }
+    // Outer loops last: depths top-down, and block lists in reverse post-order
+    for (size_t i = loops_.size(); i-- > 0;) {
+        Loop* loop = loops_[i].get();
+        if (loop->parent_ == nullptr) {
+            loop->depth_ = 1;
+            top_level_loops_.push_back(loop);
+        } else {
+            loop->depth_ = loop->parent_->depth_ + 1;
+        }
+    }
+    for (BasicBlock* bb : traversal.getReversePostOrder()) {
+        for (Loop* loop = innermost_[bb->getId()]; loop != nullptr; loop = loop->parent_) {
+            loop->blocks_.push_back(bb);
+        }
+    }
+
+    for (auto& loop : loops_) {
+        BasicBlock* outside = nullptr;
+        unsigned num_outside = 0;
+        for (BasicBlock* pred : loop->header_->getPredecessors()) {
+            if (traversal.isReachable(pred) && !contains(loop.get(), pred)) {
+                outside = pred;
+                ++num_outside;
+            }
+        }
+        if (num_outside == 1 && outside->getNumSuccessors() == 1) {
+            loop->preheader_ = outside;
+        }
+    }
+
+    std::vector<bool> is_entry(innermost_.size(), false);
+    for (BasicBlock* bb : traversal.getReversePostOrder()) {
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (traversal.getRPONumber(succ) <= traversal.getRPONumber(bb) &&
+                !dom_tree_.dominates(succ, bb) && !is_entry[succ->getId()]) {
+                is_entry[succ->getId()] = true;
+                irreducible_entries_.push_back(succ);
+            }
+        }
+    }
+}
+
+void LoopInfo::discoverLoop(BasicBlock* header, const CFGTraversal& traversal) {
+    std::unique_ptr<Loop> loop;
+    for (BasicBlock* pred : header->getPredecessors()) {
+        if (traversal.isReachable(pred) && dom_tree_.dominates(header, pred)) {
+            if (loop == nullptr) {
+                loop.reset(new Loop(header));
+            }
+            loop->latches_.push_back(pred);
+            worklist_.push_back(pred);
+        }
+    }
+    if (loop == nullptr) {
+        return;
+    }
+
+    while (!worklist_.empty()) {
+        BasicBlock* bb = worklist_.back();
+        worklist_.pop_back();
+        Loop* inner = innermost_[bb->getId()];
+        if (inner == nullptr) {
+            innermost_[bb->getId()] = loop.get();
+            if (bb != header) {
+                for (BasicBlock* pred : bb->getPredecessors()) {
+                    if (traversal.isReachable(pred)) {
+                        worklist_.push_back(pred);
+                    }
+                }
+            }
+            continue;
+        }
+        while (inner->parent_ != nullptr) {
+            inner = inner->parent_;
+        }
+        if (inner == loop.get()) {
+            continue;
+        }
+        // A loop found earlier: continue from its header, whose predecessors inside the
+        // inner loop lead back to it
+        inner->parent_ = loop.get();
+        loop->sub_loops_.push_back(inner);
+        for (BasicBlock* pred : inner->header_->getPredecessors()) {
+            if (traversal.isReachable(pred)) {
+                worklist_.push_back(pred);
+            }
+        }
+    }
+    loops_.push_back(std::move(loop));
+}
+
+void LoopInfo::dump(std::ostream& os) const {
+    os << "Loops (innermost first):\n";
+    for (const auto& loop : loops_) {
+        os << "  BB" << loop->header_->getId() << ": depth " << loop->depth_ << ", blocks";
+        for (BasicBlock* bb : loop->blocks_) {
+            os << " BB" << bb->getId();
+        }
+        os << ", latches";
+        for (BasicBlock* bb : loop->latches_) {
+            os << " BB" << bb->getId();
+        }
+        if (loop->preheader_ != nullptr) {
+            os << ", preheader BB" << loop->preheader_->getId();
+        }
+        os << "\n";
+    }
+    if (!isReducible()) {
+        os << "Irreducible entries:";
+        for (BasicBlock* bb : irreducible_entries_) {
+            os << " BB" << bb->getId();
+        }
+        os << "\n";
+    }
+}
@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+#if defined(__unix__)
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    error_.clear();
+#if defined(__unix__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error_ = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        error_ = "cannot read " + path;
+        return false;
+    }
+    size_t size = info.st_size;
+    if (size == 0) {
+        ::close(fd);  // mmap rejects empty mappings
+        return true;
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error_ = "cannot map " + path;
+        return false;
+    }
+    data_ = data;
+    size_ = size;
+    return true;
+#else
+    error_ = "memory-mapped files need POSIX";
+    return false;
+#endif
+}
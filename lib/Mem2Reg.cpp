@@ -0,0 +1,240 @@
+#include "mem2reg.h"
+
+unsigned Mem2Reg::run() {
+    inserted_phis_.clear();
+    zero_ = nullptr;
+    BasicBlock* entry = graph_->getStartBlock();
+    if (entry == nullptr || !entry->getPredecessors().empty()) {
+        return 0;
+    }
+
+    const auto& blocks = graph_->getBasicBlocks();
+    slot_var_.assign(graph_->getNumInsts(), kNotPromoted);
+    num_vars_ = 0;
+    for (BasicBlock* bb : blocks) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() == Opcode::ALLOCA && isPromotable(inst)) {
+                slot_var_[inst->getId()] = num_vars_++;
+            }
+        }
+    }
+    if (num_vars_ == 0) {
+        return 0;
+    }
+
+    // One scan collects, per variable, the blocks that store it and the blocks whose first
+    // access to it is a load, i.e. where it is certainly live on entry
+    std::vector<std::vector<BasicBlock*>> def_blocks(num_vars_);
+    std::vector<std::vector<BasicBlock*>> live_seeds(num_vars_);
+    std::vector<unsigned> last_block(num_vars_, kNotPromoted);
+    for (BasicBlock* bb : blocks) {
+        for (Inst* inst : bb->getInstructions()) {
+            unsigned var = getVariable(inst);
+            if (var == kNotPromoted) {
+                continue;
+            }
+            bool first_access = last_block[var] != bb->getId();
+            last_block[var] = bb->getId();
+            if (inst->getOpcode() == Opcode::LOAD) {
+                if (first_access) {
+                    live_seeds[var].push_back(bb);
+                }
+            } else if (def_blocks[var].empty() || def_blocks[var].back() != bb) {
+                def_blocks[var].push_back(bb);
+            }
+        }
+    }
+
+    block_phis_.assign(blocks.size(), {});
+    live_mark_.assign(blocks.size(), 0);
+    def_mark_.assign(blocks.size(), 0);
+    for (unsigned var = 0; var < num_vars_; ++var) {
+        placePhis(var, def_blocks[var], live_seeds[var]);
+    }
+
+    // The new phis go in front of each block, with one shift per block
+    std::vector<Inst*> phis;
+    for (BasicBlock* bb : blocks) {
+        if (block_phis_[bb->getId()].empty()) {
+            continue;
+        }
+        phis.clear();
+        for (const auto& phi_var : block_phis_[bb->getId()]) {
+            phis.push_back(phi_var.first);
+        }
+        bb->insertInstructions(0, phis);
+    }
+
+    rename();
+
+    // Every load is dead now; drop them together with the stores and the slots
+    for (BasicBlock* bb : blocks) {
+        bb->removeInstructionsIf([this](Inst* inst) {
+            bool promoted = inst->getOpcode() == Opcode::ALLOCA
+                                ? slot_var_[inst->getId()] != kNotPromoted
+                                : getVariable(inst) != kNotPromoted;
+            if (promoted) {
+                inst->dropAllReferences();
+            }
+            return promoted;
+        });
+    }
+    if (zero_ != nullptr) {
+        entry->insertInstructions(0, Span<Inst* const>(&zero_, 1));
+    }
+    return num_vars_;
+}
+
+unsigned Mem2Reg::getVariable(const Inst* inst) const {
+    Opcode opcode = inst->getOpcode();
+    if (opcode != Opcode::LOAD && opcode != Opcode::STORE) {
+        return kNotPromoted;
+    }
+    unsigned slot_id = inst->getOperand(0)->getId();
+    return slot_id < slot_var_.size() ? slot_var_[slot_id] : kNotPromoted;
+}
+
+bool Mem2Reg::isPromotable(const Inst* alloca) const {
+    for (Use* use = alloca->getFirstUse(); use; use = use->getNext()) {
+        Inst* user = use->getUser();
+        if (user->getOpcode() == Opcode::LOAD) {
+            continue;
+        }
+        // Storing the slot itself somewhere lets it escape
+        if (user->getOpcode() == Opcode::STORE &&
+            static_cast<StoreInst*>(user)->getValue() != alloca) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+void Mem2Reg::placePhis(unsigned var, const std::vector<BasicBlock*>& def_blocks,
+                        const std::vector<BasicBlock*>& live_seeds) {
+    if (live_seeds.empty()) {
+        // Never read before being written in the same block, so no phi would be live
+        return;
+    }
+
+    // The variable is live on entry to the seeds and, transitively, to predecessors that
+    // do not store it
+    unsigned stamp = var + 1;
+    for (BasicBlock* bb : def_blocks) {
+        def_mark_[bb->getId()] = stamp;
+    }
+    live_in_.clear();
+    for (BasicBlock* bb : live_seeds) {
+        live_mark_[bb->getId()] = stamp;
+        live_in_.push_back(bb);
+    }
+    worklist_ = live_in_;
+    while (!worklist_.empty()) {
+        BasicBlock* bb = worklist_.back();
+        worklist_.pop_back();
+        for (BasicBlock* pred : bb->getPredecessors()) {
+            unsigned id = pred->getId();
+            if (live_mark_[id] != stamp && def_mark_[id] != stamp) {
+                live_mark_[id] = stamp;
+                live_in_.push_back(pred);
+                worklist_.push_back(pred);
+            }
+        }
+    }
+
+    idf_.setDefiningBlocks(def_blocks);
+    idf_.setLiveInBlocks(live_in_);
+    idf_.calculate(phi_blocks_);
+    for (BasicBlock* bb : phi_blocks_) {
+        auto* phi = graph_->createInst<PhiInst>(nullptr);
+        block_phis_[bb->getId()].emplace_back(phi, var);
+        inserted_phis_.push_back(phi);
+    }
+}
+
+void Mem2Reg::rename() {
+    // current[var] is the value of var at the walk's position; each definition logs the
+    // value it shadows so leaving a block restores the state of its idom
+    std::vector<Inst*> current(num_vars_, nullptr);
+    std::vector<std::pair<unsigned, Inst*>> undo;
+    auto valueOf = [&](unsigned var) {
+        return current[var] != nullptr ? current[var] : getZero();
+    };
+    auto define = [&](unsigned var, Inst* value) {
+        undo.emplace_back(var, current[var]);
+        current[var] = value;
+    };
+    auto addPhiOperands = [&](BasicBlock* bb) {
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            for (const auto& [phi, var] : block_phis_[succ->getId()]) {
+                phi->addIncoming(valueOf(var), bb);
+            }
+        }
+    };
+
+    // Preorder walk of the dominator tree with an explicit stack
+    struct Frame {
+        BasicBlock* bb;
+        unsigned next_child;
+        size_t undo_size;
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](BasicBlock* bb) {
+        stack.push_back({bb, 0, undo.size()});
+        for (const auto& [phi, var] : block_phis_[bb->getId()]) {
+            define(var, phi);
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            unsigned var = getVariable(inst);
+            if (var == kNotPromoted) {
+                continue;
+            }
+            if (inst->getOpcode() == Opcode::LOAD) {
+                inst->replaceAllUsesWith(valueOf(var));
+            } else {
+                define(var, static_cast<StoreInst*>(inst)->getValue());
+            }
+        }
+        addPhiOperands(bb);
+    };
+
+    enter(graph_->getStartBlock());
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        auto children = dom_tree_.getChildren(frame.bb);
+        if (frame.next_child < children.size()) {
+            enter(children[frame.next_child++]);
+            continue;
+        }
+        while (undo.size() > frame.undo_size) {
+            current[undo.back().first] = undo.back().second;
+            undo.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    // Unreachable blocks are outside the tree; no store reaches their loads
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        if (dom_tree_.getImmediateDominator(bb) != nullptr) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() == Opcode::LOAD && getVariable(inst) != kNotPromoted) {
+                inst->replaceAllUsesWith(getZero());
+            }
+        }
+        addPhiOperands(bb);
+    }
+}
+
+Inst* Mem2Reg::getZero() {
+    if (zero_ == nullptr) {
+        zero_ = graph_->createInst<ConstInst>(nullptr, 0);
+    }
+    return zero_;
+}
+
+PreservedAnalyses Mem2RegPass::run(Graph& g, AnalysisManager& am) {
+    num_promoted_ = Mem2Reg(&g, am.getDominatorTree()).run();
+    return num_promoted_ != 0 ? PreservedAnalyses::cfg() : PreservedAnalyses::all();
+}
@@ -0,0 +1,38 @@
+#include "module.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "parallel_for.h"
+
+void Module::dump(std::ostream& os) const {
+    for (const auto& function : functions_) {
+        function->dump(os);
+    }
+}
+
+ModuleDriver::ModuleDriver(unsigned num_threads)
+    : contexts_(num_threads != 0 ? num_threads : getHardwareThreads()) {
+    for (unsigned worker = 0; worker < contexts_.size(); ++worker) {
+        contexts_[worker].worker_ = worker;
+    }
+}
+
+void ModuleDriver::run(Module& module, const Job& job) {
+    std::vector<size_t> order(module.getNumFunctions());
+    std::iota(order.begin(), order.end(), 0);
+    if (getNumThreads() > 1) {
+        std::vector<unsigned> sizes(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sizes[i] = module.getFunction(i)->getNumInsts();
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    }
+    parallelFor(getNumThreads(), order.size(), [&](size_t i, unsigned worker) {
+        WorkerContext& ctx = contexts_[worker];
+        ctx.function_index_ = order[i];
+        job(*module.getFunction(order[i]), ctx);
+        ctx.scratch_.reset();
+    });
+}
@@ -0,0 +1,391 @@
+#include "out_of_ssa.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+namespace {
+
+constexpr unsigned kNone = ~0u;
+constexpr uint64_t kUnordered = ~uint64_t(0);
+
+bool hasPhis(const BasicBlock* bb) {
+    Span<Inst* const> insts = bb->getInstructions();
+    return !insts.empty() && insts[0]->getOpcode() == Opcode::PHI;
+}
+
+// Index of the first incoming value of `phi` from `pred`, kNone if there is none
+unsigned findIncoming(const PhiInst* phi, const BasicBlock* pred) {
+    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+        if (phi->getIncomingBlock(i) == pred) {
+            return i;
+        }
+    }
+    return kNone;
+}
+
+// Constants and parameters keep storage of their own in every backend
+bool isCoalescable(const Inst* value) {
+    return value->getOpcode() != Opcode::CONST && value->getOpcode() != Opcode::PARAM;
+}
+
+}  // namespace
+
+bool OutOfSSA::run() {
+    num_edges_split_ = 0;
+    num_phi_copies_ = 0;
+    num_coalesced_ = 0;
+    num_moves_ = 0;
+    num_temporaries_ = 0;
+    num_variables_ = 0;
+    temporary_ = nullptr;
+    variables_.clear();
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+    splitCriticalEdges();
+    if (num_edges_split_ != 0) {
+        graph_->buildPredecessors();
+    }
+
+    DominatorTree dom_tree(graph_);
+    dom_tree.run();
+    LoopInfo loops(graph_, dom_tree);
+    loops.run();
+    Liveness liveness(graph_);
+    liveness.run();
+    dom_tree_ = &dom_tree;
+    liveness_ = &liveness;
+    numberInstructions();
+    coalesce(loops);
+
+    unsigned num_locations = graph_->getNumInsts() + 1;
+    loc_.assign(num_locations, kNone);
+    pred_.assign(num_locations, kNone);
+    written_.assign(num_locations, false);
+    holder_.assign(num_locations, nullptr);
+    for (BasicBlock* succ : graph_->getBasicBlocks()) {
+        if (dom_tree.getPreOrderNumber(succ) == kNone || !hasPhis(succ)) {
+            continue;
+        }
+        for (BasicBlock* pred : succ->getPredecessors()) {
+            if (dom_tree.getPreOrderNumber(pred) != kNone) {
+                lowerParallelCopy(pred, succ);
+            }
+        }
+    }
+    assignVariables();
+    dom_tree_ = nullptr;
+    liveness_ = nullptr;
+    return num_edges_split_ != 0 || num_moves_ != 0;
+}
+
+void OutOfSSA::splitCriticalEdges() {
+    // Every edge out of a COND_JUMP is critical once its target has phis: the edge stays
+    // critical even if both targets are the same block
+    const std::vector<BasicBlock*>& blocks = graph_->getBasicBlocks();
+    for (size_t b = 0, num_blocks = blocks.size(); b < num_blocks; ++b) {
+        BasicBlock* pred = blocks[b];
+        Inst* terminator = pred->getTerminator();
+        if (terminator == nullptr || terminator->getOpcode() != Opcode::COND_JUMP) {
+            continue;
+        }
+        auto* cond_jump = static_cast<CondJumpInst*>(terminator);
+        for (unsigned edge = 0; edge < 2; ++edge) {
+            BasicBlock* succ = cond_jump->getTargets()[edge];
+            if (!hasPhis(succ)) {
+                continue;
+            }
+            const std::string& name = succ->getName();
+            BasicBlock* split = graph_->createBB(name.empty() ? "split" : name + ".split");
+            graph_->createInst<JumpInst>(split, succ);
+            if (edge == 0) {
+                cond_jump->setTrueTarget(split);
+            } else {
+                cond_jump->setFalseTarget(split);
+            }
+            for (Inst* inst : succ->getInstructions()) {
+                if (inst->getOpcode() != Opcode::PHI) {
+                    break;
+                }
+                auto* phi = static_cast<PhiInst*>(inst);
+                unsigned i = findIncoming(phi, pred);
+                if (i != kNone) {
+                    phi->setIncomingBlock(i, split);
+                }
+            }
+            ++num_edges_split_;
+        }
+    }
+}
+
+void OutOfSSA::numberInstructions() {
+    unsigned num_insts = graph_->getNumInsts();
+    order_.assign(num_insts, kUnordered);
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        unsigned pre = dom_tree_->getPreOrderNumber(bb);
+        if (pre == kNone) {
+            continue;
+        }
+        Span<Inst* const> insts = bb->getInstructions();
+        for (unsigned i = 0; i < insts.size(); ++i) {
+            order_[insts[i]->getId()] = uint64_t(pre) << 32 | i;
+        }
+    }
+    parent_.resize(num_insts);
+    std::iota(parent_.begin(), parent_.end(), 0);
+    members_.assign(num_insts, {});
+}
+
+unsigned OutOfSSA::find(unsigned id) {
+    while (parent_[id] != id) {
+        parent_[id] = parent_[parent_[id]];
+        id = parent_[id];
+    }
+    return id;
+}
+
+bool OutOfSSA::interfere(const Inst* a, const Inst* b) const {
+    // `a` dominates `b`, so they interfere iff `a` is still live where `b` is defined. The
+    // phis of a block are all defined at its entry, together.
+    BasicBlock* bb = b->getParent();
+    if (a->getParent() == bb && a->getOpcode() == Opcode::PHI &&
+        b->getOpcode() == Opcode::PHI) {
+        return true;
+    }
+    if (liveness_->isLiveOut(a, bb)) {
+        return true;
+    }
+    // A phi reads its input at the end of a predecessor, which live-out already covers
+    for (Inst* user : a->getUsers()) {
+        if (user->getParent() == bb && user->getOpcode() != Opcode::PHI &&
+            order_[user->getId()] > order_[b->getId()]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OutOfSSA::tryMerge(unsigned x, unsigned y) {
+    // A class without a member list has only its root
+    auto membersOf = [this](unsigned root) {
+        if (members_[root].empty()) {
+            members_[root].push_back(graph_->getInst(root));
+        }
+        return &members_[root];
+    };
+    std::vector<Inst*>* xs = membersOf(x);
+    std::vector<Inst*>* ys = membersOf(y);
+    merged_.clear();
+    std::merge(xs->begin(), xs->end(), ys->begin(), ys->end(), std::back_inserter(merged_),
+               [this](Inst* a, Inst* b) { return order_[a->getId()] < order_[b->getId()]; });
+
+    // The stack holds the chain of members that dominate the current one. If the dominating
+    // `a` is live at the definition of `c`, it is live at the definition of every member
+    // between them on the chain, so only the closest dominating member needs checking; and
+    // two members of the same class are already known not to interfere.
+    stack_.clear();
+    for (Inst* value : merged_) {
+        while (!stack_.empty() &&
+               !dom_tree_->dominates(stack_.back()->getParent(), value->getParent())) {
+            stack_.pop_back();
+        }
+        if (!stack_.empty() && find(stack_.back()->getId()) != find(value->getId()) &&
+            interfere(stack_.back(), value)) {
+            return false;
+        }
+        stack_.push_back(value);
+    }
+    if (xs->size() < ys->size()) {
+        std::swap(x, y);
+    }
+    parent_[y] = x;
+    members_[x].swap(merged_);
+    members_[y].clear();
+    members_[y].shrink_to_fit();
+    return true;
+}
+
+void OutOfSSA::coalesce(const LoopInfo& loops) {
+    // (loop depth of the edge, phi, input); copies on deeper edges run more often
+    struct Affinity {
+        unsigned depth;
+        PhiInst* phi;
+        Inst* value;
+    };
+    std::vector<Affinity> affinities;
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        if (dom_tree_->getPreOrderNumber(bb) == kNone) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                break;
+            }
+            auto* phi = static_cast<PhiInst*>(inst);
+            for (auto [value, pred] : phi->getIncoming()) {
+                if (isCoalescable(value) && order_[value->getId()] != kUnordered &&
+                    dom_tree_->getPreOrderNumber(pred) != kNone) {
+                    affinities.push_back({loops.getLoopDepth(pred), phi, value});
+                }
+            }
+        }
+    }
+    std::stable_sort(affinities.begin(), affinities.end(),
+                     [](const Affinity& a, const Affinity& b) { return a.depth > b.depth; });
+    for (const Affinity& affinity : affinities) {
+        unsigned x = find(affinity.phi->getId());
+        unsigned y = find(affinity.value->getId());
+        if (x != y) {
+            tryMerge(x, y);
+        }
+    }
+}
+
+void OutOfSSA::lowerParallelCopy(BasicBlock* pred, BasicBlock* succ) {
+    // The copies of the edge that were not coalesced, as (destination class, source value)
+    std::vector<std::pair<unsigned, Inst*>> copies;
+    std::vector<std::pair<PhiInst*, unsigned>> rewritten;  // (phi, incoming index)
+    for (Inst* inst : succ->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            break;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        unsigned i = findIncoming(phi, pred);
+        if (i == kNone) {
+            continue;
+        }
+        ++num_phi_copies_;
+        unsigned dst = find(phi->getId());
+        Inst* value = phi->getIncomingValue(i);
+        if (find(value->getId()) == dst) {
+            ++num_coalesced_;
+            continue;
+        }
+        copies.emplace_back(dst, value);
+        rewritten.emplace_back(phi, i);
+    }
+    if (copies.empty()) {
+        return;
+    }
+
+    // Sequentialize over locations, the classes and a temporary: loc_[a] is where the
+    // value of source a is now, pred_[b] the source that destination b copies, and
+    // holder_[l] the instruction whose value location l holds. A destination is ready once
+    // nothing still has to read it. Unlike the backends' sequentializeParallelCopy, this is
+    // linear in the copies, as classes are dense numbers that index the scratch arrays, and
+    // every move is a new MovInst whose readers must be followed through holder_.
+    const unsigned temp = loc_.size() - 1;
+    std::vector<Inst*> moves;
+    auto move = [&](unsigned dst, unsigned src) {
+        Inst* mov = graph_->createInst<MovInst>(nullptr, holder_[src]);
+        parent_.resize(graph_->getNumInsts());
+        parent_[mov->getId()] = dst;
+        if (dst == temp) {
+            if (temporary_ == nullptr) {
+                temporary_ = mov;
+            }
+            parent_[mov->getId()] = temporary_->getId();
+            ++num_temporaries_;
+        }
+        holder_[dst] = mov;
+        moves.push_back(mov);
+    };
+    std::vector<unsigned> ready;
+    std::vector<unsigned> todo;
+    for (auto [dst, value] : copies) {
+        unsigned src = find(value->getId());
+        loc_[src] = src;
+        holder_[src] = value;
+        pred_[dst] = src;
+    }
+    // Both are stacks; pushed backwards, independent moves come out in phi order
+    for (auto it = copies.rbegin(); it != copies.rend(); ++it) {
+        if (loc_[it->first] == kNone) {
+            ready.push_back(it->first);
+        }
+        todo.push_back(it->first);
+    }
+    while (!todo.empty()) {
+        while (!ready.empty()) {
+            unsigned b = ready.back();
+            ready.pop_back();
+            unsigned a = pred_[b];
+            unsigned c = loc_[a];
+            move(b, c);
+            written_[b] = true;
+            loc_[a] = b;
+            // The source's own value has now been copied out, so it may be overwritten
+            if (a == c && pred_[a] != kNone) {
+                ready.push_back(a);
+            }
+        }
+        unsigned b = todo.back();
+        todo.pop_back();
+        if (!written_[b]) {
+            // Only cycles are left: save b and free it
+            move(temp, b);
+            loc_[b] = temp;
+            ready.push_back(b);
+        }
+    }
+    for (auto [dst, value] : copies) {
+        loc_[find(value->getId())] = kNone;
+        loc_[dst] = kNone;
+        pred_[dst] = kNone;
+        written_[dst] = false;
+    }
+
+    pred->insertInstructions(pred->getInstructions().size() - 1,
+                             Span<Inst* const>(moves.data(), moves.size()));
+    for (auto [phi, i] : rewritten) {
+        phi->setOperand(i, holder_[find(phi->getId())]);
+    }
+    num_moves_ += moves.size();
+}
+
+void OutOfSSA::assignVariables() {
+    unsigned num_insts = graph_->getNumInsts();
+    std::vector<unsigned> variable_of_root(num_insts, kNoVariable);
+    auto number = [&](const Inst* value) {
+        unsigned root = find(value->getId());
+        if (variable_of_root[root] == kNoVariable) {
+            variable_of_root[root] = num_variables_++;
+        }
+    };
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                break;
+            }
+            number(inst);
+        }
+    }
+    if (temporary_ != nullptr) {
+        number(temporary_);
+    }
+    variables_.resize(num_insts);
+    for (unsigned id = 0; id < num_insts; ++id) {
+        variables_[id] = variable_of_root[find(id)];
+    }
+}
+
+PreservedAnalyses OutOfSSAPass::run(Graph& g, AnalysisManager& /*am*/) {
+    OutOfSSA lowering(&g);
+    bool changed = lowering.run();
+    if (report_ != nullptr) {
+        *report_ << "out-of-ssa " << g.getName() << ": " << lowering.getNumPhiCopies()
+                 << " phi copies, " << lowering.getNumCoalesced() << " coalesced, "
+                 << lowering.getNumMoves() << " moves (" << lowering.getNumTemporaries()
+                 << " through a temporary), " << lowering.getNumEdgesSplit()
+                 << " edges split\n";
+    }
+    if (!changed) {
+        return PreservedAnalyses::all();
+    }
+    if (lowering.getNumEdgesSplit() == 0) {
+        return PreservedAnalyses::cfg();
+    }
+    // The predecessor lists were rebuilt
+    return PreservedAnalyses::none().preserve(Analysis::Predecessors);
+}
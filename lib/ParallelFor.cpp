@@ -0,0 +1,41 @@
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+unsigned getHardwareThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallelFor(unsigned num_threads, size_t count,
+                 const std::function<void(size_t index, unsigned worker)>& job) {
+    if (num_threads == 0) {
+        num_threads = getHardwareThreads();
+    }
+    num_threads = std::min<size_t>(num_threads, count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            job(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto runItems = [&](unsigned worker) {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            job(i, worker);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned worker = 1; worker < num_threads; ++worker) {
+        threads.emplace_back(runItems, worker);
+    }
+    runItems(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,202 @@
+#include "pass_manager.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+// What each analysis is built from, indexed by Analysis
+constexpr AnalysisSet kDependencies[kNumAnalyses] = {
+    0,                                      // Predecessors
+    0,                                      // ReversePostOrder
+    analysisBit(Analysis::Predecessors),    // Dominators
+    analysisBit(Analysis::Predecessors),    // PostDominators
+    analysisBit(Analysis::Dominators),      // DominanceFrontier
+    analysisBit(Analysis::PostDominators),  // ControlDependence
+    analysisBit(Analysis::Dominators),      // Loops
+};
+
+const char* const kAnalysisNames[kNumAnalyses] = {
+    "predecessors",       "rpo", "dominators", "post-dominators", "dominance-frontier",
+    "control-dependence", "loops"};
+
+}  // namespace
+
+AnalysisManager::~AnalysisManager() {
+    // Dependent results point into the trees
+    clear();
+}
+
+void AnalysisManager::requirePredecessors() {
+    if (!isCached(Analysis::Predecessors)) {
+        graph_->buildPredecessors();
+        markComputed(Analysis::Predecessors);
+    }
+}
+
+const CFGTraversal& AnalysisManager::getRPO() {
+    if (!isCached(Analysis::ReversePostOrder)) {
+        rpo_ = std::make_unique<CFGTraversal>(graph_);
+        rpo_->run();
+        markComputed(Analysis::ReversePostOrder);
+    }
+    return *rpo_;
+}
+
+DominatorTree& AnalysisManager::getDominatorTree() {
+    if (!isCached(Analysis::Dominators)) {
+        requirePredecessors();
+        dom_tree_ = std::make_unique<DominatorTree>(graph_);
+        dom_tree_->run();
+        markComputed(Analysis::Dominators);
+    }
+    return *dom_tree_;
+}
+
+PostDominatorTree& AnalysisManager::getPostDominatorTree() {
+    if (!isCached(Analysis::PostDominators)) {
+        requirePredecessors();
+        post_dom_tree_ = std::make_unique<PostDominatorTree>(graph_);
+        post_dom_tree_->run();
+        markComputed(Analysis::PostDominators);
+    }
+    return *post_dom_tree_;
+}
+
+const DominanceFrontier& AnalysisManager::getDominanceFrontier() {
+    if (!isCached(Analysis::DominanceFrontier)) {
+        const DominatorTree& dom_tree = getDominatorTree();
+        frontier_ = std::make_unique<DominanceFrontier>(graph_, dom_tree);
+        frontier_->run();
+        markComputed(Analysis::DominanceFrontier);
+    }
+    return *frontier_;
+}
+
+const ControlDependenceGraph& AnalysisManager::getControlDependence() {
+    if (!isCached(Analysis::ControlDependence)) {
+        const PostDominatorTree& pdt = getPostDominatorTree();
+        control_dependence_ = std::make_unique<ControlDependenceGraph>(graph_, pdt);
+        control_dependence_->run();
+        markComputed(Analysis::ControlDependence);
+    }
+    return *control_dependence_;
+}
+
+const LoopInfo& AnalysisManager::getLoopInfo() {
+    if (!isCached(Analysis::Loops)) {
+        const DominatorTree& dom_tree = getDominatorTree();
+        loop_info_ = std::make_unique<LoopInfo>(graph_, dom_tree);
+        loop_info_->run();
+        markComputed(Analysis::Loops);
+    }
+    return *loop_info_;
+}
+
+void AnalysisManager::require(AnalysisSet analyses) {
+    for (unsigned i = 0; i < kNumAnalyses; ++i) {
+        if ((analyses & (AnalysisSet(1) << i)) == 0) {
+            continue;
+        }
+        switch (Analysis(i)) {
+            case Analysis::Predecessors:
+                requirePredecessors();
+                break;
+            case Analysis::ReversePostOrder:
+                getRPO();
+                break;
+            case Analysis::Dominators:
+                getDominatorTree();
+                break;
+            case Analysis::PostDominators:
+                getPostDominatorTree();
+                break;
+            case Analysis::DominanceFrontier:
+                getDominanceFrontier();
+                break;
+            case Analysis::ControlDependence:
+                getControlDependence();
+                break;
+            case Analysis::Loops:
+                getLoopInfo();
+                break;
+        }
+    }
+}
+
+void AnalysisManager::invalidate(const PreservedAnalyses& preserved) {
+    // Dependencies come first, so one pass in enum order sees their final state
+    AnalysisSet kept = 0;
+    for (unsigned i = 0; i < kNumAnalyses; ++i) {
+        AnalysisSet bit = AnalysisSet(1) << i;
+        if ((cached_ & bit) != 0 && (preserved.getSet() & bit) != 0 &&
+            (kDependencies[i] & ~kept) == 0) {
+            kept |= bit;
+        }
+    }
+    cached_ = kept;
+    // Release dependents before what they point into
+    if (!isCached(Analysis::Loops)) {
+        loop_info_.reset();
+    }
+    if (!isCached(Analysis::ControlDependence)) {
+        control_dependence_.reset();
+    }
+    if (!isCached(Analysis::DominanceFrontier)) {
+        frontier_.reset();
+    }
+    if (!isCached(Analysis::PostDominators)) {
+        post_dom_tree_.reset();
+    }
+    if (!isCached(Analysis::Dominators)) {
+        dom_tree_.reset();
+    }
+    if (!isCached(Analysis::ReversePostOrder)) {
+        rpo_.reset();
+    }
+}
+
+PreservedAnalyses PassManager::run(Graph& g, AnalysisManager& am) {
+    PreservedAnalyses pipeline = PreservedAnalyses::all();
+    for (auto& pass : passes_) {
+        am.require(pass->getRequiredAnalyses());
+        PreservedAnalyses preserved = pass->run(g, am);
+        if (verify_analyses_) {
+            verifyPreserved(*pass, preserved, am);
+        }
+        AnalysisSet cached = am.getCached();
+        am.invalidate(preserved);
+        if (trace_ != nullptr) {
+            *trace_ << pass->getName();
+            AnalysisSet dropped = cached & ~am.getCached();
+            for (unsigned i = 0; i < kNumAnalyses; ++i) {
+                if ((dropped & (AnalysisSet(1) << i)) != 0) {
+                    *trace_ << " -" << kAnalysisNames[i];
+                }
+            }
+            *trace_ << "\n";
+        }
+        pipeline.intersect(preserved);
+    }
+    return pipeline;
+}
+
+void PassManager::verifyPreserved(const FunctionPass& pass, const PreservedAnalyses& preserved,
+                                  AnalysisManager& am) const {
+    // Only trees the pass keeps, together with the predecessor lists they were built from
+    auto kept = [&](Analysis analysis) {
+        return am.isCached(analysis) && preserved.isPreserved(analysis) &&
+               preserved.isPreserved(Analysis::Predecessors);
+    };
+    bool ok = true;
+    if (kept(Analysis::Dominators)) {
+        ok &= am.getDominatorTree().verify(&std::cerr);
+    }
+    if (kept(Analysis::PostDominators)) {
+        ok &= am.getPostDominatorTree().verify(&std::cerr);
+    }
+    if (!ok) {
+        std::cerr << "Pass " << pass.getName() << " broke a dominator tree it preserved\n";
+        std::abort();
+    }
+}
@@ -0,0 +1,308 @@
+#include "sccp.h"
+
+bool SCCP::run() {
+    num_folded_values_ = 0;
+    num_folded_branches_ = 0;
+    num_removed_blocks_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+    size_t num_blocks = graph_->getBasicBlocks().size();
+    values_.assign(graph_->getNumInsts(), Value());
+    executable_.assign(num_blocks, 0);
+    feasible_succs_.assign(num_blocks, 0);
+
+    executable_[graph_->getStartBlock()->getId()] = 1;
+    block_worklist_.push_back(graph_->getStartBlock());
+    for (;;) {
+        solve();
+        // A branch on a value that never got defined takes its false edge, like a branch on
+        // an uninitialized variable may; then the solver continues from there
+        bool resolved = false;
+        for (BasicBlock* bb : graph_->getBasicBlocks()) {
+            Inst* terminator = bb->getTerminator();
+            if (!executable_[bb->getId()] || feasible_succs_[bb->getId()] != 0 ||
+                terminator == nullptr || terminator->getOpcode() != Opcode::COND_JUMP) {
+                continue;
+            }
+            markEdge(bb, 1);
+            resolved = true;
+        }
+        if (!resolved) {
+            break;
+        }
+    }
+    return rewrite();
+}
+
+void SCCP::solve() {
+    while (!value_worklist_.empty() || !block_worklist_.empty()) {
+        while (!value_worklist_.empty()) {
+            Inst* inst = value_worklist_.back();
+            value_worklist_.pop_back();
+            for (Use* use = inst->getFirstUse(); use != nullptr; use = use->getNext()) {
+                BasicBlock* parent = use->getUser()->getParent();
+                if (parent != nullptr && executable_[parent->getId()]) {
+                    visit(use->getUser());
+                }
+            }
+        }
+        if (!block_worklist_.empty()) {
+            BasicBlock* bb = block_worklist_.back();
+            block_worklist_.pop_back();
+            for (Inst* inst : bb->getInstructions()) {
+                visit(inst);
+            }
+        }
+    }
+}
+
+void SCCP::visit(Inst* inst) {
+    switch (inst->getOpcode()) {
+        case Opcode::CONST:
+            lower(inst, {Lattice::Constant, static_cast<ConstInst*>(inst)->getValue()});
+            break;
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::CMP: {
+            Value lhs = getValue(inst->getOperand(0));
+            Value rhs = getValue(inst->getOperand(1));
+            auto isZero = [](Value v) { return v.state == Lattice::Constant && v.constant == 0; };
+            if (inst->getOpcode() == Opcode::MUL && (isZero(lhs) || isZero(rhs))) {
+                lower(inst, {Lattice::Constant, 0});
+            } else if (lhs.state == Lattice::Overdefined || rhs.state == Lattice::Overdefined) {
+                lower(inst, {Lattice::Overdefined, 0});
+            } else if (lhs.state == Lattice::Constant && rhs.state == Lattice::Constant) {
+                uint64_t a = lhs.constant;
+                uint64_t b = rhs.constant;
+                int64_t result = inst->getOpcode() == Opcode::ADD   ? int64_t(a + b)
+                                 : inst->getOpcode() == Opcode::MUL ? int64_t(a * b)
+                                                                    : lhs.constant <= rhs.constant;
+                lower(inst, {Lattice::Constant, result});
+            }
+            break;
+        }
+        case Opcode::CAST: {
+            Value value = getValue(inst->getOperand(0));
+            if (value.state == Lattice::Constant) {
+                unsigned bits = static_cast<CastInst*>(inst)->getBits();
+                value.constant = CastInst::apply(value.constant, bits);
+            }
+            lower(inst, value);
+            break;
+        }
+        case Opcode::PHI:
+            visitPhi(static_cast<PhiInst*>(inst));
+            break;
+        case Opcode::JUMP:
+            markEdge(inst->getParent(), 0);
+            break;
+        case Opcode::COND_JUMP:
+            visitCondJump(static_cast<CondJumpInst*>(inst));
+            break;
+        case Opcode::RETURN:
+        case Opcode::STORE:
+        case Opcode::ALLOCA:
+            break;
+        default:  // PARAM, LOAD and MOV: nothing is known about the value
+            lower(inst, {Lattice::Overdefined, 0});
+            break;
+    }
+}
+
+void SCCP::visitPhi(PhiInst* phi) {
+    if (getValue(phi).state == Lattice::Overdefined) {
+        return;
+    }
+    Value result;
+    for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+        if (!isEdgeFeasible(phi->getIncomingBlock(i), phi->getParent())) {
+            continue;
+        }
+        Value value = getValue(phi->getIncomingValue(i));
+        if (value.state == Lattice::Unknown) {
+            continue;
+        }
+        if (value.state == Lattice::Overdefined ||
+            (result.state == Lattice::Constant && result.constant != value.constant)) {
+            lower(phi, {Lattice::Overdefined, 0});
+            return;
+        }
+        result = value;
+    }
+    lower(phi, result);
+}
+
+void SCCP::visitCondJump(CondJumpInst* jump) {
+    Value cond = getValue(jump->getOperand(0));
+    if (cond.state == Lattice::Constant) {
+        markEdge(jump->getParent(), cond.constant != 0 ? 0 : 1);
+    } else if (cond.state == Lattice::Overdefined) {
+        markEdge(jump->getParent(), 0);
+        markEdge(jump->getParent(), 1);
+    }
+}
+
+void SCCP::lower(Inst* inst, Value value) {
+    Value& current = values_[inst->getId()];
+    if (value.state == Lattice::Unknown || current.state == Lattice::Overdefined) {
+        return;
+    }
+    if (current.state == Lattice::Constant) {
+        if (value.state == Lattice::Constant && value.constant == current.constant) {
+            return;
+        }
+        value.state = Lattice::Overdefined;
+    }
+    current = value;
+    value_worklist_.push_back(inst);
+}
+
+void SCCP::markEdge(BasicBlock* from, unsigned succ_index) {
+    uint8_t& feasible = feasible_succs_[from->getId()];
+    if ((feasible & (1u << succ_index)) != 0) {
+        return;
+    }
+    feasible |= 1u << succ_index;
+    BasicBlock* to = from->getSuccessor(succ_index);
+    if (!executable_[to->getId()]) {
+        executable_[to->getId()] = 1;
+        block_worklist_.push_back(to);
+        return;
+    }
+    // The block was evaluated already; only its phis see the new edge. Phis lead the block.
+    for (Inst* inst : to->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            break;
+        }
+        visitPhi(static_cast<PhiInst*>(inst));
+    }
+}
+
+bool SCCP::isEdgeFeasible(const BasicBlock* from, const BasicBlock* to) const {
+    unsigned feasible = feasible_succs_[from->getId()];
+    Span<BasicBlock* const> succs = from->getSuccessors();
+    for (unsigned i = 0; i < succs.size(); ++i) {
+        if ((feasible & (1u << i)) != 0 && succs[i] == to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SCCP::rewrite() {
+    bool changed = false;
+    // Dead edges are found from the original terminators, so prune the phis first
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        if (executable_[bb->getId()]) {
+            removeDeadIncoming(bb);
+        }
+    }
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        if (executable_[bb->getId()]) {
+            changed |= foldInstructions(bb);
+        }
+    }
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        num_removed_blocks_ += !executable_[bb->getId()];
+    }
+    if (num_removed_blocks_ != 0) {
+        graph_->removeBasicBlocksIf([this](BasicBlock* bb) { return !executable_[bb->getId()]; });
+    }
+    if (num_folded_branches_ != 0 || num_removed_blocks_ != 0) {
+        graph_->buildPredecessors();
+        changed = true;
+    }
+    return changed;
+}
+
+void SCCP::removeDeadIncoming(BasicBlock* bb) {
+    for (Inst* inst : bb->getInstructions()) {
+        if (inst->getOpcode() != Opcode::PHI) {
+            break;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        for (unsigned i = phi->getNumIncoming(); i-- > 0;) {
+            if (!isEdgeFeasible(phi->getIncomingBlock(i), bb)) {
+                phi->removeIncoming(i);
+            }
+        }
+    }
+}
+
+bool SCCP::foldInstructions(BasicBlock* bb) {
+    Inst* terminator = bb->getTerminator();
+    if (terminator == nullptr) {
+        return false;
+    }
+    bool changed = false;
+    // The terminator goes first, so that a folded condition has no use left and is dropped
+    unsigned feasible = feasible_succs_[bb->getId()];
+    Inst* dead_cond = nullptr;
+    if (terminator->getOpcode() == Opcode::COND_JUMP && (feasible == 1 || feasible == 2)) {
+        auto* cond_jump = static_cast<CondJumpInst*>(terminator);
+        dead_cond = cond_jump->getOperand(0);
+        terminator = graph_->createInst<JumpInst>(
+            nullptr, feasible == 1 ? cond_jump->getTrueTarget() : cond_jump->getFalseTarget());
+        cond_jump->dropAllReferences();
+        ++num_folded_branches_;
+        changed = true;
+    }
+
+    std::vector<Inst*> phis;
+    std::vector<Inst*> body;
+    Span<Inst* const> insts = bb->getInstructions();
+    for (size_t i = 0; i + 1 < insts.size(); ++i) {
+        Inst* inst = insts[i];
+        Value value = getValue(inst);
+        // Like the constants main.cpp branches on
+        if (inst == dead_cond && inst->getOpcode() == Opcode::CONST && !inst->hasUses()) {
+            changed = true;
+            continue;
+        }
+        if (value.state == Lattice::Constant && inst->getOpcode() != Opcode::CONST) {
+            if (inst->hasUses()) {
+                Inst* constant = graph_->createInst<ConstInst>(nullptr, value.constant);
+                inst->replaceAllUsesWith(constant);
+                body.push_back(constant);
+            }
+            inst->dropAllReferences();
+            ++num_folded_values_;
+            changed = true;
+            continue;
+        }
+        if (inst->getOpcode() != Opcode::PHI) {
+            body.push_back(inst);
+            continue;
+        }
+        auto* phi = static_cast<PhiInst*>(inst);
+        if (phi->getNumIncoming() == 1 && phi->getIncomingValue(0) != phi) {
+            phi->replaceAllUsesWith(phi->getIncomingValue(0));
+            phi->dropAllReferences();
+            changed = true;
+            continue;
+        }
+        phis.push_back(phi);
+    }
+    if (!changed) {
+        return false;
+    }
+    // Constants of folded phis start the body, so they end up right after the other phis
+    phis.insert(phis.end(), body.begin(), body.end());
+    phis.push_back(terminator);
+    bb->removeInstructionsIf([](Inst*) { return true; });
+    bb->insertInstructions(0, Span<Inst* const>(phis.data(), phis.size()));
+    return true;
+}
+
+PreservedAnalyses SCCPPass::run(Graph& g, AnalysisManager& /*am*/) {
+    SCCP sccp(&g);
+    if (!sccp.run()) {
+        return PreservedAnalyses::all();
+    }
+    if (sccp.getNumFoldedBranches() == 0 && sccp.getNumRemovedBlocks() == 0) {
+        return PreservedAnalyses::cfg();
+    }
+    // The predecessor lists were rebuilt
+    return PreservedAnalyses::none().preserve(Analysis::Predecessors);
+}
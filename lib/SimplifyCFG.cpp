@@ -0,0 +1,212 @@
+#include "simplify_cfg.h"
+
+#include <algorithm>
+
+namespace {
+
+// Targets of a terminator, like BasicBlock::getSuccessors
+Span<BasicBlock* const> getTargets(const Inst* terminator) {
+    switch (terminator->getOpcode()) {
+        case Opcode::JUMP:
+            return static_cast<const JumpInst*>(terminator)->getTargets();
+        case Opcode::COND_JUMP:
+            return static_cast<const CondJumpInst*>(terminator)->getTargets();
+        default:
+            return {};
+    }
+}
+
+bool startsWithPhi(const BasicBlock* bb) {
+    Span<Inst* const> insts = bb->getInstructions();
+    return !insts.empty() && insts[0]->getOpcode() == Opcode::PHI;
+}
+
+}  // namespace
+
+bool SimplifyCFG::run() {
+    num_removed_blocks_ = 0;
+    num_forwarded_blocks_ = 0;
+    num_merged_blocks_ = 0;
+    if (graph_->getStartBlock() == nullptr) {
+        return false;
+    }
+    // Bypassed and merged blocks become unreachable and go in the next round's sweep
+    for (;;) {
+        bool changed = removeUnreachableBlocks();
+        graph_->buildPredecessors();
+        size_t num_blocks = graph_->getBasicBlocks().size();
+        dead_.assign(num_blocks, 0);
+        replacement_.assign(num_blocks, nullptr);
+        for (BasicBlock* bb : graph_->getBasicBlocks()) {
+            changed |= forwardBlock(bb);
+        }
+        for (BasicBlock* bb : graph_->getBasicBlocks()) {
+            changed |= mergeSuccessors(bb);
+        }
+        if (!changed) {
+            break;
+        }
+        renamePhiInputs();
+    }
+    bool renumbered = graph_->compactInstIds();
+    return hasChangedCFG() || renumbered;
+}
+
+bool SimplifyCFG::removeUnreachableBlocks() {
+    const auto& blocks = graph_->getBasicBlocks();
+    reachable_.assign(blocks.size(), 0);
+    reachable_[graph_->getStartBlock()->getId()] = 1;
+    stack_.push_back(graph_->getStartBlock());
+    while (!stack_.empty()) {
+        BasicBlock* bb = stack_.back();
+        stack_.pop_back();
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (!reachable_[succ->getId()]) {
+                reachable_[succ->getId()] = 1;
+                stack_.push_back(succ);
+            }
+        }
+    }
+    unsigned num_unreachable = std::count(reachable_.begin(), reachable_.end(), 0);
+    if (num_unreachable == 0) {
+        return false;
+    }
+
+    for (BasicBlock* bb : blocks) {
+        if (!reachable_[bb->getId()]) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                break;
+            }
+            auto* phi = static_cast<PhiInst*>(inst);
+            for (unsigned i = phi->getNumIncoming(); i-- > 0;) {
+                if (!reachable_[phi->getIncomingBlock(i)->getId()]) {
+                    phi->removeIncoming(i);
+                }
+            }
+        }
+    }
+    graph_->removeBasicBlocksIf([this](BasicBlock* bb) { return !reachable_[bb->getId()]; });
+    num_removed_blocks_ += num_unreachable;
+    return true;
+}
+
+bool SimplifyCFG::forwardBlock(BasicBlock* bb) {
+    Span<Inst* const> insts = bb->getInstructions();
+    if (bb == graph_->getStartBlock() || dead_[bb->getId()] || insts.size() != 1 ||
+        insts[0]->getOpcode() != Opcode::JUMP) {
+        return false;
+    }
+    BasicBlock* target = static_cast<JumpInst*>(insts[0])->getTarget();
+    std::vector<BasicBlock*> preds = bb->getPredecessors();
+    if (target == bb || preds.empty()) {
+        return false;
+    }
+    if (startsWithPhi(target)) {
+        Span<BasicBlock* const> pred_succs = preds[0]->getSuccessors();
+        if (preds.size() != 1 ||
+            std::find(pred_succs.begin(), pred_succs.end(), target) != pred_succs.end()) {
+            return false;
+        }
+        replacement_[bb->getId()] = preds[0];
+    }
+
+    target->removePredecessor(bb);
+    for (BasicBlock* pred : preds) {
+        pred->replaceSuccessor(bb, target);
+        target->addPredecessor(pred);
+    }
+    bb->clearPredecessors();
+    dead_[bb->getId()] = 1;
+    ++num_forwarded_blocks_;
+    return true;
+}
+
+bool SimplifyCFG::mergeSuccessors(BasicBlock* bb) {
+    if (dead_[bb->getId()]) {
+        return false;
+    }
+    // The merged chain is assembled here and stored in bb once, so long chains stay linear
+    std::vector<Inst*> insts;
+    Inst* jump = bb->getTerminator();
+    while (jump != nullptr && jump->getOpcode() == Opcode::JUMP) {
+        BasicBlock* succ = static_cast<JumpInst*>(jump)->getTarget();
+        if (succ == bb || succ == graph_->getStartBlock() ||
+            succ->getPredecessors().size() != 1) {
+            break;
+        }
+        if (insts.empty()) {
+            Span<Inst* const> own = bb->getInstructions();
+            insts.assign(own.begin(), own.end());
+        }
+        insts.pop_back();
+
+        // The phis have bb as their only input
+        for (Inst* inst : succ->getInstructions()) {
+            if (inst->getOpcode() == Opcode::PHI) {
+                inst->replaceAllUsesWith(inst->getOperand(0));
+                inst->dropAllReferences();
+            } else {
+                insts.push_back(inst);
+            }
+        }
+        succ->removeInstructionsIf([](Inst*) { return true; });
+
+        jump = insts.back();
+        Span<BasicBlock* const> succs = getTargets(jump);
+        for (BasicBlock* next : succs) {
+            next->removePredecessor(succ);
+        }
+        for (BasicBlock* next : succs) {
+            next->addPredecessor(bb);
+        }
+        succ->clearPredecessors();
+        dead_[succ->getId()] = 1;
+        replacement_[succ->getId()] = bb;
+        ++num_merged_blocks_;
+    }
+    if (insts.empty()) {
+        return false;
+    }
+    bb->removeInstructionsIf([](Inst*) { return true; });
+    bb->insertInstructions(0, Span<Inst* const>(insts.data(), insts.size()));
+    return true;
+}
+
+void SimplifyCFG::renamePhiInputs() {
+    // A block merged into one that was merged in turn is renamed along the chain
+    auto resolve = [this](BasicBlock* bb) {
+        while (replacement_[bb->getId()] != nullptr) {
+            bb = replacement_[bb->getId()];
+        }
+        return bb;
+    };
+    for (BasicBlock* bb : graph_->getBasicBlocks()) {
+        if (dead_[bb->getId()]) {
+            continue;
+        }
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                break;
+            }
+            auto* phi = static_cast<PhiInst*>(inst);
+            for (unsigned i = 0; i < phi->getNumIncoming(); ++i) {
+                phi->setIncomingBlock(i, resolve(phi->getIncomingBlock(i)));
+            }
+        }
+    }
+}
+
+PreservedAnalyses SimplifyCFGPass::run(Graph& g, AnalysisManager& /*am*/) {
+    SimplifyCFG simplify(&g);
+    if (!simplify.run()) {
+        return PreservedAnalyses::all();
+    }
+    if (!simplify.hasChangedCFG()) {
+        return PreservedAnalyses::cfg();
+    }
+    // The predecessor lists were rebuilt
+    return PreservedAnalyses::none().preserve(Analysis::Predecessors);
+}
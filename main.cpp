@@ -1,3 +1,5 @@
+#include <map>
+
 #include "IR.h"
 #include "dominators.h"
 int main() {
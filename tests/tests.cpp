@@ -1,7 +1,38 @@
 #include "gtest/gtest.h"
 #include "IR.h"
+#include "adce.h"
+#include "binary_ir.h"
+#include "cfg_traversal.h"
+#include "control_dependence.h"
+#include "dominance_frontier.h"
 #include "dominators.h"
+#include "gvn.h"
+#include "ind_var_simplify.h"
+#include "induction_variables.h"
+#include "interpreter.h"
+#include "ir_parser.h"
+#include "jit.h"
+#include "licm.h"
+#include "linear_scan.h"
+#include "liveness.h"
+#include "loop_info.h"
+#include "mem2reg.h"
+#include "module.h"
+#include "out_of_ssa.h"
+#include "parallel_for.h"
+#include "pass_manager.h"
+#include "sccp.h"
+#include "simplify_cfg.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <map>
+#include <random>
+#include <set>
+#include <sstream>
 #include <string>
 
 using BlockMap = std::map<char, BasicBlock*>;
@@ -108,6 +139,83 @@ BlockMap buildNewExample3(Graph& g) {
     return blocks;
 }
 
+struct FactorialIR {
+    BasicBlock* entry;
+    BasicBlock* header;
+    BasicBlock* body;
+    BasicBlock* exit;
+    Inst* n;
+    PhiInst* res_phi;
+    PhiInst* i_phi;
+    Inst* cmp;
+    Inst* res_new;
+    Inst* const_1;
+    Inst* i_new;
+    Inst* ret;
+};
+
+// The factorial function from main.cpp / README.md
+FactorialIR buildFactorial(Graph& g) {
+    FactorialIR f;
+    f.entry = g.createBB("entry");
+    f.header = g.createBB("loop.header");
+    f.body = g.createBB("loop.body");
+    f.exit = g.createBB("exit");
+    g.setStartBlock(f.entry);
+
+    f.n = g.createInst<ParamInst>(f.entry, 0);
+    Inst* res_init = g.createInst<ConstInst>(f.entry, 1);
+    Inst* i_init = g.createInst<ConstInst>(f.entry, 2);
+    g.createInst<JumpInst>(f.entry, f.header);
+
+    f.res_phi = g.createInst<PhiInst>(f.header);
+    f.i_phi = g.createInst<PhiInst>(f.header);
+    f.cmp = g.createInst<BinaryInst>(f.header, Opcode::CMP, f.i_phi, f.n);
+    g.createInst<CondJumpInst>(f.header, f.cmp, f.body, f.exit);
+
+    f.res_new = g.createInst<BinaryInst>(f.body, Opcode::MUL, f.res_phi, f.i_phi);
+    f.const_1 = g.createInst<ConstInst>(f.body, 1);
+    f.i_new = g.createInst<BinaryInst>(f.body, Opcode::ADD, f.i_phi, f.const_1);
+    g.createInst<JumpInst>(f.body, f.header);
+
+    f.res_phi->addIncoming(res_init, f.entry);
+    f.res_phi->addIncoming(f.res_new, f.body);
+    f.i_phi->addIncoming(i_init, f.entry);
+    f.i_phi->addIncoming(f.i_new, f.body);
+
+    f.ret = g.createInst<ReturnInst>(f.exit, f.res_phi);
+    g.buildPredecessors();
+    return f;
+}
+
+// Random CFG where every block branches to up to two arbitrary blocks, producing loops,
+// irreducible regions and unreachable blocks
+void buildRandomGraph(Graph& g, unsigned num_blocks, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<BasicBlock*> blocks;
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        blocks.push_back(g.createBB());
+    }
+    g.setStartBlock(blocks[0]);
+    std::uniform_int_distribution<unsigned> pick(0, num_blocks - 1);
+    for (auto* bb : blocks) {
+        switch (rng() % 4) {
+            case 0:
+                g.createInst<ReturnInst>(bb);
+                break;
+            case 1:
+                g.createInst<JumpInst>(bb, blocks[pick(rng)]);
+                break;
+            default: {
+                Inst* cond = g.createInst<ConstInst>(bb, 1);
+                g.createInst<CondJumpInst>(bb, cond, blocks[pick(rng)], blocks[pick(rng)]);
+                break;
+            }
+        }
+    }
+    g.buildPredecessors();
+}
+
 // =============================================================================
 // GTest Test Cases
 // =============================================================================
@@ -169,6 +277,3316 @@ TEST(DominatorTreeSuite, CorrectedExample3) {
     EXPECT_EQ(dom_tree.getImmediateDominator(blocks['I']), blocks['B']);
 }
 
+TEST(DominatorTreeSuite, ChildrenAndUnreachableBlocks) {
+    Graph g("Example 1");
+    BlockMap blocks = buildNewExample1(g);
+    BasicBlock* dead = g.createBB("dead");
+    g.createInst<JumpInst>(dead, blocks['D']);
+
+    g.buildPredecessors();
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    auto children = dom_tree.getChildren(blocks['B']);
+    ASSERT_EQ(children.size(), 3u);
+    EXPECT_EQ(children[0], blocks['C']);
+    EXPECT_EQ(children[1], blocks['D']);
+    EXPECT_EQ(children[2], blocks['F']);
+    EXPECT_TRUE(dom_tree.getChildren(blocks['D']).empty());
+
+    // Edges out of unreachable blocks must not influence reachable dominators
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['D']), blocks['B']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(dead), nullptr);
+    EXPECT_FALSE(dom_tree.dominates(blocks['A'], dead));
+    EXPECT_TRUE(dom_tree.dominates(blocks['F'], blocks['E']));
+    EXPECT_FALSE(dom_tree.dominates(blocks['C'], blocks['D']));
+}
+
+// Reference dominance check that walks the idom chain
+static bool dominatesByWalk(const DominatorTree& dom_tree, BasicBlock* a, BasicBlock* b) {
+    for (BasicBlock* cur = b; cur != nullptr; cur = dom_tree.getImmediateDominator(cur)) {
+        if (cur == a) {
+            return true;
+        }
+        if (dom_tree.getImmediateDominator(cur) == cur) {
+            break;
+        }
+    }
+    return false;
+}
+
+TEST(DominatorTreeSuite, IntervalQueriesMatchIdomWalk) {
+    for (auto* build : {&buildNewExample1, &buildNewExample2, &buildNewExample3}) {
+        Graph g("intervals");
+        build(g);
+        g.buildPredecessors();
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+
+        std::vector<std::pair<BasicBlock*, BasicBlock*>> queries;
+        for (auto* a : g.getBasicBlocks()) {
+            for (auto* b : g.getBasicBlocks()) {
+                EXPECT_EQ(dom_tree.dominates(a, b), dominatesByWalk(dom_tree, a, b));
+                queries.push_back({a, b});
+            }
+        }
+        std::vector<bool> batch = dom_tree.dominates(queries);
+        ASSERT_EQ(batch.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            EXPECT_EQ(batch[i], dom_tree.dominates(queries[i].first, queries[i].second));
+        }
+
+        // The nearest common dominator dominates both and none of its children does
+        for (auto* a : g.getBasicBlocks()) {
+            for (auto* b : g.getBasicBlocks()) {
+                BasicBlock* ncd = dom_tree.findNearestCommonDominator(a, b);
+                ASSERT_NE(ncd, nullptr);
+                EXPECT_TRUE(dom_tree.dominates(ncd, a));
+                EXPECT_TRUE(dom_tree.dominates(ncd, b));
+                for (auto* child : dom_tree.getChildren(ncd)) {
+                    EXPECT_FALSE(dom_tree.dominates(child, a) && dom_tree.dominates(child, b));
+                }
+            }
+        }
+    }
+}
+
+TEST(DominatorTreeSuite, NearestCommonDominatorOnDeepTree) {
+    // A chain of diamonds: every join block is dominated by the previous one
+    Graph g("diamonds");
+    BasicBlock* join = g.createBB("entry");
+    g.setStartBlock(join);
+    std::vector<BasicBlock*> joins = {join};
+    std::vector<BasicBlock*> lefts;
+    for (int i = 0; i < 300; ++i) {
+        BasicBlock* left = g.createBB();
+        BasicBlock* right = g.createBB();
+        BasicBlock* next = g.createBB();
+        auto* cond = g.createInst<ConstInst>(join, 1);
+        g.createInst<CondJumpInst>(join, cond, left, right);
+        g.createInst<JumpInst>(left, next);
+        g.createInst<JumpInst>(right, next);
+        lefts.push_back(left);
+        joins.push_back(next);
+        join = next;
+    }
+    g.createInst<ReturnInst>(join);
+    g.buildPredecessors();
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    EXPECT_EQ(dom_tree.getDepth(joins[300]), 300u);
+    EXPECT_EQ(dom_tree.findNearestCommonDominator(lefts[7], lefts[250]), joins[7]);
+    EXPECT_EQ(dom_tree.findNearestCommonDominator(joins[300], lefts[0]), joins[0]);
+    EXPECT_EQ(dom_tree.findNearestCommonDominator(joins[120], joins[121]), joins[120]);
+    EXPECT_TRUE(dom_tree.dominates(joins[3], lefts[299]));
+    EXPECT_FALSE(dom_tree.dominates(lefts[3], joins[4]));
+}
+
+template <typename Tree>
+static void expectSameTrees(Graph& g, const Tree& expected, const Tree& actual) {
+    for (auto* bb : g.getBasicBlocks()) {
+        // Post-dominator trees each own their virtual exit, so compare block ids
+        BasicBlock* expected_idom = expected.getImmediateDominator(bb);
+        BasicBlock* actual_idom = actual.getImmediateDominator(bb);
+        ASSERT_EQ(expected_idom == nullptr, actual_idom == nullptr) << "BB" << bb->getId();
+        if (expected_idom != nullptr) {
+            ASSERT_EQ(expected_idom->getId(), actual_idom->getId()) << "BB" << bb->getId();
+        }
+        auto expected_children = expected.getChildren(bb);
+        auto actual_children = actual.getChildren(bb);
+        ASSERT_EQ(std::vector<BasicBlock*>(expected_children.begin(), expected_children.end()),
+                  std::vector<BasicBlock*>(actual_children.begin(), actual_children.end()));
+    }
+}
+
+TEST(DominatorTreeSuite, SemiNCAMatchesIterative) {
+    for (auto* build : {&buildNewExample1, &buildNewExample2, &buildNewExample3}) {
+        Graph g("examples");
+        build(g);
+        g.buildPredecessors();
+        DominatorTree iterative(&g, DomAlgorithm::CooperHarveyKennedy);
+        DominatorTree semi_nca(&g, DomAlgorithm::SemiNCA);
+        iterative.run();
+        semi_nca.run();
+        expectSameTrees(g, iterative, semi_nca);
+    }
+
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 1 + seed % 97, seed);
+        DominatorTree iterative(&g, DomAlgorithm::CooperHarveyKennedy);
+        DominatorTree semi_nca(&g, DomAlgorithm::SemiNCA);
+        iterative.run();
+        semi_nca.run();
+        expectSameTrees(g, iterative, semi_nca);
+    }
+}
+
+TEST(DominatorTreeSuite, SemiNCAOnIrreducibleExample) {
+    Graph g("Example 3");
+    BlockMap blocks = buildNewExample3(g);
+    g.buildPredecessors();
+    DominatorTree dom_tree(&g, DomAlgorithm::SemiNCA);
+    dom_tree.run();
+
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['A']), blocks['A']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['C']), blocks['B']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['D']), blocks['B']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['G']), blocks['B']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['H']), blocks['F']);
+    EXPECT_TRUE(dom_tree.dominates(blocks['E'], blocks['H']));
+}
+
+// Retargets one edge of a random CondJump and returns the matching edge updates
+static std::vector<CFGUpdate> retargetRandomEdge(Graph& g, std::mt19937& rng) {
+    const auto& blocks = g.getBasicBlocks();
+    Inst* term = blocks[rng() % blocks.size()]->getTerminator();
+    if (term == nullptr || term->getOpcode() != Opcode::COND_JUMP) {
+        return {};
+    }
+    auto* jump = static_cast<CondJumpInst*>(term);
+    BasicBlock* bb = jump->getParent();
+    BasicBlock* target = blocks[rng() % blocks.size()];
+    BasicBlock* old_target = jump->getTrueTarget();
+    BasicBlock* other = jump->getFalseTarget();
+
+    std::vector<CFGUpdate> updates;
+    if (rng() % 4 == 0) {
+        // Split the edge with a fresh block instead
+        target = g.createBB("split");
+        g.createInst<JumpInst>(target, old_target);
+        updates.push_back({CFGUpdateKind::Insert, target, old_target});
+    }
+    jump->setTrueTarget(target);
+    if (old_target != other) {
+        updates.push_back({CFGUpdateKind::Delete, bb, old_target});
+    }
+    if (target != other) {
+        updates.push_back({CFGUpdateKind::Insert, bb, target});
+    }
+    return updates;
+}
+
+// Predecessor lists as sets must match the terminators
+static void expectPredecessorsMatchSuccessors(Graph& g) {
+    std::vector<std::set<BasicBlock*>> expected(g.getBasicBlocks().size());
+    for (auto* bb : g.getBasicBlocks()) {
+        for (auto* succ : bb->getSuccessors()) {
+            expected[succ->getId()].insert(bb);
+        }
+    }
+    for (auto* bb : g.getBasicBlocks()) {
+        const auto& preds = bb->getPredecessors();
+        ASSERT_EQ(std::set<BasicBlock*>(preds.begin(), preds.end()), expected[bb->getId()])
+            << "BB" << bb->getId();
+    }
+}
+
+TEST(DominatorTreeSuite, IncrementalUpdatesMatchRecompute) {
+    for (uint32_t seed = 1; seed <= 40; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 100 + seed * 7, seed);
+        DominatorTree dom_tree(&g, seed % 2 ? DomAlgorithm::SemiNCA
+                                            : DomAlgorithm::CooperHarveyKennedy);
+        dom_tree.run();
+
+        std::mt19937 rng(seed);
+        for (int batch = 0; batch < 30; ++batch) {
+            std::vector<CFGUpdate> updates;
+            for (unsigned edits = 1 + rng() % 3; edits > 0; --edits) {
+                for (const CFGUpdate& update : retargetRandomEdge(g, rng)) {
+                    updates.push_back(update);
+                }
+            }
+            dom_tree.applyUpdates(updates);
+            expectPredecessorsMatchSuccessors(g);
+
+            DominatorTree fresh(&g);
+            fresh.run();
+            ASSERT_TRUE(dom_tree.verify(&std::cerr)) << "seed " << seed << " batch " << batch;
+            expectSameTrees(g, fresh, dom_tree);
+            const auto& blocks = g.getBasicBlocks();
+            for (int q = 0; q < 50; ++q) {
+                BasicBlock* a = blocks[rng() % blocks.size()];
+                BasicBlock* b = blocks[rng() % blocks.size()];
+                ASSERT_EQ(dom_tree.dominates(a, b), fresh.dominates(a, b));
+                ASSERT_EQ(dom_tree.findNearestCommonDominator(a, b),
+                          fresh.findNearestCommonDominator(a, b));
+            }
+        }
+    }
+}
+
+TEST(DominatorTreeSuite, DeletingTheOnlyEntryDropsTheRegion) {
+    Graph g("Example 1");
+    BlockMap blocks = buildNewExample1(g);
+    g.buildPredecessors();
+    DominatorTree dom_tree(&g);
+    dom_tree.setVerifyUpdates(true);
+    dom_tree.run();
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['D']), blocks['B']);
+
+    // B -> {C, F} becomes B -> {C, C}: F, G and E become unreachable, D is left with C
+    static_cast<CondJumpInst*>(blocks['B']->getTerminator())->setFalseTarget(blocks['C']);
+    dom_tree.applyUpdates({{CFGUpdateKind::Delete, blocks['B'], blocks['F']}});
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['F']), nullptr);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['G']), nullptr);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['E']), nullptr);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['D']), blocks['C']);
+    EXPECT_TRUE(blocks['F']->getPredecessors().empty());
+
+    // And back again
+    static_cast<CondJumpInst*>(blocks['B']->getTerminator())->setFalseTarget(blocks['F']);
+    dom_tree.applyUpdates({{CFGUpdateKind::Insert, blocks['B'], blocks['F']}});
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['E']), blocks['F']);
+    EXPECT_EQ(dom_tree.getImmediateDominator(blocks['D']), blocks['B']);
+    EXPECT_TRUE(dom_tree.dominates(blocks['F'], blocks['G']));
+
+    DominatorTree fresh(&g);
+    fresh.run();
+    std::ostringstream expected;
+    std::ostringstream actual;
+    fresh.dump(expected);
+    dom_tree.dump(actual);
+    EXPECT_EQ(actual.str(), expected.str());
+}
+
+TEST(PostDominatorTreeSuite, FactorialAndInfiniteLoop) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    // A self-loop that never returns is not in the post-dominator tree
+    BasicBlock* spin = g.createBB("spin");
+    g.createInst<JumpInst>(spin, spin);
+    g.buildPredecessors();
+
+    PostDominatorTree pdt(&g);
+    pdt.run();
+    BasicBlock* exit = pdt.getRoot();
+    ASSERT_NE(exit, nullptr);
+    EXPECT_EQ(pdt.getImmediateDominator(exit), exit);
+    EXPECT_EQ(pdt.getImmediateDominator(f.exit), exit);
+    EXPECT_EQ(pdt.getImmediateDominator(f.header), f.exit);
+    EXPECT_EQ(pdt.getImmediateDominator(f.body), f.header);
+    EXPECT_EQ(pdt.getImmediateDominator(f.entry), f.header);
+    EXPECT_EQ(pdt.getImmediateDominator(spin), nullptr);
+    EXPECT_TRUE(pdt.dominates(f.exit, f.entry));
+    EXPECT_FALSE(pdt.dominates(f.body, f.entry));
+    EXPECT_FALSE(pdt.dominates(f.exit, spin));
+    EXPECT_EQ(pdt.findNearestCommonDominator(f.body, f.entry), f.header);
+}
+
+// B post-dominates A iff A reaches a return but no longer does once B is removed
+static bool postDominatesByReachability(Graph& g, BasicBlock* b, BasicBlock* a) {
+    std::vector<bool> seen(g.getBasicBlocks().size(), false);
+    std::vector<BasicBlock*> stack{a};
+    seen[a->getId()] = true;
+    bool reaches_return = false;
+    while (!stack.empty()) {
+        BasicBlock* bb = stack.back();
+        stack.pop_back();
+        if (bb == b) {
+            continue;
+        }
+        if (ReverseCFG::isExitBlock(bb)) {
+            reaches_return = true;
+        }
+        for (auto* succ : bb->getSuccessors()) {
+            if (!seen[succ->getId()]) {
+                seen[succ->getId()] = true;
+                stack.push_back(succ);
+            }
+        }
+    }
+    return !reaches_return;
+}
+
+TEST(PostDominatorTreeSuite, MatchesReachabilityDefinition) {
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 1 + seed % 61, seed);
+        PostDominatorTree iterative(&g, DomAlgorithm::CooperHarveyKennedy);
+        PostDominatorTree semi_nca(&g, DomAlgorithm::SemiNCA);
+        iterative.run();
+        semi_nca.run();
+        expectSameTrees(g, iterative, semi_nca);
+
+        for (auto* a : g.getBasicBlocks()) {
+            bool in_tree = iterative.getImmediateDominator(a) != nullptr;
+            for (auto* b : g.getBasicBlocks()) {
+                bool expected = a == b || (in_tree && postDominatesByReachability(g, b, a));
+                ASSERT_EQ(iterative.dominates(b, a), expected)
+                    << "seed " << seed << ": BB" << b->getId() << " pdom BB" << a->getId();
+            }
+        }
+    }
+}
+
+TEST(PostDominatorTreeSuite, IncrementalUpdatesMatchRecompute) {
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 100 + seed * 7, seed);
+        PostDominatorTree pdt(&g, DomAlgorithm::SemiNCA);
+        pdt.run();
+
+        std::mt19937 rng(seed);
+        for (int batch = 0; batch < 30; ++batch) {
+            std::vector<CFGUpdate> updates;
+            for (unsigned edits = 1 + rng() % 3; edits > 0; --edits) {
+                for (const CFGUpdate& update : retargetRandomEdge(g, rng)) {
+                    updates.push_back(update);
+                }
+            }
+            pdt.applyUpdates(updates);
+            expectPredecessorsMatchSuccessors(g);
+            ASSERT_TRUE(pdt.verify(&std::cerr)) << "seed " << seed << " batch " << batch;
+        }
+    }
+}
+
+TEST(ControlDependenceSuite, FactorialLoop) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    PostDominatorTree pdt(&g);
+    pdt.run();
+    ControlDependenceGraph cdg(&g, pdt);
+    cdg.run();
+
+    auto asVector = [](Span<BasicBlock* const> blocks) {
+        return std::vector<BasicBlock*>(blocks.begin(), blocks.end());
+    };
+    // The loop test decides whether the body and the test itself run again
+    EXPECT_EQ(asVector(cdg.getDependentBlocks(f.header)),
+              (std::vector<BasicBlock*>{f.header, f.body}));
+    EXPECT_EQ(asVector(cdg.getControllingBlocks(f.body)), std::vector<BasicBlock*>{f.header});
+    EXPECT_TRUE(cdg.isControlDependent(f.header, f.header));
+    EXPECT_TRUE(cdg.getControllingBlocks(f.entry).empty());
+    EXPECT_TRUE(cdg.getControllingBlocks(f.exit).empty());
+    EXPECT_TRUE(cdg.getDependentBlocks(f.body).empty());
+}
+
+TEST(ControlDependenceSuite, MatchesPostDominanceDefinition) {
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 1 + seed % 61, seed);
+        PostDominatorTree pdt(&g, DomAlgorithm::SemiNCA);
+        pdt.run();
+        ControlDependenceGraph cdg(&g, pdt);
+        cdg.run();
+
+        // B depends on A iff B post-dominates a successor of A but not A itself (strictly)
+        size_t num_edges = 0;
+        for (auto* a : g.getBasicBlocks()) {
+            for (auto* b : g.getBasicBlocks()) {
+                bool expected = false;
+                if (pdt.getImmediateDominator(a) != nullptr &&
+                    !(a != b && pdt.dominates(b, a))) {
+                    for (auto* succ : a->getSuccessors()) {
+                        bool returns = pdt.getImmediateDominator(succ) != nullptr;
+                        expected |= returns && pdt.dominates(b, succ);
+                    }
+                }
+                ASSERT_EQ(cdg.isControlDependent(b, a), expected)
+                    << "seed " << seed << ": BB" << b->getId() << " on BB" << a->getId();
+                auto dependents = cdg.getDependentBlocks(a);
+                ASSERT_EQ(std::count(dependents.begin(), dependents.end(), b), expected ? 1 : 0);
+                num_edges += expected;
+            }
+        }
+        size_t num_listed = 0;
+        for (auto* bb : g.getBasicBlocks()) {
+            num_listed += cdg.getControllingBlocks(bb).size();
+        }
+        ASSERT_EQ(num_listed, num_edges);
+    }
+}
+
+TEST(DominanceFrontierSuite, MatchesDefinition) {
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 1 + seed % 61, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        DominanceFrontier df(&g, dom_tree);
+        df.run();
+
+        // Y is in DF(X) iff X dominates a predecessor of Y but does not strictly dominate Y
+        for (auto* x : g.getBasicBlocks()) {
+            std::vector<BasicBlock*> expected;
+            for (auto* y : g.getBasicBlocks()) {
+                if (dom_tree.getImmediateDominator(x) == nullptr ||
+                    dom_tree.getImmediateDominator(y) == nullptr ||
+                    (x != y && dom_tree.dominates(x, y))) {
+                    continue;
+                }
+                for (auto* pred : y->getPredecessors()) {
+                    if (dom_tree.getImmediateDominator(pred) != nullptr &&
+                        dom_tree.dominates(x, pred)) {
+                        expected.push_back(y);
+                        break;
+                    }
+                }
+            }
+            auto frontier = df.getFrontier(x);
+            ASSERT_EQ(std::vector<BasicBlock*>(frontier.begin(), frontier.end()), expected)
+                << "seed " << seed << ": DF(BB" << x->getId() << ")";
+        }
+    }
+}
+
+TEST(DominanceFrontierSuite, IteratedFrontierMatchesFixpoint) {
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        buildRandomGraph(g, 1 + seed % 61, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        DominanceFrontier df(&g, dom_tree);
+        df.run();
+        IteratedDominanceFrontier idf(&g, dom_tree);
+
+        std::mt19937 rng(seed);
+        const auto& blocks = g.getBasicBlocks();
+        for (int query = 0; query < 10; ++query) {
+            std::vector<BasicBlock*> defs;
+            for (unsigned n = 1 + rng() % 4; n > 0; --n) {
+                defs.push_back(blocks[rng() % blocks.size()]);
+            }
+            // DF+(S) = DF(S u DF+(S)), by iterating to a fixpoint
+            std::set<BasicBlock*> expected;
+            std::vector<BasicBlock*> worklist(defs);
+            while (!worklist.empty()) {
+                BasicBlock* bb = worklist.back();
+                worklist.pop_back();
+                for (auto* y : df.getFrontier(bb)) {
+                    if (expected.insert(y).second) {
+                        worklist.push_back(y);
+                    }
+                }
+            }
+
+            std::vector<BasicBlock*> result;
+            idf.setDefiningBlocks(defs);
+            idf.resetLiveInBlocks();
+            idf.calculate(result);
+            ASSERT_EQ(std::set<BasicBlock*>(result.begin(), result.end()), expected)
+                << "seed " << seed;
+            ASSERT_EQ(result.size(), expected.size());
+
+            // Pruned: live on entry where a use is reachable without passing a definition
+            std::set<BasicBlock*> live_in;
+            for (unsigned n = 1 + rng() % 4; n > 0; --n) {
+                worklist.push_back(blocks[rng() % blocks.size()]);
+                live_in.insert(worklist.back());
+            }
+            while (!worklist.empty()) {
+                BasicBlock* bb = worklist.back();
+                worklist.pop_back();
+                for (auto* pred : bb->getPredecessors()) {
+                    bool defines = std::count(defs.begin(), defs.end(), pred) != 0;
+                    if (!defines && live_in.insert(pred).second) {
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+            std::vector<BasicBlock*> live_in_blocks(live_in.begin(), live_in.end());
+            std::set<BasicBlock*> expected_pruned;
+            for (auto* bb : expected) {
+                if (live_in.count(bb)) {
+                    expected_pruned.insert(bb);
+                }
+            }
+            idf.setLiveInBlocks(live_in_blocks);
+            idf.calculate(result);
+            ASSERT_EQ(std::set<BasicBlock*>(result.begin(), result.end()), expected_pruned)
+                << "seed " << seed;
+        }
+    }
+}
+
+// The factorial from buildFactorial(), written the way a front end emits it: result and k
+// are stack slots, and every read and write goes through a load or store
+TEST(Mem2RegSuite, FactorialFromVariables) {
+    Graph g("factorial");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("loop.header");
+    BasicBlock* body = g.createBB("loop.body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* result = g.createInst<AllocaInst>(entry);
+    Inst* k = g.createInst<AllocaInst>(entry);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    Inst* two = g.createInst<ConstInst>(entry, 2);
+    g.createInst<StoreInst>(entry, result, one);
+    g.createInst<StoreInst>(entry, k, two);
+    g.createInst<JumpInst>(entry, header);
+
+    Inst* k_header = g.createInst<LoadInst>(header, k);
+    Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, k_header, n);
+    g.createInst<CondJumpInst>(header, cmp, body, exit);
+
+    Inst* result_body = g.createInst<LoadInst>(body, result);
+    Inst* k_body = g.createInst<LoadInst>(body, k);
+    Inst* mul = g.createInst<BinaryInst>(body, Opcode::MUL, result_body, k_body);
+    g.createInst<StoreInst>(body, result, mul);
+    Inst* k_body2 = g.createInst<LoadInst>(body, k);
+    Inst* add = g.createInst<BinaryInst>(body, Opcode::ADD, k_body2, one);
+    g.createInst<StoreInst>(body, k, add);
+    g.createInst<JumpInst>(body, header);
+
+    Inst* result_exit = g.createInst<LoadInst>(exit, result);
+    Inst* ret = g.createInst<ReturnInst>(exit, result_exit);
+    g.buildPredecessors();
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    Mem2Reg mem2reg(&g, dom_tree);
+    EXPECT_EQ(mem2reg.run(), 2u);
+
+    // Exactly the two phis that main.cpp places by hand, both in the loop header
+    const auto& phis = mem2reg.getInsertedPhis();
+    ASSERT_EQ(phis.size(), 2u);
+    PhiInst* result_phi = phis[0];
+    PhiInst* k_phi = phis[1];
+    EXPECT_EQ(result_phi->getParent(), header);
+    EXPECT_EQ(k_phi->getParent(), header);
+    EXPECT_EQ(header->getInstructions()[0], result_phi);
+    EXPECT_EQ(header->getInstructions()[1], k_phi);
+    auto incoming = [](PhiInst* phi) {
+        return std::vector<std::pair<Inst*, BasicBlock*>>(phi->getIncoming().begin(),
+                                                          phi->getIncoming().end());
+    };
+    using Incoming = std::vector<std::pair<Inst*, BasicBlock*>>;
+    EXPECT_EQ(incoming(result_phi), (Incoming{{one, entry}, {mul, body}}));
+    EXPECT_EQ(incoming(k_phi), (Incoming{{two, entry}, {add, body}}));
+
+    EXPECT_EQ(cmp->getOperand(0), k_phi);
+    EXPECT_EQ(mul->getOperand(0), result_phi);
+    EXPECT_EQ(mul->getOperand(1), k_phi);
+    EXPECT_EQ(add->getOperand(0), k_phi);
+    EXPECT_EQ(ret->getOperand(0), result_phi);
+    for (auto* bb : g.getBasicBlocks()) {
+        for (auto* inst : bb->getInstructions()) {
+            Opcode opcode = inst->getOpcode();
+            EXPECT_TRUE(opcode != Opcode::ALLOCA && opcode != Opcode::LOAD &&
+                        opcode != Opcode::STORE);
+        }
+    }
+    EXPECT_FALSE(result->hasUses());
+    EXPECT_FALSE(k->hasUses());
+}
+
+TEST(Mem2RegSuite, EscapingSlotsAndEntryLoops) {
+    Graph g("escape");
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    Inst* kept = g.createInst<AllocaInst>(entry);
+    Inst* promoted = g.createInst<AllocaInst>(entry);
+    Inst* holder = g.createInst<AllocaInst>(entry);
+    // Storing a slot into another one makes it escape
+    g.createInst<StoreInst>(entry, holder, kept);
+    Inst* load = g.createInst<LoadInst>(entry, promoted);
+    Inst* ret = g.createInst<ReturnInst>(entry, load);
+    g.buildPredecessors();
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    Mem2Reg mem2reg(&g, dom_tree);
+    EXPECT_EQ(mem2reg.run(), 2u);
+    EXPECT_TRUE(mem2reg.getInsertedPhis().empty());
+    // The unwritten variable reads zero; the escaping slot stays
+    EXPECT_EQ(ret->getOperand(0)->getOpcode(), Opcode::CONST);
+    EXPECT_EQ(kept->getParent(), entry);
+    EXPECT_EQ(holder->getParent(), nullptr);
+    EXPECT_EQ(promoted->getParent(), nullptr);
+
+    // A start block with predecessors cannot hold phis, so nothing is promoted
+    Graph loop("loop");
+    BasicBlock* head = loop.createBB("head");
+    loop.setStartBlock(head);
+    Inst* slot = loop.createInst<AllocaInst>(head);
+    loop.createInst<JumpInst>(head, head);
+    loop.buildPredecessors();
+    DominatorTree loop_tree(&loop);
+    loop_tree.run();
+    Mem2Reg loop_mem2reg(&loop, loop_tree);
+    EXPECT_EQ(loop_mem2reg.run(), 0u);
+    EXPECT_EQ(slot->getParent(), head);
+}
+
+// Random program over num_vars slots: an entry block that jumps to a random CFG whose blocks
+// store constants or other variables into slots and load them. Every load feeds an ADD that
+// observes its value.
+static void buildRandomProgram(Graph& g, unsigned num_blocks, unsigned num_vars,
+                               uint32_t seed) {
+    std::mt19937 rng(seed);
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    std::vector<Inst*> slots;
+    for (unsigned i = 0; i < num_vars; ++i) {
+        slots.push_back(g.createInst<AllocaInst>(entry));
+    }
+    std::vector<BasicBlock*> blocks;
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        blocks.push_back(g.createBB());
+    }
+    g.createInst<JumpInst>(entry, blocks[0]);
+    for (auto* bb : blocks) {
+        for (unsigned ops = rng() % 5; ops > 0; --ops) {
+            Inst* slot = slots[rng() % num_vars];
+            switch (rng() % 3) {
+                case 0:
+                    g.createInst<StoreInst>(bb, slot, g.createInst<ConstInst>(bb, rng() % 100));
+                    break;
+                case 1: {
+                    Inst* load = g.createInst<LoadInst>(bb, slots[rng() % num_vars]);
+                    g.createInst<StoreInst>(bb, slot, load);
+                    break;
+                }
+                default: {
+                    Inst* load = g.createInst<LoadInst>(bb, slot);
+                    g.createInst<BinaryInst>(bb, Opcode::ADD, load, load);
+                    break;
+                }
+            }
+        }
+        BasicBlock* target = blocks[rng() % num_blocks];
+        switch (rng() % 5) {
+            case 0:
+                g.createInst<ReturnInst>(bb);
+                break;
+            case 1:
+                g.createInst<JumpInst>(bb, target);
+                break;
+            default: {
+                Inst* cond = g.createInst<ConstInst>(bb, 1);
+                g.createInst<CondJumpInst>(bb, cond, target, blocks[rng() % num_blocks]);
+                break;
+            }
+        }
+    }
+    g.buildPredecessors();
+}
+
+// Executes a fixed path through the CFG and returns the value seen by every executed ADD
+// observer. Values are the ConstInsts they originate from; nullptr stands for a variable
+// that was never written (read as the zero constant Mem2Reg creates, id >= first_new_id).
+static std::vector<Inst*> observeAlongPath(const std::vector<BasicBlock*>& path,
+                                           unsigned first_new_id) {
+    std::map<Inst*, Inst*> memory;  // Slot -> value
+    std::map<Inst*, Inst*> values;  // SSA value -> origin
+    auto resolve = [&](Inst* inst) -> Inst* {
+        if (inst->getOpcode() == Opcode::CONST) {
+            return inst->getId() >= first_new_id ? nullptr : inst;
+        }
+        return values.at(inst);
+    };
+    std::vector<Inst*> observed;
+    for (size_t step = 0; step < path.size(); ++step) {
+        BasicBlock* bb = path[step];
+        // Phis read their operands simultaneously on entry
+        std::vector<std::pair<Inst*, Inst*>> phi_values;
+        for (auto* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                continue;
+            }
+            auto* phi = static_cast<PhiInst*>(inst);
+            for (auto [value, pred] : phi->getIncoming()) {
+                if (pred == path[step - 1]) {
+                    phi_values.emplace_back(phi, resolve(value));
+                    break;
+                }
+            }
+        }
+        for (auto& [phi, value] : phi_values) {
+            values[phi] = value;
+        }
+        for (auto* inst : bb->getInstructions()) {
+            switch (inst->getOpcode()) {
+                case Opcode::LOAD:
+                    values[inst] = memory.count(inst->getOperand(0))
+                                       ? memory[inst->getOperand(0)]
+                                       : nullptr;
+                    break;
+                case Opcode::STORE:
+                    memory[inst->getOperand(0)] = resolve(inst->getOperand(1));
+                    break;
+                case Opcode::ADD:
+                    observed.push_back(resolve(inst->getOperand(0)));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return observed;
+}
+
+TEST(Mem2RegSuite, RandomProgramsKeepTheirValues) {
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        buildRandomProgram(g, 2 + seed % 40, 1 + seed % 7, seed);
+        unsigned first_new_id = g.getNumInsts();
+
+        std::mt19937 rng(seed);
+        std::vector<BasicBlock*> path{g.getStartBlock()};
+        while (path.size() < 300 && !path.back()->getSuccessors().empty()) {
+            auto succs = path.back()->getSuccessors();
+            path.push_back(succs[rng() % succs.size()]);
+        }
+        std::vector<Inst*> expected = observeAlongPath(path, first_new_id);
+
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg mem2reg(&g, dom_tree);
+        mem2reg.run();
+        ASSERT_EQ(observeAlongPath(path, first_new_id), expected) << "seed " << seed;
+
+        // SSA form: phis match the predecessors and definitions dominate their uses
+        for (auto* phi : mem2reg.getInsertedPhis()) {
+            ASSERT_EQ(phi->getNumIncoming(), phi->getParent()->getPredecessors().size());
+        }
+        for (auto* bb : g.getBasicBlocks()) {
+            if (dom_tree.getImmediateDominator(bb) == nullptr) {
+                continue;
+            }
+            auto insts = bb->getInstructions();
+            for (size_t i = 0; i < insts.size(); ++i) {
+                ASSERT_NE(insts[i]->getOpcode(), Opcode::LOAD);
+                ASSERT_NE(insts[i]->getOpcode(), Opcode::STORE);
+                for (unsigned op = 0; op < insts[i]->getNumOperands(); ++op) {
+                    Inst* def = insts[i]->getOperand(op);
+                    BasicBlock* use_bb = bb;
+                    if (insts[i]->getOpcode() == Opcode::PHI) {
+                        use_bb = static_cast<PhiInst*>(insts[i])->getIncomingBlock(op);
+                        if (dom_tree.getImmediateDominator(use_bb) == nullptr) {
+                            continue;
+                        }
+                    }
+                    ASSERT_TRUE(dom_tree.dominates(def->getParent(), use_bb));
+                    if (def->getParent() == bb && insts[i]->getOpcode() != Opcode::PHI) {
+                        auto def_pos = std::find(insts.begin(), insts.end(), def) - insts.begin();
+                        ASSERT_LT(size_t(def_pos), i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Reference semantics for the interpreter: walks the IR one instruction at a time. Every
+// stack slot holds one value, zero until stored; phis read their operands simultaneously on
+// entry to a block.
+static int64_t evaluateIR(const Graph& g, const std::vector<int64_t>& args) {
+    std::vector<int64_t> values(g.getNumInsts(), 0);
+    std::vector<int64_t> memory(g.getNumInsts(), 0);  // Indexed by slot id
+    BasicBlock* prev = nullptr;
+    BasicBlock* bb = g.getStartBlock();
+    for (;;) {
+        std::vector<std::pair<Inst*, int64_t>> phi_values;
+        for (auto* inst : bb->getInstructions()) {
+            if (inst->getOpcode() != Opcode::PHI) {
+                continue;
+            }
+            for (auto [value, pred] : static_cast<PhiInst*>(inst)->getIncoming()) {
+                if (pred == prev) {
+                    phi_values.emplace_back(inst, values[value->getId()]);
+                    break;
+                }
+            }
+        }
+        for (auto& [phi, value] : phi_values) {
+            values[phi->getId()] = value;
+        }
+
+        BasicBlock* next = nullptr;
+        for (auto* inst : bb->getInstructions()) {
+            auto operand = [&](unsigned i) { return values[inst->getOperand(i)->getId()]; };
+            auto& result = values[inst->getId()];
+            switch (inst->getOpcode()) {
+                case Opcode::PARAM: {
+                    unsigned index = static_cast<ParamInst*>(inst)->getIndex();
+                    result = index < args.size() ? args[index] : 0;
+                    break;
+                }
+                case Opcode::CONST:
+                    result = static_cast<ConstInst*>(inst)->getValue();
+                    break;
+                case Opcode::ADD:
+                    result = int64_t(uint64_t(operand(0)) + uint64_t(operand(1)));
+                    break;
+                case Opcode::MUL:
+                    result = int64_t(uint64_t(operand(0)) * uint64_t(operand(1)));
+                    break;
+                case Opcode::CMP:
+                    result = operand(0) <= operand(1);
+                    break;
+                case Opcode::MOV:
+                    result = operand(0);
+                    break;
+                case Opcode::LOAD:
+                    result = memory[inst->getOperand(0)->getId()];
+                    break;
+                case Opcode::STORE:
+                    memory[inst->getOperand(0)->getId()] = operand(1);
+                    break;
+                case Opcode::JUMP:
+                    next = static_cast<JumpInst*>(inst)->getTarget();
+                    break;
+                case Opcode::COND_JUMP: {
+                    auto* cond_jump = static_cast<CondJumpInst*>(inst);
+                    next = operand(0) != 0 ? cond_jump->getTrueTarget()
+                                           : cond_jump->getFalseTarget();
+                    break;
+                }
+                case Opcode::RETURN:
+                    return inst->getNumOperands() ? operand(0) : 0;
+                default:
+                    break;
+            }
+        }
+        prev = bb;
+        bb = next;
+    }
+}
+
+TEST(InterpreterSuite, Factorial) {
+    Graph g("factorial");
+    buildFactorial(g);
+    Interpreter interpreter(&g);
+    ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+
+    uint64_t expected = 1;
+    for (int64_t n = 0; n <= 25; ++n) {
+        expected *= n < 2 ? 1 : n;
+        // 21! and above wrap around
+        EXPECT_EQ(interpreter.execute({n}), int64_t(expected)) << "n = " << n;
+    }
+    EXPECT_EQ(interpreter.execute({-3}), 1);
+    EXPECT_EQ(interpreter.execute({}), 1);
+}
+
+// Swaps two phis on a self-loop, a critical edge, so the moves need their own stub and a
+// scratch location to break the cycle. The exit phi is fed over two more critical edges.
+// Returns -1 if param #0 is negative, else 12 if it is even and 21 if it is odd.
+static void buildPhiSwap(Graph& g) {
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* loop = g.createBB("loop");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    Inst* two = g.createInst<ConstInst>(entry, 2);
+    Inst* ten = g.createInst<ConstInst>(entry, 10);
+    Inst* minus_one = g.createInst<ConstInst>(entry, -1);
+    Inst* negative = g.createInst<BinaryInst>(entry, Opcode::CMP, n, minus_one);
+    g.createInst<CondJumpInst>(entry, negative, exit, loop);
+
+    PhiInst* i = g.createInst<PhiInst>(loop);
+    PhiInst* a = g.createInst<PhiInst>(loop);
+    PhiInst* b = g.createInst<PhiInst>(loop);
+    Inst* i_next = g.createInst<BinaryInst>(loop, Opcode::ADD, i, one);
+    Inst* tens = g.createInst<BinaryInst>(loop, Opcode::MUL, a, ten);
+    Inst* digits = g.createInst<BinaryInst>(loop, Opcode::ADD, tens, b);
+    Inst* again = g.createInst<BinaryInst>(loop, Opcode::CMP, i_next, n);
+    g.createInst<CondJumpInst>(loop, again, loop, exit);
+    i->addIncoming(zero, entry);
+    i->addIncoming(i_next, loop);
+    a->addIncoming(one, entry);
+    a->addIncoming(b, loop);
+    b->addIncoming(two, entry);
+    b->addIncoming(a, loop);
+
+    PhiInst* result = g.createInst<PhiInst>(exit);
+    result->addIncoming(minus_one, entry);
+    result->addIncoming(digits, loop);
+    g.createInst<ReturnInst>(exit, result);
+    g.buildPredecessors();
+}
+
+TEST(InterpreterSuite, PhiSwapOnCriticalEdges) {
+    Graph g("swap");
+    buildPhiSwap(g);
+    Interpreter interpreter(&g);
+    ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+    for (int64_t arg = -2; arg <= 7; ++arg) {
+        int64_t expected = arg < 0 ? -1 : arg % 2 == 0 ? 12 : 21;
+        EXPECT_EQ(interpreter.execute({arg}), expected) << "n = " << arg;
+        EXPECT_EQ(interpreter.execute({arg}), evaluateIR(g, {arg}));
+    }
+    unsigned scratch = interpreter.getNumSlots() - 1;
+    EXPECT_TRUE(std::any_of(interpreter.getCode().begin(), interpreter.getCode().end(),
+                            [scratch](const BytecodeInstr& instr) {
+                                return instr.op == BytecodeOp::MOV && instr.dst == scratch;
+                            }));
+}
+
+TEST(InterpreterSuite, RejectsUnsupportedInstructions) {
+    Graph g("memory");
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    Inst* slot = g.createInst<AllocaInst>(entry);
+    g.createInst<ReturnInst>(entry, g.createInst<LoadInst>(entry, slot));
+    g.buildPredecessors();
+
+    Interpreter interpreter(&g);
+    EXPECT_FALSE(interpreter.compile());
+    EXPECT_NE(interpreter.getError().find("alloca"), std::string::npos);
+}
+
+// Terminating random program in the form a front end emits: num_vars stack slots seeded
+// from two parameters, and a random CFG whose blocks combine variables with ADD, MUL and CMP
+// and branch on them. Every block spends one unit of fuel; the program returns variable 0
+// when the fuel runs out.
+static void buildRandomArithmeticProgram(Graph& g, unsigned num_blocks, unsigned num_vars,
+                                         uint32_t seed) {
+    std::mt19937 rng(seed);
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* out = g.createBB("out");
+    g.setStartBlock(entry);
+    Inst* params[] = {g.createInst<ParamInst>(entry, 0), g.createInst<ParamInst>(entry, 1)};
+    std::vector<Inst*> slots;
+    for (unsigned i = 0; i < num_vars; ++i) {
+        slots.push_back(g.createInst<AllocaInst>(entry));
+        Inst* value = rng() % 3 == 0 ? g.createInst<ConstInst>(entry, int64_t(rng() % 100) - 50)
+                                     : params[rng() % 2];
+        g.createInst<StoreInst>(entry, slots.back(), value);
+    }
+    Inst* fuel = g.createInst<AllocaInst>(entry);
+    g.createInst<StoreInst>(entry, fuel, g.createInst<ConstInst>(entry, 50 + rng() % 100));
+    g.createInst<ReturnInst>(out, g.createInst<LoadInst>(out, slots[0]));
+
+    std::vector<BasicBlock*> blocks;
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        blocks.push_back(g.createBB());
+    }
+    g.createInst<JumpInst>(entry, blocks[0]);
+    auto load = [&](BasicBlock* bb) { return g.createInst<LoadInst>(bb, slots[rng() % num_vars]); };
+    for (auto* bb : blocks) {
+        for (unsigned ops = rng() % 4; ops > 0; --ops) {
+            // Plain copies between variables turn into phis that swap and rotate values
+            static const Opcode kOps[] = {Opcode::ADD, Opcode::MUL, Opcode::CMP};
+            Inst* value = load(bb);
+            if (rng() % 4 != 0) {
+                value = g.createInst<BinaryInst>(bb, kOps[rng() % 3], value, load(bb));
+            }
+            g.createInst<StoreInst>(bb, slots[rng() % num_vars], value);
+        }
+        Inst* left = g.createInst<LoadInst>(bb, fuel);
+        Inst* minus_one = g.createInst<ConstInst>(bb, -1);
+        Inst* remaining = g.createInst<BinaryInst>(bb, Opcode::ADD, left, minus_one);
+        g.createInst<StoreInst>(bb, fuel, remaining);
+        Inst* empty = g.createInst<BinaryInst>(bb, Opcode::CMP, remaining,
+                                               g.createInst<ConstInst>(bb, 0));
+        BasicBlock* go = g.createBB();
+        g.createInst<CondJumpInst>(bb, empty, out, go);
+
+        BasicBlock* target = blocks[rng() % num_blocks];
+        switch (rng() % 8) {
+            case 0:
+                g.createInst<ReturnInst>(go, load(go));
+                break;
+            case 1:
+                g.createInst<JumpInst>(go, target);
+                break;
+            case 2:  // Branch on a variable, which may hold a comparison result
+                g.createInst<CondJumpInst>(go, load(go), target, blocks[rng() % num_blocks]);
+                break;
+            default: {
+                Inst* lhs = load(go);
+                Inst* cond = g.createInst<BinaryInst>(go, Opcode::CMP, lhs, load(go));
+                g.createInst<CondJumpInst>(go, cond, target, blocks[rng() % num_blocks]);
+                break;
+            }
+        }
+    }
+    g.buildPredecessors();
+}
+
+TEST(InterpreterSuite, RandomProgramsMatchReference) {
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        std::vector<std::vector<int64_t>> arg_sets = {{}, {int64_t(seed) - 100, 3}, {7, -2}};
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg mem2reg(&g, dom_tree);
+        mem2reg.run();
+        Interpreter interpreter(&g);
+        ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[i]), expected[i]) << "seed " << seed;
+            ASSERT_EQ(interpreter.execute(arg_sets[i]), expected[i]) << "seed " << seed;
+        }
+    }
+}
+
+TEST(JitSuite, FactorialMatchesInterpreter) {
+    if (!JitFunction::isSupported()) {
+        GTEST_SKIP() << "no native target";
+    }
+    Graph g("factorial");
+    buildFactorial(g);
+    JitFunction jit(&g);
+    ASSERT_TRUE(jit.compile()) << jit.getError();
+    Interpreter interpreter(&g);
+    ASSERT_TRUE(interpreter.compile());
+    for (int64_t n = -3; n <= 25; ++n) {
+        EXPECT_EQ(jit(n), interpreter.execute({n})) << "n = " << n;
+    }
+    EXPECT_EQ(jit(int64_t(10)), 3628800);
+    EXPECT_EQ(jit.getFunction<int64_t (*)(int64_t)>()(5), 120);
+}
+
+TEST(JitSuite, PhiSwapOnCriticalEdges) {
+    if (!JitFunction::isSupported()) {
+        GTEST_SKIP() << "no native target";
+    }
+    Graph g("swap");
+    buildPhiSwap(g);
+    JitFunction jit(&g);
+    ASSERT_TRUE(jit.compile()) << jit.getError();
+    for (int64_t arg = -2; arg <= 7; ++arg) {
+        EXPECT_EQ(jit(arg), arg < 0 ? -1 : arg % 2 == 0 ? 12 : 21) << "n = " << arg;
+    }
+}
+
+// Eight parameters: the first six arrive in registers, the rest on the stack. Large
+// constants do not fit in an imm32.
+TEST(JitSuite, ParametersInRegistersAndOnTheStack) {
+    if (!JitFunction::isSupported()) {
+        GTEST_SKIP() << "no native target";
+    }
+    Graph g("params");
+    BasicBlock* entry = g.createBB("entry");
+    g.setStartBlock(entry);
+    // sum of param_i * 10^i, plus a constant that needs 64 bits
+    Inst* sum = g.createInst<ConstInst>(entry, int64_t(1) << 40);
+    int64_t scale = 1;
+    for (unsigned i = 0; i < 8; ++i, scale *= 10) {
+        Inst* param = g.createInst<ParamInst>(entry, i);
+        Inst* term = g.createInst<BinaryInst>(entry, Opcode::MUL, param,
+                                              g.createInst<ConstInst>(entry, scale));
+        sum = g.createInst<BinaryInst>(entry, Opcode::ADD, sum, term);
+    }
+    g.createInst<ReturnInst>(entry, sum);
+    g.buildPredecessors();
+
+    JitFunction jit(&g);
+    ASSERT_TRUE(jit.compile()) << jit.getError();
+    EXPECT_EQ(jit(1, 2, 3, 4, 5, 6, 7, 8), (int64_t(1) << 40) + 87654321);
+    EXPECT_EQ(jit(-1, 0, 0, 0, 0, 0, 0, -1), (int64_t(1) << 40) - 10000001);
+}
+
+TEST(JitSuite, RandomProgramsMatchInterpreter) {
+    if (!JitFunction::isSupported()) {
+        GTEST_SKIP() << "no native target";
+    }
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg mem2reg(&g, dom_tree);
+        mem2reg.run();
+
+        Interpreter interpreter(&g);
+        ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+        JitFunction jit(&g);
+        ASSERT_TRUE(jit.compile()) << jit.getError();
+        for (int64_t a : {int64_t(0), int64_t(seed) - 100, int64_t(1) << 35}) {
+            int64_t b = 3 - int64_t(seed % 7);
+            ASSERT_EQ(jit(a, b), interpreter.execute({a, b})) << "seed " << seed;
+        }
+    }
+}
+
+// Twenty values live at once, more than the twelve registers: some live in stack slots,
+// including operands and results of the loop
+TEST(JitSuite, SpillsUnderRegisterPressure) {
+    if (!JitFunction::isSupported()) {
+        GTEST_SKIP() << "no native target";
+    }
+    Graph g("pressure");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* loop = g.createBB("loop");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* a = g.createInst<ParamInst>(entry, 0);
+    Inst* b = g.createInst<ParamInst>(entry, 1);
+    std::vector<Inst*> terms;
+    for (int64_t i = 0; i < 20; ++i) {
+        Inst* scaled = g.createInst<BinaryInst>(entry, Opcode::MUL, a,
+                                                g.createInst<ConstInst>(entry, i + 2));
+        terms.push_back(g.createInst<BinaryInst>(entry, Opcode::ADD, scaled, b));
+    }
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    g.createInst<JumpInst>(entry, loop);
+    // sum = sum * 3 + term_k for every k, once per iteration, b times
+    PhiInst* count = g.createInst<PhiInst>(loop);
+    PhiInst* sum = g.createInst<PhiInst>(loop);
+    Inst* next = sum;
+    for (Inst* term : terms) {
+        Inst* tripled = g.createInst<BinaryInst>(loop, Opcode::MUL, next,
+                                                 g.createInst<ConstInst>(loop, 3));
+        next = g.createInst<BinaryInst>(loop, Opcode::ADD, tripled, term);
+    }
+    Inst* count_next =
+        g.createInst<BinaryInst>(loop, Opcode::ADD, count, g.createInst<ConstInst>(loop, 1));
+    Inst* again = g.createInst<BinaryInst>(loop, Opcode::CMP, count_next, b);
+    g.createInst<CondJumpInst>(loop, again, loop, exit);
+    count->addIncoming(one, entry);
+    count->addIncoming(count_next, loop);
+    sum->addIncoming(zero, entry);
+    sum->addIncoming(next, loop);
+    g.createInst<ReturnInst>(exit, next);
+    g.buildPredecessors();
+
+    JitFunction jit(&g);
+    ASSERT_TRUE(jit.compile()) << jit.getError();
+    EXPECT_GT(jit.getNumSpills(), 0u);
+    for (auto [x, y] : {std::pair<int64_t, int64_t>{0, 1}, {5, 3}, {-7, 4}, {1 << 20, 2}}) {
+        EXPECT_EQ(jit(x, y), evaluateIR(g, {x, y})) << x << ", " << y;
+    }
+}
+
+static std::string dumpOf(const Graph& g) {
+    std::ostringstream os;
+    g.dump(os);
+    return os.str();
+}
+
+// Binary IR sits in a vector<uint8_t>; the view needs 8-byte alignment
+static std::vector<uint64_t> alignedCopy(const std::vector<uint8_t>& bytes) {
+    std::vector<uint64_t> words((bytes.size() + 7) / 8);
+    std::memcpy(words.data(), bytes.data(), bytes.size());
+    return words;
+}
+
+TEST(BinaryIRSuite, ViewExposesTheFactorial) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    std::vector<uint8_t> bytes;
+    BinaryIRWriter writer(&g);
+    ASSERT_TRUE(writer.write(bytes)) << writer.getError();
+    auto words = alignedCopy(bytes);
+    BinaryIRView view;
+    ASSERT_TRUE(view.openBuffer(words.data(), bytes.size())) << view.getError();
+
+    EXPECT_EQ(view.getName(), "factorial");
+    EXPECT_EQ(view.getNumBlocks(), 4u);
+    EXPECT_EQ(view.getNumInsts(), g.getNumInsts());
+    EXPECT_EQ(view.getStartBlock(), f.entry->getId());
+    EXPECT_EQ(view.getBlockName(f.header->getId()), "loop.header");
+    // buildFactorial creates the instructions in block order, so the ids are unchanged
+    unsigned res_phi = f.res_phi->getId();
+    EXPECT_EQ(view.getOpcode(res_phi), Opcode::PHI);
+    auto values = view.getOperands(res_phi);
+    auto preds = view.getBlockOperands(res_phi);
+    ASSERT_EQ(values.size(), 2u);
+    EXPECT_EQ(view.getConstant(values[0]), 1);
+    EXPECT_EQ(values[1], f.res_new->getId());
+    EXPECT_EQ(preds[0], f.entry->getId());
+    EXPECT_EQ(preds[1], f.body->getId());
+    EXPECT_EQ(view.getParamIndex(f.n->getId()), 0u);
+    unsigned branch = f.cmp->getId() + 1;
+    EXPECT_EQ(view.getOpcode(branch), Opcode::COND_JUMP);
+    EXPECT_EQ(view.getBlockOperands(branch)[0], f.body->getId());
+    EXPECT_EQ(view.getBlockOperands(branch)[1], f.exit->getId());
+}
+
+// The file numbers instructions densely in block order, so the dump is kept exactly when the
+// original ids already are; otherwise the copy computes the same and encodes to the same bytes
+TEST(BinaryIRSuite, RoundTripKeepsGraphs) {
+    auto roundTrip = [](const Graph& g, bool same_ids, const std::vector<int64_t>& args) {
+        std::vector<uint8_t> bytes;
+        BinaryIRWriter writer(&g);
+        ASSERT_TRUE(writer.write(bytes)) << writer.getError();
+        auto words = alignedCopy(bytes);
+        BinaryIRView view;
+        ASSERT_TRUE(view.openBuffer(words.data(), bytes.size())) << view.getError();
+        Graph copy{std::string(view.getName())};
+        ASSERT_TRUE(view.materialize(copy)) << view.getError();
+        if (same_ids) {
+            EXPECT_EQ(dumpOf(copy), dumpOf(g));
+        }
+        ASSERT_EQ(copy.getBasicBlocks().size(), g.getBasicBlocks().size());
+        for (auto* bb : g.getBasicBlocks()) {
+            BasicBlock* copy_bb = copy.getBasicBlocks()[bb->getId()];
+            EXPECT_EQ(copy_bb->getName(), bb->getName());
+            EXPECT_EQ(copy_bb->getPredecessors().size(), bb->getPredecessors().size());
+        }
+        EXPECT_EQ(evaluateIR(copy, args), evaluateIR(g, args));
+        std::vector<uint8_t> copy_bytes;
+        ASSERT_TRUE(BinaryIRWriter(&copy).write(copy_bytes));
+        EXPECT_EQ(copy_bytes, bytes);
+    };
+    Graph factorial("factorial");
+    buildFactorial(factorial);
+    roundTrip(factorial, true, {6});
+    Graph swap("swap");
+    buildPhiSwap(swap);
+    roundTrip(swap, true, {5});
+    for (uint32_t seed = 0; seed < 20; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed, 1 + seed % 6, seed);
+        roundTrip(g, false, {int64_t(seed) - 7, 3});
+    }
+}
+
+// Equal constants in one block must stay apart in a graph that hash-conses, or the ids of
+// later instructions and their forward references would shift
+TEST(BinaryIRSuite, MaterializeKeepsDuplicatesWithHashConsing) {
+    Graph g("count");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("loop.header");
+    BasicBlock* body = g.createBB("loop.body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    g.createInst<ConstInst>(entry, 1);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    g.createInst<JumpInst>(entry, header);
+    auto* i_phi = g.createInst<PhiInst>(header);
+    Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, i_phi, n);
+    g.createInst<CondJumpInst>(header, cmp, body, exit);
+    Inst* i_new = g.createInst<BinaryInst>(body, Opcode::ADD, i_phi, one);
+    g.createInst<JumpInst>(body, header);
+    g.createInst<ReturnInst>(exit, i_phi);
+    i_phi->addIncoming(zero, entry);
+    i_phi->addIncoming(i_new, body);
+    g.buildPredecessors();
+
+    std::vector<uint8_t> bytes;
+    BinaryIRWriter writer(&g);
+    ASSERT_TRUE(writer.write(bytes)) << writer.getError();
+    auto words = alignedCopy(bytes);
+    BinaryIRView view;
+    ASSERT_TRUE(view.openBuffer(words.data(), bytes.size())) << view.getError();
+    Graph copy("count");
+    copy.setHashConsing(true);
+    ASSERT_TRUE(view.materialize(copy)) << view.getError();
+    EXPECT_TRUE(copy.isHashConsing());
+    ASSERT_EQ(dumpOf(copy), dumpOf(g));
+    EXPECT_EQ(evaluateIR(copy, {4}), 5);
+}
+
+// After Mem2Reg the ids have holes; the file numbers the rest densely, so the copy is
+// equivalent rather than identical, and encodes to the same bytes
+TEST(BinaryIRSuite, RoundTripThroughFileAfterMem2Reg) {
+    std::string path = ::testing::TempDir() + "binary_ir_round_trip.bin";
+    for (uint32_t seed = 0; seed < 20; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 5 + seed, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        BinaryIRWriter writer(&g);
+        ASSERT_TRUE(writer.writeFile(path)) << writer.getError();
+        std::vector<uint8_t> bytes;
+        ASSERT_TRUE(writer.write(bytes));
+
+        BinaryIRView view;
+        ASSERT_TRUE(view.openFile(path)) << view.getError();
+        Graph copy("random");
+        ASSERT_TRUE(view.materialize(copy)) << view.getError();
+        std::vector<uint8_t> copy_bytes;
+        ASSERT_TRUE(BinaryIRWriter(&copy).write(copy_bytes));
+        EXPECT_EQ(copy_bytes, bytes) << "seed " << seed;
+
+        Interpreter original(&g);
+        Interpreter loaded(&copy);
+        ASSERT_TRUE(original.compile() && loaded.compile());
+        EXPECT_EQ(loaded.execute({int64_t(seed), 5}), original.execute({int64_t(seed), 5}));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(BinaryIRSuite, RejectsCorruptInput) {
+    Graph g("random");
+    buildRandomArithmeticProgram(g, 12, 4, 3);
+    std::vector<uint8_t> bytes;
+    ASSERT_TRUE(BinaryIRWriter(&g).write(bytes));
+    BinaryIRView view;
+    std::vector<uint64_t> words;  // Must outlive the view's use of it
+
+    auto open = [&](const std::vector<uint8_t>& input) {
+        words = alignedCopy(input);
+        return view.openBuffer(words.data(), input.size());
+    };
+    auto corrupt = bytes;
+    corrupt[0] = 'X';
+    EXPECT_FALSE(open(corrupt));
+    EXPECT_EQ(view.getError(), "not a binary IR file");
+    corrupt = bytes;
+    corrupt[offsetof(BinaryIRHeader, version)] = 2;
+    EXPECT_FALSE(open(corrupt));
+    EXPECT_EQ(view.getError(), "unsupported version 2");
+    corrupt = bytes;
+    BinaryIRHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    uint32_t out_of_range = header.num_insts;
+    std::memcpy(&corrupt[header.operands_offset], &out_of_range, sizeof(out_of_range));
+    EXPECT_FALSE(open(corrupt));
+    corrupt.assign(bytes.begin(), bytes.end() - 8);
+    EXPECT_FALSE(open(corrupt));
+    EXPECT_FALSE(view.openFile(::testing::TempDir() + "no_such_file.bin"));
+
+    // Random byte flips are either rejected or still describe a graph that materializes
+    std::mt19937 rng(11);
+    for (int trial = 0; trial < 2000; ++trial) {
+        corrupt = bytes;
+        for (int flips = 1 + rng() % 3; flips > 0; --flips) {
+            corrupt[rng() % corrupt.size()] ^= uint8_t(1 + rng() % 255);
+        }
+        if (open(corrupt)) {
+            Graph copy("copy");
+            EXPECT_TRUE(view.materialize(copy));
+        } else {
+            EXPECT_FALSE(view.getError().empty());
+        }
+    }
+}
+
+TEST(IRParserSuite, RoundTripsDumps) {
+    auto roundTrip = [](const Graph& g) {
+        std::string text = dumpOf(g);
+        Graph parsed("");
+        IRParser parser(&parsed);
+        ASSERT_TRUE(parser.parse(text)) << parser.getError() << "\n" << text;
+        EXPECT_EQ(dumpOf(parsed), text);
+        EXPECT_EQ(parsed.getStartBlock(), parsed.getBasicBlocks().front());
+    };
+    Graph example1("example1");
+    buildNewExample1(example1);
+    example1.buildPredecessors();
+    roundTrip(example1);
+    Graph example3("example3");
+    buildNewExample3(example3);
+    example3.buildPredecessors();
+    roundTrip(example3);
+    Graph factorial("factorial");
+    buildFactorial(factorial);
+    roundTrip(factorial);
+    Graph swap("phi swap");
+    buildPhiSwap(swap);
+    roundTrip(swap);
+    // Ids out of block order, void returns, and after Mem2Reg phis, forward references and
+    // ids of removed instructions
+    for (uint32_t seed = 0; seed < 20; ++seed) {
+        Graph g("random");
+        buildRandomProgram(g, 2 + seed, 1 + seed % 5, seed);
+        roundTrip(g);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        roundTrip(g);
+    }
+}
+
+TEST(IRParserSuite, ReadsHandWrittenText) {
+    // Extra blanks, no preds comments, and values used above their definitions
+    const char* text = R"(
+Function Graph: max
+----------------------
+BB0 (entry):
+    i0 = param #0
+  i1 = param #1
+    i2 = cmp i1,i0
+    cond_jump i2 -> BB2,BB1
+
+BB1 ():
+  jmp -> BB2
+BB2 (join):	; preds = %BB1
+  i4 = phi [ [ i1, %BB1 ], [ i0, %BB0 ] ]
+  i5 = return i7
+  i7 = add i4, i9
+  i9 = const -9223372036854775808
+----------------------
+)";
+    Graph g("");
+    IRParser parser(&g);
+    ASSERT_TRUE(parser.parse(text)) << parser.getError();
+    EXPECT_EQ(g.getName(), "max");
+    ASSERT_EQ(g.getBasicBlocks().size(), 3u);
+    EXPECT_EQ(g.getBasicBlocks()[2]->getName(), "join");
+    EXPECT_EQ(g.getBasicBlocks()[2]->getPredecessors().size(), 2u);
+    // cond_jump and jmp take the free ids 3 and 6 in text order; id 8 stays unused
+    EXPECT_EQ(g.getNumInsts(), 10u);
+    EXPECT_EQ(g.getInst(3)->getOpcode(), Opcode::COND_JUMP);
+    EXPECT_EQ(g.getInst(6)->getOpcode(), Opcode::JUMP);
+    EXPECT_EQ(g.getInst(8), nullptr);
+    EXPECT_EQ(g.getInst(7)->getOperand(1), g.getInst(9));
+    EXPECT_EQ(static_cast<ConstInst*>(g.getInst(9))->getValue(), INT64_MIN);
+}
+
+TEST(IRParserSuite, ReportsErrorsWithLocations) {
+    const std::string header = "Function Graph: bad\n---\nBB0 (entry):\n";
+    struct Case {
+        std::string body;
+        std::string error;
+    };
+    const Case cases[] = {
+        {"  i0 = const 1\n  i1 = cast i0 to 8 bits\n---\n", "5:8: unknown instruction 'cast'"},
+        {"  i0 = const 1\n  i1 = add i0, i2\n---\n", "5:16: undefined value i2"},
+        {"  i0 = const 1\n  i0 = const 2\n---\n", "5:3: i0 is already defined"},
+        {"  jmp -> BB1\n---\n", "4:10: undefined block BB1"},
+        {"  i0 = const 1\nBB2 ():\n---\n", "5:1: expected BB1"},
+        {"  i0 = const 99999999999999999999\n---\n", "4:14: number out of range"},
+        {"  i0 = phi [ [ i0, BB0 ] ]\n---\n", "4:20: expected '%'"},
+        {"  i0 = store i0, i0\n---\n", "4:3: 'store' has no result"},
+        {"  add i0, i0\n---\n", "4:3: 'add' needs a result id"},
+        {"  i0 = const 1 2\n---\n", "4:16: expected the end of the line"},
+        {"  i0 = const 1\n", "5:1: expected a line of dashes after the last block"},
+        {"  i7777777 = const 1\n---\n", "4:3: instruction id out of range"},
+    };
+    for (const Case& c : cases) {
+        Graph g("");
+        IRParser parser(&g);
+        EXPECT_FALSE(parser.parse(header + c.body));
+        EXPECT_EQ(parser.getError(), c.error) << c.body;
+        EXPECT_TRUE(g.getBasicBlocks().empty());
+        EXPECT_EQ(g.getNumInsts(), 0u);
+    }
+    Graph g("");
+    IRParser parser(&g);
+    EXPECT_FALSE(parser.parse("BB0 (entry):\n"));
+    EXPECT_EQ(parser.getErrorLine(), 1u);
+    EXPECT_EQ(parser.getErrorColumn(), 1u);
+}
+
+TEST(IRParserSuite, ParsesMappedFiles) {
+    std::string path = ::testing::TempDir() + "ir_parser_test.ir";
+    Graph g("factorial");
+    buildFactorial(g);
+    {
+        std::ofstream file(path);
+        g.dump(file);
+    }
+    Graph parsed("");
+    IRParser parser(&parsed);
+    ASSERT_TRUE(parser.parseFile(path)) << parser.getError();
+    EXPECT_EQ(dumpOf(parsed), dumpOf(g));
+    Interpreter interpreter(&parsed);
+    ASSERT_TRUE(interpreter.compile());
+    EXPECT_EQ(interpreter.execute({5}), 120);
+
+    {
+        std::ofstream file(path);
+        file << "Function Graph: g\n---\nBB0 ():\n  jmp -> BB0 BB0\n---\n";
+    }
+    Graph bad("");
+    IRParser bad_parser(&bad);
+    EXPECT_FALSE(bad_parser.parseFile(path));
+    EXPECT_EQ(bad_parser.getError(), path + ":4:14: expected the end of the line");
+    std::remove(path.c_str());
+    EXPECT_FALSE(bad_parser.parseFile(path));
+}
+
+TEST(ModuleSuite, ParallelForVisitsEveryIndexOnce) {
+    for (size_t count : {0, 1, 3, 1000}) {
+        std::vector<std::atomic<unsigned>> visits(count);
+        std::atomic<bool> bad_worker{false};
+        parallelFor(4, count, [&](size_t i, unsigned worker) {
+            visits[i].fetch_add(1);
+            if (worker >= 4) {
+                bad_worker = true;
+            }
+        });
+        for (auto& v : visits) {
+            EXPECT_EQ(v.load(), 1u) << "count " << count;
+        }
+        EXPECT_FALSE(bad_worker);
+    }
+}
+
+// Runs mem2reg and the interpreter over a module of random functions and returns the dump
+// and the results for a few argument sets
+static std::string runModulePipeline(unsigned num_threads, std::vector<int64_t>& results) {
+    Module module("random");
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph* g = module.createFunction("f" + std::to_string(seed));
+        buildRandomArithmeticProgram(*g, 1 + seed % 40, 1 + seed % 6, seed);
+    }
+    const std::vector<std::vector<int64_t>> arg_sets = {{}, {5, -3}, {-40, 11}};
+    results.assign(module.getNumFunctions() * arg_sets.size(), 0);
+    std::atomic<bool> failed{false};
+    ModuleDriver driver(num_threads);
+    EXPECT_EQ(driver.getNumThreads(), num_threads);
+    driver.run(module, [&](Graph& g, WorkerContext& ctx) {
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        Interpreter interpreter(&g);
+        if (!interpreter.compile()) {
+            failed = true;
+            return;
+        }
+        // Scratch memory comes back empty for every function
+        int64_t* args = ctx.getScratch().allocateArray<int64_t>(2);
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            size_t num_args = arg_sets[i].size();
+            std::copy(arg_sets[i].begin(), arg_sets[i].end(), args);
+            results[ctx.getFunctionIndex() * arg_sets.size() + i] =
+                interpreter.execute(Span<const int64_t>(args, num_args));
+        }
+    });
+    EXPECT_FALSE(failed);
+    std::ostringstream os;
+    module.dump(os);
+    return os.str();
+}
+
+TEST(ModuleSuite, ParallelPipelineMatchesSerialRun) {
+    std::vector<int64_t> serial_results;
+    std::string serial = runModulePipeline(1, serial_results);
+    for (unsigned num_threads : {2, 4}) {
+        std::vector<int64_t> results;
+        EXPECT_EQ(runModulePipeline(num_threads, results), serial) << num_threads;
+        EXPECT_EQ(results, serial_results) << num_threads;
+    }
+}
+
+// Test pass that runs a callback and reports what the callback returns
+class LambdaPass : public FunctionPass {
+   public:
+    LambdaPass(AnalysisSet required, std::function<PreservedAnalyses(Graph&, AnalysisManager&)> fn)
+        : required_(required), fn_(std::move(fn)) {
+    }
+    const char* getName() const override {
+        return "lambda";
+    }
+    AnalysisSet getRequiredAnalyses() const override {
+        return required_;
+    }
+    PreservedAnalyses run(Graph& g, AnalysisManager& am) override {
+        return fn_(g, am);
+    }
+
+   private:
+    AnalysisSet required_;
+    std::function<PreservedAnalyses(Graph&, AnalysisManager&)> fn_;
+};
+
+TEST(PassManagerSuite, CachesAnalysesUntilAPassDropsThem) {
+    Graph expected("random");
+    buildRandomArithmeticProgram(expected, 20, 4, 3);
+    DominatorTree expected_tree(&expected);
+    expected_tree.run();
+    Mem2Reg(&expected, expected_tree).run();
+
+    Graph g("random");
+    buildRandomArithmeticProgram(g, 20, 4, 3);
+    AnalysisManager am(&g);
+    PassManager pm;
+    Mem2RegPass* mem2reg = pm.addPass<Mem2RegPass>();
+    const AnalysisSet kFrontier = analysisBit(Analysis::DominanceFrontier);
+    for (int i = 0; i < 5; ++i) {
+        pm.addPass<LambdaPass>(kFrontier, [](Graph&, AnalysisManager& am) {
+            EXPECT_TRUE(am.isCached(Analysis::Dominators));
+            return PreservedAnalyses::cfg();
+        });
+    }
+    // Keeping the frontier does not help once the tree it points into is gone
+    pm.addPass<LambdaPass>(0, [](Graph&, AnalysisManager&) {
+        return PreservedAnalyses::all().abandon(Analysis::Dominators);
+    });
+    pm.addPass<LambdaPass>(kFrontier, [](Graph&, AnalysisManager&) {
+        return PreservedAnalyses::all();
+    });
+    pm.setVerifyAnalyses(true);
+    std::ostringstream trace;
+    pm.setTrace(&trace);
+
+    PreservedAnalyses preserved = pm.run(g, am);
+    EXPECT_EQ(mem2reg->getNumPromoted(), 5u);  // 4 variables and the fuel
+    EXPECT_EQ(dumpOf(g), dumpOf(expected));
+    EXPECT_FALSE(preserved.isPreserved(Analysis::Dominators));
+    EXPECT_TRUE(preserved.isPreserved(Analysis::Predecessors));
+    EXPECT_EQ(am.getNumComputations(Analysis::Predecessors), 1u);
+    EXPECT_EQ(am.getNumComputations(Analysis::Dominators), 2u);
+    EXPECT_EQ(am.getNumComputations(Analysis::DominanceFrontier), 2u);
+    EXPECT_EQ(am.getNumComputations(Analysis::PostDominators), 0u);
+    EXPECT_TRUE(am.isCached(Analysis::DominanceFrontier));
+    EXPECT_EQ(trace.str(),
+              "mem2reg\nlambda\nlambda\nlambda\nlambda\nlambda\n"
+              "lambda -dominators -dominance-frontier\nlambda\n");
+}
+
+TEST(PassManagerSuite, RecomputesAfterCFGChanges) {
+    Graph g("random");
+    buildRandomArithmeticProgram(g, 30, 3, 11);
+    AnalysisManager am(&g);
+    PassManager pm;
+    const AnalysisSet kTrees =
+        analysisBit(Analysis::Dominators) | analysisBit(Analysis::ControlDependence);
+    pm.addPass<LambdaPass>(kTrees,
+                           [](Graph&, AnalysisManager&) { return PreservedAnalyses::all(); });
+    // Splits the edge out of the entry block
+    pm.addPass<LambdaPass>(0, [](Graph& g, AnalysisManager&) {
+        auto* jump = static_cast<JumpInst*>(g.getStartBlock()->getTerminator());
+        BasicBlock* split = g.createBB("split");
+        g.createInst<JumpInst>(split, jump->getTarget());
+        jump->setTarget(split);
+        return PreservedAnalyses::none();
+    });
+    pm.addPass<LambdaPass>(kTrees, [](Graph& g, AnalysisManager& am) {
+        BasicBlock* split = g.getBasicBlocks().back();
+        EXPECT_EQ(am.getDominatorTree().getImmediateDominator(split), g.getStartBlock());
+        EXPECT_EQ(split->getPredecessors().size(), 1u);
+        EXPECT_TRUE(am.getDominatorTree().verify());
+        EXPECT_TRUE(am.getPostDominatorTree().verify());
+        return PreservedAnalyses::all();
+    });
+    pm.setVerifyAnalyses(true);
+    pm.run(g, am);
+    EXPECT_EQ(am.getNumComputations(Analysis::Predecessors), 2u);
+    EXPECT_EQ(am.getNumComputations(Analysis::Dominators), 2u);
+    EXPECT_EQ(am.getNumComputations(Analysis::ControlDependence), 2u);
+    am.clear();
+    EXPECT_EQ(am.getCached(), 0u);
+}
+
+// The CFG from main.cpp: every branch tests the constant 1
+TEST(SCCPSuite, FoldsConstantBranchesAndDropsDeadBlocks) {
+    Graph g("test");
+    std::map<char, BasicBlock*> blocks;
+    for (char name = 'A'; name <= 'I'; ++name) {
+        blocks[name] = g.createBB(std::string(1, name));
+    }
+    g.setStartBlock(blocks['A']);
+    auto branch = [&](char from, char on_true, char on_false) {
+        Inst* cond = g.createInst<ConstInst>(blocks[from], 1);
+        g.createInst<CondJumpInst>(blocks[from], cond, blocks[on_true], blocks[on_false]);
+    };
+    g.createInst<JumpInst>(blocks['A'], blocks['B']);
+    branch('B', 'C', 'E');
+    g.createInst<JumpInst>(blocks['C'], blocks['D']);
+    g.createInst<JumpInst>(blocks['D'], blocks['G']);
+    branch('E', 'D', 'F');
+    branch('F', 'H', 'B');
+    branch('G', 'C', 'I');
+    branch('H', 'G', 'I');
+    g.createInst<ReturnInst>(blocks['I']);
+    g.buildPredecessors();
+
+    SCCP sccp(&g);
+    EXPECT_TRUE(sccp.run());
+    EXPECT_EQ(sccp.getNumFoldedBranches(), 2u);
+    EXPECT_EQ(sccp.getNumRemovedBlocks(), 4u);
+    EXPECT_EQ(dumpOf(g),
+              "Function Graph: test\n"
+              "----------------------\n"
+              "BB0 (A):\n"
+              "    jmp -> BB1\n"
+              "BB1 (B):  ; preds = %BB0\n"
+              "    jmp -> BB2\n"
+              "BB2 (C):  ; preds = %BB1, %BB4\n"
+              "    jmp -> BB3\n"
+              "BB3 (D):  ; preds = %BB2\n"
+              "    jmp -> BB4\n"
+              "BB4 (G):  ; preds = %BB3\n"
+              "    jmp -> BB2\n"
+              "----------------------\n");
+    EXPECT_FALSE(SCCP(&g).run());
+}
+
+// Optimistic propagation: a loop variable that is only ever assigned its initial value is a
+// constant, which a pessimistic pass cannot see through the back edge
+TEST(SCCPSuite, FoldsLoopInvariantPhisAndCasts) {
+    Graph g("loop");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("header");
+    BasicBlock* body = g.createBB("body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* seven = g.createInst<ConstInst>(entry, 7);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    g.createInst<JumpInst>(entry, header);
+    auto* x = g.createInst<PhiInst>(header);
+    auto* i = g.createInst<PhiInst>(header);
+    Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, i, n);
+    g.createInst<CondJumpInst>(header, cmp, body, exit);
+    // x * 0 + 7 is 7 whatever x is
+    Inst* x_times_zero = g.createInst<BinaryInst>(body, Opcode::MUL, x, zero);
+    Inst* x_next = g.createInst<BinaryInst>(body, Opcode::ADD, x_times_zero, seven);
+    Inst* i_next = g.createInst<BinaryInst>(body, Opcode::ADD, i, x_next);
+    g.createInst<JumpInst>(body, header);
+    x->addIncoming(seven, entry);
+    x->addIncoming(x_next, body);
+    i->addIncoming(zero, entry);
+    i->addIncoming(i_next, body);
+    Inst* wide = g.createInst<BinaryInst>(exit, Opcode::MUL, x, g.createInst<ConstInst>(exit, 100));
+    Inst* narrow = g.createInst<CastInst>(exit, wide, 8);  // 700 wraps to -68
+    g.createInst<ReturnInst>(exit, g.createInst<BinaryInst>(exit, Opcode::ADD, narrow, i));
+    g.buildPredecessors();
+
+    std::vector<int64_t> expected;
+    for (int64_t arg : {-1, 0, 5, 30}) {
+        expected.push_back(-68 + (arg < 0 ? 0 : (arg / 7 + 1) * 7));
+    }
+    SCCP sccp(&g);
+    EXPECT_TRUE(sccp.run());
+    EXPECT_EQ(sccp.getNumFoldedBranches(), 0u);
+    // x, x * 0, x * 0 + 7, x * 100 and the cast
+    EXPECT_EQ(sccp.getNumFoldedValues(), 5u);
+    for (Inst* inst : header->getInstructions()) {
+        EXPECT_NE(inst, x);
+    }
+    Inst* ret = exit->getTerminator();
+    Inst* sum = ret->getOperand(0);
+    ASSERT_EQ(sum->getOperand(0)->getOpcode(), Opcode::CONST);
+    EXPECT_EQ(static_cast<ConstInst*>(sum->getOperand(0))->getValue(), -68);
+
+    Interpreter interpreter(&g);
+    ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+    int k = 0;
+    for (int64_t arg : {-1, 0, 5, 30}) {
+        EXPECT_EQ(interpreter.execute({arg}), expected[k++]) << arg;
+    }
+}
+
+TEST(SCCPSuite, RandomProgramsKeepTheirResults) {
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        // With constant inputs whole regions fold away
+        bool constant_params = seed % 2 == 0;
+        std::vector<std::vector<int64_t>> arg_sets = {{}};
+        if (!constant_params) {
+            arg_sets.push_back({int64_t(seed) - 100, 3});
+            arg_sets.push_back({7, -2});
+        }
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+        if (constant_params) {
+            BasicBlock* entry = g.getStartBlock();
+            Inst* zero = g.createInst<ConstInst>(nullptr, 0);
+            entry->insertInstructions(0, Span<Inst* const>(&zero, 1));
+            for (Inst* inst : entry->getInstructions()) {
+                if (inst->getOpcode() == Opcode::PARAM) {
+                    inst->replaceAllUsesWith(zero);
+                }
+            }
+        }
+
+        SCCP sccp(&g);
+        sccp.run();
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[i]), expected[i]) << "seed " << seed;
+        }
+        DominatorTree after(&g);
+        after.run();
+        EXPECT_TRUE(after.verify());
+        EXPECT_FALSE(SCCP(&g).run()) << "seed " << seed;
+    }
+}
+
+TEST(GVNSuite, ReplacesTheLoopConstantWithTheEntryOne) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    Inst* res_init = f.res_phi->getIncomingValue(0);
+
+    PassManager pm;
+    pm.addPass<GVNPass>();
+    pm.setVerifyAnalyses(true);
+    AnalysisManager am(&g);
+    pm.run(g, am);
+    // Only instructions changed, so the tree GVN walked stays cached
+    EXPECT_TRUE(am.isCached(Analysis::Dominators));
+    EXPECT_EQ(am.getNumComputations(Analysis::Dominators), 1u);
+
+    EXPECT_EQ(f.i_new->getOperand(1), res_init);
+    EXPECT_FALSE(f.const_1->hasUses());
+    EXPECT_EQ(f.const_1->getParent(), nullptr);
+    EXPECT_EQ(f.body->getInstructions().size(), 3u);
+    EXPECT_EQ(evaluateIR(g, {5}), 120);
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    EXPECT_FALSE(GVN(&g, dom_tree).run());
+}
+
+TEST(GVNSuite, KeepsValuesOfSiblingBranchesApart) {
+    Graph g("diamond");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* left = g.createBB("left");
+    BasicBlock* right = g.createBB("right");
+    BasicBlock* merge = g.createBB("merge");
+    g.setStartBlock(entry);
+
+    Inst* a = g.createInst<ParamInst>(entry, 0);
+    Inst* b = g.createInst<ParamInst>(entry, 1);
+    Inst* sum = g.createInst<BinaryInst>(entry, Opcode::ADD, a, b);
+    Inst* cmp = g.createInst<BinaryInst>(entry, Opcode::CMP, a, b);
+    g.createInst<CondJumpInst>(entry, cmp, left, right);
+
+    // Commuted operands name the same value
+    Inst* left_sum = g.createInst<BinaryInst>(left, Opcode::ADD, b, a);
+    Inst* left_mul = g.createInst<BinaryInst>(left, Opcode::MUL, left_sum, a);
+    g.createInst<JumpInst>(left, merge);
+
+    Inst* right_mul = g.createInst<BinaryInst>(right, Opcode::MUL, sum, a);
+    g.createInst<JumpInst>(right, merge);
+
+    // Neither arm dominates the merge, and CMP is not commutative
+    auto* phi = g.createInst<PhiInst>(merge);
+    Inst* merge_mul = g.createInst<BinaryInst>(merge, Opcode::MUL, sum, a);
+    Inst* swapped_cmp = g.createInst<BinaryInst>(merge, Opcode::CMP, b, a);
+    Inst* cast = g.createInst<CastInst>(merge, merge_mul, 8);
+    Inst* same_cast = g.createInst<CastInst>(merge, merge_mul, 8);
+    Inst* wider_cast = g.createInst<CastInst>(merge, merge_mul, 16);
+    Inst* total = g.createInst<BinaryInst>(merge, Opcode::ADD, phi, swapped_cmp);
+    total = g.createInst<BinaryInst>(merge, Opcode::ADD, total, cast);
+    total = g.createInst<BinaryInst>(merge, Opcode::ADD, total, same_cast);
+    total = g.createInst<BinaryInst>(merge, Opcode::ADD, total, wider_cast);
+    g.createInst<ReturnInst>(merge, total);
+    phi->addIncoming(left_mul, left);
+    phi->addIncoming(right_mul, right);
+    g.buildPredecessors();
+
+    std::vector<std::vector<int64_t>> arg_sets = {{3, 90}, {90, 3}, {-7, 2}};
+    std::vector<int64_t> expected;
+    for (const auto& args : arg_sets) {
+        expected.push_back(evaluateIR(g, args));
+    }
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    GVN gvn(&g, dom_tree);
+    EXPECT_TRUE(gvn.run());
+    EXPECT_EQ(gvn.getNumEliminated(), 2u);
+    EXPECT_EQ(left_mul->getOperand(0), sum);
+    EXPECT_EQ(right_mul->getParent(), right);
+    EXPECT_EQ(merge_mul->getParent(), merge);
+    EXPECT_EQ(swapped_cmp->getParent(), merge);
+    EXPECT_EQ(same_cast->getParent(), nullptr);
+    EXPECT_EQ(wider_cast->getParent(), merge);
+    for (size_t i = 0; i < arg_sets.size(); ++i) {
+        EXPECT_EQ(evaluateIR(g, arg_sets[i]), expected[i]);
+    }
+}
+
+TEST(GVNSuite, RandomProgramsKeepTheirResults) {
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        std::vector<std::vector<int64_t>> arg_sets = {{int64_t(seed) - 100, 3}, {7, -2}};
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+
+        GVN gvn(&g, dom_tree);
+        gvn.run();
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[i]), expected[i]) << "seed " << seed;
+        }
+        EXPECT_FALSE(GVN(&g, dom_tree).run()) << "seed " << seed;
+    }
+}
+
+TEST(GVNSuite, HashConsingReturnsEarlierInstructionsOfTheBlock) {
+    Graph g("consed");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    g.setHashConsing(true);
+
+    Inst* a = g.createInst<ParamInst>(entry, 0);
+    Inst* b = g.createInst<ParamInst>(entry, 1);
+    EXPECT_NE(a, b);
+    Inst* five = g.createInst<ConstInst>(entry, 5);
+    EXPECT_EQ(g.createInst<ConstInst>(entry, 5), five);
+    EXPECT_NE(g.createInst<ConstInst>(entry, 6), five);
+    Inst* sum = g.createInst<BinaryInst>(entry, Opcode::ADD, a, b);
+    EXPECT_EQ(g.createInst<BinaryInst>(entry, Opcode::ADD, b, a), sum);
+    Inst* cmp = g.createInst<BinaryInst>(entry, Opcode::CMP, a, b);
+    EXPECT_NE(g.createInst<BinaryInst>(entry, Opcode::CMP, b, a), cmp);
+    Inst* cast = g.createInst<CastInst>(entry, sum, 8);
+    EXPECT_EQ(g.createInst<CastInst>(entry, sum, 8), cast);
+    EXPECT_NE(g.createInst<CastInst>(entry, sum, 32), cast);
+    g.createInst<JumpInst>(entry, exit);
+
+    // Other blocks get their own copies, and so does everything once consing is off
+    Inst* exit_five = g.createInst<ConstInst>(exit, 5);
+    EXPECT_NE(exit_five, five);
+    g.setHashConsing(false);
+    EXPECT_NE(g.createInst<ConstInst>(exit, 5), exit_five);
+    g.createInst<ReturnInst>(exit, cast);
+    EXPECT_EQ(entry->getInstructions().size(), 10u);
+    EXPECT_EQ(exit->getInstructions().size(), 3u);
+}
+
+TEST(ADCESuite, RemovesDeadPhiCycles) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    // A counter that is carried around the loop but never read
+    Inst* zero = g.createInst<ConstInst>(nullptr, 0);
+    f.entry->insertInstructions(0, Span<Inst* const>(&zero, 1));
+    auto* counter = g.createInst<PhiInst>(nullptr);
+    Inst* counter_inst = counter;
+    f.header->insertInstructions(0, Span<Inst* const>(&counter_inst, 1));
+    Inst* next = g.createInst<BinaryInst>(nullptr, Opcode::ADD, counter, f.i_phi);
+    f.body->insertInstructions(0, Span<Inst* const>(&next, 1));
+    counter->addIncoming(zero, f.entry);
+    counter->addIncoming(next, f.body);
+    Inst* unused = g.createInst<BinaryInst>(nullptr, Opcode::MUL, f.res_phi, f.res_phi);
+    f.exit->insertInstructions(0, Span<Inst* const>(&unused, 1));
+
+    ADCE adce(&g);
+    EXPECT_TRUE(adce.run());
+    EXPECT_EQ(adce.getNumRemoved(), 4u);
+    for (Inst* inst : {zero, counter_inst, next, unused}) {
+        EXPECT_EQ(inst->getParent(), nullptr);
+        EXPECT_FALSE(inst->hasUses());
+    }
+    EXPECT_EQ(f.header->getInstructions().size(), 4u);
+    EXPECT_EQ(evaluateIR(g, {5}), 120);
+    EXPECT_FALSE(ADCE(&g).run());
+}
+
+TEST(SimplifyCFGSuite, RemovesForwardsAndMergesBlocks) {
+    Graph g("shapes");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* forward = g.createBB("forward");
+    BasicBlock* right = g.createBB("right");
+    BasicBlock* chain = g.createBB("chain");
+    BasicBlock* merge = g.createBB("merge");
+    BasicBlock* dead = g.createBB("dead");
+    g.setStartBlock(entry);
+
+    Inst* p = g.createInst<ParamInst>(entry, 0);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    Inst* cmp = g.createInst<BinaryInst>(entry, Opcode::CMP, p, zero);
+    g.createInst<CondJumpInst>(entry, cmp, forward, right);
+    g.createInst<JumpInst>(forward, merge);
+    Inst* sum = g.createInst<BinaryInst>(right, Opcode::ADD, p, p);
+    g.createInst<JumpInst>(right, chain);
+    Inst* square = g.createInst<BinaryInst>(chain, Opcode::MUL, sum, sum);
+    g.createInst<JumpInst>(chain, merge);
+    auto* phi = g.createInst<PhiInst>(merge);
+    g.createInst<ReturnInst>(merge, phi);
+    Inst* seven = g.createInst<ConstInst>(dead, 7);
+    g.createInst<JumpInst>(dead, merge);
+    phi->addIncoming(p, forward);
+    phi->addIncoming(square, chain);
+    phi->addIncoming(seven, dead);
+    g.buildPredecessors();
+
+    SimplifyCFG simplify(&g);
+    EXPECT_TRUE(simplify.run());
+    // The dead block, and then the two that were bypassed or merged
+    EXPECT_EQ(simplify.getNumRemovedBlocks(), 3u);
+    EXPECT_EQ(simplify.getNumForwardedBlocks(), 1u);
+    EXPECT_EQ(simplify.getNumMergedBlocks(), 1u);
+    EXPECT_EQ(dumpOf(g),
+              "Function Graph: shapes\n"
+              "----------------------\n"
+              "BB0 (entry):\n"
+              "  i0 = param #0\n"
+              "  i1 = const 0\n"
+              "  i2 = cmp i0, i1\n"
+              "    cond_jump i2 -> BB2, BB1\n"
+              "BB1 (right):  ; preds = %BB0\n"
+              "  i4 = add i0, i0\n"
+              "  i5 = mul i4, i4\n"
+              "    jmp -> BB2\n"
+              "BB2 (merge):  ; preds = %BB0, %BB1\n"
+              "  i7 = phi [ [ i0, %BB0 ], [ i5, %BB1 ] ]\n"
+              "    i8 = return i7\n"
+              "----------------------\n");
+    EXPECT_EQ(evaluateIR(g, {-3}), -3);
+    EXPECT_EQ(evaluateIR(g, {3}), 36);
+    EXPECT_FALSE(SimplifyCFG(&g).run());
+}
+
+TEST(SimplifyCFGSuite, RandomProgramsKeepTheirResults) {
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        std::vector<std::vector<int64_t>> arg_sets = {{int64_t(seed) - 100, 3}, {7, -2}};
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+        size_t num_blocks = g.getBasicBlocks().size();
+
+        ADCE(&g).run();
+        EXPECT_FALSE(ADCE(&g).run()) << "seed " << seed;
+        SimplifyCFG(&g).run();
+        EXPECT_FALSE(SimplifyCFG(&g).run()) << "seed " << seed;
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[i]), expected[i]) << "seed " << seed;
+        }
+        EXPECT_LE(g.getBasicBlocks().size(), num_blocks);
+        for (unsigned id = 0; id < g.getNumInsts(); ++id) {
+            ASSERT_NE(g.getInst(id), nullptr);
+            ASSERT_EQ(g.getInst(id)->getId(), id);
+        }
+        DominatorTree after(&g);
+        after.run();
+        EXPECT_TRUE(after.verify());
+    }
+}
+
+TEST(LoopInfoSuite, FindsNestedLoopsAndPreheaders) {
+    // entry -> outer -> inner <-> inner.body; inner -> outer.latch -> outer; outer -> exit
+    Graph g("nest");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* outer = g.createBB("outer");
+    BasicBlock* inner = g.createBB("inner");
+    BasicBlock* inner_body = g.createBB("inner.body");
+    BasicBlock* outer_latch = g.createBB("outer.latch");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* cond = g.createInst<ParamInst>(entry, 0);
+    g.createInst<JumpInst>(entry, outer);
+    g.createInst<CondJumpInst>(outer, cond, inner, exit);
+    g.createInst<CondJumpInst>(inner, cond, inner_body, outer_latch);
+    g.createInst<JumpInst>(inner_body, inner);
+    g.createInst<JumpInst>(outer_latch, outer);
+    g.createInst<ReturnInst>(exit);
+    g.buildPredecessors();
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+
+    LoopInfo loops(&g, dom_tree);
+    loops.run();
+    ASSERT_EQ(loops.getNumLoops(), 2u);
+    Loop* inner_loop = loops.getLoop(0);
+    Loop* outer_loop = loops.getLoop(1);
+    EXPECT_EQ(inner_loop->getHeader(), inner);
+    EXPECT_EQ(inner_loop->getParent(), outer_loop);
+    EXPECT_EQ(inner_loop->getDepth(), 2u);
+    EXPECT_EQ(inner_loop->getBlocks(), (std::vector<BasicBlock*>{inner, inner_body}));
+    EXPECT_EQ(inner_loop->getLatches(), std::vector<BasicBlock*>{inner_body});
+    // outer -> inner is a conditional edge, so the inner loop has no preheader
+    EXPECT_EQ(inner_loop->getPreheader(), nullptr);
+    EXPECT_EQ(outer_loop->getHeader(), outer);
+    EXPECT_EQ(outer_loop->getDepth(), 1u);
+    EXPECT_EQ(outer_loop->getBlocks().size(), 4u);
+    EXPECT_EQ(outer_loop->getPreheader(), entry);
+    EXPECT_EQ(outer_loop->getSubLoops(), std::vector<Loop*>{inner_loop});
+    EXPECT_EQ(loops.getTopLevelLoops(), std::vector<Loop*>{outer_loop});
+    EXPECT_TRUE(outer_loop->contains(inner_loop));
+    EXPECT_FALSE(inner_loop->contains(outer_loop));
+
+    EXPECT_EQ(loops.getLoopFor(inner_body), inner_loop);
+    EXPECT_EQ(loops.getLoopFor(outer_latch), outer_loop);
+    EXPECT_EQ(loops.getLoopFor(exit), nullptr);
+    EXPECT_EQ(loops.getLoopDepth(inner_body), 2u);
+    EXPECT_EQ(loops.getLoopDepth(entry), 0u);
+    EXPECT_TRUE(loops.contains(outer_loop, inner_body));
+    EXPECT_FALSE(loops.contains(inner_loop, outer_latch));
+    EXPECT_TRUE(loops.isLoopHeader(outer));
+    EXPECT_TRUE(loops.isReducible());
+}
+
+TEST(LoopInfoSuite, FlagsIrreducibleRegions) {
+    Graph g("Example 3");
+    BlockMap blocks = buildNewExample3(g);
+    g.buildPredecessors();
+    AnalysisManager am(&g);
+    const LoopInfo& loops = am.getLoopInfo();
+    EXPECT_TRUE(am.isCached(Analysis::Dominators));
+
+    // B -> E -> F -> B is natural; C -> D -> G -> C is entered at C and at D
+    ASSERT_EQ(loops.getNumLoops(), 1u);
+    EXPECT_EQ(loops.getLoop(0)->getHeader(), blocks['B']);
+    EXPECT_EQ(loops.getLoop(0)->getBlocks(),
+              (std::vector<BasicBlock*>{blocks['B'], blocks['E'], blocks['F']}));
+    EXPECT_EQ(loops.getLoopFor(blocks['C']), nullptr);
+    EXPECT_FALSE(loops.isReducible());
+    ASSERT_EQ(loops.getIrreducibleEntries().size(), 1u);
+    BasicBlock* entry = loops.getIrreducibleEntries()[0];
+    EXPECT_TRUE(entry == blocks['C'] || entry == blocks['D'] || entry == blocks['G']);
+
+    // Every retreating edge into a reducible loop is a back edge
+    Graph factorial("factorial");
+    buildFactorial(factorial);
+    DominatorTree dom_tree(&factorial);
+    dom_tree.run();
+    LoopInfo factorial_loops(&factorial, dom_tree);
+    factorial_loops.run();
+    EXPECT_TRUE(factorial_loops.isReducible());
+    EXPECT_EQ(factorial_loops.getNumLoops(), 1u);
+}
+
+TEST(LICMSuite, HoistsTheFactorialConstant) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    LICM licm(&g, &dom_tree);
+    EXPECT_TRUE(licm.run());
+    EXPECT_EQ(licm.getNumHoisted(), 1u);
+    EXPECT_EQ(licm.getNumPreheadersCreated(), 0u);
+    EXPECT_EQ(f.const_1->getParent(), f.entry);
+    EXPECT_EQ(f.entry->getInstructions()[3], f.const_1);
+    EXPECT_EQ(f.body->getInstructions().size(), 3u);
+    EXPECT_EQ(evaluateIR(g, {5}), 120);
+    EXPECT_FALSE(LICM(&g, &dom_tree).run());
+}
+
+TEST(LICMSuite, CreatesPreheadersAndKeepsResults) {
+    // Two entries into the loop with different initial values need a preheader phi
+    Graph g("two entries");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* left = g.createBB("left");
+    BasicBlock* loop = g.createBB("loop");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* k = g.createInst<ParamInst>(entry, 1);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    Inst* flag = g.createInst<BinaryInst>(entry, Opcode::CMP, n, zero);
+    g.createInst<CondJumpInst>(entry, flag, left, loop);
+    Inst* ten = g.createInst<ConstInst>(left, 10);
+    g.createInst<JumpInst>(left, loop);
+    auto* acc = g.createInst<PhiInst>(loop);
+    auto* i = g.createInst<PhiInst>(loop);
+    Inst* step = g.createInst<BinaryInst>(loop, Opcode::MUL, k, k);
+    Inst* acc_next = g.createInst<BinaryInst>(loop, Opcode::ADD, acc, step);
+    Inst* one = g.createInst<ConstInst>(loop, 1);
+    Inst* i_next = g.createInst<BinaryInst>(loop, Opcode::ADD, i, one);
+    Inst* more = g.createInst<BinaryInst>(loop, Opcode::CMP, i_next, n);
+    g.createInst<CondJumpInst>(loop, more, loop, exit);
+    g.createInst<ReturnInst>(exit, acc_next);
+    acc->addIncoming(zero, entry);
+    acc->addIncoming(ten, left);
+    acc->addIncoming(acc_next, loop);
+    i->addIncoming(zero, entry);
+    i->addIncoming(zero, left);
+    i->addIncoming(i_next, loop);
+    g.buildPredecessors();
+
+    std::vector<std::vector<int64_t>> arg_sets = {{-1, 3}, {0, 3}, {4, 2}, {6, -5}};
+    std::vector<int64_t> expected;
+    for (const auto& args : arg_sets) {
+        expected.push_back(evaluateIR(g, args));
+    }
+    PassManager pm;
+    pm.addPass<LICMPass>();
+    pm.setVerifyAnalyses(true);
+    AnalysisManager am(&g);
+    PreservedAnalyses preserved = pm.run(g, am);
+    EXPECT_TRUE(preserved.isPreserved(Analysis::Dominators));
+    EXPECT_FALSE(preserved.isPreserved(Analysis::Loops));
+
+    const LoopInfo& loops = am.getLoopInfo();
+    ASSERT_EQ(loops.getNumLoops(), 1u);
+    BasicBlock* preheader = loops.getLoop(0)->getPreheader();
+    ASSERT_NE(preheader, nullptr);
+    EXPECT_EQ(preheader->getName(), "loop.preheader");
+    EXPECT_EQ(step->getParent(), preheader);
+    EXPECT_EQ(one->getParent(), preheader);
+    EXPECT_EQ(more->getParent(), loop);
+    EXPECT_EQ(acc->getNumIncoming(), 2u);  // A phi in the preheader merges 0 and 10
+    EXPECT_EQ(i->getIncomingValue(1), zero);
+    for (size_t a = 0; a < arg_sets.size(); ++a) {
+        EXPECT_EQ(evaluateIR(g, arg_sets[a]), expected[a]);
+    }
+
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph random("random");
+        buildRandomArithmeticProgram(random, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&random);
+        dom_tree.run();
+        Mem2Reg(&random, dom_tree).run();
+        std::vector<int64_t> results;
+        for (const auto& args : arg_sets) {
+            results.push_back(evaluateIR(random, args));
+        }
+        LICM(&random, &dom_tree).run();
+        EXPECT_TRUE(dom_tree.verify()) << "seed " << seed;
+        for (size_t a = 0; a < arg_sets.size(); ++a) {
+            ASSERT_EQ(evaluateIR(random, arg_sets[a]), results[a]) << "seed " << seed;
+        }
+        EXPECT_FALSE(LICM(&random, &dom_tree).run()) << "seed " << seed;
+    }
+}
+
+TEST(InductionVariablesSuite, FactorialCounterAndTripCount) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    LoopInfo loops(&g, dom_tree);
+    loops.run();
+    ASSERT_EQ(loops.getNumLoops(), 1u);
+    const Loop* loop = loops.getLoop(0);
+
+    InductionVariables ivs(&g, loops, dom_tree);
+    ivs.run();
+    EXPECT_EQ(ivs.getInductionVariables(loop), std::vector<PhiInst*>{f.i_phi});
+    EXPECT_EQ(ivs.getIncrementChain(f.i_phi), std::vector<Inst*>{f.i_new});
+    const Recurrence* i = ivs.getRecurrence(f.i_phi);
+    ASSERT_NE(i, nullptr);
+    EXPECT_TRUE(i->hasConstantStart());
+    EXPECT_EQ(i->offset, 2);
+    EXPECT_EQ(i->step, 1);
+    EXPECT_EQ(ivs.getRecurrence(f.i_new)->offset, 3);
+    // The multiply-accumulator is not affine
+    EXPECT_EQ(ivs.getRecurrence(f.res_phi), nullptr);
+    EXPECT_EQ(ivs.getRecurrence(f.res_new), nullptr);
+    EXPECT_EQ(ivs.getExitingBlock(loop), f.header);
+    EXPECT_FALSE(ivs.hasConstantBackedgeTakenCount(loop));
+
+    // With n = 5 the body runs for i = 2..5
+    Inst* five = g.createInst<ConstInst>(nullptr, 5);
+    f.entry->insertInstructions(0, Span<Inst* const>(&five, 1));
+    f.n->replaceAllUsesWith(five);
+    ivs.run();
+    ASSERT_TRUE(ivs.hasConstantBackedgeTakenCount(loop));
+    EXPECT_EQ(ivs.getBackedgeTakenCount(loop), 4u);
+
+    // Counting down on a reversed test: continue while !(i <= 0), from 7 by -3
+    Inst* seven = g.createInst<ConstInst>(nullptr, 7);
+    Inst* zero = g.createInst<ConstInst>(nullptr, 0);
+    Inst* minus_three = g.createInst<ConstInst>(nullptr, -3);
+    Inst* consts[] = {seven, zero, minus_three};
+    f.entry->insertInstructions(0, Span<Inst* const>(consts, 3));
+    f.i_phi->setOperand(0, seven);
+    f.i_new->setOperand(1, minus_three);
+    f.cmp->setOperand(1, zero);
+    auto* jump = static_cast<CondJumpInst*>(f.header->getTerminator());
+    f.header->removeInstructionsIf([&](Inst* inst) { return inst == jump; });
+    jump->dropAllReferences();
+    g.createInst<CondJumpInst>(f.header, f.cmp, f.exit, f.body);
+    g.buildPredecessors();
+    ivs.run();
+    EXPECT_EQ(ivs.getRecurrence(f.i_phi)->step, -3);
+    ASSERT_TRUE(ivs.hasConstantBackedgeTakenCount(loop));
+    EXPECT_EQ(ivs.getBackedgeTakenCount(loop), 3u);  // 7, 4, 1
+}
+
+TEST(IndVarSimplifySuite, ReducesStrengthAndReplacesExitValues) {
+    // sum += i * 8 for i = 0..99, then return sum + i
+    Graph g("counted");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("header");
+    BasicBlock* body = g.createBB("body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* zero = g.createInst<ConstInst>(entry, 0);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    Inst* eight = g.createInst<ConstInst>(entry, 8);
+    Inst* bound = g.createInst<ConstInst>(entry, 99);
+    g.createInst<JumpInst>(entry, header);
+    auto* sum = g.createInst<PhiInst>(header);
+    auto* i = g.createInst<PhiInst>(header);
+    Inst* more = g.createInst<BinaryInst>(header, Opcode::CMP, i, bound);
+    g.createInst<CondJumpInst>(header, more, body, exit);
+    Inst* scaled = g.createInst<BinaryInst>(body, Opcode::MUL, i, eight);
+    Inst* sum_next = g.createInst<BinaryInst>(body, Opcode::ADD, sum, scaled);
+    Inst* i_next = g.createInst<BinaryInst>(body, Opcode::ADD, i, one);
+    g.createInst<JumpInst>(body, header);
+    Inst* result = g.createInst<BinaryInst>(exit, Opcode::ADD, sum, i);
+    g.createInst<ReturnInst>(exit, result);
+    sum->addIncoming(zero, entry);
+    sum->addIncoming(sum_next, body);
+    i->addIncoming(zero, entry);
+    i->addIncoming(i_next, body);
+    g.buildPredecessors();
+    ASSERT_EQ(evaluateIR(g, {}), 8 * 4950 + 100);
+
+    PassManager pm;
+    pm.addPass<IndVarSimplifyPass>();
+    AnalysisManager am(&g);
+    PreservedAnalyses preserved = pm.run(g, am);
+    EXPECT_TRUE(preserved.isPreserved(Analysis::Loops));
+    EXPECT_TRUE(am.isCached(Analysis::Loops));
+    EXPECT_EQ(evaluateIR(g, {}), 8 * 4950 + 100);
+
+    // The MUL became a phi stepping by 8, which now also drives the exit test, and i is gone:
+    // the loop goes on while the phi is below 8 * 100
+    EXPECT_EQ(scaled->getParent(), nullptr);
+    EXPECT_EQ(i->getParent(), nullptr);
+    EXPECT_EQ(i_next->getParent(), nullptr);
+    EXPECT_EQ(more->getParent(), nullptr);
+    Span<Inst* const> insts = header->getInstructions();
+    ASSERT_EQ(insts.size(), 4u);
+    ASSERT_EQ(insts[0]->getOpcode(), Opcode::PHI);
+    Inst* offset = insts[0];
+    EXPECT_EQ(sum_next->getOperand(1), offset);
+    Inst* test = insts[2];
+    ASSERT_EQ(test->getOpcode(), Opcode::CMP);
+    EXPECT_EQ(test->getOperand(0), offset);
+    ASSERT_EQ(test->getOperand(1)->getOpcode(), Opcode::CONST);
+    EXPECT_EQ(static_cast<ConstInst*>(test->getOperand(1))->getValue(), 8 * 100 - 1);
+    // i after the loop is the constant 100
+    ASSERT_EQ(result->getOperand(1)->getOpcode(), Opcode::CONST);
+    EXPECT_EQ(static_cast<ConstInst*>(result->getOperand(1))->getValue(), 100);
+    EXPECT_EQ(result->getOperand(1)->getParent(), entry);
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    LoopInfo loops(&g, dom_tree);
+    loops.run();
+    EXPECT_FALSE(IndVarSimplify(&g, loops, dom_tree).run());
+}
+
+// Code after `bb` for a counted loop of random shape: a basic induction variable with a
+// random step, maybe a duplicate of it, a multiple of it, an accumulator, an exit test in
+// the header or in the latch, and maybe a nested loop in the body. The loop starts at a
+// constant, or at `start` which then only changes the trip count. Returns the block after
+// the loop and in *result a value computed from the loop's exit values.
+static BasicBlock* buildRandomCountedLoop(Graph& g, std::mt19937& rng, BasicBlock* bb,
+                                          Inst* start, unsigned depth, Inst** result) {
+    auto constant = [&](int64_t value) { return g.createInst<ConstInst>(bb, value); };
+    int64_t step = 1 + int64_t(rng() % 3);
+    step = rng() % 2 == 0 ? step : -step;
+    int64_t start_value = int64_t(rng() % 41) - 20;
+    Inst* init = rng() % 4 == 0 ? start : constant(start_value);
+    Inst* dup_init = init != start ? constant(start_value + int64_t(rng() % 3)) : init;
+    Inst* step_value = constant(step);
+    Inst* factor = constant(int64_t(rng() % 9) - 4);
+    Inst* acc_init = constant(0);
+    bool test_at_latch = rng() % 2 == 0;
+    bool with_dup = rng() % 2 == 0;
+    // Continue while the tested value is <= limit when climbing, >= limit when descending
+    int64_t first = test_at_latch ? start_value + step : start_value;
+    int64_t trips = rng() % 12;
+    int64_t limit = step > 0 ? first + step * trips - 1 : first + step * trips + 1;
+    bool continue_on_true = rng() % 2 == 0;
+    Inst* bound = constant(continue_on_true ? limit : step > 0 ? limit + 1 : limit - 1);
+
+    BasicBlock* header = g.createBB();
+    BasicBlock* exit = g.createBB();
+    g.createInst<JumpInst>(bb, header);
+    auto* i = g.createInst<PhiInst>(header);
+    auto* dup = with_dup ? g.createInst<PhiInst>(header) : nullptr;
+    auto* acc = g.createInst<PhiInst>(header);
+    Inst* scaled = g.createInst<BinaryInst>(header, Opcode::MUL, i, factor);
+    Inst* acc_next = nullptr;
+    Inst* i_next = nullptr;
+    Inst* dup_next = nullptr;
+    BasicBlock* latch = header;
+    auto test = [&](BasicBlock* block, Inst* value, BasicBlock* stay) {
+        // climbing: value <= limit, or !(limit + 1 <= value); descending the mirror image
+        bool value_first = (step > 0) == continue_on_true;
+        Inst* cmp = value_first ? g.createInst<BinaryInst>(block, Opcode::CMP, value, bound)
+                                : g.createInst<BinaryInst>(block, Opcode::CMP, bound, value);
+        if (continue_on_true) {
+            g.createInst<CondJumpInst>(block, cmp, stay, exit);
+        } else {
+            g.createInst<CondJumpInst>(block, cmp, exit, stay);
+        }
+    };
+    auto increment = [&](BasicBlock* block, Inst* addend) {
+        acc_next = g.createInst<BinaryInst>(block, Opcode::ADD, acc, addend);
+        i_next = g.createInst<BinaryInst>(block, Opcode::ADD, i, step_value);
+        if (dup != nullptr) {
+            dup_next = g.createInst<BinaryInst>(block, Opcode::ADD, step_value, dup);
+        }
+    };
+    if (test_at_latch) {
+        increment(header, scaled);
+        test(header, i_next, header);
+    } else {
+        BasicBlock* body = g.createBB();
+        test(header, i, body);
+        latch = body;
+        Inst* addend = scaled;
+        if (depth < 2 && rng() % 3 == 0) {
+            latch = buildRandomCountedLoop(g, rng, body, i, depth + 1, &addend);
+        }
+        increment(latch, addend);
+        g.createInst<JumpInst>(latch, header);
+    }
+    i->addIncoming(init, bb);
+    i->addIncoming(i_next, latch);
+    if (dup != nullptr) {
+        dup->addIncoming(dup_init, bb);
+        dup->addIncoming(dup_next, latch);
+    }
+    acc->addIncoming(acc_init, bb);
+    acc->addIncoming(acc_next, latch);
+
+    Inst* value = g.createInst<BinaryInst>(exit, Opcode::ADD, acc, scaled);
+    value = g.createInst<BinaryInst>(exit, Opcode::ADD, value, test_at_latch ? i_next : i);
+    if (dup != nullptr) {
+        Inst* seven = g.createInst<ConstInst>(exit, 7);
+        Inst* weighted = g.createInst<BinaryInst>(exit, Opcode::MUL, dup, seven);
+        value = g.createInst<BinaryInst>(exit, Opcode::ADD, value, weighted);
+    }
+    *result = value;
+    return exit;
+}
+
+TEST(IndVarSimplifySuite, RandomCountedLoopsKeepTheirResults) {
+    unsigned num_reduced = 0;
+    unsigned num_exit_values = 0;
+    unsigned num_exit_tests = 0;
+    unsigned num_eliminated = 0;
+    std::vector<std::vector<int64_t>> arg_sets = {{0}, {5}, {-7}};
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("counted");
+        std::mt19937 rng(seed);
+        BasicBlock* bb = g.createBB("entry");
+        g.setStartBlock(bb);
+        Inst* total = g.createInst<ParamInst>(bb, 0);
+        for (unsigned loops = 1 + rng() % 2; loops > 0; --loops) {
+            Inst* result = nullptr;
+            bb = buildRandomCountedLoop(g, rng, bb, total, 0, &result);
+            total = g.createInst<BinaryInst>(bb, Opcode::ADD, total, result);
+        }
+        g.createInst<ReturnInst>(bb, total);
+        g.buildPredecessors();
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        LoopInfo loops(&g, dom_tree);
+        loops.run();
+        IndVarSimplify indvars(&g, loops, dom_tree);
+        indvars.run();
+        num_reduced += indvars.getNumStrengthReduced();
+        num_exit_values += indvars.getNumExitValuesReplaced();
+        num_exit_tests += indvars.getNumExitTestsReplaced();
+        num_eliminated += indvars.getNumEliminated();
+        for (size_t a = 0; a < arg_sets.size(); ++a) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[a]), expected[a]) << "seed " << seed;
+        }
+        EXPECT_FALSE(IndVarSimplify(&g, loops, dom_tree).run()) << "seed " << seed;
+    }
+    EXPECT_GT(num_reduced, 0u);
+    EXPECT_GT(num_exit_values, 0u);
+    EXPECT_GT(num_exit_tests, 0u);
+    EXPECT_GT(num_eliminated, 0u);
+
+    // Loops of arbitrary shape, with preheaders from LICM
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        LICM(&g, &dom_tree).run();
+        std::vector<std::vector<int64_t>> random_args = {{}, {int64_t(seed) - 100, 3}, {7, -2}};
+        std::vector<int64_t> expected;
+        for (const auto& args : random_args) {
+            expected.push_back(evaluateIR(g, args));
+        }
+        LoopInfo loops(&g, dom_tree);
+        loops.run();
+        IndVarSimplify(&g, loops, dom_tree).run();
+        for (size_t a = 0; a < random_args.size(); ++a) {
+            ASSERT_EQ(evaluateIR(g, random_args[a]), expected[a]) << "seed " << seed;
+        }
+    }
+}
+
+TEST(LivenessSuite, FactorialLoop) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    Inst* res_init = f.res_phi->getIncomingValue(0);
+    Inst* i_init = f.i_phi->getIncomingValue(0);
+    Liveness liveness(&g);
+    liveness.run();
+    auto asSet = [](const std::vector<Inst*>& values) {
+        return std::set<Inst*>(values.begin(), values.end());
+    };
+
+    // Phi inputs are live-out of their predecessor only, phis are defined in their block
+    EXPECT_EQ(asSet(liveness.getLiveIn(f.entry)), std::set<Inst*>{});
+    EXPECT_EQ(asSet(liveness.getLiveOut(f.entry)), (std::set<Inst*>{f.n, res_init, i_init}));
+    EXPECT_EQ(asSet(liveness.getLiveIn(f.header)), std::set<Inst*>{f.n});
+    EXPECT_EQ(asSet(liveness.getLiveOut(f.header)),
+              (std::set<Inst*>{f.n, f.res_phi, f.i_phi}));
+    EXPECT_EQ(asSet(liveness.getLiveIn(f.body)), (std::set<Inst*>{f.n, f.res_phi, f.i_phi}));
+    EXPECT_EQ(asSet(liveness.getLiveOut(f.body)), (std::set<Inst*>{f.n, f.res_new, f.i_new}));
+    EXPECT_EQ(asSet(liveness.getLiveIn(f.exit)), std::set<Inst*>{f.res_phi});
+    EXPECT_EQ(asSet(liveness.getLiveOut(f.exit)), std::set<Inst*>{});
+    EXPECT_TRUE(liveness.isLiveOut(res_init, f.entry));
+    EXPECT_FALSE(liveness.isLiveIn(res_init, f.header));
+    EXPECT_FALSE(liveness.isLiveOut(f.res_phi, f.body));
+
+    // Values read only in their own block get no index
+    EXPECT_EQ(liveness.getNumValues(), 7u);
+    EXPECT_EQ(liveness.getIndex(f.const_1), Liveness::kNoIndex);
+    EXPECT_EQ(liveness.getIndex(f.cmp), Liveness::kNoIndex);
+    EXPECT_FALSE(liveness.isLiveOut(f.cmp, f.header));
+    for (unsigned i = 0; i < liveness.getNumValues(); ++i) {
+        EXPECT_EQ(liveness.getIndex(liveness.getValue(i)), i);
+    }
+    // Entry values come first
+    EXPECT_LT(liveness.getIndex(f.n), liveness.getIndex(f.res_phi));
+}
+
+// Live blocks of one value by walking back from each use to the definition
+static void markLiveByPaths(Inst* value, const CFGTraversal& traversal,
+                            std::vector<std::set<Inst*>>& live_in,
+                            std::vector<std::set<Inst*>>& live_out) {
+    BasicBlock* def = value->getParent();
+    std::vector<BasicBlock*> worklist;
+    auto liveAtEnd = [&](BasicBlock* bb) {
+        if (traversal.isReachable(bb) && live_out[bb->getId()].insert(value).second &&
+            bb != def) {
+            worklist.push_back(bb);
+        }
+    };
+    for (Inst* user : value->getUsers()) {
+        if (user->getOpcode() == Opcode::PHI) {
+            for (auto [incoming, pred] : static_cast<PhiInst*>(user)->getIncoming()) {
+                if (incoming == value) {
+                    liveAtEnd(pred);
+                }
+            }
+        } else if (user->getParent() != def && traversal.isReachable(user->getParent())) {
+            worklist.push_back(user->getParent());
+        }
+    }
+    while (!worklist.empty()) {
+        BasicBlock* bb = worklist.back();
+        worklist.pop_back();
+        if (live_in[bb->getId()].insert(value).second) {
+            for (BasicBlock* pred : bb->getPredecessors()) {
+                liveAtEnd(pred);
+            }
+        }
+    }
+}
+
+TEST(LivenessSuite, RandomProgramsMatchPathExploration) {
+    bool saw_wide_rows = false;
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        Graph g("random");
+        unsigned num_blocks = seed % 10 == 0 ? 300 : 1 + seed % 30;
+        buildRandomArithmeticProgram(g, num_blocks, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        CFGTraversal traversal(&g);
+        traversal.run();
+        std::vector<std::set<Inst*>> live_in(g.getBasicBlocks().size());
+        std::vector<std::set<Inst*>> live_out(g.getBasicBlocks().size());
+        for (BasicBlock* bb : traversal.getReversePostOrder()) {
+            for (Inst* inst : bb->getInstructions()) {
+                markLiveByPaths(inst, traversal, live_in, live_out);
+            }
+        }
+
+        Liveness liveness(&g);
+        liveness.run();
+        saw_wide_rows |= liveness.getNumValues() > 256;
+        for (BasicBlock* bb : g.getBasicBlocks()) {
+            for (Inst* inst : bb->getInstructions()) {
+                for (BasicBlock* at : g.getBasicBlocks()) {
+                    ASSERT_EQ(liveness.isLiveIn(inst, at), live_in[at->getId()].count(inst) != 0)
+                        << "seed " << seed << " i" << inst->getId() << " BB" << at->getId();
+                    ASSERT_EQ(liveness.isLiveOut(inst, at),
+                              live_out[at->getId()].count(inst) != 0)
+                        << "seed " << seed << " i" << inst->getId() << " BB" << at->getId();
+                }
+            }
+        }
+    }
+    EXPECT_TRUE(saw_wide_rows);
+}
+
+// MovInsts of a block, in order
+static std::vector<Inst*> movesOf(const BasicBlock* bb) {
+    std::vector<Inst*> moves;
+    for (Inst* inst : bb->getInstructions()) {
+        if (inst->getOpcode() == Opcode::MOV) {
+            moves.push_back(inst);
+        }
+    }
+    return moves;
+}
+
+static size_t countBytecode(const Interpreter& interpreter, BytecodeOp op) {
+    return std::count_if(interpreter.getCode().begin(), interpreter.getCode().end(),
+                         [op](const BytecodeInstr& instr) { return instr.op == op; });
+}
+
+TEST(OutOfSSASuite, FactorialCopiesOnlyTheInitialConstants) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    OutOfSSA lowering(&g);
+    EXPECT_TRUE(lowering.run());
+
+    // The back edge is coalesced; constants keep their own storage, so the entry copies them
+    EXPECT_EQ(lowering.getNumEdgesSplit(), 0u);
+    EXPECT_EQ(lowering.getNumPhiCopies(), 4u);
+    EXPECT_EQ(lowering.getNumCoalesced(), 2u);
+    EXPECT_EQ(lowering.getNumMoves(), 2u);
+    EXPECT_EQ(lowering.getNumTemporaries(), 0u);
+    std::vector<Inst*> moves = movesOf(f.entry);
+    ASSERT_EQ(moves.size(), 2u);
+    EXPECT_EQ(f.entry->getTerminator()->getOpcode(), Opcode::JUMP);
+    EXPECT_EQ(f.res_phi->getIncomingValue(0), moves[0]);
+    EXPECT_EQ(f.i_phi->getIncomingValue(0), moves[1]);
+    EXPECT_EQ(f.res_phi->getIncomingValue(1), f.res_new);
+    EXPECT_TRUE(movesOf(f.body).empty());
+
+    EXPECT_EQ(lowering.getNumVariables(), 2u);
+    EXPECT_EQ(lowering.getVariable(f.res_phi), lowering.getVariable(f.res_new));
+    EXPECT_EQ(lowering.getVariable(f.res_phi), lowering.getVariable(moves[0]));
+    EXPECT_EQ(lowering.getVariable(f.i_phi), lowering.getVariable(f.i_new));
+    EXPECT_NE(lowering.getVariable(f.i_phi), lowering.getVariable(f.res_phi));
+    EXPECT_EQ(lowering.getVariable(f.n), OutOfSSA::kNoVariable);
+
+    // With one slot per variable, the two entry moves are all the copying there is
+    Interpreter interpreter(&g);
+    interpreter.setVariables(lowering.getVariables());
+    ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+    EXPECT_EQ(countBytecode(interpreter, BytecodeOp::MOV), 2u);
+    EXPECT_EQ(interpreter.execute({5}), 120);
+    EXPECT_EQ(interpreter.execute({1}), 1);
+    EXPECT_FALSE(OutOfSSA(&g).run());
+}
+
+TEST(OutOfSSASuite, PhiSwapNeedsATemporary) {
+    Graph g("swap");
+    buildPhiSwap(g);
+    std::ostringstream report;
+    AnalysisManager am(&g);
+    PassManager pm;
+    pm.addPass<OutOfSSAPass>(&report);
+    PreservedAnalyses preserved = pm.run(g, am);
+    EXPECT_TRUE(preserved.isPreserved(Analysis::Predecessors));
+    EXPECT_FALSE(preserved.isPreserved(Analysis::Dominators));
+
+    // All four edges are critical. On the back edge i is coalesced with its increment, and
+    // a and b swap through a temporary; the loop's result needs no copy into the exit.
+    EXPECT_EQ(report.str(),
+              "out-of-ssa swap: 8 phi copies, 2 coalesced, 7 moves (1 through a temporary), "
+              "4 edges split\n");
+    ASSERT_EQ(g.getBasicBlocks().size(), 7u);
+    BasicBlock* loop = g.getBasicBlocks()[1];
+    auto* cond_jump = static_cast<CondJumpInst*>(loop->getTerminator());
+    BasicBlock* back_edge = cond_jump->getTrueTarget();
+    EXPECT_EQ(back_edge->getName(), "loop.split");
+    EXPECT_EQ(movesOf(back_edge).size(), 3u);
+    for (BasicBlock* bb : g.getBasicBlocks()) {
+        if (bb->getSuccessors().size() > 1) {
+            for (BasicBlock* succ : bb->getSuccessors()) {
+                EXPECT_EQ(succ->getPredecessors().size(), 1u);
+            }
+        }
+    }
+
+    Interpreter interpreter(&g);
+    ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+    OutOfSSA lowering(&g);
+    EXPECT_FALSE(lowering.run());
+    Interpreter lowered(&g);
+    lowered.setVariables(lowering.getVariables());
+    ASSERT_TRUE(lowered.compile()) << lowered.getError();
+    EXPECT_EQ(countBytecode(lowered, BytecodeOp::MOV), 7u);
+    JitFunction jit(&g);
+    bool has_jit = JitFunction::isSupported() && jit.compile();
+    for (int64_t arg = -2; arg <= 7; ++arg) {
+        int64_t expected = arg < 0 ? -1 : arg % 2 == 0 ? 12 : 21;
+        EXPECT_EQ(evaluateIR(g, {arg}), expected) << "n = " << arg;
+        EXPECT_EQ(interpreter.execute({arg}), expected) << "n = " << arg;
+        EXPECT_EQ(lowered.execute({arg}), expected) << "n = " << arg;
+        if (has_jit) {
+            EXPECT_EQ(jit(arg), expected) << "n = " << arg;
+        }
+    }
+
+    // MOV reads back from the text form
+    std::string text = dumpOf(g);
+    Graph parsed("");
+    IRParser parser(&parsed);
+    ASSERT_TRUE(parser.parse(text)) << parser.getError() << "\n" << text;
+    EXPECT_EQ(dumpOf(parsed), text);
+}
+
+TEST(OutOfSSASuite, FusedCompareReadsItsOperandsBeforeTheyAreOverwritten) {
+    // The increment of i sits between the compare and its branch, in the class of i
+    Graph g("increment_before_branch");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* header = g.createBB("loop.header");
+    BasicBlock* body = g.createBB("loop.body");
+    BasicBlock* exit = g.createBB("exit");
+    g.setStartBlock(entry);
+    Inst* n = g.createInst<ParamInst>(entry, 0);
+    Inst* i_init = g.createInst<ConstInst>(entry, 0);
+    Inst* res_init = g.createInst<ConstInst>(entry, 1);
+    Inst* one = g.createInst<ConstInst>(entry, 1);
+    g.createInst<JumpInst>(entry, header);
+    auto* i_phi = g.createInst<PhiInst>(header);
+    auto* res_phi = g.createInst<PhiInst>(header);
+    Inst* cmp = g.createInst<BinaryInst>(header, Opcode::CMP, i_phi, n);
+    Inst* i_new = g.createInst<BinaryInst>(header, Opcode::ADD, i_phi, one);
+    g.createInst<CondJumpInst>(header, cmp, body, exit);
+    Inst* res_new = g.createInst<BinaryInst>(body, Opcode::MUL, res_phi, i_new);
+    g.createInst<JumpInst>(body, header);
+    g.createInst<ReturnInst>(exit, res_phi);
+    i_phi->addIncoming(i_init, entry);
+    i_phi->addIncoming(i_new, body);
+    res_phi->addIncoming(res_init, entry);
+    res_phi->addIncoming(res_new, body);
+    g.buildPredecessors();
+
+    OutOfSSA lowering(&g);
+    lowering.run();
+    ASSERT_EQ(lowering.getVariable(i_new), lowering.getVariable(i_phi));
+    Interpreter lowered(&g);
+    lowered.setVariables(lowering.getVariables());
+    ASSERT_TRUE(lowered.compile()) << lowered.getError();
+    EXPECT_EQ(countBytecode(lowered, BytecodeOp::CMP), 1u);
+    for (int64_t arg = -1; arg <= 5; ++arg) {
+        EXPECT_EQ(lowered.execute({arg}), evaluateIR(g, {arg})) << "n = " << arg;
+    }
+    EXPECT_EQ(lowered.execute({4}), 120);
+}
+
+TEST(OutOfSSASuite, RandomProgramsKeepTheirResults) {
+    unsigned phi_copies = 0;
+    unsigned coalesced = 0;
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        std::vector<std::vector<int64_t>> arg_sets = {{int64_t(seed) - 100, 3}, {7, -2}};
+        std::vector<int64_t> expected;
+        for (const auto& args : arg_sets) {
+            expected.push_back(evaluateIR(g, args));
+        }
+
+        OutOfSSA lowering(&g);
+        lowering.run();
+        phi_copies += lowering.getNumPhiCopies();
+        coalesced += lowering.getNumCoalesced();
+        ASSERT_EQ(lowering.getNumPhiCopies(),
+                  lowering.getNumCoalesced() + lowering.getNumMoves() -
+                      lowering.getNumTemporaries())
+            << "seed " << seed;
+        // Every phi shares its variable with all of its inputs
+        CFGTraversal traversal(&g);
+        traversal.run();
+        for (BasicBlock* bb : traversal.getReversePostOrder()) {
+            for (Inst* inst : bb->getInstructions()) {
+                if (inst->getOpcode() != Opcode::PHI) {
+                    continue;
+                }
+                ASSERT_NE(lowering.getVariable(inst), OutOfSSA::kNoVariable);
+                for (auto [value, pred] : static_cast<PhiInst*>(inst)->getIncoming()) {
+                    if (traversal.isReachable(pred)) {
+                        ASSERT_EQ(lowering.getVariable(value), lowering.getVariable(inst))
+                            << "seed " << seed;
+                    }
+                }
+            }
+        }
+
+        Interpreter interpreter(&g);
+        ASSERT_TRUE(interpreter.compile()) << interpreter.getError();
+        Interpreter lowered(&g);
+        lowered.setVariables(lowering.getVariables());
+        ASSERT_TRUE(lowered.compile()) << lowered.getError();
+        EXPECT_EQ(countBytecode(lowered, BytecodeOp::MOV), lowering.getNumMoves());
+        for (size_t i = 0; i < arg_sets.size(); ++i) {
+            ASSERT_EQ(evaluateIR(g, arg_sets[i]), expected[i]) << "seed " << seed;
+            ASSERT_EQ(interpreter.execute(arg_sets[i]), expected[i]) << "seed " << seed;
+            ASSERT_EQ(lowered.execute(arg_sets[i]), expected[i]) << "seed " << seed;
+        }
+    }
+    // Most copies disappear
+    EXPECT_GT(coalesced * 2, phi_copies);
+}
+
+// Runs a graph on the locations of an allocation alone, as an emitter would: registers,
+// stack slots and a scratch cell, with parameters stored before the first block, fused
+// compares evaluated by their branch and the edge moves applied one at a time
+static int64_t runAllocated(const Graph& g, const LinearScan& allocation,
+                            const std::vector<int64_t>& args) {
+    std::vector<int64_t> registers(allocation.getNumRegisters(), -1);
+    std::vector<int64_t> slots(allocation.getNumStackSlots(), -1);
+    int64_t scratch = -1;
+    auto cell = [&](Location location) -> int64_t& {
+        if (location.kind == Location::REGISTER) {
+            return registers.at(location.index);
+        }
+        if (location.kind == Location::STACK_SLOT) {
+            return slots.at(location.index);
+        }
+        EXPECT_EQ(location.kind, Location::SCRATCH);
+        return scratch;
+    };
+    auto read = [&](const Inst* value, Location location) {
+        return location.kind == Location::CONSTANT
+                   ? static_cast<const ConstInst*>(value)->getValue()
+                   : cell(location);
+    };
+    auto valueOf = [&](const Inst* value) { return read(value, allocation.getLocation(value)); };
+    auto takeEdge = [&](const BasicBlock* pred, const BasicBlock* succ) {
+        for (const EdgeMove& move : allocation.getEdgeMoves(pred, succ)) {
+            cell(move.dst) = read(move.value, move.src);
+        }
+    };
+
+    for (BasicBlock* bb : allocation.getBlockOrder()) {
+        for (Inst* inst : bb->getInstructions()) {
+            if (inst->getOpcode() == Opcode::PARAM &&
+                allocation.getLocation(inst).kind != Location::NONE) {
+                unsigned index = static_cast<ParamInst*>(inst)->getIndex();
+                cell(allocation.getLocation(inst)) = index < args.size() ? args[index] : 0;
+            }
+        }
+    }
+    const BasicBlock* bb = g.getStartBlock();
+    for (;;) {
+        const BasicBlock* next = nullptr;
+        for (Inst* inst : bb->getInstructions()) {
+            Location location = allocation.getLocation(inst);
+            switch (inst->getOpcode()) {
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::CMP: {
+                    if (location.kind == Location::NONE) {
+                        break;
+                    }
+                    int64_t lhs = valueOf(inst->getOperand(0));
+                    int64_t rhs = valueOf(inst->getOperand(1));
+                    cell(location) = inst->getOpcode() == Opcode::ADD
+                                         ? int64_t(uint64_t(lhs) + uint64_t(rhs))
+                                     : inst->getOpcode() == Opcode::MUL
+                                         ? int64_t(uint64_t(lhs) * uint64_t(rhs))
+                                         : lhs <= rhs;
+                    break;
+                }
+                case Opcode::MOV:
+                    if (location.kind != Location::NONE) {
+                        cell(location) = valueOf(inst->getOperand(0));
+                    }
+                    break;
+                case Opcode::JUMP:
+                    next = static_cast<JumpInst*>(inst)->getTarget();
+                    break;
+                case Opcode::COND_JUMP: {
+                    auto* cond_jump = static_cast<CondJumpInst*>(inst);
+                    Inst* cond = cond_jump->getOperand(0);
+                    bool taken = LinearScan::isFusedCompare(cond)
+                                     ? valueOf(cond->getOperand(0)) <=
+                                           valueOf(cond->getOperand(1))
+                                     : valueOf(cond) != 0;
+                    next = taken ? cond_jump->getTrueTarget() : cond_jump->getFalseTarget();
+                    break;
+                }
+                case Opcode::RETURN:
+                    return inst->getNumOperands() ? valueOf(inst->getOperand(0)) : 0;
+                default:
+                    break;
+            }
+        }
+        takeEdge(bb, next);
+        bb = next;
+    }
+}
+
+// No two values whose intervals overlap share a register or a stack slot
+static void expectDisjointLocations(const Graph& g, const LinearScan& allocation) {
+    std::map<std::pair<int, unsigned>, std::vector<const Inst*>> holders;
+    for (BasicBlock* bb : allocation.getBlockOrder()) {
+        for (Inst* inst : bb->getInstructions()) {
+            Location location = allocation.getLocation(inst);
+            if (location.kind == Location::REGISTER || location.kind == Location::STACK_SLOT) {
+                ASSERT_FALSE(allocation.getRanges(inst).empty());
+                holders[{location.kind, location.index}].push_back(inst);
+            }
+        }
+    }
+    for (const auto& [location, values] : holders) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            for (size_t j = i + 1; j < values.size(); ++j) {
+                for (const LiveRange& a : allocation.getRanges(values[i])) {
+                    for (const LiveRange& b : allocation.getRanges(values[j])) {
+                        ASSERT_TRUE(a.to <= b.from || b.to <= a.from)
+                            << g.getName() << ": i" << values[i]->getId() << " and i"
+                            << values[j]->getId() << " share a location";
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(LinearScanSuite, FactorialLoopNeedsNoBackEdgeMoves) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+    LinearScan allocation(&g, 4);
+    allocation.run();
+
+    // The compare is fused into the branch, which keeps n live through the loop. res is
+    // dead in the body after the multiply, so its interval has a hole until the exit. The
+    // new values take the registers of their phis: only the entry edge has moves.
+    std::ostringstream os;
+    allocation.dump(os);
+    EXPECT_EQ(os.str(),
+              "Layout: BB0 [0, 10) BB1 [10, 20) BB2 [20, 30) BB3 [30, 34)\n"
+              "Intervals:\n"
+              "  i0: [0, 30) -> r0\n"
+              "  i4: [10, 22) [30, 32) -> r1\n"
+              "  i5: [10, 26) -> r2\n"
+              "  i8: [22, 30) -> r1\n"
+              "  i10: [26, 30) -> r2\n"
+              "Edge moves:\n"
+              "  BB0 -> BB1: r1 = 1, r2 = 2\n");
+    EXPECT_EQ(allocation.getLocation(f.cmp).kind, Location::NONE);
+    EXPECT_EQ(allocation.getLocation(f.const_1).kind, Location::CONSTANT);
+    EXPECT_EQ(allocation.getPosition(f.cmp), 16u);
+    EXPECT_TRUE(allocation.getEdgeMoves(f.body, f.header).empty());
+    EXPECT_EQ(allocation.getNumSpilled(), 0u);
+    EXPECT_EQ(allocation.getNumPhiCopies(), 4u);
+    EXPECT_EQ(allocation.getNumEdgeMoves(), 2u);
+    for (int64_t n = -1; n <= 12; ++n) {
+        EXPECT_EQ(runAllocated(g, allocation, {n}), evaluateIR(g, {n})) << "n = " << n;
+    }
+
+    // With two registers, n goes to the stack: it is the longest interval and is only read
+    // once per iteration
+    LinearScan tight(&g, 2);
+    tight.run();
+    EXPECT_EQ(tight.getLocation(f.n), Location::slot(0));
+    EXPECT_EQ(tight.getLocation(f.res_phi).kind, Location::REGISTER);
+    EXPECT_EQ(tight.getLocation(f.i_phi).kind, Location::REGISTER);
+    EXPECT_EQ(tight.getNumSpilled(), 1u);
+    EXPECT_EQ(tight.getNumEvicted(), 1u);
+    EXPECT_EQ(tight.getNumStackSlots(), 1u);
+    for (int64_t n = -1; n <= 12; ++n) {
+        EXPECT_EQ(runAllocated(g, tight, {n}), evaluateIR(g, {n})) << "n = " << n;
+    }
+}
+
+TEST(LinearScanSuite, PhiSwapBreaksItsCycleThroughScratch) {
+    Graph g("swap");
+    buildPhiSwap(g);
+    LinearScan allocation(&g, 8);
+    allocation.run();
+    BasicBlock* loop = g.getBasicBlocks()[1];
+    Span<const EdgeMove> moves = allocation.getEdgeMoves(loop, loop);
+    ASSERT_EQ(moves.size(), 3u);
+    EXPECT_EQ(moves[0].dst.kind, Location::SCRATCH);
+    EXPECT_EQ(moves[2].src.kind, Location::SCRATCH);
+    EXPECT_EQ(allocation.getNumEdgeMoves(), 7u);
+    for (int64_t arg = -2; arg <= 7; ++arg) {
+        int64_t expected = arg < 0 ? -1 : arg % 2 == 0 ? 12 : 21;
+        EXPECT_EQ(runAllocated(g, allocation, {arg}), expected) << "n = " << arg;
+    }
+}
+
+// From no registers at all to more than the programs need, with loops, irreducible cycles
+// and critical edges
+TEST(LinearScanSuite, RandomProgramsRunFromTheirLocations) {
+    unsigned spilled = 0;
+    unsigned evicted = 0;
+    for (uint32_t seed = 0; seed < 150; ++seed) {
+        Graph g("random");
+        buildRandomArithmeticProgram(g, 1 + seed % 30, 1 + seed % 6, seed);
+        DominatorTree dom_tree(&g);
+        dom_tree.run();
+        Mem2Reg(&g, dom_tree).run();
+        LoopInfo loops(&g, dom_tree);
+        loops.run();
+
+        for (unsigned num_registers : {0u, 2u, 5u, 12u}) {
+            LinearScan allocation(&g, num_registers);
+            allocation.run();
+            spilled += allocation.getNumSpilled();
+            evicted += allocation.getNumEvicted();
+            expectDisjointLocations(g, allocation);
+            // Every loop is one stretch of the layout
+            for (size_t i = 0; i < loops.getNumLoops(); ++i) {
+                unsigned from = LinearScan::kNoPosition;
+                unsigned to = 0;
+                unsigned length = 0;
+                for (BasicBlock* bb : loops.getLoop(i)->getBlocks()) {
+                    from = std::min(from, allocation.getBlockStart(bb));
+                    to = std::max(to, allocation.getBlockEnd(bb));
+                    length += allocation.getBlockEnd(bb) - allocation.getBlockStart(bb);
+                }
+                ASSERT_EQ(to - from, length) << "seed " << seed;
+            }
+            for (const std::vector<int64_t>& args :
+                 {std::vector<int64_t>{int64_t(seed) - 100, 3}, {7, -2}}) {
+                ASSERT_EQ(runAllocated(g, allocation, args), evaluateIR(g, args))
+                    << "seed " << seed << ", " << num_registers << " registers";
+            }
+        }
+    }
+    EXPECT_GT(spilled, 0u);
+    EXPECT_GT(evicted, 0u);
+}
+
+TEST(CFGTraversalSuite, OrdersMatchRecursiveDFS) {
+    Graph g("Example 3");
+    BlockMap blocks = buildNewExample3(g);
+    BasicBlock* dead = g.createBB("dead");
+    g.createInst<JumpInst>(dead, blocks['A']);
+
+    CFGTraversal traversal(&g);
+    traversal.run();
+
+    auto names = [](const std::vector<BasicBlock*>& order) {
+        std::string result;
+        for (auto* bb : order) {
+            result += bb->getName();
+        }
+        return result;
+    };
+    EXPECT_EQ(names(traversal.getPreOrder()), "ABCDGIEFH");
+    EXPECT_EQ(names(traversal.getPostOrder()), "IGDCHFEBA");
+    EXPECT_EQ(names(traversal.getReversePostOrder()), "ABEFHCDGI");
+    EXPECT_EQ(traversal.getRPONumber(blocks['E']), 2u);
+    EXPECT_FALSE(traversal.isReachable(dead));
+    EXPECT_EQ(traversal.getRPONumber(dead), CFGTraversal::kUnreachable);
+}
+
+TEST(CFGTraversalSuite, EdgeTableMatchesBlockLists) {
+    Graph g("Example 2");
+    BlockMap blocks = buildNewExample2(g);
+    g.buildPredecessors();
+
+    const CFGEdgeTable& edges = g.getEdgeTable();
+    ASSERT_EQ(edges.getNumBlocks(), g.getBasicBlocks().size());
+    EXPECT_EQ(edges.getNumEdges(), 13u);
+    for (auto* bb : g.getBasicBlocks()) {
+        auto succs = bb->getSuccessors();
+        auto table_succs = edges.getSuccessors(bb->getId());
+        ASSERT_EQ(succs.size(), table_succs.size());
+        for (size_t i = 0; i < succs.size(); ++i) {
+            EXPECT_EQ(succs[i]->getId(), table_succs[i]);
+        }
+        const auto& preds = bb->getPredecessors();
+        auto table_preds = edges.getPredecessors(bb->getId());
+        ASSERT_EQ(preds.size(), table_preds.size());
+        for (size_t i = 0; i < preds.size(); ++i) {
+            EXPECT_EQ(preds[i]->getId(), table_preds[i]);
+        }
+    }
+    auto b_preds = edges.getPredecessors(blocks['B']->getId());
+    ASSERT_EQ(b_preds.size(), 2u);
+    EXPECT_EQ(b_preds[0], blocks['A']->getId());
+    EXPECT_EQ(b_preds[1], blocks['H']->getId());
+    EXPECT_EQ(blocks['B']->getSuccessor(1), blocks['J']);
+    EXPECT_EQ(blocks['J']->getNumSuccessors(), 0u);
+}
+
+TEST(CFGTraversalSuite, MillionBlockChainDoesNotOverflowStack) {
+    const unsigned kNumBlocks = 1000000;
+    Graph g("chain");
+    std::vector<BasicBlock*> chain;
+    chain.reserve(kNumBlocks);
+    for (unsigned i = 0; i < kNumBlocks; ++i) {
+        chain.push_back(g.createBB());
+    }
+    g.setStartBlock(chain[0]);
+    for (unsigned i = 0; i + 1 < kNumBlocks; ++i) {
+        g.createInst<JumpInst>(chain[i], chain[i + 1]);
+    }
+    g.createInst<ReturnInst>(chain.back());
+    g.buildPredecessors();
+
+    CFGTraversal traversal(&g);
+    traversal.run();
+    ASSERT_EQ(traversal.getReversePostOrder().size(), kNumBlocks);
+    EXPECT_EQ(traversal.getPreOrder().back(), chain.back());
+    EXPECT_EQ(traversal.getPostOrder().front(), chain.back());
+    EXPECT_EQ(traversal.getReversePostOrder()[12345], chain[12345]);
+
+    DominatorTree dom_tree(&g);
+    dom_tree.run();
+    EXPECT_EQ(dom_tree.getImmediateDominator(chain.back()), chain[kNumBlocks - 2]);
+    EXPECT_EQ(dom_tree.getDepth(chain.back()), kNumBlocks - 1);
+    EXPECT_TRUE(dom_tree.dominates(chain[1], chain.back()));
+    EXPECT_FALSE(dom_tree.dominates(chain.back(), chain[1]));
+    EXPECT_EQ(dom_tree.findNearestCommonDominator(chain[999], chain[500000]), chain[999]);
+
+    DominatorTree semi_nca(&g, DomAlgorithm::SemiNCA);
+    semi_nca.run();
+    EXPECT_EQ(semi_nca.getImmediateDominator(chain.back()), chain[kNumBlocks - 2]);
+}
+
+static std::vector<Inst*> usersOf(const Inst* inst) {
+    std::vector<Inst*> users(inst->getUsers().begin(), inst->getUsers().end());
+    std::sort(users.begin(), users.end(),
+              [](Inst* a, Inst* b) { return a->getId() < b->getId(); });
+    return users;
+}
+
+TEST(DefUseSuite, ConstructorsRegisterUsers) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+
+    EXPECT_EQ(usersOf(f.i_phi), (std::vector<Inst*>{f.cmp, f.res_new, f.i_new}));
+    EXPECT_EQ(usersOf(f.res_phi), (std::vector<Inst*>{f.res_new, f.ret}));
+    EXPECT_EQ(usersOf(f.res_new), (std::vector<Inst*>{f.res_phi}));
+    EXPECT_EQ(usersOf(f.cmp).size(), 1u);
+    EXPECT_EQ(usersOf(f.cmp)[0]->getOpcode(), Opcode::COND_JUMP);
+    EXPECT_EQ(f.n->getNumUses(), 1u);
+    EXPECT_FALSE(f.ret->hasUses());
+}
+
+TEST(DefUseSuite, SetOperandAndReplaceAllUsesWith) {
+    Graph g("factorial");
+    FactorialIR f = buildFactorial(g);
+
+    f.i_new->setOperand(1, f.n);
+    EXPECT_FALSE(f.const_1->hasUses());
+    EXPECT_EQ(f.i_new->getOperand(1), f.n);
+    EXPECT_EQ(usersOf(f.n), (std::vector<Inst*>{f.cmp, f.i_new}));
+
+    f.i_phi->replaceAllUsesWith(f.n);
+    EXPECT_FALSE(f.i_phi->hasUses());
+    EXPECT_EQ(f.n->getNumUses(), 5u);
+    EXPECT_EQ(f.cmp->getOperand(0), f.n);
+    EXPECT_EQ(f.res_new->getOperand(1), f.n);
+    EXPECT_EQ(f.i_new->getOperand(0), f.n);
+
+    f.res_new->dropAllReferences();
+    EXPECT_EQ(f.res_new->getOperand(0), nullptr);
+    EXPECT_EQ(usersOf(f.res_phi), (std::vector<Inst*>{f.ret}));
+}
+
+TEST(DefUseSuite, UseListsSurviveOperandRelocation) {
+    Graph g("phi");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* merge = g.createBB("merge");
+    g.setStartBlock(entry);
+    Inst* a = g.createInst<ConstInst>(entry, 1);
+    Inst* b = g.createInst<ConstInst>(entry, 2);
+    PhiInst* phi = g.createInst<PhiInst>(merge);
+    for (int i = 0; i < 50; ++i) {
+        phi->addIncoming(i % 3 == 0 ? b : a, entry);
+    }
+    EXPECT_EQ(a->getNumUses(), 33u);
+    EXPECT_EQ(b->getNumUses(), 17u);
+    for (Use* use = a->getFirstUse(); use; use = use->getNext()) {
+        EXPECT_EQ(use->get(), a);
+        EXPECT_EQ(use->getUser(), phi);
+    }
+
+    a->replaceAllUsesWith(b);
+    EXPECT_EQ(b->getNumUses(), 50u);
+    for (Inst* input : phi->getInputs()) {
+        EXPECT_EQ(input, b);
+    }
+}
+
+TEST(ArenaSuite, AllocationsAreAlignedAndOversizedRequestsSucceed) {
+    Arena arena;
+    auto* small = arena.allocateArray<char>(3);
+    auto* aligned = arena.allocateArray<int64_t>(5);
+    EXPECT_NE(small, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignof(int64_t), 0u);
+
+    auto* huge = arena.allocateArray<char>(4 * Arena::kMaxSlabSize);
+    huge[4 * Arena::kMaxSlabSize - 1] = 'x';
+    // The oversized slab must not steal the current slab from small allocations
+    auto* after = arena.allocateArray<char>(1);
+    EXPECT_GT(after, small);
+    EXPECT_LT(after, small + Arena::kInitialSlabSize);
+}
+
+TEST(ArenaSuite, PhiOperandsGrowInGraphArena) {
+    Graph g("phi");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* merge = g.createBB("merge");
+    g.setStartBlock(entry);
+
+    PhiInst* phi = g.createInst<PhiInst>(merge);
+    std::vector<Inst*> values;
+    for (int i = 0; i < 37; ++i) {
+        values.push_back(g.createInst<ConstInst>(entry, i));
+        phi->addIncoming(values.back(), entry);
+    }
+
+    ASSERT_EQ(phi->getNumIncoming(), 37u);
+    ASSERT_EQ(phi->getInputs().size(), 37u);
+    unsigned i = 0;
+    for (auto [value, pred] : phi->getIncoming()) {
+        EXPECT_EQ(value, values[i]);
+        EXPECT_EQ(phi->getInputs()[i], values[i]);
+        EXPECT_EQ(pred, entry);
+        ++i;
+    }
+    EXPECT_EQ(entry->getInstructions().size(), 37u);
+    EXPECT_EQ(phi->getParent(), merge);
+    EXPECT_EQ(g.getInst(phi->getId()), phi);
+    EXPECT_EQ(g.getNumInsts(), 38u);
+}
+
+// Passes build phis before placing them, so an unplaced phi must grow as well
+TEST(ArenaSuite, UnplacedPhiGrowsInGraphArena) {
+    Graph g("phi");
+    BasicBlock* entry = g.createBB("entry");
+    BasicBlock* merge = g.createBB("merge");
+    g.setStartBlock(entry);
+
+    PhiInst* phi = g.createInst<PhiInst>(nullptr);
+    std::vector<Inst*> values;
+    for (int i = 0; i < 5; ++i) {
+        values.push_back(g.createInst<ConstInst>(entry, i));
+        phi->addIncoming(values.back(), entry);
+    }
+    EXPECT_EQ(phi->getParent(), nullptr);
+    Inst* placed = phi;
+    merge->insertInstructions(0, Span<Inst* const>(&placed, 1));
+
+    ASSERT_EQ(phi->getNumIncoming(), 5u);
+    for (unsigned i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(phi->getInputs()[i], values[i]);
+        EXPECT_EQ(phi->getIncomingBlock(i), entry);
+        EXPECT_EQ(values[i]->getNumUses(), 1u);
+    }
+    EXPECT_EQ(phi->getParent(), merge);
+}
+
+TEST(ArenaSuite, ResetKeepsTheCurrentSlab) {
+    Arena arena;
+    for (int i = 0; i < 100; ++i) {
+        arena.allocateArray<char>(Arena::kInitialSlabSize);
+    }
+    size_t num_slabs = arena.getNumSlabs();
+    ASSERT_GT(num_slabs, 1u);
+    arena.reset();
+    EXPECT_EQ(arena.getNumSlabs(), 1u);
+    size_t reserved = arena.getBytesReserved();
+    // The kept slab is the largest one, so the same small workload fits again
+    char* first = arena.allocateArray<char>(16);
+    for (int i = 0; i < 10; ++i) {
+        arena.allocateArray<char>(Arena::kInitialSlabSize)[0] = 'x';
+    }
+    EXPECT_EQ(arena.getNumSlabs(), 1u);
+    EXPECT_EQ(arena.getBytesReserved(), reserved);
+    arena.reset();
+    EXPECT_EQ(arena.allocateArray<char>(16), first);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);